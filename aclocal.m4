@@ -274,6 +274,11 @@ AC_DEFUN([AC_SYBASE_ASE], [
 		# Assume this is a FreeTDS build
 		#
 			SYBASE_VERSION="FreeTDS"
+			#
+			# FreeTDS has no separate reentrant libraries, it is
+			# taken to have been built thread safe (the default).
+			#
+			SYBASE_THREADED="$with_threaded"
 			if [[ "$ac_cv_bit_mode" = "64" -a -f $SYBASE_OCOS/lib64/libct.so ]]; then
 				SYBASE_LIBDIR="$SYBASE_OCOS/lib64"
 			else
@@ -308,6 +313,7 @@ AC_DEFUN([AC_SYBASE_ASE], [
 			fi
 
 			SYBASE_LIBS=
+			SYBASE_THREADED=
 
 			case "${host_os}" in
 				*cygwin)
@@ -348,6 +354,19 @@ AC_DEFUN([AC_SYBASE_ASE], [
 					for i in $libtst
 					do
 						x=
+						#
+						# With --with-threaded use the reentrant variant
+						# (libsybct_r.so, libsybct_r64.so) where there is one.
+						#
+						if [[ "$with_threaded" = "yes" ]]; then
+							case "$i" in
+								*64) ri=`echo $i | sed 's/64$/_r64/'`;;
+								*)   ri="${i}_r";;
+							esac
+							if [[ -f $SYBASE_LIBDIR/lib${ri}.a -o -f $SYBASE_LIBDIR/lib${ri}.so ]]; then
+								i=$ri
+							fi
+						fi
 						if [[ -f $SYBASE_LIBDIR/lib${i}.a -o -f $SYBASE_LIBDIR/lib${i}.so ]]; then
 							if [[ "$with_static" = "yes" -a -f $SYBASE_LIBDIR/lib${i}.a ]]; then
 								x="$SYBASE_LIBDIR/lib${i}.a"
@@ -359,6 +378,10 @@ AC_DEFUN([AC_SYBASE_ASE], [
 							SYBASE_LIBS="$SYBASE_LIBS $x"
 						fi
 					done
+
+					case "$SYBASE_LIBS" in
+						*ct_r*) SYBASE_THREADED="yes";;
+					esac
 					;;
 			esac
 		fi
@@ -406,5 +429,6 @@ AC_DEFUN([AC_SYBASE_ASE], [
 	AC_SUBST(SYBASE_LIBS)
 	AC_SUBST(SYBASE_OCOS)
 	AC_SUBST(SYBASE_OS)
+	AC_SUBST(SYBASE_THREADED)
 ])
 
@@ -60,6 +60,7 @@ int  cmd_rpc        _ANSI_ARGS(( int, char** )) ;
 int  cmd_clear      _ANSI_ARGS(( int, char** )) ;   /* sqsh-2.1.7 */
 int  cmd_reset      _ANSI_ARGS(( int, char** )) ;   /* Buffer commands */
 int  cmd_redraw     _ANSI_ARGS(( int, char** )) ;
+int  cmd_redisplay  _ANSI_ARGS(( int, char** )) ;   /* sqsh-3.0 */
 int  cmd_history    _ANSI_ARGS(( int, char** )) ;
 int  cmd_hist_load  _ANSI_ARGS(( int, char** )) ;   /* sqsh-2.1.7 */
 int  cmd_hist_save  _ANSI_ARGS(( int, char** )) ;   /* sqsh-2.1.7 */
@@ -147,6 +148,7 @@ static cmd_entry_t  sg_cmd_entry[] = {
 	{ "\\alias",     NULL,          cmd_alias        },
 	{ "\\unalias",   NULL,          cmd_unalias      },
 	{ "\\redraw",    NULL,          cmd_redraw       },
+	{ "\\redisplay", NULL,          cmd_redisplay    }, /* sqsh-3.0 */
 	{ "\\history",   NULL,          cmd_history      },
 	{ "\\hist-load", NULL,          cmd_hist_load    }, /* sqsh-2.1.7 */
 	{ "\\hist-save", NULL,          cmd_hist_save    }, /* sqsh-2.1.7 */
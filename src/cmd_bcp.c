@@ -35,8 +35,26 @@
 #include "sqsh_env.h"
 #include "sqsh_cmd.h"
 #include "sqsh_sig.h"
+#include "sqsh_fork.h"
+#include "sqsh_sigcld.h"
+#include "sqsh_init.h"
 #include "cmd.h"
+#include "dsp.h"
 
+#if defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*-- Current Version --*/
 #if !defined(lint) && !defined(__LINT__)
@@ -72,6 +90,21 @@ static int sg_error        = False;
  */
 static CS_CONNECTION *sg_bcp_connection = NULL;
 
+/*
+ * sqsh-3.0 - sg_stream_fd: In each of the processes of a \bcp -p this
+ *      is the pipe through which it reports back to sqsh, -1 anywhere
+ *      else.  sg_stream_start is when the stream got going.
+ */
+static int            sg_stream_fd = -1;
+static struct timeval sg_stream_start;
+
+/*
+ * sqsh-3.0 - The processes of a running \bcp -p, so that an interrupt
+ * can be passed on to them.
+ */
+static pid_t *sg_streams  = NULL;
+static int    sg_nstreams = 0;
+
 /*
  * The following are used during debugging to convert an internal
  * sybase id (such as a bind-type and a data type) to a readable
@@ -89,36 +122,166 @@ typedef struct idname_st {
 
 #endif /* DEBUG */
 
+/*
+ * sqsh-3.0 - bcp_file_t: A delimited file read with \bcp -f, in place
+ *            of the result sets of the SQL buffer.  The whole file is
+ *            mapped into memory (or, failing that, read into it) and
+ *            the fields are converted straight from there.
+ */
+typedef struct _bcp_file_t {
+    char       *f_name;        /* As given with -f */
+    char       *f_map;         /* Contents of the file */
+    long        f_len;         /* Length of f_map */
+    int         f_mapped;      /* f_map came from mmap() */
+    long        f_pos;         /* Offset of the next row */
+    long        f_line;        /* Number of the row last read, from 1 */
+    char       *f_fterm;       /* Field terminator */
+    int         f_flen;
+    char       *f_rterm;       /* Row terminator */
+    int         f_rlen;
+    int         f_nresults;    /* Times bcp_file_results() was called */
+    int         f_native;      /* Written by \bcp -o, see bcp_out() */
+    int         f_fd;          /* Native file read as it goes, or -1 */
+    CS_INT      f_ncols;       /* Columns of the native result set */
+    CS_INT      f_left;        /* Rows left in the native block, -1 at its end */
+    int         f_error;       /* Native file found to be cut short */
+} bcp_file_t;
+
+/*
+ * Largest TEXT, IMAGE, etc. value that \bcp -f takes, as the table
+ * only gives their maximum as 2GB.
+ */
+#define BCP_FILE_MAXTEXT   65536
+
+/*
+ * The start of a native file written by \bcp -o, followed by a CS_INT
+ * of BCP_NATIVE_ORDER as the machine that wrote it stores it, and the
+ * number of CS_INTs that describe each column of a result set.
+ */
+#define BCP_NATIVE_MAGIC     "SQSHBCP\001"
+#define BCP_NATIVE_MAGICLEN  8
+#define BCP_NATIVE_ORDER     0x01020304
+#define BCP_NATIVE_NFMT      8
+
 /*
  * bcp_col_t: This data structure represents a single column of data
  *            as it returns from the server.  Note that all data is
  *            fetched and sent in its native data type.
+ *
+ * sqsh-3.0: The column is bound to d_arraysize rows on both sides,
+ * ct_bind() and blk_bind() sharing the same buffers, so the length
+ * and NULL indicator of every row has its own place and no row ever
+ * needs binding again.
  */
 typedef struct _bcp_col_t {
-    CS_INT      c_colid;       /* Column number */
-    CS_DATAFMT  c_format;      /* Format for column */
-    CS_INT      c_len;         /* Length of current row */
-    CS_INT      c_prevlen;     /* Length of previous row */
-    CS_SMALLINT c_nullind;     /* Null indicator for current row */
-    CS_SMALLINT c_prevnullind; /* Null indicator for previous row */
-    CS_VOID    *c_data;        /* Data space for fetch and bind */
+    CS_INT       c_colid;      /* Column number */
+    CS_DATAFMT   c_format;     /* Format for column */
+    CS_DATAFMT   c_blkfmt;     /* Format as bound with blk_bind() */
+    CS_INT      *c_lens;       /* Length of each row of the block */
+    CS_SMALLINT *c_nullinds;   /* Null indicator of each row of the block */
+    CS_VOID     *c_data;       /* Data space for fetch and bind */
 } bcp_col_t;
 
 /*
- * bcp_data_t: Represents an entire row of data.
+ * bcp_data_t: Represents a block of rows of data.
  */
 typedef struct _bcp_data_t {
     CS_INT      d_type;        /* Result type */
     CS_INT      d_ncols;       /* Number of columns to fetch */
-    CS_BOOL     d_bound;       /* Have we bound */
     bcp_col_t  *d_cols;        /* Array of columns */
+    CS_INT      d_arraysize;   /* Rows bound per ct_fetch() */
+    CS_INT      d_nrows;       /* Rows in the current block */
+    CS_INT      d_next;        /* First row of the block not yet sent */
+    CS_INT      d_blkrow;      /* Row blk_bind() was pointed at, -1 if none */
+    CS_BOOL     d_rowfail;     /* Block was cut short by a failed row */
+    bcp_file_t *d_file;        /* Rows come from here, not ct_fetch() */
 } bcp_data_t;
 
+#if defined(HAVE_PTHREAD_H)
+/*
+ * bcp_pipe_t: With -q the rows of a result set are fetched by a thread
+ *             of their own into a ring of p_nblocks blocks, while the
+ *             blocks fetched so far are sent from the ring's head, so
+ *             that neither connection waits on the other.
+ */
+typedef struct _bcp_pipe_t {
+    pthread_t        p_thread;
+    pthread_mutex_t  p_lock;
+    pthread_cond_t   p_cond;     /* Signalled when p_count changes */
+    CS_COMMAND      *p_cmd;      /* Command the rows are fetched from */
+    bcp_data_t     **p_blocks;   /* Ring of blocks, the first the caller's */
+    int              p_nblocks;
+    int              p_head;     /* Next block to be sent */
+    int              p_count;    /* Blocks fetched and not yet sent */
+    bcp_data_t      *p_sending;  /* Block blk_bind() last pointed into */
+    CS_RETCODE       p_end;      /* What ended the fetching */
+    int              p_done;     /* Fetcher has stopped */
+    int              p_stop;     /* Tells the fetcher to stop */
+} bcp_pipe_t;
+
+/*
+ * sg_bcp_pipe: The pipe that is fetching, if any, so the signal
+ *      handler doesn't pull the result set out from under it.
+ */
+static bcp_pipe_t *sg_bcp_pipe = NULL;
+#endif /* HAVE_PTHREAD_H */
+
+/*
+ * bcp_slice_t: The part of the source a \bcp -p stream copies, as
+ *              handed to its SQL in $bcp_key or $bcp_lo and $bcp_hi.
+ */
+typedef struct _bcp_slice_t {
+    char       *s_key;         /* One of the values given with -K */
+    long        s_lo;          /* Lowest key of a -K lo:hi range */
+    long        s_hi;          /* Highest key of a -K lo:hi range */
+} bcp_slice_t;
+
+/*
+ * bcp_stream_t: What each \bcp -p stream sends back once it is done.
+ */
+typedef struct _bcp_stream_t {
+    int         s_status;      /* CMD_RESETBUF, CMD_FAIL or CMD_INTERRUPTED */
+    int         s_rows;        /* Rows copied (and committed) */
+    double      s_secs;        /* Seconds from connecting to finishing */
+} bcp_stream_t;
+
 /*-- Prototypes --*/
 static void        bcp_signal       _ANSI_ARGS(( int, void* ));
-static bcp_data_t* bcp_data_bind    _ANSI_ARGS(( CS_COMMAND*, CS_INT ));
-static CS_INT      bcp_data_xfer    _ANSI_ARGS(( bcp_data_t*, CS_COMMAND*, CS_BLKDESC* ));
+static int         bcp_streams      _ANSI_ARGS(( int, char*, int* ));
+static int         bcp_stream_vars  _ANSI_ARGS(( int, int, bcp_slice_t*, int ));
+static void        bcp_stream_exit  _ANSI_ARGS(( int, int ));
+static void        bcp_streams_signal _ANSI_ARGS(( int, void* ));
+static bcp_data_t* bcp_data_bind    _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_INT ));
+static CS_RETCODE  bcp_data_alloc   _ANSI_ARGS(( bcp_data_t*, CS_INT ));
+static CS_RETCODE  bcp_data_ctbind  _ANSI_ARGS(( bcp_data_t*, CS_COMMAND* ));
+static CS_INT      bcp_data_xfer    _ANSI_ARGS(( bcp_data_t*, CS_COMMAND*, CS_BLKDESC*, CS_INT, CS_INT* ));
+static CS_RETCODE  bcp_data_fetch   _ANSI_ARGS(( bcp_data_t*, CS_COMMAND* ));
+static CS_INT      bcp_data_send    _ANSI_ARGS(( bcp_data_t*, CS_BLKDESC*, CS_INT, CS_INT* ));
+static CS_RETCODE  bcp_data_blkbind _ANSI_ARGS(( bcp_data_t*, CS_BLKDESC*, CS_INT ));
+static bcp_file_t* bcp_file_open    _ANSI_ARGS(( char*, char*, char* ));
+static CS_RETCODE  bcp_file_results _ANSI_ARGS(( bcp_file_t*, CS_INT* ));
+static bcp_data_t* bcp_file_bind    _ANSI_ARGS(( bcp_file_t*, CS_BLKDESC*, CS_INT ));
+static CS_RETCODE  bcp_file_fetch   _ANSI_ARGS(( bcp_data_t*, CS_INT* ));
+static CS_RETCODE  bcp_file_row     _ANSI_ARGS(( bcp_data_t*, CS_INT ));
+static char*       bcp_file_field   _ANSI_ARGS(( bcp_col_t*, CS_INT, char*, int ));
+static char*       bcp_file_scan    _ANSI_ARGS(( char*, char*, int, int ));
+static void        bcp_file_skip    _ANSI_ARGS(( bcp_file_t*, char* ));
+static int         bcp_file_term    _ANSI_ARGS(( char* ));
+static void        bcp_file_close   _ANSI_ARGS(( bcp_file_t* ));
+static long        bcp_file_read    _ANSI_ARGS(( bcp_file_t*, void*, long ));
+static CS_RETCODE  bcp_native_read  _ANSI_ARGS(( bcp_file_t*, void*, long ));
+static bcp_data_t* bcp_native_bind  _ANSI_ARGS(( bcp_file_t*, CS_INT ));
+static CS_RETCODE  bcp_native_fetch _ANSI_ARGS(( bcp_data_t*, CS_INT* ));
+static CS_RETCODE  bcp_out          _ANSI_ARGS(( CS_COMMAND*, char*, CS_INT, int, int* ));
+static CS_RETCODE  bcp_out_header   _ANSI_ARGS(( FILE*, bcp_data_t* ));
+static CS_RETCODE  bcp_out_block    _ANSI_ARGS(( FILE*, bcp_data_t*, char* ));
 static void        bcp_data_destroy _ANSI_ARGS(( bcp_data_t* ));
+#if defined(HAVE_PTHREAD_H)
+static bcp_pipe_t* bcp_pipe_create  _ANSI_ARGS(( bcp_data_t*, CS_COMMAND*, int ));
+static void*       bcp_pipe_fetcher _ANSI_ARGS(( void* ));
+static CS_INT      bcp_pipe_xfer    _ANSI_ARGS(( bcp_pipe_t*, CS_BLKDESC*, CS_INT, CS_INT* ));
+static void        bcp_pipe_destroy _ANSI_ARGS(( bcp_pipe_t* ));
+#endif /* HAVE_PTHREAD_H */
 static CS_RETCODE  bcp_server_cb
     _ANSI_ARGS(( CS_CONTEXT*, CS_CONNECTION*, CS_SERVERMSG* ))
 #if defined(__CYGWIN__)
@@ -164,7 +327,7 @@ int cmd_bcp( argc, argv )
     int               bcp_slicenum;  /* Partition number to bcp into */
     char             *cmd_sql;       /* SQL command to send to server */
     int               rows_in_batch; /* Rows processed in batch */
-    int               total_rows;    /* Total rows processing */
+    int               total_rows = 0; /* Total rows processing */
     struct timeval    tv_start;      /* Time we started processing */
     struct timeval    tv_end;        /* Time we finished processing */
     double            secs;          /* Seconds spend transferring data */
@@ -172,6 +335,7 @@ int cmd_bcp( argc, argv )
     CS_INT            result_type;   /* Result type coming from server */
     CS_INT            return_code;   /* Return code from ct_results() */
     CS_INT            nrows;         /* Rows transferred */
+    CS_INT            nsent;         /* Rows sent by bcp_data_xfer() */
     CS_BOOL           bcp_on = CS_TRUE; /* Flag to turn on bulk login */
     CS_INT            i;
     CS_INT            con_status;
@@ -187,6 +351,10 @@ int cmd_bcp( argc, argv )
     CS_LOCALE      *bcp_locale = NULL;  /* Locale for bcp connection */
     varbuf_t       *exp_buf    = NULL;  /* Variable expansion buffer */
     bcp_data_t     *bcp_dat    = NULL;  /* Bind data */
+    bcp_file_t     *bcp_file   = NULL;  /* Source file, with -f */
+#if defined(HAVE_PTHREAD_H)
+    bcp_pipe_t     *bcp_pipe   = NULL;  /* Fetching ahead, with -q */
+#endif
     CS_INT         blk_ver     = -1;    /* BLK_VERSION_xxx value to use */
 
 
@@ -200,6 +368,14 @@ int cmd_bcp( argc, argv )
      */
     int               maxerrors     = 10;   /* Errors before abort */
     int               batchsize     = -1;   /* Copy all rows in one batch */
+    int               arraysize     = g_dsp_props.p_fetch_rows; /* Rows per transfer */
+    int               nstreams      = 0;    /* Copy in one stream */
+    int               nahead        = 0;    /* Blocks fetched ahead (-q) */
+    char             *file_name     = NULL; /* Copy from this file (-f) */
+    char             *field_term    = "\\t";  /* Field terminator (-t) */
+    char             *row_term      = "\\n";  /* Row terminator (-r) */
+    char             *out_name      = NULL; /* Copy to this file (-o) */
+    char             *bcp_keys      = NULL; /* How to split the streams (-K) */
     int               have_error    = False;
     CS_BOOL           have_identity = CS_FALSE;
 #if defined (CS_NOCHARSETCNV_REQD) && defined (BLK_CONV)
@@ -229,7 +405,7 @@ int cmd_bcp( argc, argv )
     env_get( g_env, "hostname",   &hostname );
     env_get( g_env, "packet_size", &packet_size );
 
-    while ((opt = sqsh_getopt( argc, argv, "A:b:I:i:J:m:NP;S:TU:Xz:" )) != EOF)
+    while ((opt = sqsh_getopt( argc, argv, "A:b:f:I:i:J:K:m:No:P;p:q:R:r:S:Tt:U:Xz:" )) != EOF)
     {
         switch (opt)
         {
@@ -245,6 +421,10 @@ int cmd_bcp( argc, argv )
                 }
                 break;
 
+            case 'f' :
+                file_name = sqsh_optarg;
+                break;
+
             case 'I' :
                 if (env_set( g_env, "interfaces", sqsh_optarg ) == False)
                 {
@@ -261,6 +441,10 @@ int cmd_bcp( argc, argv )
                 charset = sqsh_optarg;
                 break;
 
+            case 'K' :
+                bcp_keys = sqsh_optarg;
+                break;
+
             case 'm':
                 if ((maxerrors = atoi(sqsh_optarg)) <= 0)
                 {
@@ -273,14 +457,71 @@ int cmd_bcp( argc, argv )
                 have_identity = CS_TRUE;
                 break;
 
+            case 'o' :
+                out_name = sqsh_optarg;
+                break;
+
             case 'P' :
                 password = sqsh_optarg;
                 break;
 
+            case 'p':
+                /*
+                 * sqsh-3.0 - Number of concurrent streams.
+                 */
+                if ((nstreams = atoi(sqsh_optarg)) <= 0)
+                {
+                    fprintf(stderr, "\\bcp: -p: Invalid value '%s'\n", sqsh_optarg);
+                    return CMD_FAIL;
+                }
+                break;
+
+            case 'q':
+                /*
+                 * sqsh-3.0 - Blocks fetched ahead of those being sent.
+                 */
+                if ((nahead = atoi(sqsh_optarg)) <= 0 || nahead > 64)
+                {
+                    fprintf(stderr, "\\bcp: -q: Invalid value '%s' (between 1 and 64 allowed)\n",
+                        sqsh_optarg);
+                    return CMD_FAIL;
+                }
+#if !defined(HAVE_PTHREAD_H) || !defined(CTLIB_THREADED)
+                /*
+                 * Both connections are used at once from two threads,
+                 * which the regular Client-Library can't take.
+                 */
+                fprintf(stderr, "\\bcp: -q: sqsh was not built with a thread safe Client-Library\n");
+                fprintf(stderr, "\\bcp: -q: (see configure --with-threaded)\n");
+                return CMD_FAIL;
+#endif
+                break;
+
+            case 'R':
+                /*
+                 * sqsh-3.0 - Rows fetched and sent per transfer.
+                 */
+                if ((arraysize = atoi(sqsh_optarg)) <= 0 ||
+                    arraysize > DSP_FETCH_MAXROWS)
+                {
+                    fprintf(stderr, "\\bcp: -R: Invalid value '%s' (between 1 and %d allowed)\n",
+                        sqsh_optarg, DSP_FETCH_MAXROWS);
+                    return CMD_FAIL;
+                }
+                break;
+
+            case 'r' :
+                row_term = sqsh_optarg;
+                break;
+
             case 'S' :
                 server = sqsh_optarg;
                 break;
 
+            case 't' :
+                field_term = sqsh_optarg;
+                break;
+
             case 'T' :
 #if defined (CS_NOCHARSETCNV_REQD) && defined (BLK_CONV)
                 transit = CS_TRUE;
@@ -313,28 +554,78 @@ int cmd_bcp( argc, argv )
      * invalid argument was supplied, then print out usage
      * information.
      */
-    if ((argc - sqsh_optind) != 1 || have_error)
+    if ((argc - sqsh_optind) != ((out_name != NULL) ? 0 : 1) || have_error)
     {
         fprintf(stderr,
-           "Use: \\bcp [-A packsetsize] [-b batchsize] [-I interfaces] [-i initcmd]\n"
-           "          [-J charset] [-m maxerrors] [-N] [-P password]\n"
-           "          [-S server] [-T] [-U username] [-X] [-z language] table_name\n");
+           "Use: \\bcp [-A packsetsize] [-b batchsize] [-f file [-t fieldterm]\n"
+           "          [-r rowterm]] [-I interfaces] [-i initcmd] [-J charset]\n"
+           "          [-K lo:hi|key,...] [-m maxerrors] [-N] [-P password]\n"
+           "          [-p streams] [-q blocks] [-R rows] [-S server] [-T]\n"
+           "          [-U username] [-X] [-z language] table_name\n"
+           "     \\bcp [-m maxerrors] [-R rows] -o file\n");
+        return CMD_FAIL;
+    }
+
+    /*
+     * sqsh-3.0 - With -o there is nothing for these to apply to.
+     */
+    if (out_name != NULL &&
+        (file_name != NULL || init_cmd != NULL || nstreams > 0 ||
+         bcp_keys != NULL || nahead > 0))
+    {
+        fprintf( stderr, "\\bcp: -o cannot be used with -f, -i, -p, -K or -q\n" );
+        return CMD_FAIL;
+    }
+
+    /*
+     * sqsh-3.0 - The file is read by a single stream, on this thread.
+     */
+    if (file_name != NULL && (nstreams > 0 || bcp_keys != NULL || nahead > 0))
+    {
+        fprintf( stderr, "\\bcp: -f cannot be used with -p, -K or -q\n" );
         return CMD_FAIL;
     }
 
+    /*
+     * sqsh-3.0 - With -p (or -K) the copy is split into streams, each
+     * a process of its own that carries on from here over connections
+     * of its own, while this one waits for them and reports.
+     */
+    if (nstreams > 0 || bcp_keys != NULL)
+    {
+        /*
+         * Each stream runs init_cmd (if any) on the bulk login of its
+         * own, just as a single \bcp does, further down.
+         */
+        if (bcp_streams( nstreams, bcp_keys, &return_code ) == False)
+            return return_code;
+    }
+
     /*
      * Keep around a handy pointer.
      */
-    bcp_table = argv[sqsh_optind];
+    bcp_table     = (out_name != NULL) ? NULL : argv[sqsh_optind];
+    bcp_partition = NULL;
 
     /*
      * sqsh-2.2.0 - Feature enable BCP_IN into a specific partition of a partitioned table
      */
-    if ((bcp_partition = strchr(bcp_table, (int) ':')) != NULL)
+    if (bcp_table != NULL &&
+        (bcp_partition = strchr(bcp_table, (int) ':')) != NULL)
     {
         *bcp_partition++ = '\0';
     }
 
+    /*
+     * sqsh-3.0 - With -f the rows come from a file rather than from
+     * the SQL buffer, which is left alone.
+     */
+    if (file_name != NULL &&
+        (bcp_file = bcp_file_open( file_name, field_term, row_term )) == NULL)
+    {
+        return CMD_FAIL;
+    }
+
     /*
      * Now, install our signal handlers.  At this point, all code should
      * perform a goto {return_fail or return_interrupt} to return an error
@@ -354,7 +645,11 @@ int cmd_bcp( argc, argv )
      * remote database (that we are bcp'ing too), lets launch our
      * query and see if it is valid.
      */
-    if (expand == NULL || *expand != '0')
+    if (bcp_file != NULL)
+    {
+        cmd_sql = NULL;
+    }
+    else if (expand == NULL || *expand != '0')
     {
         /*
          * Temporarily create a buffer in which to store the expanded
@@ -386,7 +681,7 @@ int cmd_bcp( argc, argv )
     total_rows = 0;
 
     /*-- Allocate a new command structure --*/
-    if (ct_cmd_alloc( g_connection, &bcp_cmd ) != CS_SUCCEED)
+    if (bcp_file == NULL && ct_cmd_alloc( g_connection, &bcp_cmd ) != CS_SUCCEED)
     {
         fprintf( stderr, "\\bcp: Unable to allocate new command\n" );
         goto return_fail;
@@ -465,7 +760,8 @@ int cmd_bcp( argc, argv )
 	blk_ver = BLK_VERSION_100;
 
     /*-- Initialize the command --*/
-    if (ct_command( bcp_cmd,                /* Command */
+    if (bcp_file == NULL &&
+        ct_command( bcp_cmd,                /* Command */
                     CS_LANG_CMD,            /* Type */
                     (CS_VOID*)cmd_sql,      /* Buffer */
                     CS_NULLTERM,            /* Buffer Length */
@@ -479,7 +775,7 @@ int cmd_bcp( argc, argv )
     g_p2fc = 0;
 
     /*-- Send command to server --*/
-    if (ct_send( bcp_cmd ) != CS_SUCCEED)
+    if (bcp_file == NULL && ct_send( bcp_cmd ) != CS_SUCCEED)
     {
         fprintf( stderr, "\\bcp: Unable to send command to SQL Server\n" );
         goto return_fail;
@@ -488,6 +784,26 @@ int cmd_bcp( argc, argv )
     if (sg_interrupted)
         goto return_interrupt;
 
+    /*
+     * sqsh-3.0 - With -o the result sets go to a file, rather than to
+     * a server that we would have to connect to.
+     */
+    if (out_name != NULL)
+    {
+        fprintf(stderr, "\nStarting copy...\n" );
+        rows_in_batch = 0;
+
+        switch (bcp_out( bcp_cmd, out_name, arraysize, maxerrors, &total_rows ))
+        {
+            case CS_SUCCEED:
+                goto report;
+            case CS_CANCELED:
+                goto return_interrupt;
+            default:
+                goto return_fail;
+        }
+    }
+
     /*
      * If we have reached this point, then everything looks like it
      * went OK, so it is now time to create a new connection to the
@@ -956,7 +1272,8 @@ int cmd_bcp( argc, argv )
         goto return_fail;
     }
 
-    fprintf(stderr, "\nStarting copy...\n" );
+    if (sg_stream_fd == -1)
+        fprintf(stderr, "\nStarting copy...\n" );
 
     /*
      * Allrightythen.  We have already sent the command to retrieve
@@ -967,7 +1284,9 @@ int cmd_bcp( argc, argv )
     rows_in_batch = 0;
     nerrors  = 0;
 
-    while ((return_code = ct_results( bcp_cmd, &result_type ))
+    while ((return_code = (bcp_file != NULL) ?
+                bcp_file_results( bcp_file, &result_type ) :
+                ct_results( bcp_cmd, &result_type ))
         != CS_END_RESULTS)
     {
         if (sg_interrupted)
@@ -984,20 +1303,48 @@ int cmd_bcp( argc, argv )
                 if (bcp_dat != NULL)
                 {
                     bcp_data_destroy( bcp_dat );
+                    bcp_dat = NULL;
                 }
 
                 /*-- Create new data --*/
-                if ((bcp_dat = bcp_data_bind( bcp_cmd, result_type )) == NULL)
+                if ((bcp_dat = (bcp_file != NULL) ?
+                        bcp_file_bind( bcp_file, bcp_desc, arraysize ) :
+                        bcp_data_bind( bcp_cmd, result_type, arraysize )) == NULL)
+                    goto return_fail;
+
+#if defined(HAVE_PTHREAD_H)
+                /*
+                 * sqsh-3.0: With -q the rows are fetched by a thread of
+                 * their own while the ones before them are being sent.
+                 */
+                if (nahead > 0 &&
+                    (bcp_pipe = bcp_pipe_create( bcp_dat, bcp_cmd, nahead )) == NULL)
                     goto return_fail;
+#endif
 
+                /*
+                 * sqsh-3.0: Rows go across a block at a time, but never
+                 * more than are left to fill the current batch.
+                 */
                 while ((return_code =
+#if defined(HAVE_PTHREAD_H)
+                        (bcp_pipe != NULL) ?
+                        bcp_pipe_xfer( bcp_pipe,
+                                       bcp_desc,
+                                       (batchsize > 0) ? batchsize - rows_in_batch : -1,
+                                       &nsent ) :
+#endif
                         bcp_data_xfer( bcp_dat,
-                                            bcp_cmd,
-                                         bcp_desc )) != CS_END_DATA)
+                                       bcp_cmd,
+                                       bcp_desc,
+                                       (batchsize > 0) ? batchsize - rows_in_batch : -1,
+                                       &nsent )) != CS_END_DATA)
                 {
                     if (sg_interrupted)
                         goto return_interrupt;
 
+                    rows_in_batch += nsent;
+
                     if (return_code != CS_SUCCEED)
                     {
                         DBG(sqsh_debug(DEBUG_BCP, "bcp: bcp_data_xfer failed...\n");)
@@ -1005,10 +1352,6 @@ int cmd_bcp( argc, argv )
                         if (++nerrors == maxerrors)
                             goto return_fail;
                     }
-                    else
-                    {
-                        ++rows_in_batch;
-                    }
 
                     if (rows_in_batch == batchsize)
                     {
@@ -1037,6 +1380,15 @@ int cmd_bcp( argc, argv )
                         rows_in_batch = 0;
                     }
                 } /* while (bcp_data_xfer()) */
+
+#if defined(HAVE_PTHREAD_H)
+                /*-- The next ct_results() is ours again --*/
+                if (bcp_pipe != NULL)
+                {
+                    bcp_pipe_destroy( bcp_pipe );
+                    bcp_pipe = NULL;
+                }
+#endif
                 break;
 
             case CS_PARAM_RESULT:
@@ -1060,6 +1412,10 @@ int cmd_bcp( argc, argv )
 
     }
 
+    /*-- sqsh-3.0 - The last batch of a damaged native file is not committed --*/
+    if (bcp_file != NULL && bcp_file->f_error)
+        goto return_fail;
+
     if (rows_in_batch > 0)
     {
         DBG(sqsh_debug(DEBUG_BCP, "bcp: FINAL: blk_done(CS_BLK_BATCH)\n");)
@@ -1087,39 +1443,58 @@ int cmd_bcp( argc, argv )
                       &nrows ) != CS_SUCCEED)
         goto return_fail;
 
+report:
     gettimeofday( &tv_end, NULL );
 
     if (rows_in_batch != 0)
         fprintf(stderr,"Batch successfully bulk-copied to SQL Server\n");
 
-    fprintf( stderr, "\n%d row%s copied.\n", total_rows,
-                (total_rows != 1) ? "s" : "" );
+    if (sg_stream_fd == -1)
+        fprintf( stderr, "\n%d row%s copied.\n", total_rows,
+                    (total_rows != 1) ? "s" : "" );
 
     /* add check for non-zero number of rows passed to avoid
        potential division by 0 error.
        patch by Onno van der Linden */
-    if(total_rows > 0) {
+    if(total_rows > 0 && sg_stream_fd == -1) {
         secs = ELAPSED_SEC(tv_start,tv_end);
         fprintf( stderr,
                  "Clock Time (sec.): Total = %-.4f  Avg = %-.4f (%.2f rows per sec.)\n",
                  secs, secs / (double)total_rows, (double)total_rows / secs );
     }
 
-    return_code = CMD_RESETBUF;
+    return_code = (bcp_file != NULL) ? CMD_LEAVEBUF : CMD_RESETBUF;
     goto leave;
 
 return_interrupt:
+#if defined(HAVE_PTHREAD_H)
+    if (bcp_pipe != NULL)
+    {
+        bcp_pipe_destroy( bcp_pipe );
+        bcp_pipe = NULL;
+    }
+#endif
     if (bcp_desc != NULL)
         blk_done( bcp_desc, CS_BLK_CANCEL, &nrows );
-    ct_cancel( bcp_con, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
-    ct_cancel( g_connection, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
+    if (bcp_con != NULL)
+        ct_cancel( bcp_con, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
+    if (bcp_file == NULL)
+        ct_cancel( g_connection, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
 
-    return_code = CMD_RESETBUF;
+    return_code = (bcp_file != NULL) ? CMD_LEAVEBUF : CMD_RESETBUF;
     goto leave;
 
 return_fail:
     DBG(sqsh_debug(DEBUG_ERROR, "bcp: Failure encountered, cleaning up.\n");)
 
+#if defined(HAVE_PTHREAD_H)
+    if (bcp_pipe != NULL)
+    {
+        bcp_pipe_destroy( bcp_pipe );
+        bcp_pipe = NULL;
+    }
+#endif
+
     if (bcp_con != NULL)
     {
         if (ct_con_props( bcp_con,                /* Connection */
@@ -1187,6 +1562,9 @@ leave:
     if (exp_buf != NULL)
         varbuf_destroy( exp_buf );
 
+    if (bcp_file != NULL)
+        bcp_file_close( bcp_file );
+
     if (bcp_cmd != NULL)
         ct_cmd_drop( bcp_cmd );
 
@@ -1210,12 +1588,18 @@ leave:
         cs_loc_drop( g_context, bcp_locale );
 
     sig_restore();
+
+    /*-- sqsh-3.0 - A \bcp -p stream is done at this point --*/
+    if (sg_stream_fd != -1)
+        bcp_stream_exit( return_code, total_rows );
+
     return return_code;
 }
 
-static bcp_data_t* bcp_data_bind ( cmd, result_type )
+static bcp_data_t* bcp_data_bind ( cmd, result_type, arraysize )
     CS_COMMAND    *cmd;
     CS_INT         result_type;
+    CS_INT         arraysize;
 {
     CS_INT        ncols;
     CS_INT        i;
@@ -1248,19 +1632,20 @@ static bcp_data_t* bcp_data_bind ( cmd, result_type )
     }
 
     /*-- Inialize d --*/
-    d->d_type  = result_type;
-    d->d_ncols = ncols;
-    d->d_cols  = c;
-
-    for (i = 0; i < ncols; i++)
-        d->d_cols[i].c_data = NULL;
+    d->d_type      = result_type;
+    d->d_ncols     = ncols;
+    d->d_cols      = c;
+    d->d_arraysize = 1;
+    d->d_nrows     = 0;
+    d->d_next      = 0;
+    d->d_blkrow    = -1;
+    d->d_rowfail   = CS_FALSE;
+    d->d_file      = NULL;
 
     for (i = 0; i < ncols; i++)
     {
         c = &d->d_cols[i];
-        c->c_colid   = i + 1;
-        c->c_len     = -1;
-        c->c_nullind = 0;
+        c->c_colid = i + 1;
 
         /*-- Get description for column --*/
         if (ct_describe( cmd, i+1, &c->c_format ) != CS_SUCCEED)
@@ -1271,132 +1656,2195 @@ static bcp_data_t* bcp_data_bind ( cmd, result_type )
             bcp_data_destroy( d );
             return NULL;
         }
+    }
+
+    if (bcp_data_alloc( d, arraysize ) != CS_SUCCEED ||
+        bcp_data_ctbind( d, cmd ) != CS_SUCCEED)
+    {
+        bcp_data_destroy( d );
+        return NULL;
+    }
+
+    return d;
+}
+
+/*
+ * bcp_data_alloc():
+ *
+ * sqsh-3.0: Allocates the buffers for arraysize rows of the columns
+ * of d, as described by their c_format.
+ */
+static CS_RETCODE bcp_data_alloc( d, arraysize )
+    bcp_data_t  *d;
+    CS_INT       arraysize;
+{
+    size_t        rowsize;
+    CS_INT        i;
+    bcp_col_t    *c;
+
+    rowsize = 0;
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        rowsize += (size_t)d->d_cols[i].c_format.maxlength +
+                   sizeof(CS_INT) + sizeof(CS_SMALLINT);
+    }
+
+    /*
+     * sqsh-3.0: As in dsp_desc_bind(), the block is trimmed to keep
+     * the bound buffers within DSP_FETCH_MAXMEM, so a table with a
+     * wide TEXT column falls back to fewer rows per transfer.
+     */
+    arraysize      = dsp_fetch_rows( arraysize, rowsize );
+    d->d_arraysize = arraysize;
+
+    DBG(sqsh_debug(DEBUG_BCP, "bcp: Binding %d row(s) of %lu byte(s) per transfer\n",
+        (int)arraysize, (unsigned long)rowsize);)
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        c = &d->d_cols[i];
 
         /*-- Allocate enough space to hold data --*/
         /*-- Fix for bug report 2920048, using calloc instead of malloc --*/
-        c->c_data = (CS_VOID*)calloc( 1, c->c_format.maxlength );
+        c->c_data     = (CS_VOID*)calloc( arraysize, max( c->c_format.maxlength, 1 ) );
+        c->c_lens     = (CS_INT*)calloc( arraysize, sizeof(CS_INT) );
+        c->c_nullinds = (CS_SMALLINT*)calloc( arraysize, sizeof(CS_SMALLINT) );
+
+        if (c->c_data == NULL || c->c_lens == NULL || c->c_nullinds == NULL)
+        {
+            fprintf( stderr, "bcp_data_bind: Memory allocation failure.\n" );
+            return CS_FAIL;
+        }
 
         /*-- Clean up format --*/
-        c->c_format.count  = 1;
+        c->c_format.count  = arraysize;
         c->c_format.locale = NULL;
+        c->c_blkfmt        = c->c_format;
+    }
+
+    return CS_SUCCEED;
+}
+
+/*
+ * bcp_data_ctbind():
+ *
+ * sqsh-3.0: Binds the columns of the result set to the buffers of d,
+ * which is done again whenever the rows are to be fetched into the
+ * buffers of another bcp_data_t (see bcp_pipe_fetcher()).
+ */
+static CS_RETCODE bcp_data_ctbind( d, cmd )
+    bcp_data_t  *d;
+    CS_COMMAND  *cmd;
+{
+    CS_INT      i;
+    bcp_col_t  *c;
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        c = &d->d_cols[i];
 
         /*-- Bind to the data space --*/
         if (ct_bind( cmd,                            /* Command */
                      i + 1,                          /* Item */
                      &c->c_format,                   /* Format */
                      (CS_VOID*)c->c_data,            /* Buffer */
-                     (CS_INT*)&c->c_len,             /* Data Copied */
-                     &c->c_nullind                   /* NULL Indicator */
+                     c->c_lens,                      /* Data Copied */
+                     c->c_nullinds                   /* NULL Indicator */
                    ) != CS_SUCCEED)
         {
             fprintf( stderr,
                 "bcp_data_bind: Unable to bind column %d\n",
                 (int) i+1 );
-            bcp_data_destroy( d );
-            return NULL;
+            return CS_FAIL;
         }
     }
 
-    return d;
+    return CS_SUCCEED;
 }
 
-static CS_INT bcp_data_xfer( d, cmd, blkdesc )
+/*
+ * bcp_data_xfer():
+ *
+ * sqsh-3.0: Sends the rows of the current block that haven't been
+ * sent yet, but no more than maxrows of them (-1 for no limit), with
+ * a single blk_rowxfer_mult(), fetching the next block first if they
+ * have all been sent.  The number of rows sent is returned in nsent.
+ * Returns CS_END_DATA once there are no more rows, and CS_ROW_FAIL
+ * (once the good rows ahead of it have been sent) for a row that
+ * could not be fetched.
+ */
+static CS_INT bcp_data_xfer( d, cmd, blkdesc, maxrows, nsent )
     bcp_data_t  *d;
     CS_COMMAND  *cmd;
     CS_BLKDESC  *blkdesc;
+    CS_INT       maxrows;
+    CS_INT      *nsent;
+{
+    CS_RETCODE  return_code;
+
+    *nsent = 0;
+
+    if (d->d_next >= d->d_nrows && d->d_rowfail == CS_FALSE)
+    {
+        return_code = bcp_data_fetch( d, cmd );
+
+        if (return_code != CS_SUCCEED && return_code != CS_ROW_FAIL)
+            return return_code;
+    }
+
+    return bcp_data_send( d, blkdesc, maxrows, nsent );
+}
+
+/*
+ * bcp_data_fetch():
+ *
+ * sqsh-3.0: Fetches the next block of rows into d, returning what
+ * ct_fetch() (or bcp_file_fetch(), with \bcp -f) did.  For
+ * CS_ROW_FAIL the rows ahead of the one that failed are kept, with
+ * d_rowfail set to report it once they have been sent.
+ */
+static CS_RETCODE bcp_data_fetch( d, cmd )
+    bcp_data_t  *d;
+    CS_COMMAND  *cmd;
 {
     CS_RETCODE  return_code;
     CS_INT      nrows;
     CS_INT      i;
+    CS_INT      r;
     bcp_col_t  *c;
 
-    return_code = ct_fetch( cmd,              /* Command */
-                            CS_UNUSED,        /* Type */
-                            CS_UNUSED,        /* Offset */
-                            CS_UNUSED,        /* Option */
-                            &nrows );
+    if (d->d_file != NULL)
+    {
+        return_code = bcp_file_fetch( d, &nrows );
+    }
+    else
+    {
+        return_code = ct_fetch( cmd,              /* Command */
+                                CS_UNUSED,        /* Type */
+                                CS_UNUSED,        /* Offset */
+                                CS_UNUSED,        /* Option */
+                                &nrows );
+    }
 
-    if (return_code != CS_SUCCEED)
+    /*
+     * The rows read include the one that failed, which is the
+     * last of them.
+     */
+    if (return_code == CS_ROW_FAIL)
+    {
+        d->d_rowfail = CS_TRUE;
+        nrows = max( nrows - 1, 0 );
+    }
+    else if (return_code != CS_SUCCEED)
     {
         return return_code;
     }
+    else if (nrows == 0)
+    {
+        d->d_rowfail = CS_TRUE;
+    }
+
+    d->d_nrows = nrows;
+    d->d_next  = 0;
 
+    /*
+     * A NULL goes across with no data.
+     */
     for (i = 0; i < d->d_ncols; i++)
     {
         c = &d->d_cols[i];
 
-        /*
-         * Here we determine whether or not we need to (re-) bind to
-         * the incoming data.  If the length of the data has changed
-         * since the last row, or if it has become NULL, then we
-         * want to re-bind.
-         */
-        if (c->c_len == -1 || c->c_len != c->c_prevlen ||
-            c->c_nullind != c->c_prevnullind)
+        for (r = 0; r < nrows; r++)
         {
-            DBG(sqsh_debug(DEBUG_BCP,
-                "bcp: blk_bind( %d, DATAFMT, %d, %d )\n",
-                (int)i + 1, (int)c->c_len, (int)c->c_nullind);)
+            if (c->c_nullinds[r] == -1)
+                c->c_lens[r] = 0;
+        }
+    }
 
-            if (c->c_nullind == -1)
-            {
-                c->c_len = 0;
-            }
+    return return_code;
+}
+
+/*
+ * bcp_data_send():
+ *
+ * sqsh-3.0: The sending half of bcp_data_xfer(), which returns
+ * CS_END_DATA when every row of the block has been sent.
+ */
+static CS_INT bcp_data_send( d, blkdesc, maxrows, nsent )
+    bcp_data_t  *d;
+    CS_BLKDESC  *blkdesc;
+    CS_INT       maxrows;
+    CS_INT      *nsent;
+{
+    CS_INT      nrows;
+    CS_INT      want;
 
-            c->c_prevlen     = c->c_len;
-            c->c_prevnullind = c->c_nullind;
+    *nsent = 0;
 
-            if (blk_bind( blkdesc,              /* Block Descriptor */
-                          i + 1,                /* Column Number */
-                          &c->c_format,         /* Data Format */
-                          (CS_VOID*)c->c_data,  /* Buffer */
-                          &c->c_len,            /* Buffer Length */
-                          &c->c_nullind ) != CS_SUCCEED)
-            {
-                fprintf( stderr,
-                    "bcp_data_xfer: Unable to bind results for column %d\n",
-                    (int) i+1 );
-                return CS_FAIL;
-            }
+    if (d->d_next >= d->d_nrows)
+    {
+        if (d->d_rowfail == CS_TRUE)
+        {
+            d->d_rowfail = CS_FALSE;
+            return CS_ROW_FAIL;
         }
+        return CS_END_DATA;
+    }
+
+    want = d->d_nrows - d->d_next;
+    if (maxrows > 0 && want > maxrows)
+    {
+        want = maxrows;
+    }
+
+    /*
+     * The block descriptor only has to be pointed elsewhere when a
+     * batch ended part way through the block.
+     */
+    if (d->d_blkrow != d->d_next &&
+        bcp_data_blkbind( d, blkdesc, d->d_next ) != CS_SUCCEED)
+    {
+        d->d_next = d->d_nrows;
+        return CS_FAIL;
     }
 
-    DBG(sqsh_debug(DEBUG_BCP, "bcp: blk_rowxfer()\n");)
-    if (blk_rowxfer( blkdesc ) != CS_SUCCEED)
+    nrows      = want;
+    d->d_next += want;
+
+    DBG(sqsh_debug(DEBUG_BCP, "bcp: blk_rowxfer_mult( %d )\n", (int)want);)
+    if (blk_rowxfer_mult( blkdesc, &nrows ) != CS_SUCCEED)
     {
         fprintf( stderr,
-            "bcp_data_xfer: Unable to transfer row to remote SQL Server\n" );
+            "bcp_data_xfer: Unable to transfer rows to remote SQL Server\n" );
+        *nsent = min( max( nrows, 0 ), want );
         return CS_FAIL;
     }
 
+    *nsent = nrows;
     return CS_SUCCEED;
 }
 
 /*
- * bcp_data_destroy():
+ * bcp_data_blkbind():
  *
- * Destroys a bcp_data_t structure.
+ * Binds every column of the block descriptor to the rows of the
+ * block from row on.
  */
-static void bcp_data_destroy( d )
-    bcp_data_t   *d;
+static CS_RETCODE bcp_data_blkbind( d, blkdesc, row )
+    bcp_data_t  *d;
+    CS_BLKDESC  *blkdesc;
+    CS_INT       row;
+{
+    CS_INT      i;
+    bcp_col_t  *c;
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        c = &d->d_cols[i];
+
+        DBG(sqsh_debug(DEBUG_BCP,
+            "bcp: blk_bind( %d, DATAFMT, row %d, %d rows )\n",
+            (int)i + 1, (int)row, (int)(d->d_arraysize - row));)
+
+        c->c_blkfmt.count = d->d_arraysize - row;
+
+        if (blk_bind( blkdesc,                  /* Block Descriptor */
+                      i + 1,                    /* Column Number */
+                      &c->c_blkfmt,             /* Data Format */
+                      (CS_VOID*)((CS_BYTE*)c->c_data +
+                          row * max( c->c_format.maxlength, 1 )), /* Buffer */
+                      &c->c_lens[row],          /* Buffer Length */
+                      &c->c_nullinds[row] ) != CS_SUCCEED)
+        {
+            fprintf( stderr,
+                "bcp_data_xfer: Unable to bind results for column %d\n",
+                (int) i+1 );
+            d->d_blkrow = -1;
+            return CS_FAIL;
+        }
+    }
+
+    d->d_blkrow = row;
+    return CS_SUCCEED;
+}
+
+/*
+ * bcp_data_destroy():
+ *
+ * Destroys a bcp_data_t structure.
+ */
+static void bcp_data_destroy( d )
+    bcp_data_t   *d;
+{
+    CS_INT  i;
+
+    if (d != NULL)
+    {
+        if (d->d_cols != NULL)
+        {
+            for (i = 0; i < d->d_ncols; i++)
+            {
+                if (d->d_cols[i].c_data != NULL)
+                    free( d->d_cols[i].c_data );
+                if (d->d_cols[i].c_lens != NULL)
+                    free( d->d_cols[i].c_lens );
+                if (d->d_cols[i].c_nullinds != NULL)
+                    free( d->d_cols[i].c_nullinds );
+            }
+
+            free( d->d_cols );
+        }
+
+        free( d );
+    }
+}
+
+/*
+ * sqsh-3.0 - bcp_file_open():
+ *
+ * Opens name ("-" being stdin) as the source of a \bcp -f, with
+ * fields ending in fterm and rows in rterm, in which \t, \n, \r, \0
+ * and \\ stand for themselves.  A native file written by \bcp -o is
+ * recognised by its start, and has no terminators.  Returns NULL if
+ * it can't be read.
+ */
+static bcp_file_t* bcp_file_open( name, fterm, rterm )
+    char   *name;
+    char   *fterm;
+    char   *rterm;
+{
+    bcp_file_t   *f;
+    struct stat   st;
+    char         *cp;
+    char          magic[BCP_NATIVE_MAGICLEN];
+    CS_INT        order;
+    long          size;
+    long          n;
+    int           fd;
+    int           r = 0;
+
+    if ((f = (bcp_file_t*)calloc( 1, sizeof(bcp_file_t) )) == NULL ||
+        (f->f_fterm = sqsh_strdup( fterm )) == NULL ||
+        (f->f_rterm = sqsh_strdup( rterm )) == NULL)
+    {
+        fprintf( stderr, "\\bcp: -f: Memory allocation failure\n" );
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    f->f_name = name;
+    f->f_fd   = -1;
+    f->f_flen = bcp_file_term( f->f_fterm );
+    f->f_rlen = bcp_file_term( f->f_rterm );
+
+    if (f->f_flen == 0 || f->f_rlen == 0)
+    {
+        fprintf( stderr, "\\bcp: -f: Empty field or row terminator\n" );
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    if (strcmp( name, "-" ) == 0)
+        fd = 0;
+    else if ((fd = open( name, O_RDONLY )) == -1)
+    {
+        fprintf( stderr, "\\bcp: -f: %s: %s\n", name, strerror(errno) );
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    if (fstat( fd, &st ) == -1)
+    {
+        fprintf( stderr, "\\bcp: -f: %s: %s\n", name, strerror(errno) );
+        if (fd != 0)
+            close( fd );
+        bcp_file_close( f );
+        return NULL;
+    }
+
+#if defined(HAVE_MMAP)
+    if (S_ISREG( st.st_mode ) && st.st_size > 0)
+    {
+        f->f_len = (long)st.st_size;
+        f->f_map = (char*)mmap( NULL, (size_t)f->f_len, PROT_READ,
+                                MAP_SHARED, fd, (off_t)0 );
+
+        if (f->f_map != (char*)MAP_FAILED)
+        {
+            f->f_mapped = True;
+#if defined(MADV_SEQUENTIAL)
+            madvise( (void*)f->f_map, (size_t)f->f_len, MADV_SEQUENTIAL );
+#endif
+            if (fd != 0)
+                close( fd );
+
+            if (f->f_len >= BCP_NATIVE_MAGICLEN &&
+                memcmp( f->f_map, BCP_NATIVE_MAGIC, BCP_NATIVE_MAGICLEN ) == 0)
+            {
+                f->f_native = True;
+                f->f_pos    = BCP_NATIVE_MAGICLEN;
+                goto native;
+            }
+            return f;
+        }
+
+        DBG(sqsh_debug(DEBUG_BCP, "bcp: mmap() of %s failed: %s\n",
+            name, strerror( errno ));)
+        f->f_map = NULL;
+        f->f_len = 0;
+    }
+#endif
+
+    /*
+     * A native file that isn't mapped is read as it is loaded, so
+     * that one of any size may come through a pipe.
+     */
+    f->f_fd = fd;
+    if ((n = bcp_file_read( f, (void*)magic, (long)BCP_NATIVE_MAGICLEN )) == -1)
+    {
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    if (n == BCP_NATIVE_MAGICLEN &&
+        memcmp( magic, BCP_NATIVE_MAGIC, BCP_NATIVE_MAGICLEN ) == 0)
+    {
+        f->f_native = True;
+        goto native;
+    }
+    f->f_fd = -1;
+
+    /*
+     * Without mmap(), or for a pipe, the file is read into memory,
+     * which grows as needed.
+     */
+    size = (S_ISREG( st.st_mode ) && st.st_size > 0) ? (long)st.st_size : 1048576;
+    size = max( size, n );
+
+    if ((f->f_map = (char*)malloc( size )) == NULL)
+    {
+        fprintf( stderr, "\\bcp: -f: %s: Memory allocation failure\n", name );
+        if (fd != 0)
+            close( fd );
+        bcp_file_close( f );
+        return NULL;
+    }
+    memcpy( f->f_map, magic, n );
+    f->f_len = n;
+
+    for (;;)
+    {
+        if (f->f_len == size || f->f_map == NULL)
+        {
+            if (f->f_map != NULL)
+                size *= 2;
+
+            if ((cp = (char*)realloc( f->f_map, size )) == NULL)
+            {
+                fprintf( stderr, "\\bcp: -f: %s: Memory allocation failure\n", name );
+                r = -1;
+                break;
+            }
+            f->f_map = cp;
+        }
+
+        r = read( fd, f->f_map + f->f_len, size - f->f_len );
+
+        if (r == -1 && errno == EINTR)
+            continue;
+
+        if (r == -1)
+            fprintf( stderr, "\\bcp: -f: %s: %s\n", name, strerror(errno) );
+
+        if (r <= 0)
+            break;
+
+        f->f_len += r;
+    }
+
+    if (fd != 0)
+        close( fd );
+
+    if (r != 0)
+    {
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    return f;
+
+native:
+    if (bcp_file_read( f, (void*)&order, (long)sizeof(CS_INT) ) != sizeof(CS_INT) ||
+        order != BCP_NATIVE_ORDER)
+    {
+        fprintf( stderr, "\\bcp: -f: %s: Not a native file of this machine\n", name );
+        bcp_file_close( f );
+        return NULL;
+    }
+
+    return f;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_results():
+ *
+ * Stands in for ct_results() with \bcp -f: the file is a single
+ * result set of rows, unless it is empty.
+ */
+static CS_RETCODE bcp_file_results( f, result_type )
+    bcp_file_t   *f;
+    CS_INT       *result_type;
+{
+    CS_INT        ncols;
+    long          n;
+
+    /*
+     * A native file has as many result sets as were written to it,
+     * each starting with its number of columns.
+     */
+    if (f->f_native)
+    {
+        if (f->f_error)
+            return CS_FAIL;
+
+        if ((n = bcp_file_read( f, (void*)&ncols, (long)sizeof(CS_INT) )) == 0)
+            return CS_END_RESULTS;
+
+        if (n != sizeof(CS_INT) || ncols <= 0)
+        {
+            if (n != -1)
+                fprintf( stderr, "\\bcp: %s: Native file is cut short or damaged\n",
+                    f->f_name );
+            f->f_error = True;
+            return CS_FAIL;
+        }
+
+        f->f_nresults++;
+        f->f_ncols    = ncols;
+        *result_type  = CS_ROW_RESULT;
+        return CS_SUCCEED;
+    }
+
+    if (f->f_nresults++ > 0 || f->f_len == 0)
+        return CS_END_RESULTS;
+
+    *result_type = CS_ROW_RESULT;
+    return CS_SUCCEED;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_bind():
+ *
+ * Creates a bcp_data_t for rows of the file, bound to arraysize rows
+ * of the columns of the table, as many of them as there are fields in
+ * the first row.  Character data is copied as it is, binary data
+ * converted from hex, and everything else to the column's own type,
+ * so that the bulk library has nothing left to convert.
+ */
+static bcp_data_t* bcp_file_bind( f, blkdesc, arraysize )
+    bcp_file_t   *f;
+    CS_BLKDESC   *blkdesc;
+    CS_INT        arraysize;
+{
+    bcp_data_t   *d;
+    bcp_col_t    *c;
+    char         *cp;
+    char         *end;
+    CS_INT        ncols;
+    CS_INT        i;
+
+    if (f->f_native)
+        return bcp_native_bind( f, arraysize );
+
+    /*-- Count the fields of the first row --*/
+    end   = f->f_map + f->f_len;
+    ncols = 1;
+    for (cp = f->f_map; (cp = bcp_file_scan( cp, end, f->f_fterm[0],
+                                             f->f_rterm[0] )) < end; )
+    {
+        if (end - cp >= f->f_rlen && memcmp( cp, f->f_rterm, f->f_rlen ) == 0)
+            break;
+
+        if (end - cp >= f->f_flen && memcmp( cp, f->f_fterm, f->f_flen ) == 0)
+        {
+            ++ncols;
+            cp += f->f_flen;
+        }
+        else
+            ++cp;
+    }
+
+    d = (bcp_data_t*)calloc( 1, sizeof( bcp_data_t ) );
+    c = (bcp_col_t*)calloc( ncols, sizeof( bcp_col_t ) );
+
+    if (d == NULL || c == NULL)
+    {
+        fprintf( stderr, "bcp_file_bind: Memory allocation failure.\n" );
+        if (d != NULL)
+            free( d );
+        if (c != NULL)
+            free( c );
+        return NULL;
+    }
+
+    d->d_type      = CS_ROW_RESULT;
+    d->d_ncols     = ncols;
+    d->d_cols      = c;
+    d->d_nrows     = 0;
+    d->d_next      = 0;
+    d->d_blkrow    = -1;
+    d->d_rowfail   = CS_FALSE;
+    d->d_file      = f;
+
+    for (i = 0; i < ncols; i++)
+    {
+        c = &d->d_cols[i];
+        c->c_colid = i + 1;
+
+        if (blk_describe( blkdesc, i + 1, &c->c_format ) != CS_SUCCEED)
+        {
+            fprintf( stderr,
+                "\\bcp: %s: Row 1 has %d fields, but there is no column %d\n",
+                f->f_name, (int)ncols, (int)i + 1 );
+            bcp_data_destroy( d );
+            return NULL;
+        }
+
+        switch (c->c_format.datatype)
+        {
+            case CS_CHAR_TYPE:
+            case CS_VARCHAR_TYPE:
+            case CS_LONGCHAR_TYPE:
+                c->c_format.datatype = CS_CHAR_TYPE;
+                break;
+            case CS_UNICHAR_TYPE:
+                /*-- Up to three bytes of UTF-8 for two of UTF-16 --*/
+                c->c_format.datatype  = CS_CHAR_TYPE;
+                c->c_format.maxlength = c->c_format.maxlength * 3 / 2;
+                break;
+            case CS_TEXT_TYPE:
+#if defined(CS_UNITEXT_TYPE)
+            case CS_UNITEXT_TYPE:
+#endif
+#if defined(CS_XML_TYPE)
+            case CS_XML_TYPE:
+#endif
+                c->c_format.datatype  = CS_CHAR_TYPE;
+                c->c_format.maxlength = min( c->c_format.maxlength, BCP_FILE_MAXTEXT );
+                break;
+            case CS_BINARY_TYPE:
+            case CS_VARBINARY_TYPE:
+            case CS_LONGBINARY_TYPE:
+                c->c_format.datatype = CS_BINARY_TYPE;
+                break;
+            case CS_IMAGE_TYPE:
+                c->c_format.datatype  = CS_BINARY_TYPE;
+                c->c_format.maxlength = min( c->c_format.maxlength, BCP_FILE_MAXTEXT );
+                break;
+            default:
+                break;
+        }
+        c->c_format.format = CS_FMT_UNUSED;
+    }
+
+    if (bcp_data_alloc( d, arraysize ) != CS_SUCCEED)
+    {
+        bcp_data_destroy( d );
+        return NULL;
+    }
+
+    return d;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_fetch():
+ *
+ * Stands in for ct_fetch() with \bcp -f, reading up to a block of
+ * rows into d and returning the number read in nrows.  Just as with
+ * ct_fetch(), CS_ROW_FAIL means the last of them is bad (and has
+ * been reported with its row number); the rest are fine.
+ */
+static CS_RETCODE bcp_file_fetch( d, nrows )
+    bcp_data_t   *d;
+    CS_INT       *nrows;
+{
+    CS_RETCODE    return_code = CS_SUCCEED;
+    CS_INT        row;
+
+    if (d->d_file->f_native)
+        return bcp_native_fetch( d, nrows );
+
+    for (row = 0; row < d->d_arraysize; row++)
+    {
+        if ((return_code = bcp_file_row( d, row )) != CS_SUCCEED)
+            break;
+    }
+
+    if (return_code == CS_ROW_FAIL)
+    {
+        *nrows = row + 1;
+        return CS_ROW_FAIL;
+    }
+
+    *nrows = row;
+    return (row > 0) ? CS_SUCCEED : CS_END_DATA;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_row():
+ *
+ * Splits the next row of the file into its fields and converts them
+ * into row of the block.  Returns CS_END_DATA at the end of the file,
+ * and CS_ROW_FAIL for a row with the wrong number of fields or a field
+ * that won't convert, which is skipped.
+ */
+static CS_RETCODE bcp_file_row( d, row )
+    bcp_data_t   *d;
+    CS_INT        row;
+{
+    bcp_file_t   *f     = d->d_file;
+    char         *end   = f->f_map + f->f_len;
+    char         *cp    = f->f_map + f->f_pos;
+    char         *field = cp;
+    char         *err;
+    int           col   = 0;
+    int           last;
+
+    if (cp >= end)
+        return CS_END_DATA;
+
+    ++f->f_line;
+
+    for (;;)
+    {
+        cp   = bcp_file_scan( cp, end, f->f_fterm[0], f->f_rterm[0] );
+        last = (col == d->d_ncols - 1);
+
+        /*-- The last row need not be terminated --*/
+        if (cp == end)
+        {
+            f->f_pos = f->f_len;
+
+            if (!last)
+            {
+                fprintf( stderr, "\\bcp: %s: Row %ld: Only %d of %d fields\n",
+                    f->f_name, f->f_line, col + 1, (int)d->d_ncols );
+                return CS_ROW_FAIL;
+            }
+            break;
+        }
+
+        if (!last && end - cp >= f->f_flen &&
+            memcmp( cp, f->f_fterm, f->f_flen ) == 0)
+        {
+            if ((err = bcp_file_field( &d->d_cols[col], row, field,
+                                       cp - field )) != NULL)
+            {
+                bcp_file_skip( f, cp + f->f_flen );
+                fprintf( stderr, "\\bcp: %s: Row %ld, field %d: %s\n",
+                    f->f_name, f->f_line, col + 1, err );
+                return CS_ROW_FAIL;
+            }
+
+            cp    += f->f_flen;
+            field  = cp;
+            ++col;
+            continue;
+        }
+
+        if (end - cp >= f->f_rlen && memcmp( cp, f->f_rterm, f->f_rlen ) == 0)
+        {
+            f->f_pos = (cp - f->f_map) + f->f_rlen;
+
+            if (!last)
+            {
+                fprintf( stderr, "\\bcp: %s: Row %ld: Only %d of %d fields\n",
+                    f->f_name, f->f_line, col + 1, (int)d->d_ncols );
+                return CS_ROW_FAIL;
+            }
+            break;
+        }
+
+        if (last && end - cp >= f->f_flen &&
+            memcmp( cp, f->f_fterm, f->f_flen ) == 0)
+        {
+            bcp_file_skip( f, cp );
+            fprintf( stderr, "\\bcp: %s: Row %ld: More than %d fields\n",
+                f->f_name, f->f_line, (int)d->d_ncols );
+            return CS_ROW_FAIL;
+        }
+
+        ++cp;
+    }
+
+    /*-- Whatever ended the last field, f_pos is past it --*/
+    if ((err = bcp_file_field( &d->d_cols[col], row, field,
+                               ((cp == end) ? end : cp) - field )) != NULL)
+    {
+        fprintf( stderr, "\\bcp: %s: Row %ld, field %d: %s\n",
+            f->f_name, f->f_line, col + 1, err );
+        return CS_ROW_FAIL;
+    }
+
+    return CS_SUCCEED;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_field():
+ *
+ * Puts the len bytes of field into row of column c, an empty field
+ * being a NULL.  Returns NULL, or what was wrong with the field.
+ */
+static char* bcp_file_field( c, row, field, len )
+    bcp_col_t    *c;
+    CS_INT        row;
+    char         *field;
+    int           len;
+{
+    CS_DATAFMT    srcfmt;
+    CS_VOID      *dst;
+    CS_INT        outlen;
+
+    if (len == 0)
+    {
+        c->c_nullinds[row] = -1;
+        c->c_lens[row]     = 0;
+        return NULL;
+    }
+
+    c->c_nullinds[row] = 0;
+    dst = (CS_VOID*)((CS_BYTE*)c->c_data + row * max( c->c_format.maxlength, 1 ));
+
+    if (c->c_format.datatype == CS_CHAR_TYPE)
+    {
+        if (len > c->c_format.maxlength)
+            return "Value is too long for the column";
+
+        memcpy( dst, field, len );
+        c->c_lens[row] = len;
+        return NULL;
+    }
+
+    memset( &srcfmt, 0, sizeof(CS_DATAFMT) );
+    srcfmt.datatype  = CS_CHAR_TYPE;
+    srcfmt.format    = CS_FMT_UNUSED;
+    srcfmt.maxlength = len;
+    srcfmt.count     = 1;
+    srcfmt.locale    = NULL;
+
+    if (cs_convert( g_context, &srcfmt, (CS_VOID*)field, &c->c_format,
+                    dst, &outlen ) != CS_SUCCEED)
+        return "Value cannot be converted to the type of the column";
+
+    c->c_lens[row] = outlen;
+    return NULL;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_scan():
+ *
+ * Returns the first byte from cp up to end that is c1 or c2, or end.
+ * Where the compiler lets us, 32 (AVX2) or 16 (SSE2) bytes are
+ * compared at a time, a block with a hit then being searched byte by
+ * byte.
+ */
+static char* bcp_file_scan( cp, end, c1, c2 )
+    char   *cp;
+    char   *end;
+    int     c1;
+    int     c2;
+{
+#if defined(__AVX2__)
+    {
+        __m256i  a = _mm256_set1_epi8( (char)c1 );
+        __m256i  b = _mm256_set1_epi8( (char)c2 );
+        __m256i  x;
+
+        for (; end - cp >= 32; cp += 32)
+        {
+            x = _mm256_loadu_si256( (const __m256i*)cp );
+            if (_mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( x, a ),
+                                                       _mm256_cmpeq_epi8( x, b ) ) ) != 0)
+                break;
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    {
+        __m128i  a = _mm_set1_epi8( (char)c1 );
+        __m128i  b = _mm_set1_epi8( (char)c2 );
+        __m128i  x;
+
+        for (; end - cp >= 16; cp += 16)
+        {
+            x = _mm_loadu_si128( (const __m128i*)cp );
+            if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( x, a ),
+                                                 _mm_cmpeq_epi8( x, b ) ) ) != 0)
+                break;
+        }
+    }
+#endif
+
+    for (; cp < end; cp++)
+    {
+        if (*cp == (char)c1 || *cp == (char)c2)
+            return cp;
+    }
+
+    return end;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_skip():
+ *
+ * Moves f_pos past the end of the row that cp is in.
+ */
+static void bcp_file_skip( f, cp )
+    bcp_file_t   *f;
+    char         *cp;
+{
+    char   *end = f->f_map + f->f_len;
+
+    while ((cp = bcp_file_scan( cp, end, f->f_rterm[0], f->f_rterm[0] )) < end)
+    {
+        if (end - cp >= f->f_rlen && memcmp( cp, f->f_rterm, f->f_rlen ) == 0)
+        {
+            f->f_pos = (cp - f->f_map) + f->f_rlen;
+            return;
+        }
+        ++cp;
+    }
+
+    f->f_pos = f->f_len;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_term():
+ *
+ * Turns the escapes of a terminator into what they stand for, in
+ * place, returning its length.
+ */
+static int bcp_file_term( term )
+    char   *term;
+{
+    char   *src;
+    char   *dst;
+
+    for (src = dst = term; *src != '\0'; src++)
+    {
+        if (*src == '\\' && src[1] != '\0')
+        {
+            switch (*++src)
+            {
+                case 't':  *dst++ = '\t'; break;
+                case 'n':  *dst++ = '\n'; break;
+                case 'r':  *dst++ = '\r'; break;
+                case '0':  *dst++ = '\0'; break;
+                default:   *dst++ = *src; break;
+            }
+        }
+        else
+            *dst++ = *src;
+    }
+
+    return dst - term;
+}
+
+/*
+ * sqsh-3.0 - bcp_file_close():
+ */
+static void bcp_file_close( f )
+    bcp_file_t   *f;
+{
+    if (f == NULL)
+        return;
+
+    if (f->f_map != NULL)
+    {
+#if defined(HAVE_MMAP)
+        if (f->f_mapped)
+            munmap( (void*)f->f_map, (size_t)f->f_len );
+        else
+#endif
+            free( f->f_map );
+    }
+
+    if (f->f_fd > 0)
+        close( f->f_fd );
+    if (f->f_fterm != NULL)
+        free( f->f_fterm );
+    if (f->f_rterm != NULL)
+        free( f->f_rterm );
+    free( f );
+}
+
+/*
+ * sqsh-3.0 - bcp_file_read():
+ *
+ * Copies up to len bytes of f into buf, from the mapped file or, for
+ * a native file that isn't mapped, straight from the descriptor.
+ * Returns the number copied, which is short only at the end of the
+ * file, or -1 if the file could not be read.
+ */
+static long bcp_file_read( f, buf, len )
+    bcp_file_t   *f;
+    void         *buf;
+    long          len;
+{
+    long          n = 0;
+    int           r;
+
+    if (f->f_fd == -1)
+    {
+        n = min( len, f->f_len - f->f_pos );
+        memcpy( buf, f->f_map + f->f_pos, n );
+        f->f_pos += n;
+        return n;
+    }
+
+    while (n < len)
+    {
+        r = read( f->f_fd, (char*)buf + n, len - n );
+
+        if (r == -1 && errno == EINTR && !sg_interrupted)
+            continue;
+
+        if (r == -1)
+        {
+            fprintf( stderr, "\\bcp: %s: %s\n", f->f_name, strerror(errno) );
+            return -1;
+        }
+
+        if (r == 0)
+            break;
+
+        n += r;
+    }
+
+    f->f_pos += n;
+    return n;
+}
+
+/*
+ * sqsh-3.0 - bcp_native_read():
+ *
+ * Reads exactly len bytes of a native file into buf, anything less
+ * meaning that the file was cut short.
+ */
+static CS_RETCODE bcp_native_read( f, buf, len )
+    bcp_file_t   *f;
+    void         *buf;
+    long          len;
+{
+    long          n;
+
+    if ((n = bcp_file_read( f, buf, len )) == len)
+        return CS_SUCCEED;
+
+    if (n != -1)
+        fprintf( stderr, "\\bcp: %s: Native file is cut short or damaged\n",
+            f->f_name );
+
+    f->f_error = True;
+    f->f_left  = -1;
+    return CS_FAIL;
+}
+
+/*
+ * sqsh-3.0 - bcp_native_bind():
+ *
+ * The bcp_file_bind() of a native file, whose columns are bound just
+ * as they were when written by \bcp -o, so that the values go from
+ * the file to blk_bind() as they are and it is up to the bulk library
+ * to fit them to the table, as with a copy between servers.
+ */
+static bcp_data_t* bcp_native_bind( f, arraysize )
+    bcp_file_t   *f;
+    CS_INT        arraysize;
+{
+    bcp_data_t   *d;
+    bcp_col_t    *c;
+    CS_INT        fmt[BCP_NATIVE_NFMT];
+    CS_INT        i;
+
+    d = (bcp_data_t*)calloc( 1, sizeof( bcp_data_t ) );
+    c = (bcp_col_t*)calloc( f->f_ncols, sizeof( bcp_col_t ) );
+
+    if (d == NULL || c == NULL)
+    {
+        fprintf( stderr, "bcp_file_bind: Memory allocation failure.\n" );
+        if (d != NULL)
+            free( d );
+        if (c != NULL)
+            free( c );
+        return NULL;
+    }
+
+    d->d_type      = CS_ROW_RESULT;
+    d->d_ncols     = f->f_ncols;
+    d->d_cols      = c;
+    d->d_nrows     = 0;
+    d->d_next      = 0;
+    d->d_blkrow    = -1;
+    d->d_rowfail   = CS_FALSE;
+    d->d_file      = f;
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        c = &d->d_cols[i];
+        c->c_colid = i + 1;
+
+        if (bcp_native_read( f, (void*)fmt, (long)sizeof(fmt) ) != CS_SUCCEED)
+        {
+            bcp_data_destroy( d );
+            return NULL;
+        }
+
+        c->c_format.datatype  = fmt[0];
+        c->c_format.format    = fmt[1];
+        c->c_format.maxlength = fmt[2];
+        c->c_format.scale     = fmt[3];
+        c->c_format.precision = fmt[4];
+        c->c_format.status    = fmt[5];
+        c->c_format.usertype  = fmt[6];
+        c->c_format.namelen   = fmt[7];
+
+        if (fmt[2] < 0 || fmt[7] < 0 || fmt[7] > (CS_INT)sizeof(c->c_format.name))
+        {
+            fprintf( stderr, "\\bcp: %s: Native file is cut short or damaged\n",
+                f->f_name );
+            f->f_error = True;
+            bcp_data_destroy( d );
+            return NULL;
+        }
+
+        if (bcp_native_read( f, (void*)c->c_format.name,
+                             (long)c->c_format.namelen ) != CS_SUCCEED)
+        {
+            bcp_data_destroy( d );
+            return NULL;
+        }
+    }
+
+    if (bcp_data_alloc( d, arraysize ) != CS_SUCCEED)
+    {
+        bcp_data_destroy( d );
+        return NULL;
+    }
+
+    f->f_left = 0;
+    return d;
+}
+
+/*
+ * sqsh-3.0 - bcp_native_fetch():
+ *
+ * The bcp_file_fetch() of a native file, which reads the rows into
+ * the block whatever the size of the blocks they were written in.
+ * Returns CS_FAIL if the file was cut short, after which there are
+ * no more rows.
+ */
+static CS_RETCODE bcp_native_fetch( d, nrows )
+    bcp_data_t   *d;
+    CS_INT       *nrows;
+{
+    bcp_file_t   *f = d->d_file;
+    bcp_col_t    *c;
+    CS_INT        row;
+    CS_INT        len;
+    CS_INT        i;
+
+    *nrows = 0;
+
+    for (row = 0; row < d->d_arraysize; row++)
+    {
+        if (f->f_left == 0)
+        {
+            if (bcp_native_read( f, (void*)&f->f_left,
+                                 (long)sizeof(CS_INT) ) != CS_SUCCEED)
+                return CS_FAIL;
+
+            /*-- A block of no rows ends the result set --*/
+            if (f->f_left == 0)
+                f->f_left = -1;
+        }
+
+        if (f->f_left < 0)
+            break;
+
+        for (i = 0; i < d->d_ncols; i++)
+        {
+            c = &d->d_cols[i];
+
+            if (bcp_native_read( f, (void*)&len, (long)sizeof(CS_INT) ) != CS_SUCCEED)
+                return CS_FAIL;
+
+            if (len == -1)
+            {
+                c->c_nullinds[row] = -1;
+                c->c_lens[row]     = 0;
+                continue;
+            }
+
+            if (len < 0 || len > max( c->c_format.maxlength, 1 ))
+            {
+                fprintf( stderr, "\\bcp: %s: Native file is cut short or damaged\n",
+                    f->f_name );
+                f->f_error = True;
+                f->f_left  = -1;
+                return CS_FAIL;
+            }
+
+            if (bcp_native_read( f,
+                                 (void*)((CS_BYTE*)c->c_data +
+                                     row * max( c->c_format.maxlength, 1 )),
+                                 (long)len ) != CS_SUCCEED)
+                return CS_FAIL;
+
+            c->c_nullinds[row] = 0;
+            c->c_lens[row]     = len;
+        }
+
+        --f->f_left;
+    }
+
+    *nrows = row;
+    return (row > 0) ? CS_SUCCEED : CS_END_DATA;
+}
+
+/*
+ * sqsh-3.0 - bcp_out():
+ *
+ * Writes the result sets of cmd to name ("-" being stdout) for \bcp -o,
+ * in the native form in which they were fetched, to be loaded again
+ * with \bcp -f without being converted to text and back.  The file
+ * starts with BCP_NATIVE_MAGIC and a CS_INT of BCP_NATIVE_ORDER, and
+ * then for each result set has
+ *
+ *     CS_INT   number of columns
+ *     CS_INT   datatype, format, maxlength, scale, precision,
+ *              status, usertype and namelen of each column,
+ *              followed by namelen bytes of its name
+ *
+ * and blocks of rows, each a CS_INT of the number of rows followed
+ * by each value of each row as a CS_INT of its length (-1 for NULL)
+ * and that many bytes, with a block of no rows at the end.  All of it
+ * is in the byte order of the machine, which is why the order is
+ * checked when loading.  Returns CS_CANCELED if interrupted.
+ */
+static CS_RETCODE bcp_out( cmd, name, arraysize, maxerrors, total_rows )
+    CS_COMMAND   *cmd;
+    char         *name;
+    CS_INT        arraysize;
+    int           maxerrors;
+    int          *total_rows;
+{
+    FILE         *fp;
+    bcp_data_t   *d        = NULL;
+    char         *buf      = NULL;
+    CS_INT        order    = BCP_NATIVE_ORDER;
+    CS_INT        zero     = 0;
+    CS_INT        result_type;
+    CS_INT        nrows;
+    CS_INT        rowsize;
+    CS_INT        i;
+    CS_RETCODE    return_code;
+    CS_RETCODE    ret      = CS_SUCCEED;
+    int           nerrors  = 0;
+
+    if (strcmp( name, "-" ) == 0)
+        fp = stdout;
+    else if ((fp = fopen( name, "w" )) == NULL)
+    {
+        fprintf( stderr, "\\bcp: -o: %s: %s\n", name, strerror(errno) );
+        return CS_FAIL;
+    }
+
+    if (fwrite( BCP_NATIVE_MAGIC, BCP_NATIVE_MAGICLEN, 1, fp ) != 1 ||
+        fwrite( &order, sizeof(CS_INT), 1, fp ) != 1)
+        goto write_fail;
+
+    while ((return_code = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+    {
+        if (sg_interrupted || return_code != CS_SUCCEED)
+            goto fail;
+
+        switch (result_type)
+        {
+            case CS_ROW_RESULT:
+
+                if ((d = bcp_data_bind( cmd, result_type, arraysize )) == NULL)
+                    goto fail;
+
+                /*
+                 * A block goes out with a single fwrite(), from a
+                 * buffer large enough for every value being at its
+                 * maximum length.
+                 */
+                rowsize = 0;
+                for (i = 0; i < d->d_ncols; i++)
+                {
+                    rowsize += sizeof(CS_INT) + max( d->d_cols[i].c_format.maxlength, 1 );
+                }
+
+                if ((buf = (char*)malloc( sizeof(CS_INT) +
+                                          (size_t)d->d_arraysize * rowsize )) == NULL)
+                {
+                    fprintf( stderr, "\\bcp: -o: Memory allocation failure\n" );
+                    goto fail;
+                }
+
+                if (bcp_out_header( fp, d ) != CS_SUCCEED)
+                    goto write_fail;
+
+                while ((return_code = bcp_data_fetch( d, cmd )) != CS_END_DATA)
+                {
+                    if (sg_interrupted)
+                        goto fail;
+
+                    if (return_code != CS_SUCCEED && return_code != CS_ROW_FAIL)
+                        goto fail;
+
+                    if (d->d_nrows > 0 && bcp_out_block( fp, d, buf ) != CS_SUCCEED)
+                        goto write_fail;
+
+                    *total_rows += d->d_nrows;
+
+                    if (d->d_rowfail == CS_TRUE)
+                    {
+                        d->d_rowfail = CS_FALSE;
+
+                        if (++nerrors == maxerrors)
+                            goto fail;
+                    }
+                }
+
+                if (fwrite( &zero, sizeof(CS_INT), 1, fp ) != 1)
+                    goto write_fail;
+
+                bcp_data_destroy( d );
+                d = NULL;
+                free( buf );
+                buf = NULL;
+                break;
+
+            case CS_PARAM_RESULT:
+            case CS_STATUS_RESULT:
+            case CS_COMPUTE_RESULT:
+                while ((return_code = ct_fetch( cmd, CS_UNUSED, CS_UNUSED,
+                    CS_UNUSED, &nrows )) == CS_SUCCEED);
+
+                if (return_code != CS_END_DATA)
+                {
+                    fprintf( stderr,
+                        "\\bcp: Error discarding extraneous result sets\n" );
+                    goto fail;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (fflush( fp ) != 0)
+        goto write_fail;
+
+    goto leave;
+
+write_fail:
+    if (!sg_interrupted)
+        fprintf( stderr, "\\bcp: -o: %s: %s\n", name, strerror(errno) );
+
+fail:
+    ret = (sg_interrupted) ? CS_CANCELED : CS_FAIL;
+
+leave:
+    if (d != NULL)
+        bcp_data_destroy( d );
+
+    if (buf != NULL)
+        free( buf );
+
+    if (fp != stdout && fclose( fp ) != 0 && ret == CS_SUCCEED)
+    {
+        fprintf( stderr, "\\bcp: -o: %s: %s\n", name, strerror(errno) );
+        ret = CS_FAIL;
+    }
+
+    return ret;
+}
+
+/*
+ * sqsh-3.0 - bcp_out_header():
+ *
+ * Writes the description of the columns of d that starts each result
+ * set of a native file (see bcp_out()).
+ */
+static CS_RETCODE bcp_out_header( fp, d )
+    FILE         *fp;
+    bcp_data_t   *d;
+{
+    CS_INT        fmt[BCP_NATIVE_NFMT];
+    bcp_col_t    *c;
+    CS_INT        i;
+
+    if (fwrite( &d->d_ncols, sizeof(CS_INT), 1, fp ) != 1)
+        return CS_FAIL;
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        c = &d->d_cols[i];
+
+        fmt[0] = c->c_format.datatype;
+        fmt[1] = c->c_format.format;
+        fmt[2] = c->c_format.maxlength;
+        fmt[3] = c->c_format.scale;
+        fmt[4] = c->c_format.precision;
+        fmt[5] = c->c_format.status;
+        fmt[6] = c->c_format.usertype;
+        fmt[7] = max( min( c->c_format.namelen, (CS_INT)sizeof(c->c_format.name) ), 0 );
+
+        if (fwrite( fmt, sizeof(CS_INT), BCP_NATIVE_NFMT, fp ) != BCP_NATIVE_NFMT ||
+            (fmt[7] > 0 && fwrite( c->c_format.name, fmt[7], 1, fp ) != 1))
+            return CS_FAIL;
+    }
+
+    return CS_SUCCEED;
+}
+
+/*
+ * sqsh-3.0 - bcp_out_block():
+ *
+ * Writes the rows of the block d has just fetched to a native file,
+ * gathering them into buf first.
+ */
+static CS_RETCODE bcp_out_block( fp, d, buf )
+    FILE         *fp;
+    bcp_data_t   *d;
+    char         *buf;
+{
+    char         *cp = buf;
+    bcp_col_t    *c;
+    CS_INT        len;
+    CS_INT        row;
+    CS_INT        i;
+
+    memcpy( cp, &d->d_nrows, sizeof(CS_INT) );
+    cp += sizeof(CS_INT);
+
+    for (row = 0; row < d->d_nrows; row++)
+    {
+        for (i = 0; i < d->d_ncols; i++)
+        {
+            c   = &d->d_cols[i];
+            len = (c->c_nullinds[row] == -1) ? -1 :
+                  min( c->c_lens[row], max( c->c_format.maxlength, 1 ) );
+
+            memcpy( cp, &len, sizeof(CS_INT) );
+            cp += sizeof(CS_INT);
+
+            if (len > 0)
+            {
+                memcpy( cp, (CS_BYTE*)c->c_data +
+                            row * max( c->c_format.maxlength, 1 ), len );
+                cp += len;
+            }
+        }
+    }
+
+    if (fwrite( buf, cp - buf, 1, fp ) != 1)
+        return CS_FAIL;
+
+    return CS_SUCCEED;
+}
+
+#if defined(HAVE_PTHREAD_H)
+/*
+ * bcp_pipe_create():
+ *
+ * sqsh-3.0: Starts fetching the rows of the current result set of cmd
+ * in a thread of its own, nahead blocks ahead of what is being sent.
+ * d, which has been bound by bcp_data_bind(), is the first block of
+ * the ring and the rest are bound like it.  Returns NULL if the
+ * thread could not be started.
+ */
+static bcp_pipe_t* bcp_pipe_create( d, cmd, nahead )
+    bcp_data_t   *d;
+    CS_COMMAND   *cmd;
+    int           nahead;
+{
+    bcp_pipe_t   *p;
+    sigset_t      all_sigs;
+    sigset_t      old_sigs;
+    int           r = 0;
+    int           i;
+
+    if ((p = (bcp_pipe_t*)calloc( 1, sizeof(bcp_pipe_t) )) == NULL ||
+        (p->p_blocks = (bcp_data_t**)calloc( nahead + 1,
+                                             sizeof(bcp_data_t*) )) == NULL)
+    {
+        fprintf( stderr, "bcp_pipe_create: Memory allocation failure.\n" );
+        if (p != NULL)
+            free( p );
+        return NULL;
+    }
+
+    /*
+     * One more block than asked for, as the one being sent is never
+     * among those fetched ahead.
+     */
+    p->p_cmd       = cmd;
+    p->p_nblocks   = nahead + 1;
+    p->p_blocks[0] = d;
+    p->p_head      = 0;
+    p->p_count     = 0;
+    p->p_sending   = NULL;
+    p->p_end       = CS_END_DATA;
+    p->p_done      = False;
+    p->p_stop      = False;
+
+    for (i = 1; i < p->p_nblocks; i++)
+    {
+        if ((p->p_blocks[i] = bcp_data_bind( cmd, d->d_type,
+                                             d->d_arraysize )) == NULL)
+            break;
+    }
+
+    if (i == p->p_nblocks)
+    {
+        pthread_mutex_init( &p->p_lock, NULL );
+        pthread_cond_init( &p->p_cond, NULL );
+    }
+
+    /*
+     * As with the writer thread of dsp_fpipe(), signals are left to
+     * the thread that is sending.
+     */
+    if (i == p->p_nblocks)
+    {
+        sigfillset( &all_sigs );
+        pthread_sigmask( SIG_BLOCK, &all_sigs, &old_sigs );
+        r = pthread_create( &p->p_thread, NULL, bcp_pipe_fetcher, (void*)p );
+        pthread_sigmask( SIG_SETMASK, &old_sigs, NULL );
+
+        if (r != 0)
+        {
+            fprintf( stderr, "bcp_pipe_create: pthread_create: %s\n",
+                strerror(r) );
+            pthread_cond_destroy( &p->p_cond );
+            pthread_mutex_destroy( &p->p_lock );
+        }
+    }
+
+    if (i < p->p_nblocks || r != 0)
+    {
+        while (--i > 0)
+            bcp_data_destroy( p->p_blocks[i] );
+        free( p->p_blocks );
+        free( p );
+        return NULL;
+    }
+
+    DBG(sqsh_debug(DEBUG_BCP, "bcp: Fetcher thread started, %d blocks of %d rows\n",
+        p->p_nblocks, (int)d->d_arraysize);)
+
+    sg_bcp_pipe = p;
+    return p;
+}
+
+/*
+ * bcp_pipe_fetcher():
+ *
+ * Body of the fetching thread.  Fills the block after the last one
+ * fetched whenever there is one free, until the rows run out, a
+ * fetch fails outright or it is told to stop.
+ */
+static void* bcp_pipe_fetcher( arg )
+    void  *arg;
 {
-    CS_INT  i;
+    bcp_pipe_t  *p = (bcp_pipe_t*)arg;
+    bcp_data_t  *d;
+    bcp_data_t  *bound;
+    CS_RETCODE   return_code;
 
-    if (d != NULL)
+    /*-- bcp_data_bind() left the last block of the ring bound --*/
+    bound = p->p_blocks[p->p_nblocks - 1];
+
+    pthread_mutex_lock( &p->p_lock );
+    for (;;)
     {
-        if (d->d_cols != NULL)
+        while (p->p_count == p->p_nblocks && p->p_stop == False)
         {
-            for (i = 0; i < d->d_ncols; i++)
+            pthread_cond_wait( &p->p_cond, &p->p_lock );
+        }
+
+        if (p->p_stop == True)
+        {
+            break;
+        }
+
+        d = p->p_blocks[(p->p_head + p->p_count) % p->p_nblocks];
+        pthread_mutex_unlock( &p->p_lock );
+
+        if (d != bound)
+        {
+            return_code = bcp_data_ctbind( d, p->p_cmd );
+            bound = (return_code == CS_SUCCEED) ? d : NULL;
+        }
+        else
+        {
+            return_code = CS_SUCCEED;
+        }
+
+        if (return_code == CS_SUCCEED)
+        {
+            return_code = bcp_data_fetch( d, p->p_cmd );
+        }
+
+        pthread_mutex_lock( &p->p_lock );
+
+        if (return_code != CS_SUCCEED && return_code != CS_ROW_FAIL)
+        {
+            p->p_end = return_code;
+            break;
+        }
+
+        ++p->p_count;
+        pthread_cond_signal( &p->p_cond );
+    }
+
+    p->p_done = True;
+    pthread_cond_signal( &p->p_cond );
+    pthread_mutex_unlock( &p->p_lock );
+
+    return NULL;
+}
+
+/*
+ * bcp_pipe_xfer():
+ *
+ * Does what bcp_data_xfer() does, taking the rows from the blocks
+ * fetched by the thread, and handing each back to it once sent.
+ */
+static CS_INT bcp_pipe_xfer( p, blkdesc, maxrows, nsent )
+    bcp_pipe_t  *p;
+    CS_BLKDESC  *blkdesc;
+    CS_INT       maxrows;
+    CS_INT      *nsent;
+{
+    bcp_data_t  *d;
+    CS_INT       return_code;
+
+    for (;;)
+    {
+        pthread_mutex_lock( &p->p_lock );
+        while (p->p_count == 0 && p->p_done == False)
+        {
+            pthread_cond_wait( &p->p_cond, &p->p_lock );
+        }
+
+        if (p->p_count == 0)
+        {
+            pthread_mutex_unlock( &p->p_lock );
+            *nsent = 0;
+            return p->p_end;
+        }
+
+        d = p->p_blocks[p->p_head];
+        pthread_mutex_unlock( &p->p_lock );
+
+        /*
+         * The block descriptor is still bound to another block.
+         */
+        if (d != p->p_sending)
+        {
+            d->d_blkrow  = -1;
+            p->p_sending = d;
+        }
+
+        return_code = bcp_data_send( d, blkdesc, maxrows, nsent );
+
+        if (d->d_next >= d->d_nrows && d->d_rowfail == CS_FALSE)
+        {
+            pthread_mutex_lock( &p->p_lock );
+            p->p_head = (p->p_head + 1) % p->p_nblocks;
+            --p->p_count;
+            pthread_cond_signal( &p->p_cond );
+            pthread_mutex_unlock( &p->p_lock );
+        }
+
+        if (return_code != CS_END_DATA)
+        {
+            return return_code;
+        }
+    }
+}
+
+/*
+ * bcp_pipe_destroy():
+ *
+ * Stops the fetching thread, once the fetch it may be in the middle
+ * of is over, and frees all but the first block.
+ */
+static void bcp_pipe_destroy( p )
+    bcp_pipe_t  *p;
+{
+    int   i;
+
+    pthread_mutex_lock( &p->p_lock );
+    p->p_stop = True;
+    pthread_cond_signal( &p->p_cond );
+    pthread_mutex_unlock( &p->p_lock );
+
+    pthread_join( p->p_thread, NULL );
+
+    pthread_cond_destroy( &p->p_cond );
+    pthread_mutex_destroy( &p->p_lock );
+    sg_bcp_pipe = NULL;
+
+    for (i = 1; i < p->p_nblocks; i++)
+        bcp_data_destroy( p->p_blocks[i] );
+
+    free( p->p_blocks );
+    free( p );
+}
+#endif /* HAVE_PTHREAD_H */
+
+/*
+ * sqsh-3.0 - bcp_streams():
+ *
+ * Splits a \bcp into nstreams concurrent streams, each a process of
+ * its own with its own connection to the source (opened with \connect,
+ * so from the same $DSQUERY, $username, etc.) and its own bulk login
+ * to the destination.  What each stream selects is up to the SQL,
+ * which is expanded in every stream with $bcp_stream (1 to
+ * $bcp_streams) set and, according to keys (the -K argument):
+ *
+ *    lo:hi        $bcp_lo and $bcp_hi, a nstreams'th of the range
+ *    key,key,...  $bcp_key, one of the values (a partition name, say),
+ *                 in which case nstreams may be left at 0.
+ *
+ * Returns True in each of the streams, which go on to copy their
+ * slice as usual and report back at the end of cmd_bcp().  Returns
+ * False in sqsh itself once they are all done, with the return code
+ * of \bcp in *ret.
+ */
+static int bcp_streams( nstreams, keys, ret )
+    int     nstreams;
+    char   *keys;
+    int    *ret;
+{
+    bcp_slice_t     *slices     = NULL;
+    sigcld_t        *sc         = NULL;
+    varbuf_t        *exp_buf    = NULL;
+    int             *rfd        = NULL;
+    char            *first      = NULL;
+    char            *expand;
+    char            *cp;
+    char            *endp;
+    long             lo         = 0;
+    long             hi         = 0;
+    long             step;
+    long             rem;
+    int              have_range = False;
+    int              nstarted   = 0;
+    int              nfailed    = 0;
+    int              total_rows = 0;
+    bcp_stream_t     s;
+    struct timeval   tv_start;
+    struct timeval   tv_end;
+    double           secs;
+    int              exit_status;
+    int              n;
+    int              p[2];
+    int              i, j;
+
+    *ret = CMD_FAIL;
+
+    /*
+     * A lo:hi range is split evenly, anything else is a list of keys
+     * with a stream for each.
+     */
+    if (keys != NULL)
+    {
+        lo = strtol( keys, &endp, 10 );
+        if (endp != keys && *endp == ':')
+        {
+            cp = endp + 1;
+            hi = strtol( cp, &endp, 10 );
+            have_range = (endp != cp && *endp == '\0');
+        }
+
+        if (have_range)
+        {
+            if (nstreams == 0)
             {
-                if (d->d_cols[i].c_data != NULL)
-                    free( d->d_cols[i].c_data );
+                fprintf( stderr, "\\bcp: -K: A key range needs -p\n" );
+                return False;
+            }
+            if (hi < lo || hi - lo + 1 < (long)nstreams)
+            {
+                fprintf( stderr,
+                    "\\bcp: -K: Range %ld:%ld too small for %d streams\n",
+                    lo, hi, nstreams );
+                return False;
+            }
+        }
+        else
+        {
+            for (n = 1, cp = keys; *cp != '\0'; cp++)
+            {
+                if (*cp == ',')
+                    ++n;
             }
 
-            free( d->d_cols );
+            if (nstreams == 0)
+                nstreams = n;
+            else if (nstreams != n)
+            {
+                fprintf( stderr, "\\bcp: -K: %d key%s given for %d streams\n",
+                    n, (n == 1) ? "" : "s", nstreams );
+                return False;
+            }
         }
+    }
 
-        free( d );
+    rfd        = (int*)malloc( nstreams * sizeof(int) );
+    sg_streams = (pid_t*)calloc( nstreams, sizeof(pid_t) );
+    if (keys != NULL)
+        slices = (bcp_slice_t*)calloc( nstreams, sizeof(bcp_slice_t) );
+
+    if (rfd == NULL || sg_streams == NULL || (keys != NULL && slices == NULL))
+    {
+        fprintf( stderr, "\\bcp: -p: Memory allocation failure\n" );
+        goto bcp_streams_leave;
+    }
+
+    if (have_range)
+    {
+        step = (hi - lo + 1) / nstreams;
+        rem  = (hi - lo + 1) % nstreams;
+
+        for (i = 0; i < nstreams; i++)
+        {
+            slices[i].s_lo = lo + i * step + ((i < rem) ? i : rem);
+            slices[i].s_hi = slices[i].s_lo + step - ((i < rem) ? 0 : 1);
+        }
+    }
+    else if (keys != NULL)
+    {
+        for (i = 0, cp = keys; i < nstreams; i++)
+        {
+            slices[i].s_key = cp;
+            if ((cp = strchr( cp, ',' )) != NULL)
+                *cp++ = '\0';
+        }
+    }
+
+    /*
+     * Streams that all select the same rows would copy them nstreams
+     * times over, so the SQL must come out differently for each.
+     */
+    env_get( g_env, "expand", &expand );
+    if (expand != NULL && *expand == '0')
+    {
+        fprintf( stderr, "\\bcp: -p: Streams need $expand to select their slice\n" );
+        goto bcp_streams_leave;
+    }
+
+    if ((exp_buf = varbuf_create( 512 )) == NULL)
+    {
+        fprintf( stderr, "\\bcp: varbuf_create: %s\n", sqsh_get_errstr() );
+        goto bcp_streams_leave;
     }
+
+    env_tran( g_env );
+    for (i = 0; i < nstreams; i++)
+    {
+        if (bcp_stream_vars( i, nstreams, (slices != NULL) ? &slices[i] : NULL,
+                             ENV_F_TRAN ) == False ||
+            sqsh_expand( varbuf_getstr( g_sqlbuf ), exp_buf,
+                         EXP_STRIPESC|EXP_COMMENT|EXP_COLUMNS ) == False)
+        {
+            fprintf( stderr, "\\bcp: sqsh_expand: %s\n", sqsh_get_errstr() );
+            env_rollback( g_env );
+            goto bcp_streams_leave;
+        }
+
+        if (i == 0)
+        {
+            if ((first = sqsh_strdup( varbuf_getstr( exp_buf ) )) == NULL)
+            {
+                fprintf( stderr, "\\bcp: -p: Memory allocation failure\n" );
+                env_rollback( g_env );
+                goto bcp_streams_leave;
+            }
+        }
+        else if (strcmp( first, varbuf_getstr( exp_buf ) ) == 0)
+        {
+            fprintf( stderr,
+                "\\bcp: -p: Streams 1 and %d would copy the same rows, use\n"
+                "\\bcp: -p: $bcp_stream, $bcp_key or $bcp_lo and $bcp_hi to split them\n",
+                i + 1 );
+            env_rollback( g_env );
+            goto bcp_streams_leave;
+        }
+    }
+    env_rollback( g_env );
+
+    if ((sc = sigcld_create()) == NULL)
+    {
+        fprintf( stderr, "\\bcp: -p: %s\n", sqsh_get_errstr() );
+        goto bcp_streams_leave;
+    }
+
+    fprintf( stderr, "\nStarting copy in %d stream%s...\n", nstreams,
+        (nstreams == 1) ? "" : "s" );
+
+    /*
+     * Anything still sitting in our buffers would otherwise be written
+     * once more by each of the streams.
+     */
+    fflush( stdout );
+    fflush( stderr );
+
+    sig_save();
+    sig_install( SIGINT, bcp_streams_signal, (void*)NULL, 0 );
+
+    gettimeofday( &tv_start, NULL );
+
+    for (i = 0; i < nstreams; i++)
+    {
+        if (pipe( p ) == -1)
+        {
+            fprintf( stderr, "\\bcp: -p: pipe: %s\n", strerror(errno) );
+            ++nfailed;
+            break;
+        }
+
+        switch (sg_streams[i] = sqsh_fork())
+        {
+            case -1:
+                fprintf( stderr, "\\bcp: -p: %s\n", sqsh_get_errstr() );
+                close( p[0] );
+                close( p[1] );
+                ++nfailed;
+                break;
+
+            case 0:
+                /*
+                 * The stream only needs the write end of its own pipe,
+                 * and installs its own signal handlers in cmd_bcp().
+                 */
+                sg_nstreams = 0;
+                close( p[0] );
+                for (j = 0; j < i; j++)
+                    close( rfd[j] );
+                while (sig_restore() >= 0);
+
+                if (bcp_stream_vars( i, nstreams,
+                                     (slices != NULL) ? &slices[i] : NULL,
+                                     0 ) == False ||
+                    jobset_run( g_jobset, "\\connect", &exit_status ) == -1 ||
+                    exit_status == CMD_FAIL)
+                {
+                    sqsh_exit( 1 );
+                }
+
+                sg_stream_fd = p[1];
+                gettimeofday( &sg_stream_start, NULL );
+                return True;
+
+            default:
+                close( p[1] );
+                rfd[i] = p[0];
+                sigcld_watch( sc, sg_streams[i] );
+                sg_nstreams = ++nstarted;
+        }
+
+        if (nfailed > 0)
+            break;
+    }
+
+    /*
+     * The streams that did start are left to finish, as what they have
+     * copied is committed a batch at a time anyway.
+     */
+    for (i = 0; i < nstarted; i++)
+    {
+        for (n = 0; n < sizeof(bcp_stream_t); n += j)
+        {
+            if ((j = read( rfd[i], (char*)&s + n, sizeof(bcp_stream_t) - n )) <= 0)
+            {
+                if (j == -1 && errno == EINTR)
+                {
+                    j = 0;
+                    continue;
+                }
+                break;
+            }
+        }
+
+        fprintf( stderr, "Stream %d", i + 1 );
+        if (slices != NULL && slices[i].s_key != NULL)
+            fprintf( stderr, " (%s)", slices[i].s_key );
+        else if (slices != NULL)
+            fprintf( stderr, " (%ld:%ld)", slices[i].s_lo, slices[i].s_hi );
+
+        if (n < sizeof(bcp_stream_t))
+        {
+            fprintf( stderr, ": Failed to connect or died\n" );
+            ++nfailed;
+            continue;
+        }
+
+        total_rows += s.s_rows;
+        fprintf( stderr, ": %d row%s in %-.4f sec. (%.2f rows per sec.)%s\n",
+            s.s_rows, (s.s_rows != 1) ? "s" : "", s.s_secs,
+            (s.s_secs > 0.0) ? (double)s.s_rows / s.s_secs : 0.0,
+            (s.s_status == CMD_FAIL) ? ", failed" :
+            (s.s_status == CMD_INTERRUPTED) ? ", interrupted" : "" );
+
+        if (s.s_status == CMD_FAIL)
+            ++nfailed;
+    }
+
+    for (i = 0; i < nstarted; i++)
+    {
+        close( rfd[i] );
+        sigcld_wait( sc, sg_streams[i], &exit_status, SIGCLD_BLOCK );
+    }
+
+    gettimeofday( &tv_end, NULL );
+
+    sg_nstreams = 0;
+    sig_restore();
+
+    fprintf( stderr, "\n%d row%s copied by %d stream%s.\n", total_rows,
+        (total_rows != 1) ? "s" : "", nstarted, (nstarted != 1) ? "s" : "" );
+
+    if (total_rows > 0)
+    {
+        secs = ELAPSED_SEC(tv_start,tv_end);
+        fprintf( stderr,
+                 "Clock Time (sec.): Total = %-.4f  Avg = %-.4f (%.2f rows per sec.)\n",
+                 secs, secs / (double)total_rows, (double)total_rows / secs );
+    }
+
+    if (nfailed > 0)
+        fprintf( stderr, "\\bcp: -p: %d stream%s failed\n", nfailed,
+            (nfailed == 1) ? "" : "s" );
+    else
+        *ret = CMD_RESETBUF;
+
+bcp_streams_leave:
+    if (sc != NULL)
+        sigcld_destroy( sc );
+    if (exp_buf != NULL)
+        varbuf_destroy( exp_buf );
+    if (first != NULL)
+        free( first );
+    if (slices != NULL)
+        free( slices );
+    if (rfd != NULL)
+        free( rfd );
+    if (sg_streams != NULL)
+        free( sg_streams );
+    sg_streams = NULL;
+
+    return False;
+}
+
+/*
+ * sqsh-3.0 - bcp_stream_vars():
+ *
+ * Sets $bcp_stream, $bcp_streams and, if there is a slice, either
+ * $bcp_key or $bcp_lo and $bcp_hi, for the stream'th (from 0) of
+ * nstreams streams.
+ */
+static int bcp_stream_vars( stream, nstreams, slice, flags )
+    int           stream;
+    int           nstreams;
+    bcp_slice_t  *slice;
+    int           flags;
+{
+    char   str[32];
+
+    sprintf( str, "%d", stream + 1 );
+    if (env_put( g_env, "bcp_stream", str, flags ) == False)
+        return False;
+
+    sprintf( str, "%d", nstreams );
+    if (env_put( g_env, "bcp_streams", str, flags ) == False)
+        return False;
+
+    if (slice == NULL)
+        return True;
+
+    if (slice->s_key != NULL)
+        return env_put( g_env, "bcp_key", slice->s_key, flags );
+
+    sprintf( str, "%ld", slice->s_lo );
+    if (env_put( g_env, "bcp_lo", str, flags ) == False)
+        return False;
+
+    sprintf( str, "%ld", slice->s_hi );
+    return env_put( g_env, "bcp_hi", str, flags );
+}
+
+/*
+ * sqsh-3.0 - bcp_stream_exit():
+ *
+ * Sends what a \bcp -p stream got done back to sqsh and exits.
+ */
+static void bcp_stream_exit( return_code, total_rows )
+    int    return_code;
+    int    total_rows;
+{
+    bcp_stream_t     s;
+    struct timeval   tv_end;
+    int              n;
+    int              done;
+
+    gettimeofday( &tv_end, NULL );
+
+    s.s_status = (return_code == CMD_FAIL) ? CMD_FAIL :
+                 (sg_interrupted ? CMD_INTERRUPTED : CMD_RESETBUF);
+    s.s_rows   = total_rows;
+    s.s_secs   = ELAPSED_SEC(sg_stream_start,tv_end);
+
+    for (done = 0; done < sizeof(bcp_stream_t); done += n)
+    {
+        if ((n = write( sg_stream_fd, (char*)&s + done,
+                        sizeof(bcp_stream_t) - done )) == -1)
+        {
+            if (errno == EINTR)
+            {
+                n = 0;
+                continue;
+            }
+            break;
+        }
+    }
+    close( sg_stream_fd );
+
+    sqsh_exit( (s.s_status == CMD_FAIL) ? 1 : 0 );
+}
+
+/*
+ * sqsh-3.0 - bcp_streams_signal():
+ *
+ * Passes an interrupt of \bcp -p on to its streams.
+ */
+static void bcp_streams_signal( sig, user_data )
+    int sig;
+    void *user_data;
+{
+    int   i;
+
+    for (i = 0; i < sg_nstreams; i++)
+        kill( sg_streams[i], SIGINT );
 }
 
 /*
@@ -1416,6 +3864,19 @@ static void bcp_signal( sig, user_data )
     {
         ct_cancel( sg_bcp_connection, (CS_COMMAND*)NULL, CS_CANCEL_ATTN );
     }
+
+#if defined(HAVE_PTHREAD_H)
+    /*
+     * sqsh-3.0: The fetching thread may be in the middle of a ct_fetch(),
+     * so it is only interrupted, the rest is cancelled once it has
+     * been stopped.
+     */
+    if (sg_bcp_pipe != NULL)
+    {
+        ct_cancel( g_connection, (CS_COMMAND*)NULL, CS_CANCEL_ATTN );
+        return;
+    }
+#endif
     ct_cancel( g_connection, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
 }
 
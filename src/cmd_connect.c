@@ -1670,6 +1670,12 @@ static CS_RETCODE syb_server_cb (ctx, con, msg)
          */
         if (msg->severity >= 0 || msg->msgnumber == 10)
         {
+            /*
+             * sqsh-3.0: Push out any rows that are still buffered by the
+             * display routines, so they don't end up behind this message.
+             */
+            dsp_sync();
+
             /*
              * sqsh-2.5 : Implementation of p2f feature.
              * When the number of messages handled by this callback handler exceeds the limit specified in p2faxm,
@@ -1721,8 +1727,14 @@ static CS_RETCODE syb_server_cb (ctx, con, msg)
                 /*
                  * Otherwise, it is just an informational (e.g. print) message
                  * from the server, so send it to stdout.
+                 *
+                 * sqsh-3.0: Unless stdout is being gzipped (\go -Z), in
+                 * which case it would end up in the middle of the archive.
                  */
-                dest_fp = (p2fstat == True) ? g_p2f_fp : stdout;
+                if (p2fstat == True)
+                    dest_fp = g_p2f_fp;
+                else
+                    dest_fp = dsp_zipping( stdout ) ? stderr : stdout;
                 wrap_print( dest_fp, msg->text );
                 fflush( dest_fp );
             }
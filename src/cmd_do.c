@@ -48,7 +48,7 @@
 static void    cmd_do_sigint_jmp     _ANSI_ARGS(( int, void* )) ;
 static void    cmd_do_sigint_cancel  _ANSI_ARGS(( int, void* )) ;
 static int     cmd_do_exec           _ANSI_ARGS(( CS_CONNECTION*, char*,
-                                                  char* ));
+                                                  char*, dsp_limit_t* ));
 
 /*
 ** sg_jmp_buf: The following buffer is used to contain the location
@@ -80,6 +80,7 @@ int cmd_do( argc, argv )
 	int               have_error = False;
 	int               exit_status;
 	int               do_connection = True;
+	dsp_limit_t       limit;
 
 	/*
 	** Since we will be temporarily replacing some of our global
@@ -102,10 +103,33 @@ int cmd_do( argc, argv )
 	if (g_password != NULL)
 		strcpy ( orig_password, g_password);
 
-	while ((ch = sqsh_getopt( argc, argv, "S:U:P:D:n" )) != EOF)
+	/*
+	** sqsh-3.0: The rows looped over are subject to the same row limits
+	** as those displayed by \go.  They are kept to ourselves rather than
+	** put in the environment, so that they don't also apply to the
+	** batches run from the body of the loop.
+	*/
+	limit.l_maxrows   = g_dsp_props.p_rowlimit;
+	limit.l_batchrows = g_dsp_props.p_batchlimit;
+	limit.l_nrows     = 0;
+	limit.l_ncut      = 0;
+
+	while ((ch = sqsh_getopt( argc, argv, "S:U:P:D:nr:R:" )) != EOF)
 	{
 		switch (ch)
 		{
+			case 'r' :
+				limit.l_maxrows = atoi( sqsh_optarg );
+				ret = (limit.l_maxrows >= 0);
+				if (ret != True)
+					sqsh_set_error( SQSH_E_INVAL, "Invalid row limit" );
+				break;
+			case 'R' :
+				limit.l_batchrows = atoi( sqsh_optarg );
+				ret = (limit.l_batchrows >= 0);
+				if (ret != True)
+					sqsh_set_error( SQSH_E_INVAL, "Invalid row limit" );
+				break;
 			case 'n' :
 				do_connection = False;
 				ret = True;
@@ -140,12 +164,14 @@ int cmd_do( argc, argv )
 	if( (argc - sqsh_optind) > 0 || have_error == True)
 	{
 		fprintf( stderr,
-			"Use: \\do [-n] [-S server] [-U user] [-P pass] [-D db]\n"
+			"Use: \\do [-n] [-S server] [-U user] [-P pass] [-D db] [-r rows] [-R rows]\n"
 			"        -n   Do not establish new connection (cannot issue SQL)\n"
 			"        -S   Perform do-loop on specified server\n"
 			"        -U   User name for do-loop connection\n"
 			"        -P   Password-loop connection\n"
-			"        -D   Database context for activity\n" );
+			"        -D   Database context for activity\n"
+			"        -r   Loop over at most rows rows of each result set\n"
+			"        -R   Loop over at most rows rows in all\n" );
 		env_rollback( g_env );
 		return(CMD_FAIL);
 	}
@@ -266,7 +292,7 @@ int cmd_do( argc, argv )
 
 	if (ret != CMD_FAIL)
 	{
-		ret = cmd_do_exec( orig_conn, sql, varbuf_getstr(do_buf) );
+		ret = cmd_do_exec( orig_conn, sql, varbuf_getstr(do_buf), &limit );
 	}
 
 	if (do_connection == True &&
@@ -302,10 +328,11 @@ int cmd_do( argc, argv )
 	return(ret);
 }
 
-static int cmd_do_exec( conn, sql, dobuf )
+static int cmd_do_exec( conn, sql, dobuf, limit )
 	CS_CONNECTION  *conn;
 	char           *sql;
 	char           *dobuf;
+	dsp_limit_t    *limit;
 {
 	CS_COMMAND *cmd;
 	int         ret;
@@ -412,6 +439,11 @@ static int cmd_do_exec( conn, sql, dobuf )
 					return(CMD_FAIL);
 				}
 
+				/*
+				** sqsh-3.0: Stop looping once a row limit is reached.
+				*/
+				desc->d_limit = limit;
+
 				if (sg_canceled == True)
 				{
 					ct_cancel( conn, (CS_COMMAND*)NULL, CS_CANCEL_ALL );
@@ -510,6 +542,15 @@ static int cmd_do_exec( conn, sql, dobuf )
 
 	ct_cmd_drop( cmd );
 	sig_restore();
+
+	if (limit->l_ncut > 0)
+	{
+		fprintf( stderr,
+			"\\do: Row limit reached: %d row%s processed, remainder of %d result set%s skipped\n",
+			(int)limit->l_nrows, (limit->l_nrows == 1) ? "" : "s",
+			(int)limit->l_ncut, (limit->l_ncut == 1) ? "" : "s" );
+	}
+
 	return(CMD_RESETBUF);
 }
 
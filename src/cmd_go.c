@@ -35,6 +35,11 @@
 #include "sqsh_buf.h"
 #include "sqsh_filter.h"
 #include "sqsh_stdin.h"
+#include "sqsh_hist.h"
+#include "sqsh_fork.h"
+#include "sqsh_sig.h"
+#include "sqsh_sigcld.h"
+#include "sqsh_init.h"
 #include "cmd.h"
 #include "cmd_misc.h"
 #include "dsp.h"
@@ -49,6 +54,37 @@ USE(RCS_Id)
 static int IgnoreCommentArgs _ANSI_ARGS(( int, char ** )) ;
 static void argv_shift _ANSI_ARGS(( int, char **, int )) ;
 
+/* sqsh-3.0 - Publish the phase timings of the last batch */
+static void go_set_timing _ANSI_ARGS(( void )) ;
+
+/* sqsh-3.0 - Latency reporting and the \go -c load generator */
+static void go_latency     _ANSI_ARGS(( hist_t* )) ;
+static int  go_xact        _ANSI_ARGS(( char*, int )) ;
+static int  go_load        _ANSI_ARGS(( char*, int, int, int, double, int, hist_t* )) ;
+static void go_worker      _ANSI_ARGS(( char*, int, int, int, int, double, int )) ;
+static void go_load_signal _ANSI_ARGS(( int, void* )) ;
+static int  go_read        _ANSI_ARGS(( int, void*, int )) ;
+static int  go_write       _ANSI_ARGS(( int, void*, int )) ;
+
+/*
+ * sqsh-3.0 - What each \go -c worker sends back to the parent once it
+ * is done.
+ */
+typedef struct {
+	int       r_status;         /* DSP_SUCCEED, DSP_FAIL or DSP_INTERRUPTED */
+	long      r_nxacts;         /* Measured xacts that succeeded */
+	long      r_nfailed;        /* Measured xacts that raised an error */
+	double    r_elapsed;        /* Seconds from first to last measured xact */
+	hist_t    r_hist;           /* Latencies of the successful xacts */
+} go_result_t;
+
+/*
+ * sqsh-3.0 - The workers of a running \go -c, so that an interrupt
+ * can be passed on to them.
+ */
+static pid_t *sg_workers  = NULL;
+static int    sg_nworkers = 0;
+
 /*
  * The following macro is used to convert a start time and end
  * time into total elapsed number of seconds, to the decimal
@@ -79,6 +115,7 @@ int cmd_go( argc, argv )
 	char             *filter;               /* Dito. */
 	char             *filter_prog;          /* Dito. */
 	char             *nosepline;            /* Dito. */
+	char             *progress;             /* Dito. */
 	char             *sql;
 	int               sql_len;
 	char              pause_buf[5];         /* Buffer for "hit enter" */
@@ -94,6 +131,17 @@ int cmd_go( argc, argv )
 	int               sleep_time    = 0;
 	int               xact          = 0;
 	double            total_runtime = 0.0;
+	int               warmup        = 0;     /* sqsh-3.0 - Unmeasured xacts */
+	double            duration      = 0.0;   /* sqsh-3.0 - Run for this long */
+	double            elapsed       = 0.0;
+	int               measured      = 0;
+	int               last_xact;
+	int               timed;
+	char             *hist_file     = NULL;
+	FILE             *hist_fp;
+	hist_t           *hist          = NULL;
+	struct timeval    tv_begin;
+	int               nworkers      = 0;     /* sqsh-3.0 - Sessions for -c */
 	int               dsp_flags     = 0;
 	int               dsp_old       = -1;
 	char             *dsp_name      = NULL;
@@ -122,7 +170,7 @@ int cmd_go( argc, argv )
 		fprintf( stderr, "\\go: Unbalanced comment tokens encountered\n" );
 		have_error = True;
 	}
-	else while ((ch = sqsh_getopt( argc, argv, "nfhps:m:x;w:d:t;T:el" )) != EOF) 
+	else while ((ch = sqsh_getopt( argc, argv, "nfhps:m:x;w:d:t;T:elF:Z:r:R:PW:L:H:c:o:" )) != EOF) 
 	{
 		switch (ch) 
 		{
@@ -152,6 +200,124 @@ int cmd_go( argc, argv )
 				}
 				break;
 
+			case 'F' :
+				/*
+				 * sqsh-3.0 - Number of rows to bind per ct_fetch().
+				 */
+				if (env_put( g_env, "fetch_rows", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -F: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'Z' :
+				/*
+				 * sqsh-3.0 - gzip the output of the result set.
+				 */
+				if (env_put( g_env, "output_compress", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -Z: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'r' :
+				/*
+				 * sqsh-3.0 - Display at most this many rows of each
+				 * result set.
+				 */
+				if (env_put( g_env, "row_limit", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -r: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'o' :
+				/*
+				 * sqsh-3.0 - Sort the rows of each result set on
+				 * these columns.
+				 */
+				if (env_put( g_env, "order_by", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -o: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'R' :
+				/*
+				 * sqsh-3.0 - Display at most this many rows of the
+				 * whole batch.
+				 */
+				if (env_put( g_env, "batch_row_limit", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -R: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'P' :
+				/*
+				 * sqsh-3.0 - Report progress on stderr, every second
+				 * unless $progress already asks for something else.
+				 */
+				env_get( g_env, "progress", &progress );
+				if ((progress == NULL || atoi( progress ) <= 0) &&
+				    env_put( g_env, "progress", "1", ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\go: -P: %s\n", sqsh_get_errstr() );
+					have_error = True;
+				}
+				break;
+
+			case 'W' :
+				/*
+				 * sqsh-3.0 - Run the batch this many times before
+				 * starting to measure.
+				 */
+				warmup = atoi(sqsh_optarg);
+				if( warmup < 0 ) 
+				{
+					fprintf( stderr, "\\go: -W: Invalid number of warm-up transactions\n" );
+					have_error = True;
+				}
+				break;
+
+			case 'L' :
+				/*
+				 * sqsh-3.0 - Keep repeating the batch until this many
+				 * seconds have passed, rather than a fixed number of times.
+				 */
+				duration = atof(sqsh_optarg);
+				if( duration <= 0.0 ) 
+				{
+					fprintf( stderr, "\\go: -L: Invalid duration\n" );
+					have_error = True;
+				}
+				break;
+
+			case 'c' :
+				/*
+				 * sqsh-3.0 - Run the batch concurrently in this many
+				 * sessions of their own.
+				 */
+				nworkers = atoi(sqsh_optarg);
+				if( nworkers < 1 ) 
+				{
+					fprintf( stderr, "\\go: -c: Invalid number of sessions\n" );
+					have_error = True;
+				}
+				break;
+
+			case 'H' :
+				/*
+				 * sqsh-3.0 - Write the latency histogram to this file.
+				 */
+				hist_file = sqsh_optarg;
+				break;
+
 			case 'd' :
 				if (env_put( g_env, "DISPLAY", sqsh_optarg, ENV_F_TRAN ) == False)
 				{
@@ -230,23 +396,34 @@ int cmd_go( argc, argv )
 	if( (argc - sqsh_optind) > 1 || have_error) 
 	{
 	    fprintf( stderr, 
-		"Use: \\go [-d display] [-e] [-h] [-f] [-l] [-n] [-p] [-m mode] [-s sec]\n"
-		"          [-t [filter]] [-w width] [-x [xgeom]] [-T title] [xacts]\n"
+		"Use: \\go [-c sessions] [-d display] [-e] [-F rows] [-h] [-f] [-l] [-n] [-p] [-P] [-m mode] [-s sec]\n"
+		"          [-t [filter]] [-w width] [-x [xgeom]] [-T title] [-Z level]\n"
+		"          [-o cols] [-r rows] [-R rows] [-W xacts] [-L sec] [-H file] [xacts]\n"
+		"     -c sessions Run batch concurrently in sessions new connections\n"
 		"     -d display  When used with -x, send result to named display\n"
 		"     -e          Echo SQL buffer to output\n"
+		"     -F rows     Override value of $fetch_rows\n"
 		"     -h          Suppress headers\n"
 		"     -f          Suppress footers\n"
+		"     -H file     Write the latency histogram of the xacts to file\n"
 		"     -l          Suppress line separators with pretty style output mode\n"
+		"     -L sec      Repeat batch for sec seconds instead of xacts times\n"
 		"     -n          Do not expand variables\n"
+		"     -o cols     Override value of $order_by (sort on the client)\n"
 		"     -p          Report runtime statistics\n"
+		"     -P          Report progress on stderr while fetching\n"
+		"     -r rows     Override value of $row_limit\n"
+		"     -R rows     Override value of $batch_row_limit\n"
 		"     -m mode     Switch display mode for result set\n"
 		"     -s sec      Sleep sec seconds between transactions\n"
 		"     -t [filter] Filter SQL through program\n"
 		"                 Optional filter value overrides default variable $filter_prog\n"
 		"     -w width    Override value of $width\n"
+		"     -W xacts    Run batch xacts times before measuring\n"
 		"     -x [xgeom]  Send result set to a XWin output window\n"
 		"                 Optional xgeom value overrides default variable $xgeom\n"
 		"     -T title    Used in conjunction with -x to set window title\n"
+		"     -Z level    Override value of $output_compress\n"
 		"     xacts       Repeat batch xacts times\n" );
 
 		env_rollback( g_env );
@@ -267,6 +444,13 @@ int cmd_go( argc, argv )
 			env_rollback( g_env );
 			return CMD_FAIL;
 		}
+
+		if( duration > 0.0 )
+		{
+			fprintf( stderr, "\\go: -L may not be combined with xacts\n" );
+			env_rollback( g_env );
+			return CMD_FAIL;
+		}
 	}
 
 	/*
@@ -470,19 +654,64 @@ int cmd_go( argc, argv )
 
 	}
 
+	/*
+	 * sqsh-3.0 - The latency of every measured transaction goes into
+	 * a histogram, so that -p can report the tail and not just the
+	 * average.
+	 */
+	if (show_stats || hist_file != NULL || nworkers > 0)
+	{
+		if ((hist = hist_create()) == NULL)
+		{
+			fprintf( stderr, "\\go: %s\n", sqsh_get_errstr() );
+			env_rollback( g_env );
+			return CMD_FAIL;
+		}
+	}
+	timed = (hist != NULL || duration > 0.0);
+
+	/*
+	 * sqsh-3.0 - With -c the transactions are run by worker processes,
+	 * each with a connection of its own, and all we do here is wait
+	 * for them and report.
+	 */
+	if (nworkers > 0)
+	{
+		env_set( g_internal_env, "?", "0" );
+
+		switch (go_load( sql, nworkers, warmup, iterations, duration, 
+		                 sleep_time, hist ))
+		{
+			case DSP_SUCCEED:
+				goto cmd_go_dump;
+			case DSP_INTERRUPTED:
+				env_set( g_internal_env, "?", "-1" );
+				goto cmd_go_interrupt;
+			default:
+				env_set( g_internal_env, "?", "-1" );
+				goto cmd_go_error;
+		}
+	}
+
 	/*
 	 * For each iteration of the execution the user requested
 	 * we go through the rigamarole of executing the same
-	 * transaction over-and-over.
+	 * transaction over-and-over.  The warm-up transactions come
+	 * first and are not measured, and with -L we carry on until
+	 * the time is up.
 	 */
-	while (++xact <= iterations) 
+	while (duration > 0.0 ? (xact < warmup || elapsed < duration)
+	                      : (xact < warmup + iterations))
 	{
+		++xact;
+		last_xact = (duration <= 0.0 && xact == warmup + iterations);
 
 		/*
 		 * Allocate a command structure.
 		 */
 		if (ct_cmd_alloc( g_connection, &cmd ) != CS_SUCCEED)
 		{
+			hist_destroy( hist );
 			env_rollback( g_env );
 			return CMD_FAIL;
 		}
@@ -495,6 +724,7 @@ int cmd_go( argc, argv )
 							 CS_UNUSED ) != CS_SUCCEED)
 		{
 			ct_cmd_drop( cmd );
+			hist_destroy( hist );
 			env_rollback( g_env );
 			return CMD_FAIL;
 		}
@@ -502,14 +732,23 @@ int cmd_go( argc, argv )
 		/*
 		 * If we need to calculate the run-time, then do so.
 		 */
-		if (show_stats)
+		if (timed)
+		{
 			gettimeofday( &tv_start, NULL );
 
+			if (xact == warmup + 1)
+				tv_begin = tv_start;
+		}
+
+		if (show_stats)
+			dsp_flags |= DSP_F_TIMING;
+
 		/*
 		 * Have dsp_print() only display output on the final 
-		 * iteration.
+		 * iteration (with -L there is no telling which one that
+		 * is, so nothing is displayed).
 		 */
-		if (xact != iterations)
+		if (!last_xact)
 			dsp_flags |= DSP_F_NOTHING;
 		else
 			dsp_flags &= ~(DSP_F_NOTHING);
@@ -542,12 +781,21 @@ int cmd_go( argc, argv )
 				goto cmd_go_error;
 		}
 
-		if( show_stats ) 
+		if( timed && xact > warmup ) 
 		{
 			gettimeofday( &tv_end, NULL );
 			total_runtime += ELAPSED_SEC(tv_start,tv_end);
+			elapsed        = ELAPSED_SEC(tv_begin,tv_end);
+			++measured;
+
+			if (hist != NULL)
+				hist_record( hist, 
+					(long)(ELAPSED_SEC(tv_start,tv_end) * 1000000.0) );
 		}
 
+		if( show_stats ) 
+			go_set_timing();
+
 		if (batch_pause != NULL && *batch_pause == '1')
 		{
 			if (sqsh_getinput( "Paused. Hit enter to continue...", pause_buf, 0, 
@@ -561,21 +809,98 @@ int cmd_go( argc, argv )
 		 * If we have more transactions to go and the user has asked
 		 * us to sleep between iterations, then do so.
 		 */
-		if( xact != iterations && sleep_time > 0 )
+		if( !last_xact && sleep_time > 0 && 
+		    (duration <= 0.0 || xact < warmup || elapsed < duration) )
 			sleep( sleep_time );
 
 	} /* while trasactions remain */
 
 	if( show_stats ) 
 	{
-		if( iterations > 1 )
-			printf( "%d xact%s:\n", iterations, (iterations > 1) ? "s" : "" );
+		if( measured > 1 || warmup > 0 )
+		{
+			printf( "%d xact%s", measured, (measured > 1) ? "s" : "" );
+			if( warmup > 0 )
+				printf( " (after %d warm-up xact%s)", warmup, 
+					(warmup > 1) ? "s" : "" );
+			printf( ":\n" );
+		}
 
 		printf(
 			"Clock Time (sec.): Total = %.3f  Avg = %.3f (%4.2f xacts per sec.)\n",
 			total_runtime, 
-			(total_runtime / (double)iterations),
-			((double)1.0) / (total_runtime / (double)iterations));
+			(total_runtime / (double)measured),
+			((double)1.0) / (total_runtime / (double)measured));
+
+		/*
+		 * sqsh-3.0: The spread of the transaction times, from the
+		 * histogram (to within 1%).
+		 */
+		if( measured > 1 )
+			go_latency( hist );
+
+		/*
+		 * sqsh-3.0: Report how the output of the (last) transaction
+		 * was written, so the effect of $output_flush can be checked.
+		 */
+		printf( "Output: %ld bytes in %ld write%s\n",
+			g_dsp_stats.s_nbytes, g_dsp_stats.s_nwrites,
+			(g_dsp_stats.s_nwrites == 1) ? "" : "s" );
+
+		/*
+		 * sqsh-3.0: And where the time went, overall and for each
+		 * result set, to tell a slow server from a slow client.
+		 */
+		if (g_dsp_stats.s_timed)
+		{
+			printf( "Phases (ms): Send = %.3f  First row = %.3f  Fetch = %.3f"
+			        "  Convert = %.3f  Write = %.3f  Total = %.3f\n",
+				g_dsp_stats.s_send * 1000.0,
+				(g_dsp_stats.s_first < 0.0) ? 0.0 : g_dsp_stats.s_first * 1000.0,
+				g_dsp_stats.s_fetch * 1000.0,
+				g_dsp_stats.s_convert * 1000.0,
+				g_dsp_stats.s_write * 1000.0,
+				g_dsp_stats.s_total * 1000.0 );
+
+			for (i = 0; i < min( g_dsp_stats.s_nsets, DSP_PHASE_MAXSETS ); i++)
+			{
+				if (i == DSP_PHASE_MAXSETS - 1 && g_dsp_stats.s_nsets > DSP_PHASE_MAXSETS)
+					printf( "  Result sets %d-%d:", i + 1, g_dsp_stats.s_nsets );
+				else
+					printf( "  Result set %d:", i + 1 );
+
+				printf( " %ld rows, %ld bytes, First row = %.3f  Fetch = %.3f"
+				        "  Convert = %.3f\n",
+					g_dsp_stats.s_sets[i].ph_nrows,
+					g_dsp_stats.s_sets[i].ph_nbytes,
+					(g_dsp_stats.s_sets[i].ph_first < 0.0) ? 0.0 :
+						g_dsp_stats.s_sets[i].ph_first * 1000.0,
+					g_dsp_stats.s_sets[i].ph_fetch * 1000.0,
+					g_dsp_stats.s_sets[i].ph_convert * 1000.0 );
+			}
+		}
+	}
+
+	/*
+	 * sqsh-3.0: Dump the histogram where it can be compared with
+	 * that of another run.
+	 */
+cmd_go_dump:
+	if (hist_file != NULL)
+	{
+		if ((hist_fp = fopen( hist_file, "w" )) == NULL)
+		{
+			fprintf( stderr, "\\go: -H: %s: %s\n", hist_file, strerror(errno) );
+			goto cmd_go_error;
+		}
+
+		i = hist_dump( hist, hist_fp );
+
+		if (fclose( hist_fp ) != 0 || i != 0)
+		{
+			fprintf( stderr, "\\go: -H: %s: %s\n", hist_file, strerror(errno) );
+			goto cmd_go_error;
+		}
 	}
 
 	goto cmd_go_succeed;
@@ -607,6 +932,8 @@ cmd_go_succeed:
 	return_code = CMD_RESETBUF;
 
 cmd_go_leave:
+	hist_destroy( hist );
+
 	if (dsp_old != -1)
 	{
 		dsp_prop( DSP_SET, DSP_STYLE, (void*)&dsp_old, DSP_UNUSED );
@@ -733,3 +1060,518 @@ static void argv_shift( argc, argv, idx )
     argv[argc - 1] = cptr ;
 }
 
+
+/*
+ * sqsh-3.0 - Function: go_set_timing
+ *
+ * Makes the phase timings of the batch just run by dsp_cmd() available
+ * to scripts as the internal variables $?_send_ms, $?_first_ms,
+ * $?_fetch_ms, $?_convert_ms, $?_write_ms, $?_total_ms, $?_rows,
+ * $?_bytes and $?_sets.
+ */
+static void go_set_timing()
+{
+    char  nbr[64];
+
+    if (!g_dsp_stats.s_timed)
+        return;
+
+    sprintf( nbr, "%.3f", g_dsp_stats.s_send * 1000.0 );
+    env_set( g_internal_env, "?_send_ms", nbr );
+
+    sprintf( nbr, "%.3f",
+        (g_dsp_stats.s_first < 0.0) ? 0.0 : g_dsp_stats.s_first * 1000.0 );
+    env_set( g_internal_env, "?_first_ms", nbr );
+
+    sprintf( nbr, "%.3f", g_dsp_stats.s_fetch * 1000.0 );
+    env_set( g_internal_env, "?_fetch_ms", nbr );
+
+    sprintf( nbr, "%.3f", g_dsp_stats.s_convert * 1000.0 );
+    env_set( g_internal_env, "?_convert_ms", nbr );
+
+    sprintf( nbr, "%.3f", g_dsp_stats.s_write * 1000.0 );
+    env_set( g_internal_env, "?_write_ms", nbr );
+
+    sprintf( nbr, "%.3f", g_dsp_stats.s_total * 1000.0 );
+    env_set( g_internal_env, "?_total_ms", nbr );
+
+    sprintf( nbr, "%ld", g_dsp_stats.s_nrows );
+    env_set( g_internal_env, "?_rows", nbr );
+
+    sprintf( nbr, "%ld", g_dsp_stats.s_nbytes );
+    env_set( g_internal_env, "?_bytes", nbr );
+
+    sprintf( nbr, "%d", g_dsp_stats.s_nsets );
+    env_set( g_internal_env, "?_sets", nbr );
+}
+
+/*
+ * sqsh-3.0 - Function: go_latency
+ *
+ * Prints the spread of the transaction times recorded in hist (to
+ * within 1%).
+ */
+static void go_latency( hist )
+	hist_t  *hist;
+{
+	printf( "Latency (ms): Min = %.3f  p50 = %.3f  p90 = %.3f"
+	        "  p99 = %.3f  p99.9 = %.3f  Max = %.3f\n",
+		(double)hist->h_min / 1000.0,
+		(double)hist_percentile( hist, 50.0 ) / 1000.0,
+		(double)hist_percentile( hist, 90.0 ) / 1000.0,
+		(double)hist_percentile( hist, 99.0 ) / 1000.0,
+		(double)hist_percentile( hist, 99.9 ) / 1000.0,
+		(double)hist->h_max / 1000.0 );
+}
+
+/*
+ * sqsh-3.0 - Function: go_xact
+ *
+ * Runs sql once on g_connection, returning the result of dsp_cmd().
+ */
+static int go_xact( sql, flags )
+	char  *sql;
+	int    flags;
+{
+	CS_COMMAND  *cmd;
+	int          ret;
+
+	if (ct_cmd_alloc( g_connection, &cmd ) != CS_SUCCEED)
+		return DSP_FAIL;
+
+	if (ct_command( cmd, CS_LANG_CMD, (CS_VOID*)sql, CS_NULLTERM,
+	                CS_UNUSED ) != CS_SUCCEED)
+	{
+		ct_cmd_drop( cmd );
+		return DSP_FAIL;
+	}
+
+	ret = dsp_cmd( stdout, cmd, sql, flags );
+	ct_cmd_drop( cmd );
+
+	return ret;
+}
+
+/*
+ * sqsh-3.0 - Function: go_load
+ *
+ * The \go -c load generator.  Forks nworkers worker processes, each of
+ * which opens a connection of its own (with \connect, so with the
+ * same $DSQUERY, $username, etc. as this one) and then runs sql the
+ * same way a plain \go with -W, -L, -s and xacts would, but without
+ * displaying anything.  The workers hold off until all of them are
+ * connected, so that they start at the same time, and send their
+ * counts and latency histograms back through a pipe each, which are
+ * added up in hist and reported.
+ *
+ * Returns DSP_SUCCEED, DSP_FAIL if a worker could not be started or
+ * failed, or DSP_INTERRUPTED.
+ */
+static int go_load( sql, nworkers, warmup, iterations, duration, sleep_time, hist )
+	char    *sql;
+	int      nworkers;
+	int      warmup;
+	int      iterations;
+	double   duration;
+	int      sleep_time;
+	hist_t  *hist;
+{
+	sigcld_t        *sc       = NULL;
+	go_result_t     *r        = NULL;
+	int             *rfd      = NULL;
+	int              start[2] = { -1, -1 };
+	int              p[2];
+	int              ret      = DSP_SUCCEED;
+	int              nready   = 0;
+	int              nstarted = 0;
+	long             nxacts   = 0;
+	long             nfailed  = 0;
+	double           elapsed  = 0.0;
+	int              exit_status;
+	char             c;
+	int              i, j;
+
+	sg_workers = (pid_t*)calloc( nworkers, sizeof(pid_t) );
+	rfd        = (int*)malloc( nworkers * sizeof(int) );
+	r          = (go_result_t*)malloc( sizeof(go_result_t) );
+
+	if (sg_workers == NULL || rfd == NULL || r == NULL)
+	{
+		fprintf( stderr, "\\go: -c: Memory allocation failure\n" );
+		ret = DSP_FAIL;
+		goto go_load_leave;
+	}
+
+	if ((sc = sigcld_create()) == NULL)
+	{
+		fprintf( stderr, "\\go: -c: %s\n", sqsh_get_errstr() );
+		ret = DSP_FAIL;
+		goto go_load_leave;
+	}
+
+	if (pipe( start ) == -1)
+	{
+		fprintf( stderr, "\\go: -c: pipe: %s\n", strerror(errno) );
+		ret = DSP_FAIL;
+		goto go_load_leave;
+	}
+
+	/*
+	 * Anything still sitting in our buffers would otherwise be written
+	 * once more by each of the workers.
+	 */
+	fflush( stdout );
+	fflush( stderr );
+
+	/*
+	 * Pass an interrupt on to the workers (as a SIGTERM, see
+	 * go_worker()), who stop after the transaction they are running.
+	 */
+	sig_save();
+	sig_install( SIGINT, go_load_signal, (void*)NULL, 0 );
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (pipe( p ) == -1)
+		{
+			fprintf( stderr, "\\go: -c: pipe: %s\n", strerror(errno) );
+			ret = DSP_FAIL;
+			break;
+		}
+
+		switch (sg_workers[i] = sqsh_fork())
+		{
+			case -1:
+				fprintf( stderr, "\\go: -c: %s\n", sqsh_get_errstr() );
+				close( p[0] );
+				close( p[1] );
+				ret = DSP_FAIL;
+				break;
+
+			case 0:
+				/*
+				 * The worker only needs its own end of its own pipe
+				 * and the read end of start.
+				 */
+				sg_nworkers = 0;
+				close( start[1] );
+				close( p[0] );
+				for (j = 0; j < i; j++)
+					close( rfd[j] );
+
+				go_worker( sql, start[0], p[1], warmup, iterations, duration,
+				           sleep_time );
+				/* NOT REACHED */
+
+			default:
+				close( p[1] );
+				rfd[i] = p[0];
+				sigcld_watch( sc, sg_workers[i] );
+				sg_nworkers = ++nstarted;
+		}
+
+		if (ret != DSP_SUCCEED)
+			break;
+	}
+
+	/*
+	 * Each worker lets us know whether it managed to connect.
+	 */
+	for (i = 0; i < nstarted; i++)
+	{
+		if (go_read( rfd[i], &c, 1 ) == 1 && c == '1')
+			++nready;
+	}
+
+	if (ret == DSP_SUCCEED && nready < nworkers)
+	{
+		fprintf( stderr, "\\go: -c: %d of %d session%s failed to connect\n",
+			nworkers - nready, nworkers, (nworkers == 1) ? "" : "s" );
+		ret = DSP_FAIL;
+	}
+
+	/*
+	 * If anything went wrong the workers are sent on their way
+	 * without running anything.
+	 */
+	if (ret != DSP_SUCCEED)
+	{
+		for (i = 0; i < nstarted; i++)
+			kill( sg_workers[i], SIGTERM );
+	}
+
+	/*
+	 * Closing the write end of start lets them all go at once.
+	 */
+	close( start[1] );
+	start[1] = -1;
+
+	for (i = 0; i < nstarted; i++)
+	{
+		if (go_read( rfd[i], (void*)r, sizeof(go_result_t) ) 
+			!= sizeof(go_result_t))
+		{
+			if (ret == DSP_SUCCEED)
+			{
+				fprintf( stderr, "\\go: -c: Session %d died\n", i + 1 );
+				ret = DSP_FAIL;
+			}
+			continue;
+		}
+
+		if (r->r_status == DSP_INTERRUPTED && ret == DSP_SUCCEED)
+			ret = DSP_INTERRUPTED;
+		else if (r->r_status == DSP_FAIL && ret != DSP_FAIL)
+		{
+			fprintf( stderr, "\\go: -c: Session %d failed\n", i + 1 );
+			ret = DSP_FAIL;
+		}
+
+		nxacts  += r->r_nxacts;
+		nfailed += r->r_nfailed;
+		elapsed  = max( elapsed, r->r_elapsed );
+		hist_merge( hist, &r->r_hist );
+	}
+
+	for (i = 0; i < nstarted; i++)
+	{
+		close( rfd[i] );
+		sigcld_wait( sc, sg_workers[i], &exit_status, SIGCLD_BLOCK );
+	}
+
+	sg_nworkers = 0;
+	sig_restore();
+
+	/*
+	 * The throughput is taken over the measured part of the run of the
+	 * session that took longest, so the time spent connecting and
+	 * warming up does not count.
+	 */
+	if (ret != DSP_FAIL && nxacts + nfailed > 0)
+	{
+		printf( "%d session%s, %ld xact%s", nworkers, 
+			(nworkers == 1) ? "" : "s", nxacts + nfailed,
+			(nxacts + nfailed == 1) ? "" : "s" );
+		if (warmup > 0)
+			printf( " (after %d warm-up xact%s each)", warmup,
+				(warmup == 1) ? "" : "s" );
+		printf( ":\n" );
+
+		printf( "Clock Time (sec.): Total = %.3f  (%4.2f xacts per sec.)\n",
+			elapsed, (elapsed > 0.0) ? (double)nxacts / elapsed : 0.0 );
+
+		if (nfailed > 0)
+			printf( "Failed: %ld xact%s (not in the latencies)\n", nfailed,
+				(nfailed == 1) ? "" : "s" );
+
+		if (nxacts > 0)
+			go_latency( hist );
+	}
+
+go_load_leave:
+	if (start[0] != -1)
+		close( start[0] );
+	if (start[1] != -1)
+		close( start[1] );
+	if (sc != NULL)
+		sigcld_destroy( sc );
+	if (r != NULL)
+		free( r );
+	if (rfd != NULL)
+		free( rfd );
+	if (sg_workers != NULL)
+		free( sg_workers );
+	sg_workers = NULL;
+
+	return ret;
+}
+
+/*
+ * sqsh-3.0 - Function: go_worker
+ *
+ * The body of a \go -c worker process: connects, tells the parent
+ * whether that worked through result_fd, waits for start_fd to be
+ * closed, runs the transactions and sends a go_result_t back through
+ * result_fd.  Never returns.
+ */
+static void go_worker( sql, start_fd, result_fd, warmup, iterations, duration,
+                       sleep_time )
+	char    *sql;
+	int      start_fd;
+	int      result_fd;
+	int      warmup;
+	int      iterations;
+	double   duration;
+	int      sleep_time;
+{
+	go_result_t     *r;
+	struct timeval   tv_begin, tv_start, tv_end;
+	double           elapsed = 0.0;
+	int              xact    = 0;
+	int              exit_status;
+	int              ret;
+	char            *status;
+	char             c;
+
+	/*
+	 * Like a background job, the worker goes back to the default
+	 * signal handlers and ignores SIGINT (other than while dsp_cmd()
+	 * is running, which cancels the query).  The parent asks it to
+	 * stop with a SIGTERM, which is counted rather than fatal so that
+	 * the worker can still report.
+	 */
+	while (sig_restore() >= 0);
+	sig_install( SIGINT, SIG_H_IGN, (void*)NULL, 0 );
+	sig_install( SIGTERM, SIG_H_POLL, (void*)NULL, 0 );
+
+	/*
+	 * Nothing a worker fetches is ever redisplayed, so it doesn't
+	 * spend any time spooling it either.
+	 */
+	ret = 0;
+	dsp_prop( DSP_SET, DSP_SPOOL, (void*)&ret, DSP_UNUSED );
+
+	r = (go_result_t*)calloc( 1, sizeof(go_result_t) );
+
+	if (r == NULL ||
+	    jobset_run( g_jobset, "\\connect", &exit_status ) == -1 ||
+	    exit_status == CMD_FAIL)
+	{
+		c = '0';
+		go_write( result_fd, &c, 1 );
+		sqsh_exit( 1 );
+	}
+
+	c = '1';
+	go_write( result_fd, &c, 1 );
+
+	/*-- Wait for the others --*/
+	while (read( start_fd, &c, 1 ) == -1 && errno == EINTR);
+	close( start_fd );
+
+	r->r_status = DSP_SUCCEED;
+
+	while (duration > 0.0 ? (xact < warmup || elapsed < duration)
+	                      : (xact < warmup + iterations))
+	{
+		if (sig_poll( SIGTERM ) > 0)
+		{
+			r->r_status = DSP_INTERRUPTED;
+			break;
+		}
+
+		++xact;
+
+		gettimeofday( &tv_start, NULL );
+		if (xact == warmup + 1)
+			tv_begin = tv_start;
+
+		env_set( g_internal_env, "?", "0" );
+		ret = go_xact( sql, DSP_F_NOTHING );
+
+		if (ret != DSP_SUCCEED)
+		{
+			r->r_status = ret;
+			break;
+		}
+
+		/*
+		 * Errors raised by the server (a deadlock, say) leave the
+		 * session usable, so are counted and the worker carries on.
+		 */
+		if (xact > warmup)
+		{
+			gettimeofday( &tv_end, NULL );
+			elapsed = ELAPSED_SEC(tv_begin,tv_end);
+
+			env_get( g_internal_env, "?", &status );
+			if (status != NULL && atoi(status) != 0)
+				++r->r_nfailed;
+			else
+			{
+				++r->r_nxacts;
+				hist_record( &r->r_hist, 
+					(long)(ELAPSED_SEC(tv_start,tv_end) * 1000000.0) );
+			}
+		}
+
+		if (sleep_time > 0 && 
+		    (duration > 0.0 ? (xact < warmup || elapsed < duration)
+		                    : (xact < warmup + iterations)))
+			sleep( sleep_time );
+	}
+
+	r->r_elapsed = elapsed;
+	go_write( result_fd, (void*)r, sizeof(go_result_t) );
+	close( result_fd );
+
+	sqsh_exit( 0 );
+}
+
+/*
+ * sqsh-3.0 - Function: go_load_signal
+ *
+ * Passes an interrupt of \go -c on to its workers.
+ */
+static void go_load_signal( sig, user_data )
+	int   sig;
+	void *user_data;
+{
+	int   i;
+
+	for (i = 0; i < sg_nworkers; i++)
+		kill( sg_workers[i], SIGTERM );
+}
+
+/*
+ * sqsh-3.0 - Functions: go_read, go_write
+ *
+ * read(2) and write(2) all of len bytes from or to a pipe, returning
+ * the number of bytes transferred (less than len at end-of-file or
+ * upon error).
+ */
+static int go_read( fd, buf, len )
+	int    fd;
+	void  *buf;
+	int    len;
+{
+	int    n;
+	int    done = 0;
+
+	while (done < len)
+	{
+		if ((n = read( fd, (char*)buf + done, len - done )) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (n == 0)
+			break;
+		done += n;
+	}
+
+	return done;
+}
+
+static int go_write( fd, buf, len )
+	int    fd;
+	void  *buf;
+	int    len;
+{
+	int    n;
+	int    done = 0;
+
+	while (done < len)
+	{
+		if ((n = write( fd, (char*)buf + done, len - done )) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		done += n;
+	}
+
+	return done;
+}
@@ -0,0 +1,167 @@
+/*
+ * cmd_redisplay.c - Display the spooled result sets again
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#include <stdio.h>
+#include "sqsh_config.h"
+#include "sqsh_global.h"
+#include "sqsh_error.h"
+#include "sqsh_getopt.h"
+#include "sqsh_env.h"
+#include "sqsh_cmd.h"
+#include "sqsh_stdin.h"
+#include "cmd.h"
+#include "dsp.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: cmd_redisplay.c,v 1.1 2026/10/18 00:00:00 sqsh Exp $" ;
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * sqsh-3.0 - cmd_redisplay:
+ *
+ * Displays the result sets of the last batch run with $spool set all
+ * over again, from the spool rather than the server, optionally in a
+ * different style or just the one result set.
+ */
+int cmd_redisplay( argc, argv )
+	int    argc ;
+	char  *argv[] ;
+{
+	extern int        sqsh_optind ;          /* Required by sqsh_getopt */
+	extern char*      sqsh_optarg ;          /* Required by sqsh_getopt */
+	int               ch ;
+	int               have_error = False ;
+	int               nset       = 0 ;
+	int               dsp_flags  = 0 ;
+	int               dsp_old    = -1 ;
+	char             *dsp_name   = NULL ;
+	int               ret ;
+
+	env_tran( g_env ) ;
+
+	while ((ch = sqsh_getopt( argc, argv, "fhlm:o:w:" )) != EOF)
+	{
+		switch (ch)
+		{
+			case 'f' :
+				dsp_flags |= DSP_F_NOFOOTERS ;
+				break ;
+			case 'h' :
+				dsp_flags |= DSP_F_NOHEADERS ;
+				break ;
+			case 'l' :
+				dsp_flags |= DSP_F_NOSEPLINE ;
+				break ;
+			case 'm' :
+				dsp_name = sqsh_optarg ;
+				break ;
+			case 'o' :
+				if (env_put( g_env, "order_by", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\redisplay: -o: %s\n", sqsh_get_errstr() ) ;
+					have_error = True ;
+				}
+				break ;
+			case 'w' :
+				if (env_put( g_env, "width", sqsh_optarg, ENV_F_TRAN ) == False)
+				{
+					fprintf( stderr, "\\redisplay: -w: %s\n", sqsh_get_errstr() ) ;
+					have_error = True ;
+				}
+				break ;
+			default :
+				fprintf( stderr, "\\redisplay: %s\n", sqsh_get_errstr() ) ;
+				have_error = True ;
+		}
+	}
+
+	if ((argc - sqsh_optind) > 1 || have_error)
+	{
+		fprintf( stderr,
+			"Use: \\redisplay [-f] [-h] [-l] [-m style] [-o cols] [-w width] [result#]\n"
+			"     -f          Suppress footers\n"
+			"     -h          Suppress headers\n"
+			"     -l          Suppress line separators with pretty style output mode\n"
+			"     -m style    Display in style rather than the current one\n"
+			"     -o cols     Override value of $order_by\n"
+			"     -w width    Override value of $width\n"
+			"     result#     Display only this regular result set\n" ) ;
+		env_rollback( g_env ) ;
+		return CMD_FAIL ;
+	}
+
+	if (argc != sqsh_optind)
+	{
+		nset = atoi( argv[sqsh_optind] ) ;
+
+		if (nset < 1)
+		{
+			fprintf( stderr, "\\redisplay: Invalid result set number %s\n",
+				argv[sqsh_optind] ) ;
+			env_rollback( g_env ) ;
+			return CMD_FAIL ;
+		}
+	}
+
+	/*
+	 * As with \go -m, the style is only changed for as long as we
+	 * are displaying.
+	 */
+	if (dsp_name != NULL)
+	{
+		if (dsp_prop( DSP_GET, DSP_STYLE, (void*)&dsp_old,
+		              DSP_UNUSED ) != DSP_SUCCEED ||
+		    env_put( g_env, "style", dsp_name, ENV_F_TRAN ) != True)
+		{
+			fprintf( stderr, "\\redisplay: %s\n", sqsh_get_errstr() ) ;
+			env_rollback( g_env ) ;
+			return CMD_FAIL ;
+		}
+	}
+
+	sqsh_set_error( SQSH_E_NONE, NULL ) ;
+	ret = dsp_redisplay( stdout, nset, dsp_flags ) ;
+
+	if (dsp_old != -1)
+	{
+		dsp_prop( DSP_SET, DSP_STYLE, (void*)&dsp_old, DSP_UNUSED ) ;
+	}
+	env_rollback( g_env ) ;
+
+	switch (ret)
+	{
+		case DSP_SUCCEED:
+			return CMD_LEAVEBUF ;
+		case DSP_INTERRUPTED:
+			if (!sqsh_stdin_isatty())
+				return CMD_INTERRUPTED ;
+			return CMD_LEAVEBUF ;
+		default:
+			if (sqsh_get_error() != SQSH_E_NONE)
+				fprintf( stderr, "\\redisplay: %s\n", sqsh_get_errstr() ) ;
+			return CMD_FAIL ;
+	}
+}
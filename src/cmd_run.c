@@ -151,7 +151,7 @@ int cmd_run( argc, argv )
 		fprintf( stderr, "     -l          Suppress separator lines with pretty output\n" );
 		fprintf( stderr, "     -n          Disable SQL buffer variable expansion\n" );
 		fprintf( stderr, "     -p          Report runtime statistics\n" );
-		fprintf( stderr, "     -m style    Specify output style {bcp|csv|horiz|html|meta|none|pretty|vert}\n" );
+		fprintf( stderr, "     -m style    Specify output style {arrow|bcp|csv|horiz|html|json|meta|ndjson|none|pretty|summary|vert}\n" );
 		fprintf( stderr, "     -i filename SQL file to run\n" );
 		env_rollback( g_env );
 		return CMD_FAIL;
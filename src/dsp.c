@@ -23,6 +23,7 @@
  *            gray@xenotropic.com
  */
 #include <stdio.h>
+#include <ctype.h>
 #include "sqsh_config.h"
 #include "sqsh_global.h"
 #include "sqsh_error.h"
@@ -77,14 +78,58 @@ dsp_prop_t  g_dsp_props = {
 	",",             /* p_csv_colsep */
 	1,               /* p_csv_colsep_len */
 	"",              /* p_csv_nullind */
-	0                /* p_csv_nullind_len */
+	0,               /* p_csv_nullind_len */
+	DSP_FLUSH_AUTO,  /* p_flush */
+	1,               /* p_fetch_rows */
+	0,               /* p_pipeline */
+	0,               /* p_compress */
+	0,               /* p_sample */
+	DSP_OVERFLOW_WRAP, /* p_overflow */
+	0,               /* p_rowlimit */
+	0,               /* p_batchlimit */
+	0,               /* p_progress */
+	0,               /* p_spool */
+	"",              /* p_orderby */
+	64               /* p_sortmem */
 };
 
+/*
+ * g_dsp_stats: Output statistics of the most recent dsp_cmd().
+ */
+dsp_stats_t g_dsp_stats = { 0 };
+
+/*
+ * g_dsp_limit: Row limits of the batch being displayed by dsp_cmd(),
+ * picked up by dsp_desc_bind().
+ */
+dsp_limit_t *g_dsp_limit = NULL;
+
+/*
+ * g_dsp_meter: Progress of the batch being displayed by dsp_cmd(), if
+ * $progress is set.
+ */
+dsp_meter_t *g_dsp_meter = NULL;
+
+/*
+ * sg_timed: The output of the batch being timed (DSP_F_TIMING), and
+ * how many bytes had been written to it when the current result set
+ * was bound.
+ */
+static dsp_out_t *sg_timed     = NULL;
+static long       sg_timed_put = 0;
+
+/*
+ * Most rows dsp_desc_fetch() lets go by between looks at the clock.
+ */
+#define DSP_METER_MAXSTEP  65536
+
 /*-- Prototypes --*/
 static int   dsp_prop_set _ANSI_ARGS(( int, void*, int ));
 static int   dsp_prop_get _ANSI_ARGS(( int, void*, int ));
 static int   dsp_vlen     _ANSI_ARGS(( char* ));
 static void  dsp_signal   _ANSI_ARGS(( int, void* ));
+static void  dsp_meter_report  _ANSI_ARGS(( dsp_meter_t*, double, long, int ));
+static void  dsp_phase_close   _ANSI_ARGS(( void ));
 
 /*
  * dsp_prop():
@@ -122,7 +167,9 @@ int dsp_prop( action, prop, ptr, len )
  * dsp_cmd():
  *
  * Displays the result set of the CS_COMMAND in the current display
- * style.
+ * style.  sqsh-3.0: cmd is NULL when dsp_redisplay() is replaying
+ * the spool, in which case nothing is sent and the results come out
+ * of the spool instead.
  */
 int dsp_cmd( output, cmd, sql, flags )
 	FILE          *output;
@@ -134,12 +181,19 @@ int dsp_cmd( output, cmd, sql, flags )
 	int            ret = DSP_SUCCEED;
 	dsp_t         *dsp_func;
 	dsp_out_t     *o   = NULL;
+	dsp_limit_t    limit;
+	dsp_limit_t   *old_limit;
+	dsp_meter_t    meter;
+	dsp_meter_t   *old_meter;
+	struct dsp_spool_st *old_spool;
+	int            i;
 
 	/*
 	 * In order to install our callbacks, we must first track down
 	 * the connection that owns this command.
 	 */
-	if (ct_cmd_props( cmd,               /* Command */
+	if (cmd != NULL &&
+	    ct_cmd_props( cmd,               /* Command */
 	                  CS_GET,            /* Action */
 	                  CS_PARENT_HANDLE,  /* Property */
 	                  (CS_VOID*)&con,    /* Buffer */
@@ -158,6 +212,18 @@ int dsp_cmd( output, cmd, sql, flags )
 		return DSP_FAIL;
 	}
 
+	/*
+	 * sqsh-3.0: Compress the output as it is written, if asked to.
+	 * This has to be in place before the first byte is written (and
+	 * before any writer thread is started).
+	 */
+	if (g_dsp_props.p_compress > 0 && (flags & DSP_F_X) == 0 &&
+	    dsp_fzip( o, g_dsp_props.p_compress ) == -1)
+	{
+		dsp_fclose( o );
+		return DSP_FAIL;
+	}
+
 	/*
 	 * Mark the fact that we haven't received an interrupt yet (in
 	 * fact we haven't installed our signal handlers yet).
@@ -183,9 +249,95 @@ int dsp_cmd( output, cmd, sql, flags )
 	/* sqsh-2.5 - Feature p2f, reset g_p2fc before a new batch is started */
 	g_p2fc = 0;
 
-	if (ct_send( cmd ) != CS_SUCCEED)
+	g_dsp_stats.s_nwrites = 0;
+	g_dsp_stats.s_nbytes  = 0;
+	g_dsp_stats.s_nrows   = 0;
+	g_dsp_stats.s_ncut    = 0;
+	g_dsp_stats.s_timed   = False;
+	g_dsp_stats.s_nsets   = 0;
+
+	/*
+	 * sqsh-3.0: With DSP_F_TIMING, dsp_desc_bind() gets a dsp_phase_t
+	 * from dsp_phase_open() for each regular result set to keep its
+	 * timings in, and the time spent writing is taken from o.
+	 */
+	if ((flags & DSP_F_TIMING) != 0 && (flags & DSP_F_X) == 0)
+	{
+		g_dsp_stats.s_timed   = True;
+		g_dsp_stats.s_first   = -1.0;
+		g_dsp_stats.s_fetch   = 0.0;
+		g_dsp_stats.s_convert = 0.0;
+
+		sg_timed     = o;
+		sg_timed_put = 0;
+	}
+
+	/*
+	 * sqsh-3.0: Every result set bound from here on counts its rows
+	 * against the limits of this batch.  The previous limits are
+	 * put back afterwards, as a \do loop may be running us while
+	 * it is still working through its own results.
+	 */
+	limit.l_maxrows   = g_dsp_props.p_rowlimit;
+	limit.l_batchrows = g_dsp_props.p_batchlimit;
+	limit.l_nrows     = 0;
+	limit.l_ncut      = 0;
+
+	old_limit   = g_dsp_limit;
+	g_dsp_limit = &limit;
+
+	/*
+	 * sqsh-3.0: Keep track of how we are getting along, if we have
+	 * been asked to report it.
+	 */
+	old_meter   = g_dsp_meter;
+	g_dsp_meter = NULL;
+
+	if (g_dsp_props.p_progress > 0 && (flags & DSP_F_X) == 0)
+	{
+		meter.m_interval      = g_dsp_props.p_progress;
+		meter.m_tty           = isatty( fileno( stderr ) );
+		meter.m_shared        = meter.m_tty && isatty( o->o_fd );
+		meter.m_out           = o;
+		meter.m_nrows         = 0;
+		meter.m_step          = 16;
+		meter.m_check         = meter.m_step;
+		meter.m_nsets         = 0;
+		meter.m_start         = dsp_now();
+		meter.m_checked       = meter.m_start;
+		meter.m_reported      = meter.m_start;
+		meter.m_reported_rows = 0;
+		meter.m_len           = 0;
+		meter.m_nreports      = 0;
+
+		g_dsp_meter = &meter;
+	}
+
+	/*
+	 * sqsh-3.0: With $spool set, whatever the batch returns is
+	 * written to the spool as well as displayed, so that \redisplay
+	 * can show it again.  When replaying the spool g_dsp_spool has
+	 * already been set up by dsp_redisplay().
+	 */
+	old_spool = g_dsp_spool;
+
+	if (cmd != NULL)
+	{
+		g_dsp_spool = NULL;
+
+		if (g_dsp_props.p_spool)
+		{
+			g_dsp_spool = dsp_spool_begin();
+		}
+	}
+
+	g_dsp_stats.s_sent = dsp_now();
+
+	if (cmd != NULL && ct_send( cmd ) != CS_SUCCEED)
 		ret = DSP_FAIL;
 
+	g_dsp_stats.s_send = dsp_now() - g_dsp_stats.s_sent;
+
 	if (g_dsp_interrupted)
 		ret = DSP_INTERRUPTED;
 
@@ -227,11 +379,38 @@ int dsp_cmd( output, cmd, sql, flags )
 				case DSP_NONE:
 					dsp_func = dsp_none;
 					break;
+				case DSP_JSON:
+				case DSP_NDJSON:
+					dsp_func = dsp_json;
+					break;
+				case DSP_ARROW:
+					dsp_func = dsp_arrow;
+					break;
+				case DSP_SUMMARY:
+					dsp_func = dsp_summary;
+					break;
 				default:
 					dsp_func = dsp_horiz;
 			}
 		}
 
+		/*
+		 * sqsh-3.0: The styles that stream their rows straight out
+		 * may hand the write()'s over to a separate thread, so that
+		 * a slow reader on the other end of the output doesn't keep
+		 * us from fetching and formatting the next rows.  Signals
+		 * are still only delivered to this thread, so
+		 * g_dsp_interrupted and the ct_cancel() in dsp_signal()
+		 * work exactly as they always have.
+		 */
+		if (g_dsp_props.p_pipeline > 0 && (flags & DSP_F_X) == 0 &&
+		    (dsp_func == dsp_csv || dsp_func == dsp_bcp ||
+		     dsp_func == dsp_horiz || dsp_func == dsp_none ||
+		     dsp_func == dsp_json || dsp_func == dsp_arrow))
+		{
+			dsp_fpipe( o, g_dsp_props.p_pipeline );
+		}
+
 		if (flags & DSP_F_X)
 		{
 			ret = dsp_x( o, cmd, flags, dsp_func );
@@ -243,12 +422,71 @@ int dsp_cmd( output, cmd, sql, flags )
 
 	}
 
+	if (cmd != NULL)
+	{
+		if (g_dsp_spool != NULL)
+		{
+			dsp_spool_end( g_dsp_spool );
+		}
+
+		g_dsp_spool = old_spool;
+	}
+
 	/*
 	 * We're done with our output.
 	 */
+	dsp_fflush( o );
+	g_dsp_stats.s_nwrites = o->o_nwrites;
+	g_dsp_stats.s_nbytes  = o->o_nbytes;
+
+	if (sg_timed != NULL)
+	{
+		dsp_phase_close();
+		sg_timed = NULL;
+
+		g_dsp_stats.s_write = o->o_wtime;
+		g_dsp_stats.s_total = dsp_now() - g_dsp_stats.s_sent;
+
+		for (i = 0; i < min( g_dsp_stats.s_nsets, DSP_PHASE_MAXSETS ); i++)
+		{
+			g_dsp_stats.s_fetch   += g_dsp_stats.s_sets[i].ph_fetch;
+			g_dsp_stats.s_convert += g_dsp_stats.s_sets[i].ph_convert;
+
+			if (g_dsp_stats.s_first < 0.0)
+				g_dsp_stats.s_first = g_dsp_stats.s_sets[i].ph_first;
+		}
+	}
+
 	dsp_fclose( o );
 
-	if (ret != DSP_SUCCEED)
+	/*
+	 * If the batch went on long enough for progress to have been
+	 * reported, finish off with the totals.
+	 */
+	if (g_dsp_meter != NULL && meter.m_nreports > 0)
+	{
+		dsp_meter_report( &meter, dsp_now(), g_dsp_stats.s_nbytes, True );
+	}
+
+	g_dsp_meter          = old_meter;
+	g_dsp_limit          = old_limit;
+	g_dsp_stats.s_nrows  = limit.l_nrows;
+	g_dsp_stats.s_ncut   = limit.l_ncut;
+
+	/*
+	 * The rows that weren't displayed were never read, so all we can
+	 * say is where we stopped; the "rows affected" count reported by
+	 * the server says how many there were.
+	 */
+	if (ret == DSP_SUCCEED && limit.l_ncut > 0)
+	{
+		fprintf( stderr,
+			"Row limit reached: %d row%s displayed, remainder of %d result set%s skipped\n",
+			(int)limit.l_nrows, (limit.l_nrows == 1) ? "" : "s",
+			(int)limit.l_ncut, (limit.l_ncut == 1) ? "" : "s" );
+	}
+
+	if (ret != DSP_SUCCEED && cmd != NULL)
 	{
 		if (ct_cancel( (CS_CONNECTION*)NULL, cmd, CS_CANCEL_ALL ) != CS_SUCCEED)
 		{
@@ -266,6 +504,216 @@ int dsp_cmd( output, cmd, sql, flags )
 	return ret;
 }
 
+/*
+ * dsp_phase_open():
+ *
+ * sqsh-3.0: Called by dsp_desc_bind() as each regular result set is
+ * bound, returning where the timings of the result set are to be
+ * kept, or NULL if the batch isn't being timed.  Also credits the
+ * output produced since the last call to the previous result set.
+ */
+dsp_phase_t* dsp_phase_open()
+{
+	dsp_phase_t  *ph;
+
+	if (sg_timed == NULL)
+	{
+		return NULL;
+	}
+
+	dsp_phase_close();
+
+	/*
+	 * Result sets beyond the last one we have room for are all
+	 * lumped in with it.
+	 */
+	if (g_dsp_stats.s_nsets < DSP_PHASE_MAXSETS)
+	{
+		ph = &g_dsp_stats.s_sets[g_dsp_stats.s_nsets];
+
+		ph->ph_first   = -1.0;
+		ph->ph_fetch   = 0.0;
+		ph->ph_convert = 0.0;
+		ph->ph_nrows   = 0;
+		ph->ph_nbytes  = 0;
+	}
+	else
+	{
+		ph = &g_dsp_stats.s_sets[DSP_PHASE_MAXSETS - 1];
+	}
+
+	++g_dsp_stats.s_nsets;
+	return ph;
+}
+
+/*
+ * dsp_phase_close():
+ *
+ * Credits the output produced since the last result set was bound
+ * to that result set.
+ */
+static void dsp_phase_close()
+{
+	long    nput;
+
+	nput = sg_timed->o_nput + sg_timed->o_nbuf;
+
+	if (g_dsp_stats.s_nsets > 0)
+	{
+		g_dsp_stats.s_sets[min( g_dsp_stats.s_nsets, DSP_PHASE_MAXSETS ) - 1].ph_nbytes +=
+			nput - sg_timed_put;
+	}
+	sg_timed_put = nput;
+}
+
+/*
+ * dsp_meter_tick():
+ *
+ * sqsh-3.0: Called by dsp_desc_fetch() once m->m_nrows reaches
+ * m->m_check.  Works out when the clock should next be looked at
+ * and reports progress if it is time to.
+ */
+void dsp_meter_tick( m )
+	dsp_meter_t  *m;
+{
+	double   now;
+
+	now = dsp_now();
+
+	if (now - m->m_checked < 0.05)
+	{
+		if (m->m_step < DSP_METER_MAXSTEP)
+			m->m_step *= 2;
+	}
+	else if (now - m->m_checked > 0.25 && m->m_step > 1)
+	{
+		m->m_step /= 2;
+	}
+
+	m->m_checked = now;
+	m->m_check   = m->m_nrows + m->m_step;
+
+	/*
+	 * If the rows are going to the terminal the report is written to,
+	 * get them all out first, so that the writer thread can't add to
+	 * the line while it is on display (dsp_meter_clear() erases it
+	 * before any more rows are written).
+	 */
+	if (now - m->m_reported >= (double)m->m_interval)
+	{
+		if (m->m_shared)
+		{
+			dsp_fflush( m->m_out );
+		}
+		dsp_meter_report( m, now, dsp_fbytes( m->m_out ), False );
+	}
+}
+
+/*
+ * dsp_meter_clear():
+ *
+ * sqsh-3.0: Called by the output stream before it writes to the
+ * terminal the progress line is on, to erase the line.
+ */
+void dsp_meter_clear( m )
+	dsp_meter_t  *m;
+{
+	if (m->m_shared && m->m_len > 0)
+	{
+		fprintf( stderr, "\r%*s\r", m->m_len, "" );
+		fflush( stderr );
+		m->m_len = 0;
+	}
+}
+
+/*
+ * dsp_now():
+ *
+ * sqsh-3.0: Seconds since some point in the past, from a monotonic
+ * clock if there is one.  Used for progress reports and timings.
+ */
+double dsp_now()
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#else
+	struct timeval  tv;
+
+	gettimeofday( &tv, NULL );
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+/*
+ * dsp_meter_report():
+ *
+ * Writes a progress line to stderr.  On a terminal the line is
+ * rewritten in place, otherwise a new line is written each time.
+ * The rate given is that since the last report, or over the whole
+ * batch for the final report.
+ */
+static void dsp_meter_report( m, now, nbytes, final )
+	dsp_meter_t  *m;
+	double        now;
+	long          nbytes;
+	int           final;
+{
+	char     line[128];
+	char     bytes[32];
+	double   secs;
+	long     nrows;
+	long     elapsed;
+	int      len;
+
+	if (final)
+	{
+		secs  = now - m->m_start;
+		nrows = m->m_nrows;
+	}
+	else
+	{
+		secs  = now - m->m_reported;
+		nrows = m->m_nrows - m->m_reported_rows;
+	}
+
+	if (nbytes >= 1073741824L)
+		sprintf( bytes, "%.1f GB", (double)nbytes / 1073741824.0 );
+	else if (nbytes >= 1048576L)
+		sprintf( bytes, "%.1f MB", (double)nbytes / 1048576.0 );
+	else if (nbytes >= 1024L)
+		sprintf( bytes, "%.1f KB", (double)nbytes / 1024.0 );
+	else
+		sprintf( bytes, "%ld bytes", nbytes );
+
+	elapsed = (long)(now - m->m_start);
+
+	len = sprintf( line, "%ld rows, %s written, %.0f rows/sec, result set %d, %ld:%02ld",
+		m->m_nrows, bytes, (secs > 0.0) ? (double)nrows / secs : 0.0,
+		m->m_nsets, elapsed / 60, elapsed % 60 );
+
+	if (m->m_tty)
+	{
+		fprintf( stderr, "\r%s%*s", line,
+			(m->m_len > len) ? m->m_len - len : 0, "" );
+
+		if (final)
+			fputc( '\n', stderr );
+	}
+	else
+	{
+		fprintf( stderr, "%s\n", line );
+	}
+	fflush( stderr );
+
+	m->m_len           = len;
+	m->m_reported      = now;
+	m->m_reported_rows = m->m_nrows;
+	++m->m_nreports;
+}
+
 /*
  * dsp_vlen():
  *
@@ -624,6 +1072,212 @@ static int dsp_prop_set( prop, ptr, len )
 
 			break;
 
+		case DSP_FLUSH: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_FLUSH, %d)\n", *((int*)ptr));)
+
+			if (!(DSP_VALID_FLUSH( *((int*)ptr) )))
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid output flush policy" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_flush = *((int*)ptr);
+			break;
+
+		case DSP_FETCH_ROWS: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_FETCH_ROWS, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 1 || *((int*)ptr) > DSP_FETCH_MAXROWS)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid fetch array size" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_fetch_rows = *((int*)ptr);
+			break;
+
+		case DSP_PIPELINE: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_PIPELINE, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0 || *((int*)ptr) > DSP_PIPE_MAXBUFS)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid number of pipeline buffers" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_pipeline = *((int*)ptr);
+			break;
+
+		case DSP_COMPRESS: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_COMPRESS, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0 || *((int*)ptr) > DSP_ZIP_MAXLEVEL)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid compression level" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_compress = *((int*)ptr);
+			break;
+
+		case DSP_SAMPLE: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_SAMPLE, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid number of sample rows" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_sample = *((int*)ptr);
+			break;
+
+		case DSP_OVERFLOW: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_OVERFLOW, %d)\n", *((int*)ptr));)
+
+			if (!DSP_VALID_OVERFLOW( *((int*)ptr) ))
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid overflow policy" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_overflow = *((int*)ptr);
+			break;
+
+		case DSP_ROWLIMIT: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_ROWLIMIT, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid row limit" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_rowlimit = *((int*)ptr);
+			break;
+
+		case DSP_BATCHLIMIT: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_BATCHLIMIT, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid batch row limit" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_batchlimit = *((int*)ptr);
+			break;
+
+		case DSP_PROGRESS: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_PROGRESS, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Invalid progress interval" );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_progress = *((int*)ptr);
+			break;
+
+		case DSP_SPOOL: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_SPOOL, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) != 1 && *((int*)ptr) != 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "Spool must be 1 or 0" );
+				return DSP_FAIL;
+			}
+
+			/*
+			 * Turning the spool off throws away whatever it holds.
+			 */
+			if (*((int*)ptr) == 0)
+			{
+				dsp_spool_close();
+			}
+
+			g_dsp_props.p_spool = *((int*)ptr);
+			break;
+
+		case DSP_ORDERBY: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_ORDERBY, '%s')\n",
+				(ptr == NULL)?"":((char*)ptr));)
+
+			if (ptr == NULL)
+				ptr = "";
+
+			if (len == DSP_NULLTERM)
+			{
+				len = strlen( (char*)ptr );
+			}
+
+			if (len > DSP_ORDERBY_MAXLEN || len < 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL,
+					"Invalid length of sort key list (between 0 and %d allowed)",
+					DSP_ORDERBY_MAXLEN );
+				return DSP_FAIL;
+			}
+
+			/*
+			 * Every key has to name something, whether the column
+			 * is there is only known once the result set comes back.
+			 */
+			{
+				char  *cp  = (char*)ptr;
+				int    n   = 0;
+				int    i;
+
+				for (i = 0; i <= len && len > 0; i++)
+				{
+					if (i == len || cp[i] == ',')
+					{
+						if (n == 0)
+						{
+							sqsh_set_error( SQSH_E_INVAL,
+								"Empty sort key, format must be [-]col[,[-]col...]" );
+							return DSP_FAIL;
+						}
+						n = 0;
+					}
+					else if (!isspace( (int)cp[i] ) && cp[i] != '-' && cp[i] != '+')
+					{
+						++n;
+					}
+				}
+			}
+
+			strncpy( g_dsp_props.p_orderby, (char*)ptr, len );
+			g_dsp_props.p_orderby[len] = '\0';
+			break;
+
+		case DSP_SORTMEM: /* sqsh-3.0 */
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_SET, DSP_SORTMEM, %d)\n", *((int*)ptr));)
+
+			if (*((int*)ptr) < 1 || *((int*)ptr) > DSP_SORT_MAXMEM)
+			{
+				sqsh_set_error( SQSH_E_INVAL,
+					"Invalid sort memory (between 1 and %d megabytes allowed)",
+					DSP_SORT_MAXMEM );
+				return DSP_FAIL;
+			}
+
+			g_dsp_props.p_sortmem = *((int*)ptr);
+			break;
+
 		default:
 			sqsh_set_error( SQSH_E_EXIST, "Invalid property type" );
 			return DSP_FAIL;
@@ -826,6 +1480,108 @@ static int dsp_prop_get( prop, ptr, len )
 			strncpy( (char*)ptr, g_dsp_props.p_csv_nullind, len );
 			break;
 
+		case DSP_FLUSH:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_FLUSH) = %d\n",
+				g_dsp_props.p_flush);)
+
+			*((int*)ptr) = g_dsp_props.p_flush;
+			break;
+
+		case DSP_FETCH_ROWS:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_FETCH_ROWS) = %d\n",
+				g_dsp_props.p_fetch_rows);)
+
+			*((int*)ptr) = g_dsp_props.p_fetch_rows;
+			break;
+
+		case DSP_PIPELINE:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_PIPELINE) = %d\n",
+				g_dsp_props.p_pipeline);)
+
+			*((int*)ptr) = g_dsp_props.p_pipeline;
+			break;
+
+		case DSP_COMPRESS:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_COMPRESS) = %d\n",
+				g_dsp_props.p_compress);)
+
+			*((int*)ptr) = g_dsp_props.p_compress;
+			break;
+
+		case DSP_SAMPLE:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_SAMPLE) = %d\n",
+				g_dsp_props.p_sample);)
+
+			*((int*)ptr) = g_dsp_props.p_sample;
+			break;
+
+		case DSP_OVERFLOW:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_OVERFLOW) = %d\n",
+				g_dsp_props.p_overflow);)
+
+			*((int*)ptr) = g_dsp_props.p_overflow;
+			break;
+
+		case DSP_ROWLIMIT:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_ROWLIMIT) = %d\n",
+				g_dsp_props.p_rowlimit);)
+
+			*((int*)ptr) = g_dsp_props.p_rowlimit;
+			break;
+
+		case DSP_BATCHLIMIT:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_BATCHLIMIT) = %d\n",
+				g_dsp_props.p_batchlimit);)
+
+			*((int*)ptr) = g_dsp_props.p_batchlimit;
+			break;
+
+		case DSP_PROGRESS:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_PROGRESS) = %d\n",
+				g_dsp_props.p_progress);)
+
+			*((int*)ptr) = g_dsp_props.p_progress;
+			break;
+
+		case DSP_SPOOL:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_SPOOL) = %d\n",
+				g_dsp_props.p_spool);)
+
+			*((int*)ptr) = g_dsp_props.p_spool;
+			break;
+
+		case DSP_ORDERBY:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_ORDERBY) = %s\n",
+				g_dsp_props.p_orderby);)
+
+			if (len <= 0)
+			{
+				sqsh_set_error( SQSH_E_INVAL, "length must be greater than 0" );
+				return DSP_FAIL;
+			}
+
+			strncpy( (char*)ptr, g_dsp_props.p_orderby, len );
+			break;
+
+		case DSP_SORTMEM:
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"dsp_prop: dsp_prop(DSP_GET, DSP_SORTMEM) = %d\n",
+				g_dsp_props.p_sortmem);)
+
+			*((int*)ptr) = g_dsp_props.p_sortmem;
+			break;
+
 		default:
 			sqsh_set_error( SQSH_E_EXIST, "Invalid property type" );
 			return DSP_FAIL;
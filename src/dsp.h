@@ -42,6 +42,31 @@
 #define DSP_PROC_SEP     (1<<1)   /* Column separator has been displayed */
 #define DSP_PROC_DATA    (1<<2)   /* Column data has been displayed */
 
+/*
+ * dsp_dtcache_t: Used by dsp_datetime_conv() to remember the date
+ * portion of the last value it rendered for a column, so that rows
+ * falling on the same day only need the time of day rendered.
+ */
+#define DSP_DTCACHE_LEN  128
+typedef struct _dsp_dtcache_t {
+	int         dc_gen;            /* Format generation, -1 if empty */
+	CS_INT      dc_type;           /* Datatype rendered */
+	CS_INT      dc_year;           /* Date the prefix belongs to */
+	CS_INT      dc_month;
+	CS_INT      dc_mday;
+	CS_INT      dc_wday;
+	int         dc_len;            /* Length of dc_prefix */
+	char        dc_prefix[DSP_DTCACHE_LEN];
+} dsp_dtcache_t;
+
+/*
+ * dsp_colfmt_t: A function that turns the value fetched for a column
+ * into its display string (see dsp_desc.c).  One is chosen for each
+ * column by dsp_desc_bind() according to the datatype.
+ */
+struct _dsp_col_t;
+typedef CS_RETCODE (dsp_colfmt_t) _ANSI_ARGS(( struct _dsp_col_t* ));
+
 /*
  * dsp_col_t: This data structure is used internally to describe
  * a single column of data, including the format for the data
@@ -89,6 +114,38 @@ typedef struct _dsp_col_t {
 	 */
 	CS_INT      c_is_int_type;   /* Datatype belongs to group of integers */
 
+	/*
+	 * sqsh-3.0
+	 * Array binding.  The column is bound to d_arraysize rows worth
+	 * of buffers and dsp_desc_fetch() points c_data, c_native,
+	 * c_native_len and c_nullind at the current row of the block.
+	 */
+	CS_CHAR     *c_data_blk;     /* Block of bound (or conversion) strings */
+	CS_INT       c_data_size;    /* Bytes per row in c_data_blk, 0 if shared */
+	CS_VOID     *c_native_blk;   /* Block of bound native values */
+	CS_INT       c_native_size;  /* Bytes per row in c_native_blk */
+	CS_INT      *c_native_lens;  /* Per row native lengths */
+	CS_SMALLINT *c_nullinds;     /* Per row NULL indicators */
+
+	/*
+	 * sqsh-3.0
+	 * Formatter chosen by dsp_desc_bind(), NULL if the string bound
+	 * by CT-Lib can be displayed as is, and the radix character the
+	 * formatter should use for the column.
+	 */
+	dsp_colfmt_t *c_formatter;
+	CS_CHAR       c_radix;
+	dsp_dtcache_t *c_dtcache;      /* Date/time columns only */
+
+	/*
+	 * sqsh-3.0
+	 * Set by dsp_desc_sample(): the longest value found in the rows
+	 * looked ahead at (-1 if the result set wasn't sampled), and
+	 * whether any of them were NULL.
+	 */
+	CS_INT       c_sample_width;
+	CS_INT       c_sample_null;
+
 } dsp_col_t;
 
 /*
@@ -103,8 +160,79 @@ typedef struct _dsp_desc_t {
 
 	CS_INT       d_bylist_size;     /* Compute results, length of bylist */
 	CS_SMALLINT *d_bylist;          /* Compute results, bylist */
+
+	CS_INT       d_arraysize;       /* Rows bound per ct_fetch() */
+	CS_INT       d_nrows;           /* Rows in the current block */
+	CS_INT       d_row;             /* Current row within the block */
+
+	struct dsp_sample_st *d_sample; /* Rows held by dsp_desc_sample() */
+
+	struct dsp_limit_st  *d_limit;  /* Row limits in effect, or NULL */
+	CS_INT       d_nfetched;        /* Rows returned by dsp_desc_fetch() */
+
+	struct dsp_phase_st  *d_phase;  /* Where timings go, or NULL */
+
+	struct dsp_sort_st   *d_sort;   /* $order_by in effect, or NULL */
+
+	CS_INT       d_raw;             /* True to leave native columns unformatted */
 } dsp_desc_t;
 
+/*
+ * dsp_limit_t: The row limits in effect for a batch, and how far the
+ * batch has got towards them.  dsp_cmd() sets g_dsp_limit for the
+ * length of the batch and dsp_desc_bind() hands it to every result
+ * set it binds.  Once a regular result set reaches either limit,
+ * dsp_desc_fetch() cancels the rest of it with CS_CANCEL_CURRENT and
+ * reports CS_END_DATA.
+ */
+typedef struct dsp_limit_st {
+	CS_INT       l_maxrows;         /* Rows per result set, 0 = no limit */
+	CS_INT       l_batchrows;       /* Rows per batch, 0 = no limit */
+	CS_INT       l_nrows;           /* Rows returned so far in the batch */
+	CS_INT       l_ncut;            /* Result sets cut short so far */
+} dsp_limit_t;
+
+extern dsp_limit_t *g_dsp_limit;
+
+/*
+ * dsp_meter_t: Progress of the batch being displayed by dsp_cmd(),
+ * reported on stderr every $progress seconds.  dsp_desc_fetch() only
+ * counts the rows, looking at the clock (in dsp_meter_tick()) once
+ * every m_step rows; m_step is adjusted so that this happens a few
+ * times a second whatever the rate the rows are arriving at.
+ */
+typedef struct dsp_meter_st {
+	int          m_interval;        /* Seconds between reports */
+	int          m_tty;             /* True if reporting in place on a tty */
+	int          m_shared;          /* True if the rows go to that tty too */
+	struct dsp_out_st *m_out;       /* Output whose bytes are reported */
+	long         m_nrows;           /* Rows fetched so far */
+	long         m_check;           /* m_nrows at which to look at the clock */
+	long         m_step;            /* Rows between looks at the clock */
+	int          m_nsets;           /* Result sets bound so far */
+	double       m_start;           /* When the batch was started */
+	double       m_checked;         /* When the clock was last looked at */
+	double       m_reported;        /* When the last report was made */
+	long         m_reported_rows;   /* m_nrows at the last report */
+	int          m_len;             /* Length of the line left on the tty */
+	int          m_nreports;        /* Number of reports made */
+} dsp_meter_t;
+
+extern dsp_meter_t *g_dsp_meter;
+
+/*
+ * dsp_spool_t: The spool file of dsp_spool.c.  While dsp_cmd() is
+ * displaying a batch with $spool set, g_dsp_spool points at it and the
+ * dsp_results(), dsp_fetch(), etc. wrappers the display styles call
+ * in place of their ct_*() counterparts also write what they get back
+ * from CT-Lib to it.  dsp_redisplay() points g_dsp_spool at it while
+ * it replays it, and the same wrappers then answer from the spool
+ * rather than from CT-Lib.  The rest of the time g_dsp_spool is NULL
+ * and the wrappers go straight through to CT-Lib.
+ */
+struct dsp_spool_st;
+extern struct dsp_spool_st *g_dsp_spool;
+
 
 /*
  * The following flags are accepted by all or most display functions
@@ -116,6 +244,7 @@ typedef struct _dsp_desc_t {
 #define DSP_F_NOSEPLINE     (1<<2)  /* Suppress seperator lines */
 #define DSP_F_NOTHING       (1<<3)  /* Everything */
 #define DSP_F_X             (1<<4)  /* Send output to X Window */
+#define DSP_F_TIMING        (1<<5)  /* Time the phases of the batch */
 
 /*
  * sg_dsp_interrupted:  This variable (defined in dsp.c) is set to True
@@ -153,7 +282,19 @@ extern int g_dsp_interrupted;
 #define DSP_XGEOM         17
 #define DSP_MAXLEN        18
 #define DSP_CSV_NULLIND   19
-#define DSP_VALID_PROP(p) ((p) >= DSP_DATETIMEFMT && (p) <= DSP_CSV_NULLIND)
+#define DSP_FLUSH         20
+#define DSP_FETCH_ROWS    21
+#define DSP_PIPELINE      22
+#define DSP_COMPRESS      23
+#define DSP_SAMPLE        24
+#define DSP_OVERFLOW      25
+#define DSP_ROWLIMIT      26
+#define DSP_BATCHLIMIT    27
+#define DSP_PROGRESS      28
+#define DSP_SPOOL         29
+#define DSP_ORDERBY       30
+#define DSP_SORTMEM       31
+#define DSP_VALID_PROP(p) ((p) >= DSP_DATETIMEFMT && (p) <= DSP_SORTMEM)
 
 /*-- Length for dsp_prop() --*/
 #define DSP_NULLTERM     -1
@@ -168,12 +309,93 @@ extern int g_dsp_interrupted;
 #define DSP_HTML          6
 #define DSP_META          7
 #define DSP_NONE          8
-#define DSP_VALID_STYLE(s) ((s) >= DSP_HORIZ && (s) <= DSP_NONE)
+#define DSP_JSON          9
+#define DSP_NDJSON       10
+#define DSP_ARROW        11
+#define DSP_SUMMARY      12
+#define DSP_VALID_STYLE(s) ((s) >= DSP_HORIZ && (s) <= DSP_SUMMARY)
+
+/*-- Output flush policies for DSP_FLUSH property --*/
+#define DSP_FLUSH_AUTO    0   /* Line on a tty, full otherwise */
+#define DSP_FLUSH_LINE    1   /* Flush on every new-line */
+#define DSP_FLUSH_FULL    2   /* Flush only when the buffer fills */
+#define DSP_VALID_FLUSH(f) ((f) >= DSP_FLUSH_AUTO && (f) <= DSP_FLUSH_FULL)
+
+/*-- Limits for DSP_FETCH_ROWS property --*/
+#define DSP_FETCH_MAXROWS  10000     /* Largest array size accepted */
+#define DSP_FETCH_MAXMEM   4194304   /* Bound buffer budget per result set */
+
+/*-- Limit for DSP_PIPELINE property --*/
+#define DSP_PIPE_MAXBUFS   64        /* Most output buffers queued to the writer */
+
+/*-- Limit for DSP_COMPRESS property --*/
+#define DSP_ZIP_MAXLEVEL    9        /* Highest zlib compression level */
 
+/*-- Limit for DSP_SAMPLE property --*/
+#define DSP_SAMPLE_MAXMEM  1048576   /* Most bytes of rows held for sampling */
+
+/*-- Limits for DSP_ORDERBY and DSP_SORTMEM (megabytes) properties --*/
+#define DSP_ORDERBY_MAXLEN  255      /* Longest list of sort keys */
+#define DSP_SORT_MAXMEM    2047      /* Largest budget for sorting rows */
+
+/*-- What to do with values wider than their sampled column, DSP_OVERFLOW --*/
+#define DSP_OVERFLOW_WRAP   0   /* Wrap (pretty) or overflow (horiz) */
+#define DSP_OVERFLOW_TRUNC  1   /* Cut off at the width of the column */
+#define DSP_VALID_OVERFLOW(o) ((o) == DSP_OVERFLOW_WRAP || (o) == DSP_OVERFLOW_TRUNC)
+
+
+/*
+ * dsp_stats_t: Statistics gathered by dsp_cmd() while displaying
+ * the results of a batch.  These are reset at the start of every
+ * call to dsp_cmd() and are available afterwards in g_dsp_stats,
+ * for use by \go -p.
+ */
+/*
+ * dsp_phase_t: Where the time went while displaying one regular
+ * result set of a batch, when dsp_cmd() was asked to time it with
+ * DSP_F_TIMING.  Times are in seconds.
+ */
+typedef struct dsp_phase_st {
+	double  ph_first;        /* ct_send() until the first row, -1 if none */
+	double  ph_fetch;        /* Waiting in ct_fetch() */
+	double  ph_convert;      /* Turning the rows fetched into strings */
+	long    ph_nrows;        /* Rows displayed */
+	long    ph_nbytes;       /* Bytes of output produced */
+} dsp_phase_t;
+
+/*-- Result sets timed individually, the rest share the last entry --*/
+#define DSP_PHASE_MAXSETS  32
+
+typedef struct dsp_stats_st {
+	long    s_nwrites;       /* Number of write() calls on the output */
+	long    s_nbytes;        /* Number of bytes written to the output */
+	long    s_nrows;         /* Regular result rows displayed */
+	long    s_ncut;          /* Result sets cut short by a row limit */
+
+	/*
+	 * sqsh-3.0: The following are only filled in, and s_timed set,
+	 * when DSP_F_TIMING is passed to dsp_cmd().
+	 */
+	int     s_timed;         /* True if the batch was timed */
+	double  s_sent;          /* dsp_now() when ct_send() was called */
+	double  s_send;          /* Spent in ct_send() */
+	double  s_first;         /* ct_send() until the first row, -1 if none */
+	double  s_fetch;         /* Waiting in ct_fetch(), all result sets */
+	double  s_convert;       /* Converting rows, all result sets */
+	double  s_write;         /* Writing (and compressing) the output */
+	double  s_total;         /* ct_send() until all output was written */
+	int     s_nsets;         /* Number of regular result sets */
+	dsp_phase_t s_sets[DSP_PHASE_MAXSETS];
+} dsp_stats_t;
+
+extern dsp_stats_t g_dsp_stats;
 
 /*-- External Prototypes --*/
 int     dsp_cmd      _ANSI_ARGS(( FILE*, CS_COMMAND*, char*, int ));
 int     dsp_prop     _ANSI_ARGS(( int, int, void*, int ));
+void    dsp_sync     _ANSI_ARGS(( void ));
+int     dsp_zipping  _ANSI_ARGS(( FILE* ));
+int     dsp_redisplay _ANSI_ARGS(( FILE*, int, int ));
 
 /******************************************************************
  **                     INTERNAL DEFINITIONS                     **
@@ -182,14 +404,30 @@ int     dsp_prop     _ANSI_ARGS(( int, int, void*, int ));
 
 /*
  * The following data structure is very similar to a FILE*. It
- * is used to provide signal safe buffered I/O.
+ * is used to provide signal safe buffered I/O.  The o_flush policy
+ * decides whether the buffer is pushed out at the end of every line
+ * or only once it is full.  Normally o_buf points at o_space; once
+ * dsp_fpipe() has handed the writing over to a separate thread it
+ * points at whichever buffer of the pipeline is being filled.
+ * When dsp_fzip() is in effect everything written to o_fd passes
+ * through the gzip stream in o_zip first.
  */
 #define DSP_BUFSIZE  1048576
+struct dsp_pipe_st;
+struct dsp_zip_st;
 typedef struct dsp_out_st {
-	int          o_fd;
-	FILE        *o_file;
-	int          o_nbuf;
-	char         o_buf[DSP_BUFSIZE];
+	int                 o_fd;
+	FILE               *o_file;
+	int                 o_flush;        /* DSP_FLUSH_LINE or DSP_FLUSH_FULL */
+	long                o_nwrites;      /* Number of write() calls issued */
+	long                o_nbytes;       /* Number of bytes written */
+	long                o_nput;         /* Bytes passed on from o_buf */
+	double              o_wtime;        /* Seconds spent writing */
+	struct dsp_pipe_st *o_pipe;         /* Writer thread, or NULL */
+	struct dsp_zip_st  *o_zip;          /* gzip stream, or NULL */
+	int                 o_nbuf;
+	char               *o_buf;
+	char                o_space[DSP_BUFSIZE];
 } dsp_out_t;
 
 /*
@@ -230,6 +468,18 @@ typedef struct dsp_prop_st {
 	int     p_csv_colsep_len;            /* Display len of csv column separator */
 	char    p_csv_nullind[MAX_SEPLEN+1]; /* CSV NULL indicator string */
 	int     p_csv_nullind_len;           /* CSV NULL indicator string length */
+	int     p_flush;                     /* Output flush policy */
+	int     p_fetch_rows;                /* Rows fetched per ct_fetch() */
+	int     p_pipeline;                  /* Buffers queued to writer thread */
+	int     p_compress;                  /* gzip level of the output, 0 = none */
+	int     p_sample;                    /* Rows sampled for column widths */
+	int     p_overflow;                  /* Values wider than sampled width */
+	int     p_rowlimit;                  /* Rows displayed per result set */
+	int     p_batchlimit;                /* Rows displayed per batch */
+	int     p_progress;                  /* Seconds between progress reports */
+	int     p_spool;                     /* Keep the rows for \redisplay? */
+	char    p_orderby[DSP_ORDERBY_MAXLEN+1]; /* Sort keys, "" = unsorted */
+	int     p_sortmem;                   /* Megabytes the sort may hold */
 } dsp_prop_t;
 
 
@@ -251,17 +501,26 @@ extern dsp_prop_t g_dsp_props;
 dsp_out_t*  dsp_fopen             _ANSI_ARGS(( FILE* ));
 int         dsp_fputc             _ANSI_ARGS(( int, dsp_out_t* ));
 int         dsp_fputs             _ANSI_ARGS(( char*, dsp_out_t* ));
+int         dsp_fwrite            _ANSI_ARGS(( char*, int, dsp_out_t* ));
+int         dsp_fquote            _ANSI_ARGS(( char*, int, int, dsp_out_t* ));
+int         dsp_rtrim             _ANSI_ARGS(( char*, int ));
 int         dsp_fflush            _ANSI_ARGS(( dsp_out_t* ));
+long        dsp_fbytes            _ANSI_ARGS(( dsp_out_t* ));
+int         dsp_fpipe             _ANSI_ARGS(( dsp_out_t*, int ));
+int         dsp_fzip              _ANSI_ARGS(( dsp_out_t*, int ));
 int         dsp_fprintf           _ANSI_ARGS(( dsp_out_t*, char*, ... ));
 int         dsp_fclose            _ANSI_ARGS(( dsp_out_t* ));
 int         dsp_horiz             _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_meta              _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_vert              _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_bcp               _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
+int         dsp_arrow             _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_csv               _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_html              _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
+int         dsp_json              _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_none              _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_pretty            _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
+int         dsp_summary           _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int ));
 int         dsp_x                 _ANSI_ARGS(( dsp_out_t*, CS_COMMAND*, int, dsp_t* ));
 int         dsp_datetimefmt_set   _ANSI_ARGS(( char* ));
 char*       dsp_datetimefmt_get   _ANSI_ARGS(( void ));
@@ -271,12 +530,40 @@ int         dsp_timefmt_set       _ANSI_ARGS(( char* ));
 char*       dsp_timefmt_get       _ANSI_ARGS(( void ));
 dsp_desc_t* dsp_desc_bind         _ANSI_ARGS(( CS_COMMAND*, CS_INT ));
 CS_INT      dsp_desc_fetch        _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t* ));
+CS_INT      dsp_desc_sample       _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t*, CS_INT ));
+CS_INT      dsp_fetch_rows        _ANSI_ARGS(( CS_INT, size_t ));
+void        dsp_meter_tick        _ANSI_ARGS(( dsp_meter_t* ));
+void        dsp_meter_clear       _ANSI_ARGS(( dsp_meter_t* ));
+double      dsp_now               _ANSI_ARGS(( void ));
+dsp_phase_t* dsp_phase_open        _ANSI_ARGS(( void ));
 void        dsp_desc_destroy      _ANSI_ARGS(( dsp_desc_t* ));
 CS_INT      dsp_datetime_len      _ANSI_ARGS(( CS_CONTEXT*, CS_INT ));
 CS_INT      dsp_datetime4_len     _ANSI_ARGS(( CS_CONTEXT* ));
 CS_INT      dsp_money_len         _ANSI_ARGS(( CS_CONTEXT* ));
 CS_INT      dsp_money4_len        _ANSI_ARGS(( CS_CONTEXT* ));
-CS_RETCODE  dsp_datetime_conv     _ANSI_ARGS(( CS_CONTEXT*, CS_DATAFMT*, CS_VOID*, CS_CHAR*, CS_INT, CS_INT ));
+CS_RETCODE  dsp_datetime_conv     _ANSI_ARGS(( CS_CONTEXT*, CS_DATAFMT*, CS_VOID*, CS_CHAR*, CS_INT, CS_INT, dsp_dtcache_t* ));
+struct dsp_spool_st* dsp_spool_begin _ANSI_ARGS(( void ));
+void        dsp_spool_end         _ANSI_ARGS(( struct dsp_spool_st* ));
+void        dsp_spool_close       _ANSI_ARGS(( void ));
+FILE*       dsp_tmpfile           _ANSI_ARGS(( char* ));
+struct dsp_sort_st* dsp_sort_open _ANSI_ARGS(( dsp_desc_t* ));
+int         dsp_sort_native       _ANSI_ARGS(( struct dsp_sort_st*, CS_INT ));
+CS_INT      dsp_sort_next         _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t*, CS_INT ));
+long        dsp_sort_left         _ANSI_ARGS(( struct dsp_sort_st* ));
+void        dsp_sort_close        _ANSI_ARGS(( struct dsp_sort_st* ));
+int         dsp_numeric_len       _ANSI_ARGS(( CS_INT ));
+int         dsp_native_cmp        _ANSI_ARGS(( CS_INT, int, CS_VOID*, CS_INT, CS_VOID*, CS_INT ));
+#if defined(CS_BIGINT_TYPE) && defined(CS_UBIGINT_TYPE)
+CS_BIGINT   dsp_money_value       _ANSI_ARGS(( CS_INT, CS_VOID* ));
+#endif
+CS_RETCODE  dsp_results           _ANSI_ARGS(( CS_COMMAND*, CS_INT* ));
+CS_RETCODE  dsp_fetch             _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_INT, CS_INT, CS_INT* ));
+CS_RETCODE  dsp_res_info          _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_VOID*, CS_INT, CS_INT* ));
+CS_RETCODE  dsp_describe          _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_DATAFMT* ));
+CS_RETCODE  dsp_compute_info      _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_INT, CS_VOID*, CS_INT, CS_INT* ));
+CS_RETCODE  dsp_bind              _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_DATAFMT*, CS_VOID*, CS_INT*, CS_SMALLINT* ));
+CS_RETCODE  dsp_get_data          _ANSI_ARGS(( CS_COMMAND*, CS_INT, CS_VOID*, CS_INT, CS_INT* ));
+CS_RETCODE  dsp_cancel            _ANSI_ARGS(( CS_CONNECTION*, CS_COMMAND*, CS_INT ));
 
 #if defined(DEBUG)
 char*   dsp_result_name _ANSI_ARGS(( CS_INT ));
@@ -0,0 +1,1226 @@
+/*
+ * dsp_arrow.c - Display result set as an Apache Arrow IPC stream
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+#include <stdio.h>
+#include <ctype.h>
+#include "sqsh_config.h"
+#include "sqsh_error.h"
+#include "sqsh_global.h"
+#include "sqsh_debug.h"
+#include "dsp.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: dsp_arrow.c,v 1.1 $";
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * The Arrow IPC stream format is a schema message followed by any
+ * number of record batch messages and an end-of-stream marker.  The
+ * metadata of each message is a FlatBuffers table (see Schema.fbs and
+ * Message.fbs in the Arrow sources), which is put together here by a
+ * small builder of our own rather than pulling in a library.  The
+ * body of a record batch is the column buffers, written out straight
+ * from where the rows were gathered.
+ */
+
+#if defined(CS_BIGINT_TYPE)
+typedef CS_BIGINT           dsp_i64_t;
+typedef CS_UBIGINT          dsp_u64_t;
+#else
+typedef long long           dsp_i64_t;
+typedef unsigned long long  dsp_u64_t;
+#endif
+
+/*-- Rows per record batch, rounded up to whole fetch blocks --*/
+#define DSP_ARROW_MINBATCH   1024
+
+/*-- A record batch is cut short once its body gets this large --*/
+#define DSP_ARROW_MAXBODY    16777216
+
+/*-- Days from 1900-01-01 (Sybase) to 1970-01-01 (Arrow) --*/
+#define DSP_ARROW_EPOCH      25567
+
+/*-- Values from the Arrow FlatBuffers schema --*/
+#define ARROW_V5             4       /* MetadataVersion */
+#define ARROW_MSG_SCHEMA     1       /* MessageHeader */
+#define ARROW_MSG_BATCH      3
+#define ARROW_T_INT          2       /* Type */
+#define ARROW_T_FLOAT        3
+#define ARROW_T_BINARY       4
+#define ARROW_T_UTF8         5
+#define ARROW_T_BOOL         6
+#define ARROW_T_DECIMAL      7
+#define ARROW_T_DATE         8
+#define ARROW_T_TIME         9
+#define ARROW_T_TIMESTAMP   10
+#define ARROW_SINGLE         1       /* Precision */
+#define ARROW_DOUBLE         2
+#define ARROW_DAY            0       /* DateUnit */
+#define ARROW_SECOND         0       /* TimeUnit */
+#define ARROW_MICROSECOND    2
+
+/*-- How a value gets from the bound buffers into its column --*/
+#define DSP_AC_COPY          1       /* Native value as is */
+#define DSP_AC_BIT           2
+#define DSP_AC_MONEY         3
+#define DSP_AC_MONEY4        4
+#define DSP_AC_DATETIME      5
+#define DSP_AC_DATETIME4     6
+#define DSP_AC_DATE          7
+#define DSP_AC_TIME          8
+#define DSP_AC_DECIMAL       9       /* Parsed from the CT-Lib string */
+#define DSP_AC_BINARY       10       /* Native bytes */
+#define DSP_AC_STRING       11       /* c_data */
+
+/*
+ * dsp_abuf_t: A growable buffer.
+ */
+typedef struct {
+	unsigned char  *b_buf;
+	int             b_len;
+	int             b_size;
+} dsp_abuf_t;
+
+/*
+ * dsp_acol_t: Everything needed to turn a column into Arrow.  Fixed
+ * width columns (a_width > 0) use a_data alone, Bool columns
+ * (a_width == 0) use a_data as a bitmap, and variable length columns
+ * (a_width < 0) use a_offsets and a_data.
+ */
+typedef struct {
+	int             a_conv;       /* DSP_AC_* */
+	int             a_type;       /* ARROW_T_* */
+	int             a_width;      /* Bytes per value, see above */
+	int             a_bits;       /* Int/Time bitWidth, Decimal precision */
+	int             a_signed;     /* Int is_signed, Decimal scale */
+	int             a_unit;       /* Date/Time/Timestamp unit, Float precision */
+	dsp_abuf_t      a_valid;      /* Validity bitmap */
+	dsp_abuf_t      a_offsets;    /* Offsets of variable length values */
+	dsp_abuf_t      a_data;       /* The values */
+	int             a_nulls;      /* NULLs in the current batch */
+} dsp_acol_t;
+
+/*
+ * dsp_fbtab_t: A FlatBuffers table under construction.  Each field is
+ * either absent (size 0), a scalar of 1, 2, 4 or 8 bytes, or an
+ * offset (DSP_FB_OFFSET) to be filled in by dsp_fb_patch() once the
+ * object it refers to has been written.
+ */
+#define DSP_FB_MAXFIELDS     8
+#define DSP_FB_OFFSET       -4
+typedef struct {
+	int             t_nfields;
+	int             t_size[DSP_FB_MAXFIELDS];
+	dsp_u64_t       t_val[DSP_FB_MAXFIELDS];
+	int             t_pos[DSP_FB_MAXFIELDS];
+} dsp_fbtab_t;
+
+static unsigned char sg_arrow_zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/*-- Prototypes --*/
+static int   dsp_abuf_grow     _ANSI_ARGS(( dsp_abuf_t*, int ));
+static int   dsp_abuf_put      _ANSI_ARGS(( dsp_abuf_t*, void*, int ));
+static void  dsp_fb_store      _ANSI_ARGS(( dsp_abuf_t*, int, dsp_u64_t, int ));
+static int   dsp_fb_pad        _ANSI_ARGS(( dsp_abuf_t*, int, int ));
+static void  dsp_fb_patch      _ANSI_ARGS(( dsp_abuf_t*, int, int ));
+static void  dsp_fb_field      _ANSI_ARGS(( dsp_fbtab_t*, int, int, dsp_u64_t ));
+static int   dsp_fb_table      _ANSI_ARGS(( dsp_abuf_t*, dsp_fbtab_t* ));
+static int   dsp_fb_vector     _ANSI_ARGS(( dsp_abuf_t*, int, int, int ));
+static int   dsp_fb_string     _ANSI_ARGS(( dsp_abuf_t*, char*, int ));
+static void  dsp_arrow_map     _ANSI_ARGS(( dsp_col_t*, dsp_acol_t* ));
+static int   dsp_arrow_append  _ANSI_ARGS(( dsp_col_t*, dsp_acol_t*, int ));
+static int   dsp_arrow_decimal _ANSI_ARGS(( char*, int, int, unsigned char* ));
+static int   dsp_arrow_message _ANSI_ARGS(( dsp_out_t*, dsp_abuf_t*, int, int, dsp_i64_t ));
+static int   dsp_arrow_schema  _ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_acol_t* ));
+static int   dsp_arrow_batch   _ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_acol_t*, int ));
+static int   dsp_arrow_little  _ANSI_ARGS(( void ));
+
+/*
+ * dsp_arrow:
+ *
+ * Writes every result set as an Arrow IPC stream.  The rows are
+ * gathered column by column straight from the bound buffers, and a
+ * record batch is written each time a batch worth of rows has been
+ * fetched.  Since a stream has only one schema, a batch that returns
+ * several result sets produces several streams, one after another.
+ */
+int dsp_arrow( output, cmd, flags )
+	dsp_out_t   *output;
+	CS_COMMAND  *cmd;
+	int          flags;
+{
+	CS_INT       result_type;  /* Current result set type */
+	CS_INT       ret;          /* ct_results return code */
+	CS_INT       nrows;        /* Number of rows fetch */
+	dsp_desc_t  *desc;         /* Result set description */
+	dsp_acol_t  *acols;        /* Arrow side of each column */
+	int          batch_rows;   /* Rows per record batch */
+	int          row;          /* Rows in current batch */
+	int          body;         /* Bytes in current batch */
+	int          i;
+	int          r;
+
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
+	{
+		if (g_dsp_interrupted)
+			return DSP_INTERRUPTED;
+
+		if (ret != CS_SUCCEED)
+			return DSP_FAIL;
+
+		switch (result_type)
+		{
+			case CS_STATUS_RESULT:
+				while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+				                         &nrows )) == CS_SUCCEED);
+
+				if (ret != CS_END_DATA)
+				{
+					return DSP_FAIL;
+				}
+				break;
+
+			case CS_PARAM_RESULT:
+			case CS_ROW_RESULT:
+			case CS_COMPUTE_RESULT:
+				if (result_type == CS_PARAM_RESULT &&
+				    g_dsp_props.p_outputparms == 0)
+				{
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					                         &nrows )) == CS_SUCCEED);
+
+					if (ret != CS_END_DATA)
+					{
+						return DSP_FAIL;
+					}
+					break;
+				}
+
+				desc = dsp_desc_bind( cmd, result_type );
+
+				if (desc == NULL)
+					return DSP_FAIL;
+
+				acols = (dsp_acol_t*)calloc( desc->d_ncols, sizeof(dsp_acol_t) );
+
+				if (acols == NULL)
+				{
+					fprintf( stderr, "dsp_arrow: Memory allocation failure\n" );
+					dsp_desc_destroy( desc );
+					return DSP_FAIL;
+				}
+
+				for (i = 0; i < desc->d_ncols; i++)
+				{
+					dsp_arrow_map( &desc->d_cols[i], &acols[i] );
+				}
+
+				batch_rows = desc->d_arraysize;
+				while (batch_rows < DSP_ARROW_MINBATCH)
+					batch_rows += desc->d_arraysize;
+
+				DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_arrow: %d column(s), %d rows per batch\n",
+					(int)desc->d_ncols, batch_rows);)
+
+				r    = dsp_arrow_schema( output, desc, acols );
+				row  = 0;
+				body = 0;
+
+				while (r == 0 && (ret = dsp_desc_fetch( cmd, desc )) == CS_SUCCEED)
+				{
+					if (g_dsp_interrupted)
+						break;
+
+					for (i = 0; r == 0 && i < desc->d_ncols; i++)
+					{
+						r = dsp_arrow_append( &desc->d_cols[i], &acols[i], row );
+					}
+
+					for (i = 0, body = 0; i < desc->d_ncols; i++)
+						body += acols[i].a_data.b_len;
+
+					if (r == 0 && (++row == batch_rows || body >= DSP_ARROW_MAXBODY))
+					{
+						r    = dsp_arrow_batch( output, desc, acols, row );
+						row  = 0;
+						body = 0;
+					}
+				}
+
+				if (r == 0 && !g_dsp_interrupted && ret == CS_END_DATA)
+				{
+					if (row > 0)
+						r = dsp_arrow_batch( output, desc, acols, row );
+
+					/*-- End of stream --*/
+					if (r == 0)
+						dsp_fwrite( "\377\377\377\377\0\0\0\0", 8, output );
+				}
+
+				for (i = 0; i < desc->d_ncols; i++)
+				{
+					if (acols[i].a_valid.b_buf != NULL)
+						free( acols[i].a_valid.b_buf );
+					if (acols[i].a_offsets.b_buf != NULL)
+						free( acols[i].a_offsets.b_buf );
+					if (acols[i].a_data.b_buf != NULL)
+						free( acols[i].a_data.b_buf );
+				}
+				free( acols );
+				dsp_desc_destroy( desc );
+
+				if (g_dsp_interrupted)
+					return DSP_INTERRUPTED;
+
+				if (r != 0 || ret != CS_END_DATA)
+				{
+					return DSP_FAIL;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return DSP_SUCCEED;
+}
+
+/*
+ * dsp_arrow_map():
+ *
+ * Decides the Arrow type of a column from its CT-Lib datatype.  The
+ * columns that are read from their native value don't need to be
+ * turned into text any more, so their formatter is switched off.
+ */
+static void dsp_arrow_map( col, ac )
+	dsp_col_t   *col;
+	dsp_acol_t  *ac;
+{
+	ac->a_conv   = DSP_AC_COPY;
+	ac->a_type   = ARROW_T_INT;
+	ac->a_signed = True;
+
+	switch (col->c_format.datatype)
+	{
+		case CS_TINYINT_TYPE:
+			ac->a_width  = 1;
+			ac->a_signed = False;
+			break;
+		case CS_SMALLINT_TYPE:
+			ac->a_width  = 2;
+			break;
+		case CS_INT_TYPE:
+			ac->a_width  = 4;
+			break;
+#if defined(CS_BIGINT_TYPE)
+		case CS_BIGINT_TYPE:
+			ac->a_width  = 8;
+			break;
+#endif
+#if defined(CS_USMALLINT_TYPE)
+		case CS_USMALLINT_TYPE:
+			ac->a_width  = 2;
+			ac->a_signed = False;
+			break;
+#endif
+#if defined(CS_UINT_TYPE)
+		case CS_UINT_TYPE:
+			ac->a_width  = 4;
+			ac->a_signed = False;
+			break;
+#endif
+#if defined(CS_UBIGINT_TYPE)
+		case CS_UBIGINT_TYPE:
+			ac->a_width  = 8;
+			ac->a_signed = False;
+			break;
+#endif
+		case CS_BIT_TYPE:
+			ac->a_conv   = DSP_AC_BIT;
+			ac->a_type   = ARROW_T_BOOL;
+			ac->a_width  = 0;
+			break;
+		case CS_REAL_TYPE:
+			ac->a_type   = ARROW_T_FLOAT;
+			ac->a_unit   = ARROW_SINGLE;
+			ac->a_width  = 4;
+			break;
+		case CS_FLOAT_TYPE:
+			ac->a_type   = ARROW_T_FLOAT;
+			ac->a_unit   = ARROW_DOUBLE;
+			ac->a_width  = 8;
+			break;
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+			ac->a_conv   = (col->c_format.datatype == CS_MONEY_TYPE) ?
+				DSP_AC_MONEY : DSP_AC_MONEY4;
+			ac->a_type   = ARROW_T_DECIMAL;
+			ac->a_bits   = (col->c_format.datatype == CS_MONEY_TYPE) ? 19 : 10;
+			ac->a_signed = 4;
+			ac->a_width  = 16;
+			break;
+		case CS_DATETIME_TYPE:
+			ac->a_conv   = DSP_AC_DATETIME;
+			ac->a_type   = ARROW_T_TIMESTAMP;
+			ac->a_unit   = ARROW_MICROSECOND;
+			ac->a_width  = 8;
+			break;
+		case CS_DATETIME4_TYPE:
+			ac->a_conv   = DSP_AC_DATETIME4;
+			ac->a_type   = ARROW_T_TIMESTAMP;
+			ac->a_unit   = ARROW_SECOND;
+			ac->a_width  = 8;
+			break;
+#if defined(CS_DATE_TYPE)
+		case CS_DATE_TYPE:
+			ac->a_conv   = DSP_AC_DATE;
+			ac->a_type   = ARROW_T_DATE;
+			ac->a_unit   = ARROW_DAY;
+			ac->a_width  = 4;
+			break;
+#endif
+#if defined(CS_TIME_TYPE)
+		case CS_TIME_TYPE:
+			ac->a_conv   = DSP_AC_TIME;
+			ac->a_type   = ARROW_T_TIME;
+			ac->a_unit   = ARROW_MICROSECOND;
+			ac->a_bits   = 64;
+			ac->a_width  = 8;
+			break;
+#endif
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			if (col->c_format.precision > 0 && col->c_format.precision <= 38)
+			{
+				ac->a_conv   = DSP_AC_DECIMAL;
+				ac->a_type   = ARROW_T_DECIMAL;
+				ac->a_bits   = col->c_format.precision;
+				ac->a_signed = col->c_format.scale;
+				ac->a_width  = 16;
+			}
+			else
+			{
+				ac->a_conv   = DSP_AC_STRING;
+				ac->a_type   = ARROW_T_UTF8;
+				ac->a_width  = -1;
+			}
+			break;
+		case CS_BINARY_TYPE:
+		case CS_LONGBINARY_TYPE:
+		case CS_VARBINARY_TYPE:
+		case CS_IMAGE_TYPE:
+			ac->a_conv   = (col->c_is_native == CS_TRUE) ? DSP_AC_BINARY : DSP_AC_STRING;
+			ac->a_type   = (col->c_is_native == CS_TRUE) ? ARROW_T_BINARY : ARROW_T_UTF8;
+			ac->a_width  = -1;
+			break;
+		default:
+			ac->a_conv   = DSP_AC_STRING;
+			ac->a_type   = ARROW_T_UTF8;
+			ac->a_width  = -1;
+			break;
+	}
+
+	/*-- Everything but DSP_AC_STRING needs a native value --*/
+	if (ac->a_conv != DSP_AC_STRING && ac->a_conv != DSP_AC_DECIMAL &&
+	    col->c_is_native == CS_FALSE)
+	{
+		ac->a_conv   = DSP_AC_STRING;
+		ac->a_type   = ARROW_T_UTF8;
+		ac->a_width  = -1;
+	}
+
+	if (ac->a_conv != DSP_AC_STRING)
+	{
+		col->c_formatter = NULL;
+	}
+}
+
+/*
+ * dsp_arrow_append():
+ *
+ * Adds the current value of col as row number row of the batch
+ * being gathered.  Returns 0 upon success, -1 if memory ran out.
+ */
+static int dsp_arrow_append( col, ac, row )
+	dsp_col_t   *col;
+	dsp_acol_t  *ac;
+	int          row;
+{
+	unsigned char  val[16];
+	dsp_i64_t      v;
+	dsp_i64_t      v2;
+	int            len;
+	int            is_null;
+	int            i;
+
+	is_null = (col->c_nullind != 0);
+
+	/*-- Validity bitmap, plus the bitmap that holds Bool values --*/
+	if ((row % 8) == 0)
+	{
+		if (dsp_abuf_put( &ac->a_valid, sg_arrow_zeros, 1 ) == -1)
+			return -1;
+		if (ac->a_width == 0 && dsp_abuf_put( &ac->a_data, sg_arrow_zeros, 1 ) == -1)
+			return -1;
+	}
+
+	if (is_null)
+	{
+		++ac->a_nulls;
+	}
+	else
+	{
+		ac->a_valid.b_buf[row / 8] |= (unsigned char)(1 << (row % 8));
+	}
+
+	if (ac->a_width < 0)
+	{
+		if (row == 0)
+		{
+			len = 0;
+			if (dsp_abuf_put( &ac->a_offsets, (void*)&len, sizeof(int) ) == -1)
+				return -1;
+		}
+
+		if (!is_null)
+		{
+			if (ac->a_conv == DSP_AC_BINARY)
+			{
+				if (dsp_abuf_put( &ac->a_data, col->c_native, col->c_native_len ) == -1)
+					return -1;
+			}
+			else
+			{
+				if (dsp_abuf_put( &ac->a_data, col->c_data, strlen( col->c_data ) ) == -1)
+					return -1;
+			}
+		}
+
+		len = ac->a_data.b_len;
+		return dsp_abuf_put( &ac->a_offsets, (void*)&len, sizeof(int) );
+	}
+
+	if (ac->a_width == 0)
+	{
+		if (!is_null && *(CS_BIT*)col->c_native != 0)
+			ac->a_data.b_buf[row / 8] |= (unsigned char)(1 << (row % 8));
+		return 0;
+	}
+
+	memset( val, 0, sizeof(val) );
+
+	if (!is_null)
+	{
+		switch (ac->a_conv)
+		{
+			case DSP_AC_COPY:
+				memcpy( val, col->c_native, ac->a_width );
+				break;
+
+			case DSP_AC_MONEY:
+			case DSP_AC_MONEY4:
+				if (ac->a_conv == DSP_AC_MONEY)
+				{
+					v = ((dsp_i64_t)((CS_MONEY*)col->c_native)->mnyhigh << 32) |
+						(dsp_i64_t)((CS_MONEY*)col->c_native)->mnylow;
+				}
+				else
+				{
+					v = (dsp_i64_t)((CS_MONEY4*)col->c_native)->mny4;
+				}
+				v2 = (v < 0) ? -1 : 0;
+				if (dsp_arrow_little())
+				{
+					memcpy( val, &v, 8 );
+					memcpy( val + 8, &v2, 8 );
+				}
+				else
+				{
+					memcpy( val, &v2, 8 );
+					memcpy( val + 8, &v, 8 );
+				}
+				break;
+
+			case DSP_AC_DATETIME:
+				v = ((dsp_i64_t)((CS_DATETIME*)col->c_native)->dtdays - DSP_ARROW_EPOCH)
+					* (dsp_i64_t)86400000000LL
+					+ ((dsp_i64_t)((CS_DATETIME*)col->c_native)->dttime * 10000) / 3;
+				memcpy( val, &v, 8 );
+				break;
+
+			case DSP_AC_DATETIME4:
+				v = ((dsp_i64_t)((CS_DATETIME4*)col->c_native)->days - DSP_ARROW_EPOCH)
+					* 86400
+					+ (dsp_i64_t)((CS_DATETIME4*)col->c_native)->minutes * 60;
+				memcpy( val, &v, 8 );
+				break;
+
+#if defined(CS_DATE_TYPE)
+			case DSP_AC_DATE:
+				i = *(CS_DATE*)col->c_native - DSP_ARROW_EPOCH;
+				memcpy( val, &i, 4 );
+				break;
+#endif
+
+#if defined(CS_TIME_TYPE)
+			case DSP_AC_TIME:
+				v = ((dsp_i64_t)*(CS_TIME*)col->c_native * 10000) / 3;
+				memcpy( val, &v, 8 );
+				break;
+#endif
+
+			case DSP_AC_DECIMAL:
+				if (dsp_arrow_decimal( col->c_data, (int)col->c_radix,
+				                       ac->a_signed, val ) == -1)
+				{
+					/*-- Not a number we understand, show it as NULL --*/
+					ac->a_valid.b_buf[row / 8] &= (unsigned char)~(1 << (row % 8));
+					++ac->a_nulls;
+				}
+				break;
+		}
+	}
+
+	return dsp_abuf_put( &ac->a_data, val, ac->a_width );
+}
+
+/*
+ * dsp_arrow_decimal():
+ *
+ * Converts the string CT-Lib made of a numeric or decimal into the
+ * 128 bit two's complement integer Arrow wants, with scale digits
+ * after the radix.  The arithmetic is done in 32 bit limbs (least
+ * significant first) so that no 128 bit type is needed.  Returns
+ * 0 upon success, -1 if str doesn't look like a number.
+ */
+static int dsp_arrow_decimal( str, radix, scale, val )
+	char           *str;
+	int             radix;
+	int             scale;
+	unsigned char  *val;
+{
+	CS_UINT         limb[4];
+	dsp_u64_t       t;
+	int             neg = False;
+	int             frac = -1;
+	int             ndigits = 0;
+	int             d;
+	int             i;
+	int             little = dsp_arrow_little();
+
+	memset( limb, 0, sizeof(limb) );
+
+	for (; *str == ' '; ++str);
+
+	if (*str == '-')
+	{
+		neg = True;
+		++str;
+	}
+
+	for (;; ++str)
+	{
+		if (*str >= '0' && *str <= '9')
+		{
+			if (frac >= scale)
+				continue;
+			d = *str - '0';
+			++ndigits;
+			if (frac >= 0)
+				++frac;
+		}
+		else if ((*str == radix || *str == '.') && frac < 0)
+		{
+			frac = 0;
+			continue;
+		}
+		else if (*str == '\0' || *str == ' ')
+		{
+			if (frac < 0)
+				frac = 0;
+			if (frac >= scale)
+				break;
+			d = 0;
+			++frac;
+		}
+		else
+		{
+			return -1;
+		}
+
+		/*-- limb = limb * 10 + d --*/
+		t = (dsp_u64_t)d;
+		for (i = 0; i < 4; i++)
+		{
+			t += (dsp_u64_t)limb[i] * 10;
+			limb[i] = (CS_UINT)(t & 0xffffffff);
+			t >>= 32;
+		}
+
+		if (*str == '\0' || *str == ' ')
+			--str;
+	}
+
+	if (ndigits == 0)
+		return -1;
+
+	if (neg)
+	{
+		t = 1;
+		for (i = 0; i < 4; i++)
+		{
+			t += (dsp_u64_t)(~limb[i] & 0xffffffff);
+			limb[i] = (CS_UINT)(t & 0xffffffff);
+			t >>= 32;
+		}
+	}
+
+	for (i = 0; i < 16; i++)
+	{
+		d = (limb[i / 4] >> ((i % 4) * 8)) & 0xff;
+		val[little ? i : 15 - i] = (unsigned char)d;
+	}
+
+	return 0;
+}
+
+/*
+ * dsp_arrow_schema():
+ *
+ * Writes the schema message describing the columns of desc.
+ */
+static int dsp_arrow_schema( output, desc, acols )
+	dsp_out_t   *output;
+	dsp_desc_t  *desc;
+	dsp_acol_t  *acols;
+{
+	dsp_abuf_t   fb;
+	dsp_fbtab_t  msg;
+	dsp_fbtab_t  schema;
+	dsp_fbtab_t  field;
+	dsp_fbtab_t  type;
+	char         name[32];
+	int          fields;
+	int          pos;
+	int          i;
+	int          r;
+
+	memset( &fb, 0, sizeof(fb) );
+
+	dsp_fb_pad( &fb, 4, 4 );
+
+	dsp_fb_field( &msg, -1, 0, 0 );
+	dsp_fb_field( &msg, 0, 2, ARROW_V5 );
+	dsp_fb_field( &msg, 1, 1, ARROW_MSG_SCHEMA );
+	dsp_fb_field( &msg, 2, DSP_FB_OFFSET, 0 );
+	dsp_fb_field( &msg, 3, 8, 0 );
+	pos = dsp_fb_table( &fb, &msg );
+	dsp_fb_patch( &fb, 0, pos );
+
+	dsp_fb_field( &schema, -1, 0, 0 );
+	dsp_fb_field( &schema, 0, 2, dsp_arrow_little() ? 0 : 1 );
+	dsp_fb_field( &schema, 1, DSP_FB_OFFSET, 0 );
+	pos = dsp_fb_table( &fb, &schema );
+	dsp_fb_patch( &fb, msg.t_pos[2], pos );
+
+	fields = dsp_fb_vector( &fb, desc->d_ncols, 4, 4 );
+	dsp_fb_patch( &fb, schema.t_pos[1], fields );
+
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		dsp_fb_field( &field, -1, 0, 0 );
+		dsp_fb_field( &field, 0, DSP_FB_OFFSET, 0 );
+		dsp_fb_field( &field, 1, 1, 1 );
+		dsp_fb_field( &field, 2, 1, acols[i].a_type );
+		dsp_fb_field( &field, 3, DSP_FB_OFFSET, 0 );
+		dsp_fb_field( &field, 5, DSP_FB_OFFSET, 0 );
+		pos = dsp_fb_table( &fb, &field );
+		dsp_fb_patch( &fb, fields + 4 + (i * 4), pos );
+
+		if (desc->d_cols[i].c_format.namelen > 0)
+		{
+			pos = dsp_fb_string( &fb, desc->d_cols[i].c_format.name,
+			                     desc->d_cols[i].c_format.namelen );
+		}
+		else
+		{
+			sprintf( name, "col%d", i + 1 );
+			pos = dsp_fb_string( &fb, name, strlen( name ) );
+		}
+		dsp_fb_patch( &fb, field.t_pos[0], pos );
+
+		dsp_fb_field( &type, -1, 0, 0 );
+		switch (acols[i].a_type)
+		{
+			case ARROW_T_INT:
+				dsp_fb_field( &type, 0, 4, acols[i].a_width * 8 );
+				dsp_fb_field( &type, 1, 1, acols[i].a_signed );
+				break;
+			case ARROW_T_FLOAT:
+				dsp_fb_field( &type, 0, 2, acols[i].a_unit );
+				break;
+			case ARROW_T_DECIMAL:
+				dsp_fb_field( &type, 0, 4, acols[i].a_bits );
+				dsp_fb_field( &type, 1, 4, acols[i].a_signed );
+				dsp_fb_field( &type, 2, 4, 128 );
+				break;
+			case ARROW_T_DATE:
+			case ARROW_T_TIMESTAMP:
+				dsp_fb_field( &type, 0, 2, acols[i].a_unit );
+				break;
+			case ARROW_T_TIME:
+				dsp_fb_field( &type, 0, 2, acols[i].a_unit );
+				dsp_fb_field( &type, 1, 4, acols[i].a_bits );
+				break;
+			default:
+				break;
+		}
+		pos = dsp_fb_table( &fb, &type );
+		dsp_fb_patch( &fb, field.t_pos[3], pos );
+
+		/*-- No children --*/
+		pos = dsp_fb_vector( &fb, 0, 4, 4 );
+		dsp_fb_patch( &fb, field.t_pos[5], pos );
+	}
+
+	if (fb.b_buf == NULL)
+	{
+		fprintf( stderr, "dsp_arrow: Memory allocation failure\n" );
+		return -1;
+	}
+
+	r = dsp_arrow_message( output, &fb, fb.b_len, msg.t_pos[3], (dsp_i64_t)0 );
+	free( fb.b_buf );
+
+	return r;
+}
+
+/*
+ * dsp_arrow_batch():
+ *
+ * Writes the nrows rows gathered in acols as a record batch message,
+ * followed by the column buffers, and empties acols for the next
+ * batch.
+ */
+static int dsp_arrow_batch( output, desc, acols, nrows )
+	dsp_out_t   *output;
+	dsp_desc_t  *desc;
+	dsp_acol_t  *acols;
+	int          nrows;
+{
+	dsp_abuf_t   fb;
+	dsp_fbtab_t  msg;
+	dsp_fbtab_t  batch;
+	dsp_abuf_t  *bufs[3];
+	int          nbufs;
+	int          nodes;
+	int          buffers;
+	dsp_i64_t    offset = 0;
+	int          pos;
+	int          i;
+	int          j;
+	int          n;
+	int          r;
+
+	memset( &fb, 0, sizeof(fb) );
+
+	dsp_fb_pad( &fb, 4, 4 );
+
+	dsp_fb_field( &msg, -1, 0, 0 );
+	dsp_fb_field( &msg, 0, 2, ARROW_V5 );
+	dsp_fb_field( &msg, 1, 1, ARROW_MSG_BATCH );
+	dsp_fb_field( &msg, 2, DSP_FB_OFFSET, 0 );
+	dsp_fb_field( &msg, 3, 8, 0 );
+	pos = dsp_fb_table( &fb, &msg );
+	dsp_fb_patch( &fb, 0, pos );
+
+	dsp_fb_field( &batch, -1, 0, 0 );
+	dsp_fb_field( &batch, 0, 8, (dsp_u64_t)nrows );
+	dsp_fb_field( &batch, 1, DSP_FB_OFFSET, 0 );
+	dsp_fb_field( &batch, 2, DSP_FB_OFFSET, 0 );
+	pos = dsp_fb_table( &fb, &batch );
+	dsp_fb_patch( &fb, msg.t_pos[2], pos );
+
+	/*-- One FieldNode { length, null_count } per column --*/
+	nodes = dsp_fb_vector( &fb, desc->d_ncols, 16, 8 );
+	dsp_fb_patch( &fb, batch.t_pos[1], nodes );
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		dsp_fb_store( &fb, nodes + 4 + (i * 16), (dsp_u64_t)nrows, 8 );
+		dsp_fb_store( &fb, nodes + 12 + (i * 16), (dsp_u64_t)acols[i].a_nulls, 8 );
+	}
+
+	/*-- And a Buffer { offset, length } for each buffer of each column --*/
+	for (i = 0, n = 0; i < desc->d_ncols; i++)
+		n += (acols[i].a_width < 0) ? 3 : 2;
+
+	buffers = dsp_fb_vector( &fb, n, 16, 8 );
+	dsp_fb_patch( &fb, batch.t_pos[2], buffers );
+	for (i = 0, n = 0; i < desc->d_ncols; i++)
+	{
+		bufs[0] = &acols[i].a_valid;
+		bufs[1] = (acols[i].a_width < 0) ? &acols[i].a_offsets : &acols[i].a_data;
+		bufs[2] = &acols[i].a_data;
+		nbufs   = (acols[i].a_width < 0) ? 3 : 2;
+
+		for (j = 0; j < nbufs; j++, n++)
+		{
+			dsp_fb_store( &fb, buffers + 4 + (n * 16), (dsp_u64_t)offset, 8 );
+			dsp_fb_store( &fb, buffers + 12 + (n * 16), (dsp_u64_t)bufs[j]->b_len, 8 );
+			offset += (bufs[j]->b_len + 7) & ~7;
+		}
+	}
+
+	if (fb.b_buf == NULL)
+	{
+		fprintf( stderr, "dsp_arrow: Memory allocation failure\n" );
+		return -1;
+	}
+
+	r = dsp_arrow_message( output, &fb, fb.b_len, msg.t_pos[3], offset );
+	free( fb.b_buf );
+
+	/*-- The body, each buffer padded out to 8 bytes --*/
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		bufs[0] = &acols[i].a_valid;
+		bufs[1] = (acols[i].a_width < 0) ? &acols[i].a_offsets : &acols[i].a_data;
+		bufs[2] = &acols[i].a_data;
+		nbufs   = (acols[i].a_width < 0) ? 3 : 2;
+
+		for (j = 0; r == 0 && j < nbufs; j++)
+		{
+			if (bufs[j]->b_len > 0)
+				dsp_fwrite( (char*)bufs[j]->b_buf, bufs[j]->b_len, output );
+			if ((bufs[j]->b_len & 7) != 0)
+				dsp_fwrite( (char*)sg_arrow_zeros, 8 - (bufs[j]->b_len & 7), output );
+		}
+
+		acols[i].a_valid.b_len   = 0;
+		acols[i].a_offsets.b_len = 0;
+		acols[i].a_data.b_len    = 0;
+		acols[i].a_nulls         = 0;
+	}
+
+	return r;
+}
+
+/*
+ * dsp_arrow_message():
+ *
+ * Writes the framing of an IPC message and its metadata, fb.  The
+ * bodyLength field at body_pos of fb is filled in with body_len on
+ * the way.
+ */
+static int dsp_arrow_message( output, fb, len, body_pos, body_len )
+	dsp_out_t   *output;
+	dsp_abuf_t  *fb;
+	int          len;
+	int          body_pos;
+	dsp_i64_t    body_len;
+{
+	unsigned char  hdr[8];
+	int            padded;
+
+	dsp_fb_store( fb, body_pos, (dsp_u64_t)body_len, 8 );
+
+	/*-- Metadata is padded so that the body starts on 8 bytes --*/
+	padded = (len + 7) & ~7;
+
+	memset( hdr, 0xff, 4 );
+	hdr[4] = (unsigned char)(padded & 0xff);
+	hdr[5] = (unsigned char)((padded >> 8) & 0xff);
+	hdr[6] = (unsigned char)((padded >> 16) & 0xff);
+	hdr[7] = (unsigned char)((padded >> 24) & 0xff);
+
+	if (dsp_fwrite( (char*)hdr, 8, output ) == -1 ||
+	    dsp_fwrite( (char*)fb->b_buf, len, output ) == -1)
+	{
+		return -1;
+	}
+
+	if (padded > len)
+		dsp_fwrite( (char*)sg_arrow_zeros, padded - len, output );
+
+	return 0;
+}
+
+/*
+ * dsp_arrow_little():
+ *
+ * Returns True on a little-endian machine.  Column values are copied
+ * as they are in memory and the schema says which byte order that is.
+ */
+static int dsp_arrow_little()
+{
+	int   one = 1;
+
+	return (*(char*)&one == 1);
+}
+
+/*
+ * dsp_abuf_grow():
+ *
+ * Makes room for n more bytes in b.  Returns -1 on failure.  b_buf is
+ * left NULL if the memory couldn't be had, so that a string of
+ * FlatBuffers calls only needs to be checked once at the end.
+ */
+static int dsp_abuf_grow( b, n )
+	dsp_abuf_t  *b;
+	int          n;
+{
+	unsigned char  *p;
+	int             size;
+
+	/*-- An earlier failure has already lost the contents --*/
+	if (b->b_buf == NULL && b->b_len > 0)
+		return -1;
+
+	if (b->b_len + n <= b->b_size)
+		return 0;
+
+	for (size = (b->b_size > 0) ? b->b_size : 256; size < b->b_len + n; size *= 2);
+
+	p = (unsigned char*)realloc( b->b_buf, size );
+
+	if (p == NULL)
+	{
+		if (b->b_buf != NULL)
+			free( b->b_buf );
+		b->b_buf  = NULL;
+		b->b_size = 0;
+		return -1;
+	}
+
+	b->b_buf  = p;
+	b->b_size = size;
+
+	return 0;
+}
+
+static int dsp_abuf_put( b, data, n )
+	dsp_abuf_t  *b;
+	void        *data;
+	int          n;
+{
+	if (dsp_abuf_grow( b, n ) == -1)
+	{
+		fprintf( stderr, "dsp_arrow: Memory allocation failure\n" );
+		return -1;
+	}
+
+	memcpy( b->b_buf + b->b_len, data, n );
+	b->b_len += n;
+
+	return 0;
+}
+
+/*
+ * dsp_fb_store():
+ *
+ * Stores the size byte value val at pos of the FlatBuffers buffer b,
+ * in little-endian order.
+ */
+static void dsp_fb_store( b, pos, val, size )
+	dsp_abuf_t  *b;
+	int          pos;
+	dsp_u64_t    val;
+	int          size;
+{
+	int          i;
+
+	if (b->b_buf == NULL)
+		return;
+
+	for (i = 0; i < size; i++)
+	{
+		b->b_buf[pos + i] = (unsigned char)(val & 0xff);
+		val >>= 8;
+	}
+}
+
+/*
+ * dsp_fb_pad():
+ *
+ * Appends zeros until b_len is aligned to align, then appends room
+ * for n more bytes.  Returns the position of that room.
+ */
+static int dsp_fb_pad( b, align, n )
+	dsp_abuf_t  *b;
+	int          align;
+	int          n;
+{
+	int          pos;
+
+	pos = (b->b_len + align - 1) & ~(align - 1);
+
+	if (dsp_abuf_grow( b, (pos - b->b_len) + n ) == 0)
+		memset( b->b_buf + b->b_len, 0, (pos - b->b_len) + n );
+
+	b->b_len = pos + n;
+
+	return pos;
+}
+
+/*
+ * dsp_fb_patch():
+ *
+ * Points the offset at pos to the object at target.  The builder
+ * lays everything out front to back, so target always lies beyond
+ * pos as the format requires.
+ */
+static void dsp_fb_patch( b, pos, target )
+	dsp_abuf_t  *b;
+	int          pos;
+	int          target;
+{
+	dsp_fb_store( b, pos, (dsp_u64_t)(target - pos), 4 );
+}
+
+/*
+ * dsp_fb_field():
+ *
+ * Adds field id of the given size to a table, or with an id of -1
+ * empties the table.
+ */
+static void dsp_fb_field( t, id, size, val )
+	dsp_fbtab_t  *t;
+	int           id;
+	int           size;
+	dsp_u64_t     val;
+{
+	if (id < 0)
+	{
+		memset( t, 0, sizeof(dsp_fbtab_t) );
+		return;
+	}
+
+	t->t_size[id] = size;
+	t->t_val[id]  = val;
+	if (id >= t->t_nfields)
+		t->t_nfields = id + 1;
+}
+
+/*
+ * dsp_fb_table():
+ *
+ * Writes the vtable of t followed by the table itself, largest
+ * fields first so that each one lands on its natural alignment.
+ * The position of each field is left in t_pos for the offsets to
+ * be patched later, and the position of the table is returned.
+ */
+static int dsp_fb_table( b, t )
+	dsp_abuf_t   *b;
+	dsp_fbtab_t  *t;
+{
+	int           vtable;
+	int           vsize;
+	int           table;
+	int           end;
+	int           size;
+	int           sz;
+	int           i;
+
+	vsize  = 4 + (2 * t->t_nfields);
+	vtable = dsp_fb_pad( b, 2, vsize );
+
+	/*-- Work out where everything goes --*/
+	table = (b->b_len + 3) & ~3;
+	end   = table + 4;
+	for (size = 8; size >= 1; size /= 2)
+	{
+		for (i = 0; i < t->t_nfields; i++)
+		{
+			sz = (t->t_size[i] == DSP_FB_OFFSET) ? 4 : t->t_size[i];
+			if (sz == size)
+			{
+				end = (end + size - 1) & ~(size - 1);
+				t->t_pos[i] = end;
+				end += size;
+			}
+		}
+	}
+
+	dsp_fb_store( b, vtable, (dsp_u64_t)vsize, 2 );
+	dsp_fb_store( b, vtable + 2, (dsp_u64_t)(end - table), 2 );
+	for (i = 0; i < t->t_nfields; i++)
+	{
+		dsp_fb_store( b, vtable + 4 + (2 * i),
+			(dsp_u64_t)((t->t_size[i] == 0) ? 0 : t->t_pos[i] - table), 2 );
+	}
+
+	dsp_fb_pad( b, 1, end - b->b_len );
+	dsp_fb_store( b, table, (dsp_u64_t)(table - vtable), 4 );
+	for (i = 0; i < t->t_nfields; i++)
+	{
+		if (t->t_size[i] > 0)
+			dsp_fb_store( b, t->t_pos[i], t->t_val[i], t->t_size[i] );
+	}
+
+	return table;
+}
+
+/*
+ * dsp_fb_vector():
+ *
+ * Writes the length of a vector of n elements of size bytes, and
+ * makes (zeroed) room for the elements, aligned to align.  Returns
+ * the position of the length, which is what offsets point to.
+ */
+static int dsp_fb_vector( b, n, size, align )
+	dsp_abuf_t  *b;
+	int          n;
+	int          size;
+	int          align;
+{
+	int          pos;
+
+	/*-- The elements follow the 4 byte length --*/
+	pos = dsp_fb_pad( b, 4, 0 );
+	while (((pos + 4) % align) != 0)
+		pos = dsp_fb_pad( b, 1, 4 ) + 4;
+
+	pos = dsp_fb_pad( b, 4, 4 + (n * size) );
+	dsp_fb_store( b, pos, (dsp_u64_t)n, 4 );
+
+	return pos;
+}
+
+/*
+ * dsp_fb_string():
+ *
+ * Writes a string: its length, the bytes and a null terminator.
+ */
+static int dsp_fb_string( b, str, len )
+	dsp_abuf_t  *b;
+	char        *str;
+	int          len;
+{
+	int          pos;
+
+	pos = dsp_fb_pad( b, 4, 4 + len + 1 );
+	dsp_fb_store( b, pos, (dsp_u64_t)len, 4 );
+
+	if (b->b_buf != NULL)
+		memcpy( b->b_buf + pos + 4, str, len );
+
+	return pos;
+}
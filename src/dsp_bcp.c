@@ -62,7 +62,7 @@ int dsp_bcp( output, cmd, flags )
 	/*
 	 * Start blasting through result sets...
 	 */
-	while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		if (g_dsp_interrupted)
 			return DSP_INTERRUPTED;
@@ -73,7 +73,7 @@ int dsp_bcp( output, cmd, flags )
 		switch (result_type)
 		{
 			case CS_STATUS_RESULT:
-				while ((ret = ct_fetch( cmd,          /* Command */
+				while ((ret = dsp_fetch( cmd,         /* Command */
 				                  CS_UNUSED,    /* Type */
 				                  CS_UNUSED,    /* Offset */
 				                  CS_UNUSED,    /* Option */
@@ -91,7 +91,7 @@ int dsp_bcp( output, cmd, flags )
 				if (result_type == CS_PARAM_RESULT &&
 					g_dsp_props.p_outputparms == 0)
 				{
-					while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 						&nrows )) == CS_SUCCEED);
 					
 					if (ret != CS_END_DATA)
@@ -169,24 +169,18 @@ static void dsp_col( output, col_value, col_width )
 	char      *col_value;
 	int        col_width;
 {
-	char    *end;
-
 	if (col_width > 0)
 	{
 		/*
-		 * Traverse backwards over any whitespace that we find.
+		 * Skip back over any trailing whitespace.
 		 * MW: Applied fix for bugreport 1959260 supplied by Stephen Doherty.
 		 */
-		end = (col_value + col_width - 1);
-
 		if (g_dsp_props.p_bcp_trim == True)
 		{
-			for (; end > col_value && (*end == '\0' || isspace((int)*end));
-				--end);
+			col_width = dsp_rtrim( col_value, col_width );
 		}
 
-		for (; col_value <= end; ++col_value)
-			dsp_fputc( *col_value, output );
+		dsp_fwrite( col_value, col_width, output );
 	}
 
 	return;
@@ -67,10 +67,40 @@ static char sg_datetime_def[64]  = "%b %d %Y %l:%M:%S.%q%p";
 static char sg_time_def[64]      = "%l:%M:%S.%q%p";
 #endif
 
+/*
+ * sqsh-3.0 - Compiled datetime formats.  Every time one of the format
+ * variables is set, the format is stripped for each datatype it applies
+ * to (just as dsp_datetime_strip() does) and split into the part that
+ * only depends on the date and the rest.  DSP_MS_MARK marks the spots
+ * in the rest where the milliseconds go.  sg_dtfmt_gen changes with
+ * every new format so dsp_dtcache_t entries can tell they are stale.
+ */
+#define DSP_MS_MARK      '\001'
+#define DSP_DTFMT_SLOTS  6
+
+typedef struct _dsp_dtfmt_t {
+    int   cf_state;                 /* -1 not compiled, 0 unusable, 1 usable */
+    char  cf_prefix[64];            /* strftime() format of the date part */
+    char  cf_rest[64];              /* Remainder, with DSP_MS_MARK for %q */
+    int   cf_nms;                   /* Number of DSP_MS_MARK's in cf_rest */
+} dsp_dtfmt_t;
+
+static dsp_dtfmt_t sg_dtfmt[DSP_DTFMT_SLOTS] = {
+    { -1, "", "", 0 }, { -1, "", "", 0 }, { -1, "", "", 0 },
+    { -1, "", "", 0 }, { -1, "", "", 0 }, { -1, "", "", 0 }
+};
+static int  sg_dtfmt_gen         = 0;
+
 /*-- Prototypes --*/
 static CS_INT dsp_type_len       _ANSI_ARGS(( CS_CONTEXT*, CS_CHAR*,
                                               CS_DATAFMT*, CS_VOID* ));
 static char*  dsp_datetime_strip _ANSI_ARGS(( CS_INT, char*, int ));
+static char*  dsp_datetime_fmt   _ANSI_ARGS(( CS_INT ));
+static int    dsp_dtfmt_slot     _ANSI_ARGS(( CS_INT ));
+static void   dsp_dtfmt_compile  _ANSI_ARGS(( CS_INT ));
+static int    dsp_datetime_fast  _ANSI_ARGS(( dsp_dtfmt_t*, CS_INT, CS_DATEREC*,
+                                              struct tm*, CS_CHAR*, CS_INT,
+                                              dsp_dtcache_t* ));
 
 /*
  * dsp_datetimefmt_set():
@@ -100,16 +130,25 @@ int dsp_datetimefmt_set( fmt )
     if (fmt == NULL || strcmp( fmt, "default" ) == 0)
     {
         sg_datetime_fmt[0] = '\0';
-        return DSP_SUCCEED;
+    }
+    else
+    {
+        /*
+         * This is a little cheesy. If the user passes us a string
+         * longer than the size of sg_datetime_fmt, then we quietly
+         * trim it to the appropriate length.
+         */
+        strncpy( sg_datetime_fmt, fmt, sizeof(sg_datetime_fmt)-1 );
+        sg_datetime_fmt[sizeof(sg_datetime_fmt)-1] = '\0';
     }
 
-    /*
-     * This is a little cheesy. If the user passes us a string
-     * longer than the size of sg_datetime_fmt, then we quietly
-     * trim it to the appropriate length.
-     */
-    strncpy( sg_datetime_fmt, fmt, sizeof(sg_datetime_fmt)-1 );
-    sg_datetime_fmt[sizeof(sg_datetime_fmt)-1] = '\0';
+    /*-- sqsh-3.0: Parse the new format once, up front --*/
+    ++sg_dtfmt_gen;
+    dsp_dtfmt_compile( CS_DATETIME_TYPE );
+    dsp_dtfmt_compile( CS_DATETIME4_TYPE );
+#if defined(CS_BIGDATETIME_TYPE)
+    dsp_dtfmt_compile( CS_BIGDATETIME_TYPE );
+#endif
     return DSP_SUCCEED;
 }
 
@@ -159,16 +198,23 @@ int dsp_datefmt_set( fmt )
     if (fmt == NULL || strcmp( fmt, "default" ) == 0)
     {
         sg_date_fmt[0] = '\0';
-        return DSP_SUCCEED;
+    }
+    else
+    {
+        /*
+         * This is a little cheesy. If the user passes us a string
+         * longer than the size of sg_date_fmt, then we quietly
+         * trim it to the appropriate length.
+         */
+        strncpy( sg_date_fmt, fmt, sizeof(sg_date_fmt)-1 );
+        sg_date_fmt[sizeof(sg_date_fmt)-1] = '\0';
     }
 
-    /*
-     * This is a little cheesy. If the user passes us a string
-     * longer than the size of sg_date_fmt, then we quietly
-     * trim it to the appropriate length.
-     */
-    strncpy( sg_date_fmt, fmt, sizeof(sg_date_fmt)-1 );
-    sg_date_fmt[sizeof(sg_date_fmt)-1] = '\0';
+    /*-- sqsh-3.0: Parse the new format once, up front --*/
+    ++sg_dtfmt_gen;
+#if defined(CS_DATE_TYPE)
+    dsp_dtfmt_compile( CS_DATE_TYPE );
+#endif
     return DSP_SUCCEED;
 }
 
@@ -220,16 +266,26 @@ int dsp_timefmt_set( fmt )
     if (fmt == NULL || strcmp( fmt, "default" ) == 0)
     {
         sg_time_fmt[0] = '\0';
-        return DSP_SUCCEED;
+    }
+    else
+    {
+        /*
+         * This is a little cheesy. If the user passes us a string
+         * longer than the size of sg_time_fmt, then we quietly
+         * trim it to the appropriate length.
+         */
+        strncpy( sg_time_fmt, fmt, sizeof(sg_time_fmt)-1 );
+        sg_time_fmt[sizeof(sg_time_fmt)-1] = '\0';
     }
 
-    /*
-     * This is a little cheesy. If the user passes us a string
-     * longer than the size of sg_time_fmt, then we quietly
-     * trim it to the appropriate length.
-     */
-    strncpy( sg_time_fmt, fmt, sizeof(sg_time_fmt)-1 );
-    sg_time_fmt[sizeof(sg_time_fmt)-1] = '\0';
+    /*-- sqsh-3.0: Parse the new format once, up front --*/
+    ++sg_dtfmt_gen;
+#if defined(CS_TIME_TYPE)
+    dsp_dtfmt_compile( CS_TIME_TYPE );
+#endif
+#if defined(CS_BIGTIME_TYPE)
+    dsp_dtfmt_compile( CS_BIGTIME_TYPE );
+#endif
     return DSP_SUCCEED;
 }
 
@@ -565,47 +621,24 @@ CS_INT dsp_datetime_len( ctxt, type )
  *
  * sqsh-2.1.9 - Also implement the date and time datatype conversions.
  */
-CS_RETCODE dsp_datetime_conv( ctx, dt_fmt, dt, buf, len, type )
-    CS_CONTEXT  *ctx;     /* Context */
-    CS_DATAFMT  *dt_fmt;  /* Date format */
-    CS_VOID     *dt;      /* Pointer to date */
-    CS_CHAR     *buf;     /* Buffer */
-    CS_INT       len;     /* Length */
-    CS_INT       type;    /* CS_TYPE */
+CS_RETCODE dsp_datetime_conv( ctx, dt_fmt, dt, buf, len, type, cache )
+    CS_CONTEXT    *ctx;     /* Context */
+    CS_DATAFMT    *dt_fmt;  /* Date format */
+    CS_VOID       *dt;      /* Pointer to date */
+    CS_CHAR       *buf;     /* Buffer */
+    CS_INT         len;     /* Length */
+    CS_INT         type;    /* CS_TYPE */
+    dsp_dtcache_t *cache;   /* Per column cache, may be NULL */
 {
     struct tm   tm;
     char       *fmt;
     CS_DATEREC  dr;
     CS_DATAFMT  cs_fmt;
     char       *conv_fmt;
+    int         slot;
 
-
-    switch (type)
-    {
-#if defined(CS_DATE_TYPE)
-        case CS_DATE_TYPE:
-            conv_fmt = sg_date_fmt;
-            break;
-#endif
-#if defined(CS_TIME_TYPE)
-        case CS_TIME_TYPE:
-            conv_fmt = sg_time_fmt;
-            break;
-#endif
-#if defined(CS_BIGDATETIME_TYPE)
-        case CS_BIGDATETIME_TYPE:
-            conv_fmt = sg_datetime_fmt[0] == '\0' ? sg_datetime_def : sg_datetime_fmt;
-            break;
-#endif
-#if defined(CS_BIGTIME_TYPE)
-        case CS_BIGTIME_TYPE:
-            conv_fmt = sg_time_fmt[0] == '\0' ? sg_time_def : sg_time_fmt;
-            break;
-#endif
-        default:
-            conv_fmt = sg_datetime_fmt;
-            break;
-    }
+    conv_fmt = dsp_datetime_fmt( type );
+    memset( &tm, 0, sizeof(tm) );
 
     /*
      * If the user has not specified a format, then we let ct-lib
@@ -655,6 +688,26 @@ CS_RETCODE dsp_datetime_conv( ctx, dt_fmt, dt, buf, len, type )
     tm.tm_yday  = 0;
     tm.tm_isdst = -1;
 
+    /*
+     * sqsh-3.0: Use the compiled format if we have one that can be
+     * used, it gives the same result without stripping the format
+     * again and usually without rendering the date part again.
+     */
+    if ((slot = dsp_dtfmt_slot( dt_fmt->datatype )) != -1)
+    {
+        if (sg_dtfmt[slot].cf_state == -1)
+        {
+            dsp_dtfmt_compile( dt_fmt->datatype );
+        }
+
+        if (sg_dtfmt[slot].cf_state == 1 &&
+            dsp_datetime_fast( &sg_dtfmt[slot], dt_fmt->datatype, &dr, &tm,
+                               buf, len, cache ) == True)
+        {
+            return CS_SUCCEED;
+        }
+    }
+
     /*
      * Take the existing format and strip it down according to the
      * type of date that we are processing and replace the ms
@@ -830,7 +883,7 @@ static char* dsp_datetime_strip( type, fmt, ms )
     char          *fmt;
     int            ms;
 {
-    static   char new_fmt[64];
+    static   char new_fmt[192];   /* Room for every %q to become 6 digits */
     char         *cp;
 
     /*
@@ -887,3 +940,320 @@ static char* dsp_datetime_strip( type, fmt, ms )
 
     return new_fmt;
 }
+
+/*
+ * dsp_datetime_fmt():
+ *
+ * Returns the format set by the user for the given date/time datatype,
+ * or an empty string if CT-Lib should do the conversion.
+ */
+static char* dsp_datetime_fmt( type )
+    CS_INT         type;
+{
+    switch (type)
+    {
+#if defined(CS_DATE_TYPE)
+        case CS_DATE_TYPE:
+            return sg_date_fmt;
+#endif
+#if defined(CS_TIME_TYPE)
+        case CS_TIME_TYPE:
+            return sg_time_fmt;
+#endif
+#if defined(CS_BIGDATETIME_TYPE)
+        case CS_BIGDATETIME_TYPE:
+            return sg_datetime_fmt[0] == '\0' ? sg_datetime_def : sg_datetime_fmt;
+#endif
+#if defined(CS_BIGTIME_TYPE)
+        case CS_BIGTIME_TYPE:
+            return sg_time_fmt[0] == '\0' ? sg_time_def : sg_time_fmt;
+#endif
+        default:
+            break;
+    }
+
+    return sg_datetime_fmt;
+}
+
+/*
+ * dsp_dtfmt_slot():
+ *
+ * Returns the index into sg_dtfmt for a date/time datatype, -1 for
+ * anything else.
+ */
+static int dsp_dtfmt_slot( type )
+    CS_INT         type;
+{
+    switch (type)
+    {
+        case CS_DATETIME_TYPE:
+            return 0;
+        case CS_DATETIME4_TYPE:
+            return 1;
+#if defined(CS_DATE_TYPE)
+        case CS_DATE_TYPE:
+            return 2;
+#endif
+#if defined(CS_TIME_TYPE)
+        case CS_TIME_TYPE:
+            return 3;
+#endif
+#if defined(CS_BIGDATETIME_TYPE)
+        case CS_BIGDATETIME_TYPE:
+            return 4;
+#endif
+#if defined(CS_BIGTIME_TYPE)
+        case CS_BIGTIME_TYPE:
+            return 5;
+#endif
+        default:
+            break;
+    }
+
+    return -1;
+}
+
+/*
+ * dsp_dtfmt_compile():
+ *
+ * Builds the compiled form of the current format for the given
+ * datatype.  The format is first stripped exactly as done by
+ * dsp_datetime_strip(), leaving DSP_MS_MARK wherever the milliseconds
+ * would have been inserted.  The result is then scanned the way
+ * strftime() would read it, and the leading run of literal text and
+ * conversions that depend on nothing but the date (year, month, day
+ * of month and day of week) becomes cf_prefix.  Everything from the
+ * first other conversion or millisecond field on is left in cf_rest.
+ * A format that can't safely be split this way (for instance one in
+ * which a '%' ends up in front of the milliseconds) is marked as
+ * unusable, and dsp_datetime_conv() handles it the old way.
+ */
+static void dsp_dtfmt_compile( type )
+    CS_INT         type;
+{
+    dsp_dtfmt_t  *cf;
+    char         *fmt;
+    char          tmp[64];
+    char         *cp;
+    char         *p;
+    char         *q;
+    int           slot;
+
+    if ((slot = dsp_dtfmt_slot( type )) == -1)
+        return;
+
+    cf           = &sg_dtfmt[slot];
+    cf->cf_state = 0;
+    cf->cf_nms   = 0;
+    fmt          = dsp_datetime_fmt( type );
+
+    if (*fmt == '\0' || strchr( fmt, DSP_MS_MARK ) != NULL ||
+        strlen( fmt ) >= sizeof(tmp))
+    {
+        return;
+    }
+
+    /*-- Same as dsp_datetime_strip(), but leave a mark for the ms --*/
+    for (cp = tmp; *fmt != '\0'; ++fmt)
+    {
+        switch (*fmt)
+        {
+            case '%':
+                if (*(fmt + 1) == 'q')
+                {
+                    fmt += 1;
+                    *cp++ = DSP_MS_MARK;
+                }
+                else
+                {
+                    *cp++ = *fmt;
+                }
+                break;
+
+            case '[':
+                if (type == CS_DATETIME4_TYPE)
+                {
+                    while (*fmt != '\0' && *fmt != ']')
+                    {
+                        ++fmt;
+                    }
+                }
+                break;
+
+            case ']':
+                break;
+
+            default:
+                *cp++ = *fmt;
+        }
+
+        /*-- The strip loop runs off the end on an unbalanced '[' --*/
+        if (*fmt == '\0')
+            return;
+    }
+    *cp = '\0';
+
+    /*
+     * Find the end of the date part.  A conversion may carry flags,
+     * a field width and an E or O modifier before its character.
+     */
+    for (p = tmp; *p != '\0' && *p != DSP_MS_MARK; )
+    {
+        if (*p != '%')
+        {
+            ++p;
+            continue;
+        }
+
+        for (q = p + 1; *q != '\0' && strchr( "_-0^#", *q ) != NULL; ++q);
+        for (; *q >= '0' && *q <= '9'; ++q);
+        if (*q == 'E' || *q == 'O')
+            ++q;
+
+        if (*q == DSP_MS_MARK)
+            return;
+
+        if (*q == '\0' || strchr( "aAbBhCdeDFgGjmuUVwWxyYnt%", *q ) == NULL)
+            break;
+
+        p = q + 1;
+    }
+
+    /*-- Make sure the rest has no '%' directly in front of a mark --*/
+    for (q = p; *q != '\0'; ++q)
+    {
+        if (*q == DSP_MS_MARK)
+        {
+            ++cf->cf_nms;
+            if (q > p && *(q - 1) == '%')
+                return;
+        }
+    }
+
+    memcpy( cf->cf_prefix, tmp, p - tmp );
+    cf->cf_prefix[p - tmp] = '\0';
+    strcpy( cf->cf_rest, p );
+    cf->cf_state = 1;
+
+    DBG(sqsh_debug(DEBUG_DISPLAY,
+        "dsp_dtfmt_compile: type %d, prefix '%s', rest '%s', %d ms field(s)\n",
+        (int)type, cf->cf_prefix, cf->cf_rest, cf->cf_nms);)
+}
+
+/*
+ * dsp_datetime_fast():
+ *
+ * Renders a cracked date using a compiled format.  The date part is
+ * taken from the column cache when the row falls on the same day as
+ * the previous one.  Returns False, leaving it to the caller to do the
+ * conversion the old way, whenever the result might differ from a
+ * single strftime() of the stripped format (such as when it doesn't
+ * fit into len bytes).
+ */
+static int dsp_datetime_fast( cf, type, dr, tm, buf, len, cache )
+    dsp_dtfmt_t   *cf;
+    CS_INT         type;
+    CS_DATEREC    *dr;
+    struct tm     *tm;
+    CS_CHAR       *buf;
+    CS_INT         len;
+    dsp_dtcache_t *cache;
+{
+    char           rest[384];      /* cf_rest with every mark 6 digits */
+    char           msbuf[8];
+    char          *src;
+    char          *dst;
+    size_t         plen;
+    int            ms;
+    int            ndig;
+    int            i;
+
+    ms   = (int)dr->datemsecond;
+    ndig = 3;
+#if defined(CS_BIGDATETIME_TYPE) && defined(CS_BIGTIME_TYPE)
+    if (type == CS_BIGDATETIME_TYPE || type == CS_BIGTIME_TYPE)
+    {
+        ms   = (int)dr->datesecfrac;
+        ndig = 6;
+    }
+#endif
+
+    if (len <= 0)
+        return False;
+
+    plen = 0;
+    if (cf->cf_prefix[0] != '\0')
+    {
+        if (cache != NULL              &&
+            cache->dc_gen   == sg_dtfmt_gen &&
+            cache->dc_type  == type           &&
+            cache->dc_mday  == dr->datedmonth &&
+            cache->dc_month == dr->datemonth  &&
+            cache->dc_year  == dr->dateyear   &&
+            cache->dc_wday  == dr->datedweek)
+        {
+            if (cache->dc_len >= len)
+                return False;
+
+            plen = cache->dc_len;
+            memcpy( buf, cache->dc_prefix, plen );
+        }
+        else
+        {
+            if ((plen = strftime( buf, len, cf->cf_prefix, tm )) == 0)
+                return False;
+
+            if (cache != NULL && plen < sizeof(cache->dc_prefix))
+            {
+                cache->dc_gen   = sg_dtfmt_gen;
+                cache->dc_type  = type;
+                cache->dc_year  = dr->dateyear;
+                cache->dc_month = dr->datemonth;
+                cache->dc_mday  = dr->datedmonth;
+                cache->dc_wday  = dr->datedweek;
+                cache->dc_len   = (int)plen;
+                memcpy( cache->dc_prefix, buf, plen );
+            }
+        }
+    }
+
+    if (cf->cf_rest[0] == '\0')
+    {
+        buf[plen] = '\0';
+        return True;
+    }
+
+    /*-- Drop the ms into the rest of the format, as "%03d" would --*/
+    src = cf->cf_rest;
+    if (cf->cf_nms > 0)
+    {
+        if (ms < 0 || ms >= ((ndig == 3) ? 1000 : 1000000))
+            return False;
+
+        for (i = ndig - 1; i >= 0; --i)
+        {
+            msbuf[i] = (char)('0' + (ms % 10));
+            ms      /= 10;
+        }
+
+        for (dst = rest; *src != '\0'; ++src)
+        {
+            if (*src == DSP_MS_MARK)
+            {
+                memcpy( dst, msbuf, ndig );
+                dst += ndig;
+            }
+            else
+            {
+                *dst++ = *src;
+            }
+        }
+        *dst = '\0';
+        src  = rest;
+    }
+
+    if (strftime( buf + plen, len - plen, src, tm ) == 0)
+        return False;
+
+    return True;
+}
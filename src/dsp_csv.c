@@ -63,7 +63,7 @@ int dsp_csv( output, cmd, flags )
     /*
      * Start blasting through result sets...
      */
-    while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+    while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
     {
 	if (g_dsp_interrupted)
 	    return DSP_INTERRUPTED;
@@ -74,7 +74,7 @@ int dsp_csv( output, cmd, flags )
 	switch (result_type)
 	{
 	  case CS_STATUS_RESULT:
-	    while ((ret = ct_fetch( cmd,          /* Command */
+	    while ((ret = dsp_fetch( cmd,         /* Command */
 				    CS_UNUSED,    /* Type */
 				    CS_UNUSED,    /* Offset */
 				    CS_UNUSED,    /* Option */
@@ -92,7 +92,7 @@ int dsp_csv( output, cmd, flags )
 	    if (result_type == CS_PARAM_RESULT &&
 		g_dsp_props.p_outputparms == 0)
 	    {
-		while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+		while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 					&nrows )) == CS_SUCCEED);
 
 		if (ret != CS_END_DATA)
@@ -187,32 +187,27 @@ static void dsp_col( output, col_value, col_width, col_int_type )
     int        col_width;
     int        col_int_type;
 {
-    char    *end;
-
     if (col_width > 0)
     {
 	/*
-	 * Traverse backwards over any whitespace that we find.
+	 * Skip back over any trailing whitespace.
 	 */
-	end = (col_value + col_width - 1);
-
 	if (g_dsp_props.p_bcp_trim == True)
 	{
-	    for (; end > col_value && (*end == '\0' || isspace((int)*end));
-		 --end);
+	    col_width = dsp_rtrim( col_value, col_width );
 	}
 
         if (col_int_type == False)
-            dsp_fputc('"', output);
-        for (; col_value <= end; ++col_value)
         {
             /* sqsh-2.1.9 - Bug fix 3525302 */
-            if (col_int_type == False && *col_value == '"')
-                dsp_fputc('"', output);
-            dsp_fputc( *col_value, output );
-        }
-        if (col_int_type == False)
             dsp_fputc('"', output);
+            dsp_fquote( col_value, col_width, '"', output );
+            dsp_fputc('"', output);
+        }
+        else
+        {
+            dsp_fwrite( col_value, col_width, output );
+        }
     }
 
     return;
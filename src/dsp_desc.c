@@ -30,6 +30,12 @@
 #include "sqsh_debug.h"
 #include "dsp.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*-- Current Version --*/
 #if !defined(lint) && !defined(__LINT__)
 static char RCS_Id[] = "$Id: dsp_desc.c,v 1.13 2013/12/03 09:22:23 mwesdorp Exp $";
@@ -45,10 +51,6 @@ USE(RCS_Id)
 #define CS_UNIQUE_TYPE 40
 #endif
 
-/*-- Local Prototypes --*/
-static CS_INT dsp_dlen           _ANSI_ARGS(( CS_DATAFMT* ));
-static CS_INT dsp_just           _ANSI_ARGS(( CS_INT ));
-static void   dsp_display_fmt    _ANSI_ARGS(( CS_CHAR*, CS_DATAFMT* ));
 
 /*
  * This is almost entirely cheesy.  Since CT-Lib does a crappy job
@@ -61,52 +63,43 @@ static void   dsp_display_fmt    _ANSI_ARGS(( CS_CHAR*, CS_DATAFMT* ));
  *               Fix bugreport 3079678.
  * sqsh-2.3  : Added missing data types to the list (CS_UNITEXT_TYPE,
  *              CS_BIGINT_TYPE,CS_USMALLINT_TYPE,CS_UINT_TYPE,CS_UBIGINT_TYPE)
+ * sqsh-3.0  : Integer types are bound natively, dsp_fmt_uint()
+ *              formats them a good deal faster than CT-Lib does.
+ * sqsh-3.0  : Binary types are bound natively too, unless dsp_hex_probe()
+ *              finds that CT-Lib would display them differently.
  */
 #if defined(CS_UNITEXT_TYPE) && defined(CS_BIGINT_TYPE) && defined(CS_USMALLINT_TYPE) && defined(CS_UINT_TYPE) && defined(CS_UBIGINT_TYPE)
 #define LET_CTLIB_CONV(t) ( \
         ((t) == CS_CHAR_TYPE)       \
-     || ((t) == CS_BINARY_TYPE)     \
      || ((t) == CS_LONGCHAR_TYPE)   \
-     || ((t) == CS_LONGBINARY_TYPE) \
      || ((t) == CS_TEXT_TYPE)       \
-     || ((t) == CS_IMAGE_TYPE)      \
-     || ((t) == CS_TINYINT_TYPE)    \
-     || ((t) == CS_SMALLINT_TYPE)   \
-     || ((t) == CS_INT_TYPE)        \
-     || ((t) == CS_BIT_TYPE)        \
      || ((t) == CS_NUMERIC_TYPE)    \
      || ((t) == CS_DECIMAL_TYPE)    \
      || ((t) == CS_VARCHAR_TYPE)    \
-     || ((t) == CS_VARBINARY_TYPE)  \
      || ((t) == CS_UNICHAR_TYPE)    \
      || ((t) == CS_UNITEXT_TYPE)    \
-     || ((t) == CS_BIGINT_TYPE)     \
-     || ((t) == CS_USMALLINT_TYPE)  \
-     || ((t) == CS_UINT_TYPE)       \
-     || ((t) == CS_UBIGINT_TYPE)    \
      || ((t) == CS_UNIQUE_TYPE)     \
     )
 #else
 #define LET_CTLIB_CONV(t) ( \
         ((t) == CS_CHAR_TYPE)       \
-     || ((t) == CS_BINARY_TYPE)     \
      || ((t) == CS_LONGCHAR_TYPE)   \
-     || ((t) == CS_LONGBINARY_TYPE) \
      || ((t) == CS_TEXT_TYPE)       \
-     || ((t) == CS_IMAGE_TYPE)      \
-     || ((t) == CS_TINYINT_TYPE)    \
-     || ((t) == CS_SMALLINT_TYPE)   \
-     || ((t) == CS_INT_TYPE)        \
-     || ((t) == CS_BIT_TYPE)        \
      || ((t) == CS_NUMERIC_TYPE)    \
      || ((t) == CS_DECIMAL_TYPE)    \
      || ((t) == CS_VARCHAR_TYPE)    \
-     || ((t) == CS_VARBINARY_TYPE)  \
      || ((t) == CS_UNICHAR_TYPE)    \
      || ((t) == CS_UNIQUE_TYPE)     \
     )
 #endif
 
+#define IS_BINARY_TYPE(t) ( \
+        ((t) == CS_BINARY_TYPE)     \
+     || ((t) == CS_LONGBINARY_TYPE) \
+     || ((t) == CS_VARBINARY_TYPE)  \
+     || ((t) == CS_IMAGE_TYPE)      \
+    )
+
 /*
  * sqsh-3.0
  * Determine if datatype is a integer kind of datatype.
@@ -123,14 +116,123 @@ static void   dsp_display_fmt    _ANSI_ARGS(( CS_CHAR*, CS_DATAFMT* ));
      || ((t) == CS_USMALLINT_TYPE)  \
     )
 #else
+/*
+ * Not every library has all of the wider and unsigned types, so each
+ * one is only tested for where it is defined.
+ */
+#if defined(CS_BIGINT_TYPE)
+#define IS_BIGINT_TYPE(t)     ((t) == CS_BIGINT_TYPE)
+#else
+#define IS_BIGINT_TYPE(t)     0
+#endif
+#if defined(CS_UBIGINT_TYPE)
+#define IS_UBIGINT_TYPE(t)    ((t) == CS_UBIGINT_TYPE)
+#else
+#define IS_UBIGINT_TYPE(t)    0
+#endif
+#if defined(CS_UINT_TYPE)
+#define IS_UINT_TYPE(t)       ((t) == CS_UINT_TYPE)
+#else
+#define IS_UINT_TYPE(t)       0
+#endif
+#if defined(CS_USMALLINT_TYPE)
+#define IS_USMALLINT_TYPE(t)  ((t) == CS_USMALLINT_TYPE)
+#else
+#define IS_USMALLINT_TYPE(t)  0
+#endif
 #define IS_INT_TYPE(t) ( \
         ((t) == CS_INT_TYPE)        \
      || ((t) == CS_SMALLINT_TYPE)   \
      || ((t) == CS_TINYINT_TYPE)    \
      || ((t) == CS_BIT_TYPE)        \
+     || IS_BIGINT_TYPE(t)           \
+     || IS_UBIGINT_TYPE(t)          \
+     || IS_UINT_TYPE(t)             \
+     || IS_USMALLINT_TYPE(t)        \
     )
 #endif
 
+/*
+ * sqsh-3.0
+ * Types and tables used by the column formatters (see dsp_fmt_select()).
+ */
+#if defined(CS_BIGINT_TYPE) && defined(CS_UBIGINT_TYPE)
+#define DSP_HAVE_INT64
+typedef CS_UBIGINT dsp_uint_t;
+#define DSP_FIXED_MAX   1099511627776.0     /* 2^40 */
+#else
+typedef CS_UINT dsp_uint_t;
+#define DSP_FIXED_MAX   2147483648.0        /* 2^31 */
+#endif
+#define DSP_FIXED_TIE   (1.0 / 4096.0)
+
+/*-- How CT-Lib displays money, see dsp_money_calibrate() --*/
+typedef struct _dsp_money_t {
+    int          m_ok;        /* -1 not probed yet, 0 no match, 1 usable */
+    int          m_ndec;      /* Number of decimals shown */
+    int          m_round;     /* Rounded (1) or truncated (0) */
+    int          m_lead0;     /* "0.50" (1) or ".50" (0) */
+    int          m_negzero;   /* "-0.00" (1) or "0.00" (0) for tiny negatives */
+} dsp_money_t;
+
+static dsp_money_t sg_money_cal  = { -1, 0, 0, 0, 0 };
+static dsp_money_t sg_money4_cal = { -1, 0, 0, 0, 0 };
+
+static const char sg_dsp_digits[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*-- How binary data is shown, see dsp_hex_probe() --*/
+#define DSP_HEX_UNKNOWN  -1
+#define DSP_HEX_LOWER     0
+#define DSP_HEX_UPPER     1
+#define DSP_HEX_CTLIB     2
+static int sg_hex_case = DSP_HEX_UNKNOWN;
+
+/*
+ * sqsh-3.0: dsp_sample_t: The rows fetched ahead of time by
+ * dsp_desc_sample().  s_buf holds, for every row and column, a byte
+ * that is non-zero for NULL followed by the null terminated string.
+ * The row that didn't fit into DSP_SAMPLE_MAXMEM is left in the bound
+ * buffers, and is handed back once the rows in s_buf are used up.
+ */
+typedef struct dsp_sample_st {
+    char        *s_buf;       /* Rows held */
+    int          s_len;       /* Bytes used in s_buf */
+    int          s_size;      /* Bytes allocated for s_buf */
+    CS_INT       s_nrows;     /* Number of rows held */
+    CS_INT       s_next;      /* Next row to be handed back */
+    int          s_pos;       /* Offset of that row in s_buf */
+    CS_INT       s_status;    /* Return code of the last fetch */
+    int          s_pending;   /* True if a row is left in the bound buffers */
+    CS_CHAR    **s_data;      /* c_data of each column before replaying */
+    CS_SMALLINT *s_nullinds;  /* c_nullind of each column of that row */
+} dsp_sample_t;
+
+static const double sg_dsp_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*-- Local Prototypes --*/
+static CS_INT dsp_dlen           _ANSI_ARGS(( CS_DATAFMT* ));
+static CS_INT dsp_just           _ANSI_ARGS(( CS_INT ));
+static void   dsp_display_fmt    _ANSI_ARGS(( CS_CHAR*, CS_DATAFMT* ));
+static void   dsp_fmt_select     _ANSI_ARGS(( dsp_col_t* ));
+static int    dsp_hex_probe      _ANSI_ARGS(( void ));
+static void   dsp_hex_encode     _ANSI_ARGS(( CS_CHAR*, CS_BYTE*, CS_INT, int ));
+static void   dsp_money_calibrate _ANSI_ARGS(( CS_INT, dsp_money_t* ));
+static CS_INT dsp_desc_next      _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t* ));
+static CS_INT dsp_desc_left      _ANSI_ARGS(( dsp_desc_t* ));
+static CS_INT dsp_desc_replay    _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t* ));
+static void   dsp_sample_free    _ANSI_ARGS(( dsp_sample_t* ));
+#if defined(DSP_HAVE_INT64)
+static int    dsp_money_render   _ANSI_ARGS(( CS_CHAR*, CS_BIGINT, dsp_money_t*, int ));
+#endif
+
 /*
  * dsp_desc_bind():
  *
@@ -148,13 +250,14 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
     dsp_desc_t  *d = NULL;
     dsp_col_t   *c = NULL;
     CS_DATAFMT   str_fmt;
+    size_t       rowsize;
 
     /*-- Retrieve the number of columns in the result set --*/
-    if (ct_res_info( cmd,               /* Command */
-                     CS_NUMDATA,        /* Type */
-                     (CS_VOID*)&ncols,  /* Buffer */
-                     CS_UNUSED,         /* Buffer Length */
-                     (CS_INT*)NULL) != CS_SUCCEED)
+    if (dsp_res_info( cmd,              /* Command */
+                      CS_NUMDATA,       /* Type */
+                      (CS_VOID*)&ncols, /* Buffer */
+                      CS_UNUSED,        /* Buffer Length */
+                      (CS_INT*)NULL) != CS_SUCCEED)
     {
         fprintf( stderr, "dsp_desc_bind: Unable to retrieve column count (CS_NUMDATA)\n" );
         return NULL;
@@ -178,10 +281,39 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
     d->d_cols        = c;
     d->d_bylist_size = 0;
     d->d_bylist      = NULL;
+    d->d_arraysize   = 1;
+    d->d_nrows       = 0;
+    d->d_row         = 0;
+    d->d_sample      = NULL;
+    d->d_limit       = g_dsp_limit;
+    d->d_nfetched    = 0;
+
+    d->d_phase       = NULL;
+    d->d_sort        = NULL;
+    d->d_raw         = False;
+
+    if (result_type == CS_ROW_RESULT)
+    {
+        d->d_phase = dsp_phase_open();
+
+        if (g_dsp_meter != NULL)
+        {
+            ++g_dsp_meter->m_nsets;
+        }
+    }
 
     for (i = 0; i < ncols; i++)
     {
-        d->d_cols[i].c_data = NULL;
+        d->d_cols[i].c_sample_width = -1;
+        d->d_cols[i].c_sample_null  = False;
+        d->d_cols[i].c_data        = NULL;
+        d->d_cols[i].c_native      = NULL;
+        d->d_cols[i].c_data_blk    = NULL;
+        d->d_cols[i].c_native_blk  = NULL;
+        d->d_cols[i].c_native_lens = NULL;
+        d->d_cols[i].c_nullinds    = NULL;
+        d->d_cols[i].c_formatter   = NULL;
+        d->d_cols[i].c_dtcache     = NULL;
 
         /*-- This should be replaced with memset() --*/
         d->d_cols[i].c_format.name[0]     = '\0';
@@ -199,12 +331,12 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
 
     if (result_type == CS_COMPUTE_RESULT)
     {
-        if (ct_compute_info( cmd,                         /* Command */
-                             CS_BYLIST_LEN,               /* Type */
-                             CS_UNUSED,                   /* Colnum */
-                             (CS_VOID*)&d->d_bylist_size, /* Buffer */
-                             CS_UNUSED,                   /* Buffer Length */
-                             (CS_INT*)NULL ) != CS_SUCCEED)
+        if (dsp_compute_info( cmd,                        /* Command */
+                              CS_BYLIST_LEN,              /* Type */
+                              CS_UNUSED,                  /* Colnum */
+                              (CS_VOID*)&d->d_bylist_size,/* Buffer */
+                              CS_UNUSED,                  /* Buffer Length */
+                              (CS_INT*)NULL ) != CS_SUCCEED)
         {
             dsp_desc_destroy( d );
             fprintf( stderr, "dsp_desc_bind: Unable to fetch by-list len of compute results\n" );
@@ -223,12 +355,12 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 return NULL;
             }
 
-            if (ct_compute_info( cmd,                         /* Command */
-                                 CS_COMP_BYLIST,              /* Type */
-                                 CS_UNUSED,                   /* Colnum */
-                                 (CS_VOID*)d->d_bylist,       /* Buffer */
-                                 (CS_INT)sizeof(CS_SMALLINT) * d->d_bylist_size,
-                                 (CS_INT*)NULL) != CS_SUCCEED)
+            if (dsp_compute_info( cmd,                        /* Command */
+                                  CS_COMP_BYLIST,             /* Type */
+                                  CS_UNUSED,                  /* Colnum */
+                                  (CS_VOID*)d->d_bylist,      /* Buffer */
+                                  (CS_INT)sizeof(CS_SMALLINT) * d->d_bylist_size,
+                                  (CS_INT*)NULL) != CS_SUCCEED)
             {
                 dsp_desc_destroy( d );
                 fprintf( stderr, "dsp_desc_bind: Memory allocation failure for by-list array\n" );
@@ -239,13 +371,14 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
 
 
     /*
-     * Blast through the set of columns, binding the output to a
-     * friendly chunk of memory.
+     * sqsh-3.0: Describe every column up front so that we know how
+     * wide a row is before deciding how many rows to bind per fetch.
      */
+    rowsize = 0;
     for (i = 0; i < ncols; i++)
     {
         /*-- Get description for column --*/
-        if (ct_describe( cmd, i+1, &d->d_cols[i].c_format ) != CS_SUCCEED)
+        if (dsp_describe( cmd, i+1, &d->d_cols[i].c_format ) != CS_SUCCEED)
         {
             dsp_desc_destroy( d );
             fprintf( stderr, "dsp_desc_bind: Unable to fetch description of column #%d\n",
@@ -260,7 +393,20 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
         d->d_cols[i].c_is_int_type  = IS_INT_TYPE(d->d_cols[i].c_format.datatype); /* sqsh-3.0 */
         d->d_cols[i].c_native       = NULL;
         d->d_cols[i].c_data         = NULL;
+    }
 
+    /*
+     * sqsh-3.0: With $order_by set, the rows of a regular result set
+     * go through a sort, which needs to know which columns are keys
+     * before they are bound.
+     */
+    if (result_type == CS_ROW_RESULT && g_dsp_props.p_orderby[0] != '\0')
+    {
+        d->d_sort = dsp_sort_open( d );
+    }
+
+    for (i = 0; i < ncols; i++)
+    {
 #if 0
         /* This code has been commented out as it generates the dreaded
            "bind resulted in truncation" error. */
@@ -271,6 +417,63 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
         }
 #endif
 
+        /*
+         * There are two types of data that we are going to deal with. Those
+         * that we allow CT-Lib to do the conversion for us implicitly by
+         * simply binding the incoming row to a CS_CHAR, and those that we
+         * would rather do the conversion ourselves.  For the former every
+         * row in the block needs its own string, for the latter every row
+         * needs room for the native value and the string is shared.
+         * Sort keys whose string doesn't sort like the value are kept
+         * native.
+         */
+        if ((LET_CTLIB_CONV(d->d_cols[i].c_format.datatype) ||
+             (IS_BINARY_TYPE(d->d_cols[i].c_format.datatype) &&
+              dsp_hex_probe() == DSP_HEX_CTLIB)) &&
+            (d->d_sort == NULL || !dsp_sort_native( d->d_sort, i )))
+        {
+            d->d_cols[i].c_is_native   = CS_FALSE;
+            d->d_cols[i].c_data_size   = d->d_cols[i].c_maxlength + 1;
+            d->d_cols[i].c_native_size = 0;
+            rowsize += (size_t)d->d_cols[i].c_data_size;
+        }
+        else
+        {
+            d->d_cols[i].c_is_native   = CS_TRUE;
+            d->d_cols[i].c_data_size   = 0;
+            d->d_cols[i].c_native_size = d->d_cols[i].c_format.maxlength;
+            rowsize += (size_t)d->d_cols[i].c_native_size + sizeof(CS_INT);
+        }
+        rowsize += sizeof(CS_SMALLINT);
+
+        dsp_fmt_select( &d->d_cols[i] );
+    }
+
+    /*
+     * Only regular rows are worth fetching in blocks.  Compute and
+     * parameter results come back one row at a time anyway.  The
+     * requested array size is trimmed by dsp_fetch_rows() to keep the
+     * bound buffers within DSP_FETCH_MAXMEM, so a wide TEXT column
+     * quietly falls back to one row per fetch.
+     */
+    if (result_type == CS_ROW_RESULT || result_type == CS_CURSOR_RESULT)
+    {
+        d->d_arraysize = dsp_fetch_rows( g_dsp_props.p_fetch_rows, rowsize );
+    }
+
+    DBG(sqsh_debug(DEBUG_DISPLAY,
+        "dsp_desc_bind: Binding %d row(s) of %lu byte(s) per fetch\n",
+        (int)d->d_arraysize, (unsigned long)rowsize);)
+
+    /*
+     * Blast through the set of columns, binding the output to a
+     * friendly chunk of memory.
+     */
+    for (i = 0; i < ncols; i++)
+    {
+        d->d_cols[i].c_nullinds =
+            (CS_SMALLINT*)malloc( sizeof(CS_SMALLINT) * d->d_arraysize );
+
         /*
          * Allocate enough space to hold the native data-type as it
          * comes from the server as well as enough space to convert
@@ -287,15 +490,19 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
         if (d->d_cols[i].c_format.datatype == CS_FLOAT_TYPE ||
             d->d_cols[i].c_format.datatype == CS_REAL_TYPE)
         {
-            d->d_cols[i].c_data = (CS_CHAR*)malloc(256);
+            d->d_cols[i].c_data_blk = (CS_CHAR*)malloc(256);
+        }
+        else if (d->d_cols[i].c_is_native == CS_TRUE)
+        {
+            d->d_cols[i].c_data_blk = (CS_CHAR*)malloc(d->d_cols[i].c_maxlength + 1);
         }
         else
         {
-            d->d_cols[i].c_data = (CS_CHAR*)malloc(d->d_cols[i].c_maxlength + 1);
+            d->d_cols[i].c_data_blk =
+                (CS_CHAR*)malloc((size_t)d->d_cols[i].c_data_size * d->d_arraysize);
         }
 
-
-        if (d->d_cols[i].c_data == NULL)
+        if (d->d_cols[i].c_data_blk == NULL || d->d_cols[i].c_nullinds == NULL)
         {
             fprintf( stderr,
                 "dsp_desc_bind: Memory allocation failure for column #%d\n",
@@ -304,31 +511,21 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
             return NULL;
         }
 
-        /*
-         * There are two types of data that we are going to deal with. Those
-         * that we allow CT-Lib to do the conversion for us implicitly by
-         * simply binding the incoming row to a CS_CHAR, and those that we
-         * would rather do the conversion ourselves.
-         */
-        if (LET_CTLIB_CONV(d->d_cols[i].c_format.datatype))
-        {
-            /*
-             * If CT-Lib is doing the conversion then we don't need to
-             * allocate any space to stored the data in its native format
-             */
-            d->d_cols[i].c_is_native = CS_FALSE;
-            d->d_cols[i].c_native    = NULL;
+        d->d_cols[i].c_data    = d->d_cols[i].c_data_blk;
+        d->d_cols[i].c_nullind = 0;
 
+        if (d->d_cols[i].c_is_native == CS_FALSE)
+        {
             /*
              * Create a format description for the string representation
              * of the outgoing data.
              */
             str_fmt.datatype  = CS_CHAR_TYPE;
             str_fmt.format    = CS_FMT_NULLTERM;
-            str_fmt.maxlength = d->d_cols[i].c_maxlength + 1;
+            str_fmt.maxlength = d->d_cols[i].c_data_size;
             str_fmt.scale     = 0;
             str_fmt.precision = 0;
-            str_fmt.count     = 1;
+            str_fmt.count     = d->d_arraysize;
             str_fmt.locale    = NULL;
 
             DBG(sqsh_debug(DEBUG_DISPLAY,
@@ -338,7 +535,7 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 "    fmt  = [datatype  = CS_CHAR_TYPE,\n"
                 "            format    = CS_FMT_NULLTERM,\n"
                 "            maxlength = %d,\n"
-                "            count     = 1,\n"
+                "            count     = %d,\n"
                 "            locale    = NULL],\n"
                 "    buf  = %p,\n"
                 "    bytes= NULL,\n"
@@ -346,8 +543,9 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 (void*)cmd,
                 i + 1,
                 (int)str_fmt.maxlength,
-                (void*)d->d_cols[i].c_data,
-                (void*)&d->d_cols[i].c_nullind);)
+                (int)str_fmt.count,
+                (void*)d->d_cols[i].c_data_blk,
+                (void*)d->d_cols[i].c_nullinds);)
 
 
             /*
@@ -355,12 +553,12 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
              * is about it.  The only important thing here is to remember
              * during dsp_desc_fetch() which data types need conversion.
              */
-            if (ct_bind( cmd,                                 /* Command */
-                         i + 1,                               /* Item */
-                         &str_fmt,                            /* Format */
-                         (CS_VOID*)d->d_cols[i].c_data,       /* Buffer */
-                         (CS_INT*)NULL,                       /* Bytes Xfered */
-                         &d->d_cols[i].c_nullind              /* NULL Indicator */
+            if (dsp_bind( cmd,                                /* Command */
+                          i + 1,                              /* Item */
+                          &str_fmt,                           /* Format */
+                          (CS_VOID*)d->d_cols[i].c_data_blk,  /* Buffer */
+                          (CS_INT*)NULL,                      /* Bytes Xfered */
+                          d->d_cols[i].c_nullinds             /* NULL Indicator */
                        ) != CS_SUCCEED)
             {
                 dsp_desc_destroy( d );
@@ -377,10 +575,12 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
              * then we want to allocate enough space to hold the native
              * data prior to doing the conversion.
              */
-            d->d_cols[i].c_is_native = CS_TRUE;
-            d->d_cols[i].c_native    = (CS_VOID*)malloc(d->d_cols[i].c_format.maxlength);
+            d->d_cols[i].c_native_blk  =
+                (CS_VOID*)malloc((size_t)d->d_cols[i].c_native_size * d->d_arraysize);
+            d->d_cols[i].c_native_lens =
+                (CS_INT*)malloc(sizeof(CS_INT) * d->d_arraysize);
 
-            if (d->d_cols[i].c_native == NULL)
+            if (d->d_cols[i].c_native_blk == NULL || d->d_cols[i].c_native_lens == NULL)
             {
                 fprintf( stderr,
                     "dsp_desc_bind: Memory alloc failure for native column %d\n",
@@ -389,11 +589,9 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 return NULL;
             }
 
-            /*
-             * This probably isn't necessary, but I just want to be
-             * on the safe side.
-             */
-            d->d_cols[i].c_format.count = 1;
+            d->d_cols[i].c_native     = d->d_cols[i].c_native_blk;
+            d->d_cols[i].c_native_len = 0;
+            d->d_cols[i].c_format.count = d->d_arraysize;
 
             DBG(sqsh_debug(DEBUG_DISPLAY,
                 "dsp_desc_bind: ct_bind(\n"
@@ -418,21 +616,21 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 (int)d->d_cols[i].c_format.precision,
                 (int)d->d_cols[i].c_format.count,
                 (void*)d->d_cols[i].c_format.locale,
-                (void*)d->d_cols[i].c_native,
-                (void*)&d->d_cols[i].c_native_len,
-                (void*)&d->d_cols[i].c_nullind );)
+                (void*)d->d_cols[i].c_native_blk,
+                (void*)d->d_cols[i].c_native_lens,
+                (void*)d->d_cols[i].c_nullinds );)
 
             /*
              * Now, bind the incoming row to the native data type. That
              * is about it.  The only important thing here is to remember
              * during dsp_desc_fetch() which data types need conversion.
              */
-            if (ct_bind( cmd,                                 /* Command */
-                         i + 1,                               /* Item */
-                         &d->d_cols[i].c_format,              /* Format */
-                         (CS_VOID*)d->d_cols[i].c_native,     /* Buffer */
-                         (CS_INT*)&d->d_cols[i].c_native_len, /* Bytes Xfered */
-                         &d->d_cols[i].c_nullind              /* NULL Indicator */
+            if (dsp_bind( cmd,                                /* Command */
+                          i + 1,                              /* Item */
+                          &d->d_cols[i].c_format,             /* Format */
+                          d->d_cols[i].c_native_blk,          /* Buffer */
+                          d->d_cols[i].c_native_lens,         /* Bytes Xfered */
+                          d->d_cols[i].c_nullinds             /* NULL Indicator */
                        ) != CS_SUCCEED)
             {
                 fprintf( stderr,
@@ -450,7 +648,7 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
          */
         if (result_type == CS_COMPUTE_RESULT)
         {
-            if (ct_compute_info( cmd,                         /* Command */
+            if (dsp_compute_info( cmd,                        /* Command */
                                         CS_COMP_OP,                  /* Type */
                                         i + 1,                       /* Colnum */
                                         (CS_VOID*)&d->d_cols[i].c_aggregate_op,
@@ -464,7 +662,7 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
                 return NULL;
             }
 
-            if (ct_compute_info( cmd,                         /* Command */
+            if (dsp_compute_info( cmd,                        /* Command */
                                         CS_COMP_COLID,               /* Type */
                                         i + 1,                       /* Colnum */
                                         (CS_VOID*)&d->d_cols[i].c_column_id,
@@ -483,299 +681,1522 @@ dsp_desc_t* dsp_desc_bind( cmd, result_type )
     return d;
 }
 
+/*
+ * dsp_fetch_rows():
+ *
+ * sqsh-3.0: Returns how many of the arraysize rows asked for may be
+ * fetched at a time, given rows of rowsize bytes, without the bound
+ * buffers going over DSP_FETCH_MAXMEM.  The test divides rather than
+ * multiplies, since the size of a row with a TEXT or IMAGE column in
+ * it may be anything up to $textsize.
+ */
+CS_INT dsp_fetch_rows( arraysize, rowsize )
+    CS_INT       arraysize;
+    size_t       rowsize;
+{
+    if (arraysize > 1 && rowsize > 0 &&
+        (size_t)arraysize > (size_t)DSP_FETCH_MAXMEM / rowsize)
+    {
+        arraysize = (CS_INT)((size_t)DSP_FETCH_MAXMEM / rowsize);
+        if (arraysize < 1)
+            arraysize = 1;
+    }
+
+    return arraysize;
+}
+
 
+/*
+ * dsp_desc_fetch():
+ *
+ * Makes the next row of the result set available in the columns of
+ * d, returning CS_SUCCEED, CS_END_DATA once there are no more rows,
+ * or the failing return code of ct_fetch().  Rows looked ahead at by
+ * dsp_desc_sample() are handed back first.  A regular result set that
+ * has reached the row limits of d_limit is cancelled and reported as
+ * CS_END_DATA.
+ */
 CS_INT dsp_desc_fetch( cmd, d )
     CS_COMMAND  *cmd;
     dsp_desc_t  *d;
 {
-    CS_RETCODE  r;
-    CS_INT      nrows;
-    CS_INT      i;
-    CS_INT      j;
-    CS_INT      p;
-    CS_DATAFMT  str_fmt;
-#if defined(HAVE_LOCALE_H)
-    CS_CHAR    *radix;
-#endif
-
-    if ((r = ct_fetch( cmd,              /* Command */
-                       CS_UNUSED,        /* Type */
-                       CS_UNUSED,        /* Offset */
-                       CS_UNUSED,        /* Option */
-                       &nrows )) == CS_END_DATA)
-    {
-        return CS_END_DATA;
-    }
+    CS_INT         r;
 
-        /* mpeppler - 4/9/2004
-           allow CS_ROW_FAIL results to go through and not abort the entire
-           query. CS_ROW_FAIL usually means a conversion or truncation error
-           which shouldn't be fatal to the entire query, although a warning
-           should be printed. */
-    if (r != CS_SUCCEED && r != CS_ROW_FAIL)
+    /*
+     * sqsh-3.0: Once the row limit is reached the rest of the result
+     * set is thrown away rather than fetched.
+     */
+    if (dsp_desc_left( d ) == 0)
     {
-        return r;
-    }
-
-    /*-- Note, should use memset() here --*/
-    str_fmt.name[0]   = '\0';
-    str_fmt.namelen   = 0;
-    str_fmt.datatype  = CS_CHAR_TYPE;
-    str_fmt.format    = CS_FMT_NULLTERM;
-    str_fmt.maxlength = 0;
-    str_fmt.scale     = 0;
-    str_fmt.precision = 0;
-    str_fmt.status    = 0;
-    str_fmt.count     = 0;
-    str_fmt.usertype  = 0;
-    str_fmt.locale    = NULL;
+        DBG(sqsh_debug(DEBUG_DISPLAY,
+            "dsp_desc_fetch: Row limit reached after %d rows\n",
+            (int)d->d_nfetched);)
 
-    for (i = 0; i < d->d_ncols; i++)
-    {
         /*
-         * If the column is NULL, then don't bother to attempt any
-         * sort of conversion, just empty out the data string and
-         * continue on to the next column.
+         * A sort has already read the result set to the end, so there
+         * is nothing left to cancel.
          */
-        if (d->d_cols[i].c_nullind != 0)
+        if (d->d_sort != NULL && dsp_sort_left( d->d_sort ) >= 0)
         {
-            d->d_cols[i].c_data[0] = '\0';
-            continue;
+            if (dsp_sort_left( d->d_sort ) > 0)
+            {
+                ++d->d_limit->l_ncut;
+            }
+            return CS_END_DATA;
         }
 
         /*
-         * If the is_native flag is FALSE then the data was already
-         * converted into a string for us by CT-Lib, so there is
-         * nothing left to be done.
-         * sqsh-2.1.8: Except when the source datatype was binary, then
-         * we have to prepend the result string with characters '0x'.
-         * 20110107: Prepend 0x0 in case of odd number of chars in string.
+         * Only if there is another row has the result set been cut
+         * short, and does what is left of it need cancelling.
          */
-        if (d->d_cols[i].c_is_native == CS_FALSE)
+        r = dsp_desc_replay( cmd, d );
+
+        if (r != CS_SUCCEED)
         {
-            if (d->d_cols[i].c_format.datatype == CS_BINARY_TYPE     ||
-                d->d_cols[i].c_format.datatype == CS_LONGBINARY_TYPE ||
-                d->d_cols[i].c_format.datatype == CS_VARBINARY_TYPE  ||
-                d->d_cols[i].c_format.datatype == CS_IMAGE_TYPE)
-            {
-                p = strlen (d->d_cols[i].c_data);
-                j = (p % 2 == 0 ? 2 : 3);
-                for (; p >= 0; p--)
-                    d->d_cols[i].c_data[p+j] = d->d_cols[i].c_data[p];
-                d->d_cols[i].c_data[0] = '0';
-                d->d_cols[i].c_data[1] = 'x';
-                if (j==3) d->d_cols[i].c_data[2] = '0';
-            }
-#if defined(HAVE_LOCALE_H)
-            else if (d->d_cols[i].c_format.datatype == CS_NUMERIC_TYPE ||
-                     d->d_cols[i].c_format.datatype == CS_DECIMAL_TYPE)
-            {
-                /*
-                 * sqsh-2.3: Convert the decimal separator in numeric/decimal datatypes
-                 * to the character according to the locale definition of the client.
-                 * By courtesy of Niki Hansche.
-                */
-                if (g_lconv != NULL && (radix = (CS_CHAR *) strrchr((CS_CHAR*) (d->d_cols[i].c_data), '.')) != NULL)
-                {
-                    *radix = (CS_CHAR) *g_lconv->decimal_point;
-                }
-            }
-#endif
-            continue;
+            return r;
         }
 
-        /*
-         * The datatype is declared native, so we have to convert it to displayable character data here.
-         * The case for CS_BINARY_TYPE, CS_LONGBINARY_TYPE. CS_VARBINARY_TYPE, CS_IMAGE_TYPE,
-         * CS_NUMERIC_TYPE and CS_DECIMAL_TYPE will only be executed if one or more of these datatypes
-         * are removed from the LET_CTLIB_CONV macro coded above. Otherwise these types are already
-         * decoded by CT-LIB. Note that freetds might have problems converting NUMERIC and DECIMAL
-         * types with cs_convert.
-        */
-        str_fmt.maxlength = d->d_cols[i].c_maxlength + 1;
-        str_fmt.precision = d->d_cols[i].c_format.precision;
-        str_fmt.scale = d->d_cols[i].c_format.scale;
-        d->d_cols[i].c_format.maxlength = d->d_cols[i].c_native_len;
-
-        switch (d->d_cols[i].c_format.datatype)
+        if (dsp_cancel( (CS_CONNECTION*)NULL, cmd, CS_CANCEL_CURRENT ) != CS_SUCCEED)
         {
-            case CS_BINARY_TYPE:
-            case CS_LONGBINARY_TYPE:
-            case CS_VARBINARY_TYPE:
-            case CS_IMAGE_TYPE:
-                strcpy( d->d_cols[i].c_data, "0x" );
-
-                if (cs_convert( g_context,                     /* Context */
-                                &d->d_cols[i].c_format,        /* Source Format */
-                                d->d_cols[i].c_native,         /* Source Data */
-                                &str_fmt,                      /* Dest Format */
-                                (CS_VOID*)(d->d_cols[i].c_data+2),/* Dest Data */
-                                (CS_INT*)NULL ) == CS_FAIL)
-                {
-                    fprintf( stderr, "dsp_desc_fetch: cs_convert(BIN->CHAR) column %d failed\n", (int) i+1 );
-                    dsp_display_fmt( "src_fmt", &d->d_cols[i].c_format );
-                    dsp_display_fmt( "dst_fmt", &str_fmt );
-                    return CS_FAIL;
-                }
-                break;
+            return CS_FAIL;
+        }
 
-            case CS_NUMERIC_TYPE:
-            case CS_DECIMAL_TYPE:
-                if (cs_convert( g_context,                     /* Context */
-                                &d->d_cols[i].c_format,        /* Source Format */
-                                d->d_cols[i].c_native,         /* Source Data */
-                                &str_fmt,                      /* Dest Format */
-                                (CS_VOID*)(d->d_cols[i].c_data),/* Dest Data */
-                                (CS_INT*)NULL ) == CS_FAIL)
-                {
-                    fprintf( stderr, "dsp_desc_fetch: cs_convert(NUMERIC->CHAR) column %d failed\n", (int) i+1 );
-                    dsp_display_fmt( "src_fmt", &d->d_cols[i].c_format );
-                    dsp_display_fmt( "dst_fmt", &str_fmt );
-                    return CS_FAIL;
-                }
+        ++d->d_limit->l_ncut;
+        return CS_END_DATA;
+    }
 
-#if defined(HAVE_LOCALE_H)
-                /*
-                 * sqsh-2.3: Convert the decimal separator in numeric/decimal datatypes
-                 * to the character according to the locale definition of the client.
-                 * By courtesy of Niki Hansche.
-                */
-                if (g_lconv != NULL && (radix = (CS_CHAR *) strrchr((CS_CHAR*) (d->d_cols[i].c_data), '.')) != NULL)
-                {
-                    *radix = (CS_CHAR) *g_lconv->decimal_point;
-                }
-#endif
-                break;
+    r = dsp_desc_replay( cmd, d );
 
-            case CS_MONEY_TYPE:
-            case CS_MONEY4_TYPE:
-                if (cs_convert( g_context,                     /* Context */
-                                &d->d_cols[i].c_format,        /* Source Format */
-                                d->d_cols[i].c_native,         /* Source Data */
-                                &str_fmt,                      /* Dest Format */
-                                (CS_VOID*)(d->d_cols[i].c_data),/* Dest Data */
-                                (CS_INT*)NULL ) == CS_FAIL)
-                {
-                    fprintf( stderr, "dsp_desc_fetch: cs_convert(MONEY->CHAR) column %d failed\n", (int) i+1 );
-                    dsp_display_fmt( "src_fmt", &d->d_cols[i].c_format );
-                    dsp_display_fmt( "dst_fmt", &str_fmt );
-                    return CS_FAIL;
-                }
+    if (r == CS_SUCCEED && d->d_limit != NULL && d->d_type == CS_ROW_RESULT)
+    {
+        ++d->d_nfetched;
+        ++d->d_limit->l_nrows;
+    }
 
-#if defined(HAVE_LOCALE_H)
-                /*
-                 * sqsh-2.3: Convert the decimal separator in money datatypes
-                 * to the character according to the locale definition of the client.
-                 * By courtesy of Niki Hansche.
-                */
-                if (g_lconv != NULL && (radix = (CS_CHAR *) strrchr((CS_CHAR*) (d->d_cols[i].c_data), '.')) != NULL)
-                {
-                    *radix = (CS_CHAR) *g_lconv->mon_decimal_point;
-                }
-#endif
-                break;
+    if (r == CS_SUCCEED && d->d_phase != NULL)
+    {
+        ++d->d_phase->ph_nrows;
+    }
 
-            case CS_REAL_TYPE:
-                sprintf( (char*)d->d_cols[i].c_data, "%*.*f",
-                         g_dsp_props.p_real_prec + 2,
-                         g_dsp_props.p_real_scale,
-                         (double)(*((CS_REAL*)d->d_cols[i].c_native)) );
-                break;
+    /*
+     * sqsh-3.0: Progress reporting costs a compare per row, the clock
+     * is only looked at every so many rows.  The rows of a sort were
+     * counted as it read them.
+     */
+    if (r == CS_SUCCEED && g_dsp_meter != NULL && d->d_sort == NULL &&
+        ++g_dsp_meter->m_nrows >= g_dsp_meter->m_check)
+    {
+        dsp_meter_tick( g_dsp_meter );
+    }
 
-            case CS_FLOAT_TYPE:
-                sprintf( (char*)d->d_cols[i].c_data, "%*.*f",
-                         g_dsp_props.p_flt_prec + 2,
-                         g_dsp_props.p_flt_scale,
-                         (double)(*((CS_FLOAT*)d->d_cols[i].c_native)) );
-                break;
+    return r;
+}
 
-            /*
-             * sqsh-2.1.9 - Also take date and time datatypes into consideration
-            */
-            case CS_DATETIME_TYPE:
-            case CS_DATETIME4_TYPE:
-#if defined(CS_DATE_TYPE)
-            case CS_DATE_TYPE:
-#endif
-#if defined(CS_TIME_TYPE)
-            case CS_TIME_TYPE:
-#endif
-#if defined(CS_BIGDATETIME_TYPE)
-            case CS_BIGDATETIME_TYPE:
-#endif
-#if defined(CS_BIGTIME_TYPE)
-            case CS_BIGTIME_TYPE:
-#endif
-                if (dsp_datetime_conv( g_context,              /* Context */
-                                      &d->d_cols[i].c_format,  /* Data format */
-                                       d->d_cols[i].c_native,  /* Data */
-                                       d->d_cols[i].c_data,    /* Destination */
-                                       d->d_cols[i].c_maxlength+1,
-                                       d->d_cols[i].c_format.datatype ) != CS_SUCCEED)
-                {
-                    return CS_FAIL;
-                }
-                break;
+/*
+ * dsp_desc_left():
+ *
+ * The number of rows of d that may still be returned under the row
+ * limits in effect, or -1 if there is no limit.  Only regular result
+ * sets are limited.
+ */
+static CS_INT dsp_desc_left( d )
+    dsp_desc_t  *d;
+{
+    dsp_limit_t  *l = d->d_limit;
+    CS_INT        left = -1;
 
-            default:
-                if (cs_convert( g_context,                     /* Context */
-                                &d->d_cols[i].c_format,        /* Source Format */
-                                d->d_cols[i].c_native,         /* Source Data */
-                                &str_fmt,                      /* Dest Format */
-                                (CS_VOID*)d->d_cols[i].c_data, /* Dest Data */
-                                (CS_INT*)NULL ) != CS_SUCCEED)
-                {
-                    fprintf( stderr, "dsp_desc_fetch: cs_convert(%d->CHAR) column %d failed\n",
-                             (int) d->d_cols[i].c_format.datatype, (int) i+1 );
-                    dsp_display_fmt( "src_fmt", &d->d_cols[i].c_format );
-                    dsp_display_fmt( "dst_fmt", &str_fmt );
-                    return CS_FAIL;
-                }
-                break;
-        }
+    if (l == NULL || d->d_type != CS_ROW_RESULT)
+    {
+        return -1;
     }
 
-    return CS_SUCCEED;
-}
+    if (l->l_maxrows > 0)
+    {
+        left = max( l->l_maxrows - d->d_nfetched, 0 );
+    }
+
+    if (l->l_batchrows > 0 &&
+        (left == -1 || l->l_batchrows - l->l_nrows < left))
+    {
+        left = max( l->l_batchrows - l->l_nrows, 0 );
+    }
 
+    return left;
+}
 
 /*
- * dsp_desc_destroy():
+ * dsp_desc_replay():
  *
- * Destroys a dsp_desc structure.
+ * Hands back the rows held by dsp_desc_sample(), if any, before
+ * going on to fetch the rest.
  */
-void dsp_desc_destroy( d )
+static CS_INT dsp_desc_replay( cmd, d )
+    CS_COMMAND  *cmd;
     dsp_desc_t  *d;
 {
-    CS_INT       i;
+    dsp_sample_t  *s;
+    CS_CHAR       *p;
+    int            pending;
+    CS_INT         r;
+    CS_INT         i;
 
-    if (d != NULL)
+    if (d->d_sample != NULL)
     {
-        if (d->d_cols != NULL)
+        s = d->d_sample;
+
+        if (s->s_next < s->s_nrows)
         {
             for (i = 0; i < d->d_ncols; i++)
             {
-                if (d->d_cols[i].c_native != NULL)
-                {
-                    free( d->d_cols[i].c_native );
-                }
+                p = s->s_buf + s->s_pos;
 
-                if (d->d_cols[i].c_data != NULL)
-                {
-                    free( d->d_cols[i].c_data );
-                }
+                d->d_cols[i].c_nullind = (*p != '\0') ? -1 : 0;
+                d->d_cols[i].c_data    = p + 1;
+                s->s_pos += strlen( p + 1 ) + 2;
             }
+            ++s->s_next;
 
-            free( d->d_cols );
+            return CS_SUCCEED;
         }
 
-        if (d->d_bylist != NULL)
-            free( d->d_bylist );
+        /*
+         * All of the rows held have been handed back, so point the
+         * columns back at their own buffers.
+         */
+        for (i = 0; i < d->d_ncols; i++)
+        {
+            d->d_cols[i].c_data = s->s_data[i];
 
-        free( d );
-    }
-}
+            if (s->s_pending == True)
+            {
+                d->d_cols[i].c_nullind = s->s_nullinds[i];
+            }
+        }
+
+        pending = s->s_pending;
+        r       = s->s_status;
+
+        dsp_sample_free( s );
+        d->d_sample = NULL;
+
+        /*
+         * Either the row left in the bound buffers is the next one,
+         * or the look ahead may already have run into the end of the
+         * data.
+         */
+        if (pending == True)
+        {
+            return CS_SUCCEED;
+        }
+
+        if (r != CS_SUCCEED)
+        {
+            return r;
+        }
+    }
+
+    return dsp_desc_next( cmd, d );
+}
+
+/*
+ * dsp_desc_sample():
+ *
+ * sqsh-3.0: Fetches up to nrows rows ahead of time, recording in
+ * c_sample_width the longest value found for each column, so that a
+ * display style can size its columns according to what is really in
+ * them rather than their declared length.  The rows are held on to
+ * (up to DSP_SAMPLE_MAXMEM bytes of them, whatever the value of
+ * nrows) and are returned by dsp_desc_fetch() before any others.
+ */
+CS_INT dsp_desc_sample( cmd, d, nrows )
+    CS_COMMAND  *cmd;
+    dsp_desc_t  *d;
+    CS_INT       nrows;
+{
+    dsp_sample_t  *s;
+    dsp_col_t     *col;
+    char          *buf;
+    int            rowlen;
+    int            len;
+    int            size;
+    CS_INT         r;
+    CS_INT         i;
+
+    /*
+     * There is no point looking at rows that won't be displayed.
+     */
+    r = dsp_desc_left( d );
+    if (r >= 0 && r < nrows)
+    {
+        nrows = r;
+    }
+
+    if (nrows <= 0 || d->d_sample != NULL)
+    {
+        return CS_SUCCEED;
+    }
+
+    s = (dsp_sample_t*)malloc( sizeof(dsp_sample_t) );
+    if (s == NULL)
+    {
+        return CS_SUCCEED;
+    }
+
+    s->s_buf      = NULL;
+    s->s_len      = 0;
+    s->s_size     = 0;
+    s->s_nrows    = 0;
+    s->s_next     = 0;
+    s->s_pos      = 0;
+    s->s_status   = CS_SUCCEED;
+    s->s_pending  = False;
+    s->s_data     = (CS_CHAR**)malloc( sizeof(CS_CHAR*) * max(d->d_ncols, 1) );
+    s->s_nullinds = (CS_SMALLINT*)malloc( sizeof(CS_SMALLINT) * max(d->d_ncols, 1) );
+
+    if (s->s_data == NULL || s->s_nullinds == NULL)
+    {
+        /*
+         * Nothing has been fetched yet, so the result set is simply
+         * displayed without sampling.
+         */
+        dsp_sample_free( s );
+        return CS_SUCCEED;
+    }
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        d->d_cols[i].c_sample_width = 0;
+        d->d_cols[i].c_sample_null  = False;
+    }
+
+    while (s->s_nrows < nrows && !g_dsp_interrupted)
+    {
+        if ((r = dsp_desc_next( cmd, d )) != CS_SUCCEED)
+        {
+            s->s_status = r;
+            break;
+        }
+
+        rowlen = 0;
+        for (i = 0; i < d->d_ncols; i++)
+        {
+            col = &d->d_cols[i];
+
+            if (col->c_nullind != 0)
+            {
+                col->c_sample_null = True;
+                len = 0;
+            }
+            else
+            {
+                len = strlen( col->c_data );
+                col->c_sample_width = max(col->c_sample_width, len);
+            }
+            rowlen += len + 2;
+        }
+
+        /*
+         * Make room for the row, leaving it where it is if that
+         * would take us past the limit.
+         */
+        if (s->s_len + rowlen > s->s_size)
+        {
+            size = max(s->s_size * 2, 65536);
+            while (size < s->s_len + rowlen)
+            {
+                size *= 2;
+            }
+            size = min(size, DSP_SAMPLE_MAXMEM);
+
+            buf = NULL;
+            if (s->s_len + rowlen <= size)
+            {
+                buf = (char*)realloc( s->s_buf, size );
+            }
+
+            if (buf == NULL)
+            {
+                for (i = 0; i < d->d_ncols; i++)
+                {
+                    s->s_nullinds[i] = d->d_cols[i].c_nullind;
+                }
+                s->s_pending = True;
+                break;
+            }
+
+            s->s_buf  = buf;
+            s->s_size = size;
+        }
+
+        for (i = 0; i < d->d_ncols; i++)
+        {
+            col = &d->d_cols[i];
+
+            if (col->c_nullind != 0)
+            {
+                s->s_buf[s->s_len++] = 1;
+                s->s_buf[s->s_len++] = '\0';
+            }
+            else
+            {
+                len = strlen( col->c_data ) + 1;
+                s->s_buf[s->s_len++] = 0;
+                memcpy( s->s_buf + s->s_len, col->c_data, len );
+                s->s_len += len;
+            }
+        }
+        ++s->s_nrows;
+    }
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        s->s_data[i] = d->d_cols[i].c_data;
+    }
+
+    DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_desc_sample: %d rows (%d bytes) held%s\n",
+        (int)s->s_nrows, s->s_len, (s->s_pending == True) ? ", one more bound" : "");)
+
+    d->d_sample = s;
+    return CS_SUCCEED;
+}
+
+/*
+ * dsp_sample_free():
+ *
+ * Releases the rows held by dsp_desc_sample().
+ */
+static void dsp_sample_free( s )
+    dsp_sample_t  *s;
+{
+    if (s->s_buf != NULL)
+        free( s->s_buf );
+    if (s->s_data != NULL)
+        free( s->s_data );
+    if (s->s_nullinds != NULL)
+        free( s->s_nullinds );
+    free( s );
+}
+
+/*
+ * dsp_desc_next():
+ *
+ * Moves on to the next row of the result set, fetching another block
+ * of rows from CT-Lib when the current one is used up.
+ */
+static CS_INT dsp_desc_next( cmd, d )
+    CS_COMMAND  *cmd;
+    dsp_desc_t  *d;
+{
+    CS_RETCODE  r;
+    CS_INT      nrows;
+    CS_INT      i;
+    double      start = 0.0;
+    double      now;
+
+    /*
+     * sqsh-3.0: If the block bound by dsp_desc_bind() still holds
+     * rows that haven't been handed out, simply move on to the next
+     * one. Otherwise go back to CT-Lib for another block.  A sort
+     * hands its rows back one at a time, in the first row of the
+     * block.
+     */
+    if (d->d_sort != NULL)
+    {
+        r = dsp_sort_next( cmd, d, dsp_desc_left( d ) );
+
+        if (r != CS_SUCCEED)
+        {
+            return r;
+        }
+    }
+    else if (d->d_row + 1 < d->d_nrows)
+    {
+        ++d->d_row;
+    }
+    else
+    {
+        d->d_nrows = 0;
+        d->d_row   = 0;
+
+        if (d->d_phase != NULL)
+        {
+            start = dsp_now();
+        }
+
+        r = dsp_fetch( cmd,             /* Command */
+                       CS_UNUSED,       /* Type */
+                       CS_UNUSED,       /* Offset */
+                       CS_UNUSED,       /* Option */
+                       &nrows );
+
+        /*
+         * sqsh-3.0: The wait for the first row of a batch is mostly
+         * the server working on the query.
+         */
+        if (d->d_phase != NULL)
+        {
+            now = dsp_now();
+            d->d_phase->ph_fetch += now - start;
+
+            if (d->d_phase->ph_first < 0.0 && r != CS_END_DATA)
+            {
+                d->d_phase->ph_first = now - g_dsp_stats.s_sent;
+            }
+        }
+
+        if (r == CS_END_DATA)
+        {
+            return CS_END_DATA;
+        }
+
+        /* mpeppler - 4/9/2004
+           allow CS_ROW_FAIL results to go through and not abort the entire
+           query. CS_ROW_FAIL usually means a conversion or truncation error
+           which shouldn't be fatal to the entire query, although a warning
+           should be printed. */
+        if (r != CS_SUCCEED && r != CS_ROW_FAIL)
+        {
+            return r;
+        }
+
+        d->d_nrows = (nrows > 0) ? nrows : 1;
+    }
+
+    /*
+     * Point each column at the current row of its block.  Columns
+     * converted by CT-Lib have a string per row, the others share
+     * the one conversion buffer.
+     */
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        d->d_cols[i].c_nullind = d->d_cols[i].c_nullinds[d->d_row];
+
+        if (d->d_cols[i].c_is_native == CS_FALSE)
+        {
+            d->d_cols[i].c_data = d->d_cols[i].c_data_blk +
+                (d->d_row * d->d_cols[i].c_data_size);
+        }
+        else
+        {
+            d->d_cols[i].c_native = (CS_VOID*)((CS_BYTE*)d->d_cols[i].c_native_blk +
+                (d->d_row * d->d_cols[i].c_native_size));
+            d->d_cols[i].c_native_len = d->d_cols[i].c_native_lens[d->d_row];
+        }
+    }
+
+    /*
+     * sqsh-3.0: A style that works on the native values itself (see
+     * dsp_summary.c) has no use for their strings.
+     */
+    if (d->d_raw)
+    {
+        return CS_SUCCEED;
+    }
+
+    if (d->d_phase != NULL)
+    {
+        start = dsp_now();
+    }
+
+    for (i = 0; i < d->d_ncols; i++)
+    {
+        /*
+         * If the column is NULL, then don't bother to attempt any
+         * sort of conversion, just empty out the data string and
+         * continue on to the next column.
+         */
+        if (d->d_cols[i].c_nullind != 0)
+        {
+            d->d_cols[i].c_data[0] = '\0';
+            continue;
+        }
+
+        /*
+         * sqsh-3.0: Let the formatter chosen by dsp_desc_bind() turn
+         * the data into a displayable string. Columns converted by
+         * CT-Lib usually have nothing left to be done.
+         */
+        if (d->d_cols[i].c_formatter != NULL &&
+            (*d->d_cols[i].c_formatter)( &d->d_cols[i] ) != CS_SUCCEED)
+        {
+            return CS_FAIL;
+        }
+    }
+
+    if (d->d_phase != NULL)
+    {
+        d->d_phase->ph_convert += dsp_now() - start;
+    }
+
+    return CS_SUCCEED;
+}
+
+
+/*
+ * dsp_desc_destroy():
+ *
+ * Destroys a dsp_desc structure.
+ */
+void dsp_desc_destroy( d )
+    dsp_desc_t  *d;
+{
+    CS_INT       i;
+
+    if (d != NULL)
+    {
+        if (d->d_cols != NULL)
+        {
+            for (i = 0; i < d->d_ncols; i++)
+            {
+                if (d->d_cols[i].c_native_blk != NULL)
+                {
+                    free( d->d_cols[i].c_native_blk );
+                }
+
+                if (d->d_cols[i].c_native_lens != NULL)
+                {
+                    free( d->d_cols[i].c_native_lens );
+                }
+
+                if (d->d_cols[i].c_data_blk != NULL)
+                {
+                    free( d->d_cols[i].c_data_blk );
+                }
+
+                if (d->d_cols[i].c_nullinds != NULL)
+                {
+                    free( d->d_cols[i].c_nullinds );
+                }
+
+                if (d->d_cols[i].c_dtcache != NULL)
+                {
+                    free( d->d_cols[i].c_dtcache );
+                }
+            }
+
+            free( d->d_cols );
+        }
+
+        if (d->d_bylist != NULL)
+            free( d->d_bylist );
+
+        if (d->d_sample != NULL)
+            dsp_sample_free( d->d_sample );
+
+        if (d->d_sort != NULL)
+            dsp_sort_close( d->d_sort );
+
+        free( d );
+    }
+}
+
+
+/*
+ * sqsh-3.0
+ * Column formatters.  Each of the following turns the value fetched
+ * for the current row of a column into the string found in c_data.
+ * dsp_fmt_select() picks the formatter for a column once, when the
+ * result set is bound, so dsp_desc_fetch() only has to make a call
+ * per non-NULL cell.
+ */
+
+/*
+ * dsp_fmt_uint():
+ *
+ * Writes the decimal representation of v, preceded by a '-' if neg
+ * is set, to buf.  Two digits at a time are taken from sg_dsp_digits.
+ * Returns the number of characters written, not counting the
+ * terminating null.
+ */
+static int dsp_fmt_uint( buf, neg, v )
+    CS_CHAR     *buf;
+    int          neg;
+    dsp_uint_t   v;
+{
+    char         tmp[24];
+    char        *p = tmp + sizeof(tmp);
+    int          n;
+    int          len;
+
+    while (v >= 100)
+    {
+        n   = (int)(v % 100) * 2;
+        v  /= 100;
+        *--p = sg_dsp_digits[n + 1];
+        *--p = sg_dsp_digits[n];
+    }
+
+    if (v >= 10)
+    {
+        n    = (int)v * 2;
+        *--p = sg_dsp_digits[n + 1];
+        *--p = sg_dsp_digits[n];
+    }
+    else
+    {
+        *--p = (char)('0' + v);
+    }
+
+    if (neg)
+        *--p = '-';
+
+    len = (int)((tmp + sizeof(tmp)) - p);
+    memcpy( buf, p, len );
+    buf[len] = '\0';
+
+    return len;
+}
+
+static CS_RETCODE dsp_fmt_tinyint( c )
+    dsp_col_t   *c;
+{
+    dsp_fmt_uint( c->c_data, 0, (dsp_uint_t)*((CS_TINYINT*)c->c_native) );
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_bit( c )
+    dsp_col_t   *c;
+{
+    c->c_data[0] = *((CS_BIT*)c->c_native) ? '1' : '0';
+    c->c_data[1] = '\0';
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_smallint( c )
+    dsp_col_t   *c;
+{
+    CS_SMALLINT  v = *((CS_SMALLINT*)c->c_native);
+
+    dsp_fmt_uint( c->c_data, v < 0,
+        (v < 0) ? (dsp_uint_t)0 - (dsp_uint_t)v : (dsp_uint_t)v );
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_int( c )
+    dsp_col_t   *c;
+{
+    CS_INT       v = *((CS_INT*)c->c_native);
+
+    dsp_fmt_uint( c->c_data, v < 0,
+        (v < 0) ? (dsp_uint_t)0 - (dsp_uint_t)v : (dsp_uint_t)v );
+    return CS_SUCCEED;
+}
+
+#if defined(DSP_HAVE_INT64)
+static CS_RETCODE dsp_fmt_bigint( c )
+    dsp_col_t   *c;
+{
+    CS_BIGINT    v = *((CS_BIGINT*)c->c_native);
+
+    dsp_fmt_uint( c->c_data, v < 0,
+        (v < 0) ? (dsp_uint_t)0 - (dsp_uint_t)v : (dsp_uint_t)v );
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_ubigint( c )
+    dsp_col_t   *c;
+{
+    dsp_fmt_uint( c->c_data, 0, (dsp_uint_t)*((CS_UBIGINT*)c->c_native) );
+    return CS_SUCCEED;
+}
+#endif
+
+#if defined(CS_USMALLINT_TYPE) && defined(CS_UINT_TYPE)
+static CS_RETCODE dsp_fmt_usmallint( c )
+    dsp_col_t   *c;
+{
+    dsp_fmt_uint( c->c_data, 0, (dsp_uint_t)*((CS_USMALLINT*)c->c_native) );
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_uint32( c )
+    dsp_col_t   *c;
+{
+    dsp_fmt_uint( c->c_data, 0, (dsp_uint_t)*((CS_UINT*)c->c_native) );
+    return CS_SUCCEED;
+}
+#endif
+
+/*
+ * dsp_fmt_fixed():
+ *
+ * Produces exactly what sprintf( buf, "%*.*f", width, scale, v ) would,
+ * for the common case where v scaled by 10^scale is small enough to be
+ * held exactly in an integer.  The scaled value is rounded to the nearest
+ * integer, which is only safe when it is not too close to half way
+ * between two integers; the error in the scaling multiplication is below
+ * 2^-13 for values under DSP_FIXED_MAX, so anything within DSP_FIXED_TIE
+ * of a tie is left to sprintf(), along with infinities, NaNs and large
+ * values.  Returns the length of the string, or -1 if the caller should
+ * fall back to sprintf().
+ */
+static int dsp_fmt_fixed( buf, v, width, scale, radix )
+    CS_CHAR     *buf;
+    double       v;
+    int          width;
+    int          scale;
+    int          radix;
+{
+    char         tmp[64];
+    char        *p = tmp + sizeof(tmp);
+    double       a;
+    double       r;
+    double       f;
+    dsp_uint_t   n;
+    int          i;
+    int          len;
+
+    if (radix == '\0' || scale < 0 ||
+        scale >= (int)(sizeof(sg_dsp_pow10) / sizeof(double)))
+    {
+        return -1;
+    }
+
+    a = ((v < 0.0) ? -v : v) * sg_dsp_pow10[scale];
+
+    /*-- Also fails for NaN and infinity --*/
+    if (!(a < DSP_FIXED_MAX))
+    {
+        return -1;
+    }
+
+    r = (double)(dsp_uint_t)a;
+    f = a - r;
+
+    if (f - 0.5 < DSP_FIXED_TIE && 0.5 - f < DSP_FIXED_TIE)
+    {
+        return -1;
+    }
+
+    n = (dsp_uint_t)r + ((f > 0.5) ? 1 : 0);
+
+    for (i = 0; i < scale; i++)
+    {
+        *--p = (char)('0' + (n % 10));
+        n   /= 10;
+    }
+
+    if (scale > 0)
+        *--p = (char)radix;
+
+    do
+    {
+        *--p = (char)('0' + (n % 10));
+        n   /= 10;
+    }
+    while (n > 0);
+
+    /*
+     * sprintf() shows the sign of anything negative, including values
+     * that round to zero and negative zero itself.
+     */
+    if (v < 0.0 || (v == 0.0 && 1.0 / v < 0.0))
+        *--p = '-';
+
+    len = (int)((tmp + sizeof(tmp)) - p);
+
+    for (i = len; i < width; i++)
+        *buf++ = ' ';
+
+    memcpy( buf, p, len );
+    buf[len] = '\0';
+
+    return (len < width) ? width : len;
+}
+
+static CS_RETCODE dsp_fmt_real( c )
+    dsp_col_t   *c;
+{
+    double       v = (double)(*((CS_REAL*)c->c_native));
+
+    if (dsp_fmt_fixed( c->c_data, v, g_dsp_props.p_real_prec + 2,
+                       g_dsp_props.p_real_scale, c->c_radix ) < 0)
+    {
+        sprintf( (char*)c->c_data, "%*.*f",
+                 g_dsp_props.p_real_prec + 2,
+                 g_dsp_props.p_real_scale, v );
+    }
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_float( c )
+    dsp_col_t   *c;
+{
+    double       v = (double)(*((CS_FLOAT*)c->c_native));
+
+    if (dsp_fmt_fixed( c->c_data, v, g_dsp_props.p_flt_prec + 2,
+                       g_dsp_props.p_flt_scale, c->c_radix ) < 0)
+    {
+        sprintf( (char*)c->c_data, "%*.*f",
+                 g_dsp_props.p_flt_prec + 2,
+                 g_dsp_props.p_flt_scale, v );
+    }
+    return CS_SUCCEED;
+}
+
+/*
+ * dsp_fmt_convert_to():
+ *
+ * Lets cs_convert() turn the native value of the column into a string
+ * at dst.  This is the fallback for datatypes that have no formatter
+ * of their own.
+ */
+static CS_RETCODE dsp_fmt_convert_to( c, dst, what )
+    dsp_col_t   *c;
+    CS_CHAR     *dst;
+    char        *what;
+{
+    CS_DATAFMT   str_fmt;
+
+    memset( &str_fmt, 0, sizeof(str_fmt) );
+    str_fmt.datatype  = CS_CHAR_TYPE;
+    str_fmt.format    = CS_FMT_NULLTERM;
+    str_fmt.maxlength = c->c_maxlength + 1;
+    str_fmt.precision = c->c_format.precision;
+    str_fmt.scale     = c->c_format.scale;
+    str_fmt.locale    = NULL;
+
+    c->c_format.maxlength = c->c_native_len;
+
+    if (cs_convert( g_context,                     /* Context */
+                    &c->c_format,                  /* Source Format */
+                    c->c_native,                   /* Source Data */
+                    &str_fmt,                      /* Dest Format */
+                    (CS_VOID*)dst,                 /* Dest Data */
+                    (CS_INT*)NULL ) != CS_SUCCEED)
+    {
+        if (what != NULL)
+        {
+            fprintf( stderr, "dsp_desc_fetch: cs_convert(%s->CHAR) column %d failed\n",
+                     what, (int)c->c_colid );
+        }
+        else
+        {
+            fprintf( stderr, "dsp_desc_fetch: cs_convert(%d->CHAR) column %d failed\n",
+                     (int)c->c_format.datatype, (int)c->c_colid );
+        }
+        dsp_display_fmt( "src_fmt", &c->c_format );
+        dsp_display_fmt( "dst_fmt", &str_fmt );
+        return CS_FAIL;
+    }
+
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_convert( c )
+    dsp_col_t   *c;
+{
+    return dsp_fmt_convert_to( c, c->c_data, (char*)NULL );
+}
+
+/*
+ * dsp_fmt_radix():
+ *
+ * Replaces the last '.' in the string of the column with the radix
+ * character of the client locale.  This is only chosen when that
+ * character differs from '.'.
+ */
+static void dsp_fmt_radix( c )
+    dsp_col_t   *c;
+{
+    CS_CHAR     *radix;
+
+    if ((radix = (CS_CHAR*)strrchr( (char*)c->c_data, '.' )) != NULL)
+    {
+        *radix = c->c_radix;
+    }
+}
+
+/*
+ * dsp_fmt_ctlib_binary():
+ *
+ * sqsh-2.1.8: CT-Lib converts binary data to hex for us, but we
+ * have to prepend the result string with characters '0x'.
+ * 20110107: Prepend 0x0 in case of odd number of chars in string.
+ */
+static CS_RETCODE dsp_fmt_ctlib_binary( c )
+    dsp_col_t   *c;
+{
+    int          p;
+    int          j;
+
+    p = strlen( c->c_data );
+    j = (p % 2 == 0 ? 2 : 3);
+    for (; p >= 0; p--)
+        c->c_data[p+j] = c->c_data[p];
+    c->c_data[0] = '0';
+    c->c_data[1] = 'x';
+    if (j==3) c->c_data[2] = '0';
+
+    return CS_SUCCEED;
+}
+
+/*
+ * dsp_fmt_ctlib_numeric():
+ *
+ * sqsh-2.3: Convert the decimal separator in numeric/decimal datatypes
+ * to the character according to the locale definition of the client.
+ * By courtesy of Niki Hansche.
+ */
+static CS_RETCODE dsp_fmt_ctlib_numeric( c )
+    dsp_col_t   *c;
+{
+    dsp_fmt_radix( c );
+    return CS_SUCCEED;
+}
+
+/*
+ * dsp_hex_encode():
+ *
+ * Writes the n bytes at src to dst as 2*n hex digits followed by a
+ * null.  Where the compiler lets us, 32 (AVX2) or 16 (SSE2) bytes are
+ * done at a time by splitting them into nibbles, turning each nibble
+ * into its digit with a compare and two adds, and interleaving the
+ * high and low digits.  What's left over goes through a table lookup.
+ */
+static void dsp_hex_encode( dst, src, n, upper )
+    CS_CHAR     *dst;
+    CS_BYTE     *src;
+    CS_INT       n;
+    int          upper;
+{
+    static const char lower_digits[] = "0123456789abcdef";
+    static const char upper_digits[] = "0123456789ABCDEF";
+    const char  *digits = upper ? upper_digits : lower_digits;
+    CS_INT       i = 0;
+
+#if defined(__AVX2__)
+    {
+        __m256i  mask  = _mm256_set1_epi8( 0x0f );
+        __m256i  nine  = _mm256_set1_epi8( 9 );
+        __m256i  zero  = _mm256_set1_epi8( '0' );
+        __m256i  alpha = _mm256_set1_epi8( upper ? 'A' - '0' - 10 : 'a' - '0' - 10 );
+        __m256i  x, hi, lo, a, b;
+
+        for (; i + 32 <= n; i += 32)
+        {
+            x  = _mm256_loadu_si256( (const __m256i*)(src + i) );
+            hi = _mm256_and_si256( _mm256_srli_epi16( x, 4 ), mask );
+            lo = _mm256_and_si256( x, mask );
+            hi = _mm256_add_epi8( _mm256_add_epi8( hi, zero ),
+                     _mm256_and_si256( _mm256_cmpgt_epi8( hi, nine ), alpha ) );
+            lo = _mm256_add_epi8( _mm256_add_epi8( lo, zero ),
+                     _mm256_and_si256( _mm256_cmpgt_epi8( lo, nine ), alpha ) );
+
+            /*-- The unpacks work per 128 bit lane, so put the lanes back in order --*/
+            a = _mm256_unpacklo_epi8( hi, lo );
+            b = _mm256_unpackhi_epi8( hi, lo );
+            _mm256_storeu_si256( (__m256i*)(dst + 2 * i),
+                _mm256_permute2x128_si256( a, b, 0x20 ) );
+            _mm256_storeu_si256( (__m256i*)(dst + 2 * i + 32),
+                _mm256_permute2x128_si256( a, b, 0x31 ) );
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    {
+        __m128i  mask  = _mm_set1_epi8( 0x0f );
+        __m128i  nine  = _mm_set1_epi8( 9 );
+        __m128i  zero  = _mm_set1_epi8( '0' );
+        __m128i  alpha = _mm_set1_epi8( upper ? 'A' - '0' - 10 : 'a' - '0' - 10 );
+        __m128i  x, hi, lo;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            x  = _mm_loadu_si128( (const __m128i*)(src + i) );
+            hi = _mm_and_si128( _mm_srli_epi16( x, 4 ), mask );
+            lo = _mm_and_si128( x, mask );
+            hi = _mm_add_epi8( _mm_add_epi8( hi, zero ),
+                     _mm_and_si128( _mm_cmpgt_epi8( hi, nine ), alpha ) );
+            lo = _mm_add_epi8( _mm_add_epi8( lo, zero ),
+                     _mm_and_si128( _mm_cmpgt_epi8( lo, nine ), alpha ) );
+            _mm_storeu_si128( (__m128i*)(dst + 2 * i),
+                _mm_unpacklo_epi8( hi, lo ) );
+            _mm_storeu_si128( (__m128i*)(dst + 2 * i + 16),
+                _mm_unpackhi_epi8( hi, lo ) );
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[2 * i]     = digits[src[i] >> 4];
+        dst[2 * i + 1] = digits[src[i] & 0x0f];
+    }
+    dst[2 * n] = '\0';
+}
+
+/*
+ * dsp_hex_probe():
+ *
+ * Binary columns are only bound natively if that makes no difference
+ * to what is displayed.  A few bytes are converted by cs_convert(),
+ * run through dsp_fmt_ctlib_binary() just as they would have been, and
+ * compared against dsp_hex_encode() in lower and upper case.  The
+ * outcome is remembered in sg_hex_case.
+ */
+static int dsp_hex_probe()
+{
+    static CS_BYTE probe[] = { 0x00, 0x0a, 0xbc, 0xff, 0x5d, 0x10 };
+    CS_DATAFMT   bin_fmt;
+    CS_DATAFMT   str_fmt;
+    dsp_col_t    col;
+    CS_CHAR      ctlib[2 * sizeof(probe) + 4];
+    CS_CHAR      native[2 * sizeof(probe) + 4];
+
+    if (sg_hex_case != DSP_HEX_UNKNOWN)
+        return sg_hex_case;
+
+    sg_hex_case = DSP_HEX_CTLIB;
+
+    memset( &bin_fmt, 0, sizeof(bin_fmt) );
+    bin_fmt.datatype  = CS_BINARY_TYPE;
+    bin_fmt.format    = CS_FMT_UNUSED;
+    bin_fmt.maxlength = sizeof(probe);
+    bin_fmt.locale    = NULL;
+
+    memset( &str_fmt, 0, sizeof(str_fmt) );
+    str_fmt.datatype  = CS_CHAR_TYPE;
+    str_fmt.format    = CS_FMT_NULLTERM;
+    str_fmt.maxlength = 2 * sizeof(probe) + 1;
+    str_fmt.locale    = NULL;
+
+    if (cs_convert( g_context, &bin_fmt, (CS_VOID*)probe, &str_fmt,
+                    (CS_VOID*)ctlib, (CS_INT*)NULL ) != CS_SUCCEED)
+    {
+        return sg_hex_case;
+    }
+
+    col.c_data = ctlib;
+    dsp_fmt_ctlib_binary( &col );
+
+    native[0] = '0';
+    native[1] = 'x';
+    dsp_hex_encode( native + 2, probe, (CS_INT)sizeof(probe), False );
+    if (strcmp( ctlib, native ) == 0)
+    {
+        sg_hex_case = DSP_HEX_LOWER;
+    }
+    else
+    {
+        dsp_hex_encode( native + 2, probe, (CS_INT)sizeof(probe), True );
+        if (strcmp( ctlib, native ) == 0)
+            sg_hex_case = DSP_HEX_UPPER;
+    }
+
+    DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_hex_probe: CT-Lib gives '%s', using %s\n",
+        ctlib, (sg_hex_case == DSP_HEX_CTLIB) ? "CT-Lib" : "dsp_hex_encode");)
+
+    return sg_hex_case;
+}
+
+/*
+ * dsp_fmt_binary():
+ *
+ * Natively bound binary data is written straight after the "0x".
+ */
+static CS_RETCODE dsp_fmt_binary( c )
+    dsp_col_t   *c;
+{
+    c->c_data[0] = '0';
+    c->c_data[1] = 'x';
+    dsp_hex_encode( c->c_data + 2, (CS_BYTE*)c->c_native, c->c_native_len,
+                    sg_hex_case == DSP_HEX_UPPER );
+    return CS_SUCCEED;
+}
+
+static CS_RETCODE dsp_fmt_numeric( c )
+    dsp_col_t   *c;
+{
+    if (dsp_fmt_convert_to( c, c->c_data, "NUMERIC" ) != CS_SUCCEED)
+        return CS_FAIL;
+
+    if (c->c_radix != '.')
+        dsp_fmt_radix( c );
+    return CS_SUCCEED;
+}
+
+/*
+ * dsp_money_calibrate():
+ *
+ * CT-Lib implementations do not agree on how money is displayed;
+ * some round to two decimals, others show all four, and so on.  So
+ * rather than guessing, a handful of probe values are converted by
+ * cs_convert() and the results are compared against every variant
+ * dsp_money_render() knows how to produce.  If one of them matches
+ * all probes it is used from then on, otherwise money columns keep
+ * going through cs_convert().
+ */
+static void dsp_money_calibrate( type, cal )
+    CS_INT        type;
+    dsp_money_t  *cal;
+{
+#if defined(DSP_HAVE_INT64)
+    static char  *money_probes[] = {
+        "-1234.5678", "0.0050", "0.0049", "-0.0001", "0.9999", "-0.5000",
+        "12345678901.2345", "-922337203685477.5808", NULL
+    };
+    static char  *money4_probes[] = {
+        "-1234.5678", "0.0050", "0.0049", "-0.0001", "0.9999", "-0.5000",
+        "-214748.3648", NULL
+    };
+    char        **probes;
+    CS_CHAR       expect[8][64];
+    CS_CHAR       got[64];
+    CS_BIGINT     vals[8];
+    CS_DATAFMT    str_fmt;
+    CS_DATAFMT    mon_fmt;
+    CS_MONEY      mon;
+    CS_MONEY4     mon4;
+    CS_VOID      *mon_ptr;
+    dsp_money_t   try;
+    int           nprobes;
+    int           i;
+
+    cal->m_ok = 0;
+
+    memset( &str_fmt, 0, sizeof(str_fmt) );
+    str_fmt.datatype  = CS_CHAR_TYPE;
+    str_fmt.format    = CS_FMT_NULLTERM;
+    str_fmt.locale    = NULL;
+
+    memset( &mon_fmt, 0, sizeof(mon_fmt) );
+    mon_fmt.datatype  = type;
+    mon_fmt.format    = CS_FMT_UNUSED;
+    mon_fmt.locale    = NULL;
+
+    if (type == CS_MONEY_TYPE)
+    {
+        probes            = money_probes;
+        mon_fmt.maxlength = sizeof(CS_MONEY);
+        mon_ptr           = (CS_VOID*)&mon;
+    }
+    else
+    {
+        probes            = money4_probes;
+        mon_fmt.maxlength = sizeof(CS_MONEY4);
+        mon_ptr           = (CS_VOID*)&mon4;
+    }
+
+    for (nprobes = 0; probes[nprobes] != NULL; nprobes++)
+    {
+        str_fmt.maxlength = strlen( probes[nprobes] );
+        if (cs_convert( g_context, &str_fmt, (CS_VOID*)probes[nprobes],
+                        &mon_fmt, mon_ptr, (CS_INT*)NULL ) != CS_SUCCEED)
+        {
+            return;
+        }
+
+        str_fmt.maxlength = sizeof(expect[nprobes]);
+        if (cs_convert( g_context, &mon_fmt, mon_ptr, &str_fmt,
+                        (CS_VOID*)expect[nprobes], (CS_INT*)NULL ) != CS_SUCCEED)
+        {
+            return;
+        }
+
+        vals[nprobes] = dsp_money_value( type, mon_ptr );
+    }
+
+    for (try.m_ndec = 0; try.m_ndec <= 4; try.m_ndec++)
+    {
+        for (try.m_round = 0; try.m_round <= 1; try.m_round++)
+        {
+            for (try.m_lead0 = 0; try.m_lead0 <= 1; try.m_lead0++)
+            {
+                for (try.m_negzero = 0; try.m_negzero <= 1; try.m_negzero++)
+                {
+                    for (i = 0; i < nprobes; i++)
+                    {
+                        dsp_money_render( got, vals[i], &try, '.' );
+                        if (strcmp( got, expect[i] ) != 0)
+                            break;
+                    }
+
+                    if (i == nprobes)
+                    {
+                        *cal      = try;
+                        cal->m_ok = 1;
+
+                        DBG(sqsh_debug(DEBUG_DISPLAY,
+                            "dsp_money_calibrate: type %d, %d decimals, round %d, "
+                            "lead0 %d, negzero %d\n", (int)type, try.m_ndec,
+                            try.m_round, try.m_lead0, try.m_negzero);)
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    DBG(sqsh_debug(DEBUG_DISPLAY,
+        "dsp_money_calibrate: type %d, no match (e.g. '%s'), using cs_convert\n",
+        (int)type, expect[0]);)
+#else
+    cal->m_ok = 0;
+#endif
+}
+
+#if defined(DSP_HAVE_INT64)
+/*
+ * dsp_money_value():
+ *
+ * Returns a money value as a count of 1/10000ths.
+ */
+CS_BIGINT dsp_money_value( type, mon )
+    CS_INT       type;
+    CS_VOID     *mon;
+{
+    if (type == CS_MONEY4_TYPE)
+    {
+        return (CS_BIGINT)((CS_MONEY4*)mon)->mny4;
+    }
+
+    return (CS_BIGINT)(((dsp_uint_t)(CS_UINT)((CS_MONEY*)mon)->mnyhigh << 32) |
+                       (dsp_uint_t)((CS_MONEY*)mon)->mnylow);
+}
+
+/*
+ * dsp_money_render():
+ *
+ * Formats v (in 1/10000ths) the way described by cal, using radix
+ * as the decimal separator.
+ */
+static int dsp_money_render( buf, v, cal, radix )
+    CS_CHAR      *buf;
+    CS_BIGINT     v;
+    dsp_money_t  *cal;
+    int           radix;
+{
+    static dsp_uint_t pow10[] = { 1, 10, 100, 1000, 10000 };
+    char          tmp[32];
+    char         *p = tmp + sizeof(tmp);
+    dsp_uint_t    m;
+    dsp_uint_t    div;
+    int           i;
+    int           len;
+
+    m   = (v < 0) ? (dsp_uint_t)0 - (dsp_uint_t)v : (dsp_uint_t)v;
+    div = pow10[4 - cal->m_ndec];
+    m   = cal->m_round ? (m + div / 2) / div : m / div;
+
+    for (i = 0; i < cal->m_ndec; i++)
+    {
+        *--p = (char)('0' + (m % 10));
+        m   /= 10;
+    }
+
+    if (cal->m_ndec > 0)
+        *--p = (char)radix;
+
+    if (m > 0 || cal->m_lead0 || cal->m_ndec == 0)
+    {
+        do
+        {
+            *--p = (char)('0' + (m % 10));
+            m   /= 10;
+        }
+        while (m > 0);
+    }
+
+    if (v < 0)
+    {
+        for (i = 0; &p[i] < tmp + sizeof(tmp); i++)
+        {
+            if (p[i] != '0' && p[i] != (char)radix)
+                break;
+        }
+
+        if (&p[i] < tmp + sizeof(tmp) || cal->m_negzero)
+            *--p = '-';
+    }
+
+    len = (int)((tmp + sizeof(tmp)) - p);
+    memcpy( buf, p, len );
+    buf[len] = '\0';
+
+    return len;
+}
+#endif /* DSP_HAVE_INT64 */
+
+static CS_RETCODE dsp_fmt_money( c )
+    dsp_col_t   *c;
+{
+#if defined(DSP_HAVE_INT64)
+    dsp_money_t *cal;
+
+    cal = (c->c_format.datatype == CS_MONEY_TYPE) ? &sg_money_cal : &sg_money4_cal;
+
+    if (cal->m_ok == 1)
+    {
+        dsp_money_render( c->c_data,
+            dsp_money_value( c->c_format.datatype, c->c_native ),
+            cal, c->c_radix );
+        return CS_SUCCEED;
+    }
+#endif
+
+    if (dsp_fmt_convert_to( c, c->c_data, "MONEY" ) != CS_SUCCEED)
+        return CS_FAIL;
+
+    /*
+     * sqsh-2.3: Convert the decimal separator in money datatypes
+     * to the character according to the locale definition of the client.
+     * By courtesy of Niki Hansche.
+     */
+    if (c->c_radix != '.')
+        dsp_fmt_radix( c );
+    return CS_SUCCEED;
+}
+
+/*
+ * sqsh-2.1.9 - Also take date and time datatypes into consideration
+ */
+static CS_RETCODE dsp_fmt_datetime( c )
+    dsp_col_t   *c;
+{
+    return dsp_datetime_conv( g_context,           /* Context */
+                              &c->c_format,        /* Data format */
+                              c->c_native,         /* Data */
+                              c->c_data,           /* Destination */
+                              c->c_maxlength+1,
+                              c->c_format.datatype,
+                              c->c_dtcache );
+}
+
+/*
+ * Formatters for natively bound columns, by datatype.  Anything not
+ * in here goes through dsp_fmt_convert().  The numeric entries are
+ * only used if those types are removed from the LET_CTLIB_CONV macro
+ * above.
+ */
+static struct {
+    CS_INT        f_type;
+    dsp_colfmt_t *f_func;
+} sg_fmt_table[] = {
+    { CS_TINYINT_TYPE,     dsp_fmt_tinyint   },
+    { CS_SMALLINT_TYPE,    dsp_fmt_smallint  },
+    { CS_INT_TYPE,         dsp_fmt_int       },
+    { CS_BIT_TYPE,         dsp_fmt_bit       },
+#if defined(DSP_HAVE_INT64)
+    { CS_BIGINT_TYPE,      dsp_fmt_bigint    },
+    { CS_UBIGINT_TYPE,     dsp_fmt_ubigint   },
+#endif
+#if defined(CS_USMALLINT_TYPE) && defined(CS_UINT_TYPE)
+    { CS_USMALLINT_TYPE,   dsp_fmt_usmallint },
+    { CS_UINT_TYPE,        dsp_fmt_uint32    },
+#endif
+    { CS_REAL_TYPE,        dsp_fmt_real      },
+    { CS_FLOAT_TYPE,       dsp_fmt_float     },
+    { CS_MONEY_TYPE,       dsp_fmt_money     },
+    { CS_MONEY4_TYPE,      dsp_fmt_money     },
+    { CS_NUMERIC_TYPE,     dsp_fmt_numeric   },
+    { CS_DECIMAL_TYPE,     dsp_fmt_numeric   },
+    { CS_BINARY_TYPE,      dsp_fmt_binary    },
+    { CS_LONGBINARY_TYPE,  dsp_fmt_binary    },
+    { CS_VARBINARY_TYPE,   dsp_fmt_binary    },
+    { CS_IMAGE_TYPE,       dsp_fmt_binary    },
+    { CS_DATETIME_TYPE,    dsp_fmt_datetime  },
+    { CS_DATETIME4_TYPE,   dsp_fmt_datetime  },
+#if defined(CS_DATE_TYPE)
+    { CS_DATE_TYPE,        dsp_fmt_datetime  },
+#endif
+#if defined(CS_TIME_TYPE)
+    { CS_TIME_TYPE,        dsp_fmt_datetime  },
+#endif
+#if defined(CS_BIGDATETIME_TYPE)
+    { CS_BIGDATETIME_TYPE, dsp_fmt_datetime  },
+#endif
+#if defined(CS_BIGTIME_TYPE)
+    { CS_BIGTIME_TYPE,     dsp_fmt_datetime  },
+#endif
+};
+
+/*
+ * dsp_fmt_select():
+ *
+ * Picks the formatter and radix character for a column whose
+ * c_format and c_is_native have been filled in.
+ */
+static void dsp_fmt_select( c )
+    dsp_col_t   *c;
+{
+    CS_INT       type = c->c_format.datatype;
+    int          i;
+
+    c->c_radix = '.';
+
+#if defined(HAVE_LOCALE_H)
+    if (g_lconv != NULL)
+    {
+        if (type == CS_MONEY_TYPE || type == CS_MONEY4_TYPE)
+        {
+            c->c_radix = (CS_CHAR)*g_lconv->mon_decimal_point;
+        }
+        else if (type == CS_REAL_TYPE || type == CS_FLOAT_TYPE)
+        {
+            /*
+             * The radix used by sprintf(). A multi-byte one makes
+             * dsp_fmt_fixed() give up.
+             */
+            c->c_radix = (strlen( g_lconv->decimal_point ) == 1) ?
+                (CS_CHAR)*g_lconv->decimal_point : '\0';
+        }
+        else
+        {
+            c->c_radix = (CS_CHAR)*g_lconv->decimal_point;
+        }
+    }
+#endif
+
+    if (c->c_is_native == CS_FALSE)
+    {
+        switch (type)
+        {
+            case CS_BINARY_TYPE:
+            case CS_LONGBINARY_TYPE:
+            case CS_VARBINARY_TYPE:
+            case CS_IMAGE_TYPE:
+                c->c_formatter = dsp_fmt_ctlib_binary;
+                break;
+            case CS_NUMERIC_TYPE:
+            case CS_DECIMAL_TYPE:
+                c->c_formatter = (c->c_radix != '.') ? dsp_fmt_ctlib_numeric : NULL;
+                break;
+            default:
+                c->c_formatter = NULL;
+                break;
+        }
+        return;
+    }
+
+    if ((type == CS_MONEY_TYPE && sg_money_cal.m_ok == -1) ||
+        (type == CS_MONEY4_TYPE && sg_money4_cal.m_ok == -1))
+    {
+        dsp_money_calibrate( type,
+            (type == CS_MONEY_TYPE) ? &sg_money_cal : &sg_money4_cal );
+    }
+
+    c->c_formatter = dsp_fmt_convert;
+    for (i = 0; i < (int)(sizeof(sg_fmt_table) / sizeof(sg_fmt_table[0])); i++)
+    {
+        if (sg_fmt_table[i].f_type == type)
+        {
+            c->c_formatter = sg_fmt_table[i].f_func;
+            break;
+        }
+    }
 
+    /*
+     * Date/time columns get a cache for the rendered date, if the
+     * memory can't be had they simply do without.
+     */
+    if (c->c_formatter == dsp_fmt_datetime)
+    {
+        c->c_dtcache = (dsp_dtcache_t*)malloc( sizeof(dsp_dtcache_t) );
+        if (c->c_dtcache != NULL)
+            c->c_dtcache->dc_gen = -1;
+    }
+}
 
 static void dsp_display_fmt( nm, f )
     CS_CHAR     *nm;
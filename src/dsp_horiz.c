@@ -38,17 +38,44 @@ static char RCS_Id[] = "$Id: dsp_horiz.c,v 1.1.1.1 2004/04/07 12:35:03 chunkm0nk
 USE(RCS_Id)
 #endif /* !defined(lint) */
 
+/*
+ * sqsh-3.0: dsp_hcol_t: Where each column of a result set goes on the
+ * screen.  This only depends upon the description of the result set
+ * and the current width, so it is worked out once by dsp_plan() when
+ * the result set is bound, instead of for every row that is printed.
+ */
+typedef struct dsp_hcol_st {
+	int     h_width;       /* Width of the column */
+	int     h_limit;       /* Left justified data is padded up to here */
+	int     h_offset;      /* Position of the column on its line */
+	int     h_line;        /* Line of the row the column is on */
+	int     h_wrap;        /* True if preceded by a line separator */
+	int     h_max;         /* Longest value displayed in full, or -1 */
+} dsp_hcol_t;
+
+typedef struct dsp_hplan_st {
+	CS_INT      h_ncols;
+	int         h_colsep;  /* strlen() of p_colsep, or -1 if not plain */
+	dsp_hcol_t *h_cols;
+} dsp_hplan_t;
+
 /*-- Prototypes --*/
-static void       dsp_prhead         _ANSI_ARGS(( dsp_out_t*, dsp_desc_t* ));
-static void       dsp_prrow          _ANSI_ARGS(( dsp_out_t*, dsp_desc_t* ));
+static dsp_hplan_t* dsp_plan         _ANSI_ARGS(( dsp_desc_t* ));
+static void       dsp_plan_destroy   _ANSI_ARGS(( dsp_hplan_t* ));
+static void       dsp_prhead         _ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_hplan_t* ));
+static void       dsp_prrow          _ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_hplan_t* ));
+static void       dsp_prsep          _ANSI_ARGS(( dsp_out_t*, dsp_hplan_t*, CS_INT ));
 static int        dsp_putc           _ANSI_ARGS(( int, dsp_out_t* ));
 static int        dsp_puts           _ANSI_ARGS(( char*, dsp_out_t* ));
+static void       dsp_putn           _ANSI_ARGS(( char*, int, dsp_out_t* ));
+static int        dsp_putdata        _ANSI_ARGS(( char*, int, dsp_out_t* ));
+static void       dsp_putpad         _ANSI_ARGS(( int, int, dsp_out_t* ));
 static dsp_col_t* dsp_comp_find      _ANSI_ARGS(( dsp_desc_t*, CS_INT,CS_INT ));
 static char*      dsp_comp_aggregate _ANSI_ARGS(( CS_INT ));
 static void       dsp_comp_prrow 
-	_ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_desc_t* ));
+	_ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_desc_t*, dsp_hplan_t* ));
 static CS_INT     dsp_comp_prrow_one
-	_ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_desc_t* ));
+	_ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_desc_t*, dsp_hplan_t* ));
 
 /*
  * The maximum width of a single given column is defined as either 512 or
@@ -89,12 +116,13 @@ int dsp_horiz( output, cmd, flags )
 	 */
 	dsp_desc_t  *select_desc = NULL;     /* Description of regular result set */
 	dsp_desc_t  *compute_desc = NULL;    /* Description of computed result set */
+	dsp_hplan_t *select_plan = NULL;     /* Layout of select_desc */
 
 	/*
 	 * That's it for the setup, now start banging through the set of
 	 * results coming back from the server.
 	 */
-	while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		/*-- Check for interrupt --*/
 		if (g_dsp_interrupted)
@@ -137,11 +165,11 @@ int dsp_horiz( output, cmd, flags )
 							 (rows_affected == 1) ? "" : "s");
 				}
 
-				if (ct_res_info( cmd,                       /* Command */
-				                 CS_ROW_COUNT,              /* Type */
-				                 (CS_VOID*)&rows_affected,  /* Buffer */
-				                 CS_UNUSED,                 /* Buffer Length */
-				                 (CS_INT*)NULL ) != CS_SUCCEED)
+				if (dsp_res_info( cmd,                       /* Command */
+				                  CS_ROW_COUNT,              /* Type */
+				                  (CS_VOID*)&rows_affected,  /* Buffer */
+				                  CS_UNUSED,                 /* Buffer Length */
+				                  (CS_INT*)NULL ) != CS_SUCCEED)
 				{
 					goto dsp_fail;
 				}
@@ -151,7 +179,7 @@ int dsp_horiz( output, cmd, flags )
 				break;
 
 			case CS_STATUS_RESULT:
-				while ((ret = ct_fetch( cmd,        /* Command */
+				while ((ret = dsp_fetch( cmd,       /* Command */
 				                  CS_UNUSED,        /* Type */
 				                  CS_UNUSED,        /* Offset */
 				                  CS_UNUSED,        /* Option */
@@ -160,11 +188,11 @@ int dsp_horiz( output, cmd, flags )
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
 
-					if (ct_get_data( cmd,                      /* Command */
-					                 1,                        /* Item */
-					                 (CS_VOID*)&result_status, /* Buffer */
-					                 CS_SIZEOF(CS_INT),        /* Buffer Length */
-					                 (CS_INT*)NULL ) != CS_END_DATA)
+					if (dsp_get_data( cmd,                      /* Command */
+					                  1,                        /* Item */
+					                  (CS_VOID*)&result_status, /* Buffer */
+					                  CS_SIZEOF(CS_INT),        /* Buffer Length */
+					                  (CS_INT*)NULL ) != CS_END_DATA)
 					{
 						goto dsp_fail;
 					}
@@ -214,7 +242,7 @@ int dsp_horiz( output, cmd, flags )
 				if (result_type == CS_PARAM_RESULT &&
 					g_dsp_props.p_outputparms == 0)
 				{
-					while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 						&nrows )) == CS_SUCCEED);
 					
 					if (ret != CS_END_DATA)
@@ -253,6 +281,12 @@ int dsp_horiz( output, cmd, flags )
 				if (select_desc != NULL)
 				{
 					dsp_desc_destroy( select_desc );
+					select_desc = NULL;
+				}
+				if (select_plan != NULL)
+				{
+					dsp_plan_destroy( select_plan );
+					select_plan = NULL;
 				}
 
 				/*
@@ -265,6 +299,25 @@ int dsp_horiz( output, cmd, flags )
 				{
 					goto dsp_fail;
 				}
+
+				/*
+				 * sqsh-3.0: Look at the first $width_sample rows to see
+				 * how wide the columns really need to be, then lay out
+				 * the columns once for the whole result set.
+				 */
+				if (g_dsp_props.p_sample > 0 &&
+				    dsp_desc_sample( cmd, select_desc,
+				                     g_dsp_props.p_sample ) != CS_SUCCEED)
+				{
+					goto dsp_fail;
+				}
+
+				select_plan = dsp_plan( select_desc );
+
+				if (select_plan == NULL)
+				{
+					goto dsp_fail;
+				}
 				
 				/*
 				 * Display our headers.
@@ -274,7 +327,7 @@ int dsp_horiz( output, cmd, flags )
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
 
-					dsp_prhead( output, select_desc );
+					dsp_prhead( output, select_desc, select_plan );
 				}
 
 				if (g_dsp_interrupted)
@@ -289,7 +342,7 @@ int dsp_horiz( output, cmd, flags )
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
 
-					dsp_prrow( output, select_desc );
+					dsp_prrow( output, select_desc, select_plan );
 
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
@@ -328,7 +381,7 @@ int dsp_horiz( output, cmd, flags )
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
 
-					dsp_comp_prrow( output, select_desc, compute_desc );
+					dsp_comp_prrow( output, select_desc, compute_desc, select_plan );
 
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
@@ -372,198 +425,267 @@ dsp_leave:
 		dsp_desc_destroy( compute_desc );
 	if (select_desc != NULL)
 		dsp_desc_destroy( select_desc );
+	if (select_plan != NULL)
+		dsp_plan_destroy( select_plan );
 
 	return dsp_return;
 }
 
 /*
- * dsp_prhead():
+ * dsp_plan():
  *
- * Displays the column headers as described by result set desc, sending
- * the output to stream output.
+ * Works out where each column of desc is to be displayed: a column
+ * that doesn't fit onto the current line starts a new one, following
+ * the line separator rather than the column separator.  Returns NULL
+ * if memory could not be allocated.
  */
-static void dsp_prhead( output, desc )
-	dsp_out_t   *output;
+static dsp_hplan_t* dsp_plan( desc )
 	dsp_desc_t  *desc;
 {
-	int          col_width;        /* Width of current column */
-	int          tot_width;        /* Total screen width used */
-	CS_INT       i;
-	CS_INT       j;
+	dsp_hplan_t  *plan;
+	dsp_hcol_t   *hcol;
 	dsp_col_t    *col;
+	int           tot_width;       /* Total screen width used */
+	int           line;
+	CS_INT        i;
+
+	plan = (dsp_hplan_t*)malloc( sizeof(dsp_hplan_t) );
+	if (plan == NULL)
+	{
+		return NULL;
+	}
+
+	plan->h_ncols = desc->d_ncols;
+	plan->h_cols  = (dsp_hcol_t*)malloc( sizeof(dsp_hcol_t) * 
+	                                     max(desc->d_ncols, 1) );
+	if (plan->h_cols == NULL)
+	{
+		free( plan );
+		return NULL;
+	}
+
+	/*
+	 * The column separator can be copied straight out, unless it has
+	 * characters in it that make its width differ from its length.
+	 */
+	if (g_dsp_props.p_colsep[strcspn( g_dsp_props.p_colsep, "\t\n" )] == '\0')
+	{
+		plan->h_colsep = strlen( g_dsp_props.p_colsep );
+	}
+	else
+	{
+		plan->h_colsep = -1;
+	}
 
-	/*-- We haven't used any screen yet --*/
 	tot_width = 0;
+	line      = 0;
 
-	/*-- Blast through available data --*/
 	for (i = 0; i < desc->d_ncols; i++)
 	{
-		/*-- Handy Pointer --*/
-		col = &desc->d_cols[i];
+		col  = &desc->d_cols[i];
+		hcol = &plan->h_cols[i];
 
 		/*
 		 * The column is as wide as the widest of the name or the
 		 * length of the data that it holds.
 		 */
-		col_width = max(col->c_format.namelen, col->c_maxlength);
+		hcol->h_width = max(col->c_format.namelen, col->c_maxlength);
+		hcol->h_max   = -1;
 
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
-		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
-		}
-		else
+		/*
+		 * If the result set was sampled then the column only needs to
+		 * be as wide as what was found in it, and a NULL takes four.
+		 * A wider value further on either pushes the rest of the line
+		 * over, as usual, or is cut off.
+		 */
+		if (col->c_sample_width >= 0)
 		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
+			hcol->h_width = max(col->c_format.namelen, col->c_sample_width);
+			if (col->c_sample_null == True)
+			{
+				hcol->h_width = max(hcol->h_width, 4);
+			}
+
+			if (g_dsp_props.p_overflow == DSP_OVERFLOW_TRUNC)
+			{
+				hcol->h_max = hcol->h_width;
+			}
 		}
 
-		tot_width += col_width;
+		hcol->h_limit = min(hcol->h_width, MAX_COLWIDTH);
 
-		/*
-		 * Display the name of the column.
-		 */
-		for (j = 0; j < col->c_format.namelen; j++)
+		if ((tot_width + g_dsp_props.p_colsep_len + 
+		     hcol->h_width) > g_dsp_props.p_width)
 		{
-			dsp_putc ( col->c_format.name[j], output );
+			hcol->h_wrap = True;
+			tot_width    = g_dsp_props.p_linesep_len;
+			++line;
 		}
-
-		/*-- Display trailing padding spaces --*/
-		for (j = col->c_format.namelen; 
-		     j < col_width && j < MAX_COLWIDTH; j++)
+		else
 		{
-			dsp_putc ( ' ', output );
+			hcol->h_wrap = False;
+			tot_width   += g_dsp_props.p_colsep_len;
 		}
+
+		hcol->h_offset = tot_width;
+		hcol->h_line   = line;
+		tot_width     += hcol->h_width;
+
+		DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_plan: Column %d: width %d, line %d, offset %d\n",
+			(int)i + 1, hcol->h_width, hcol->h_line, hcol->h_offset);)
 	}
-	dsp_putc ( '\n', output );
 
-	/*
-	 * Now that that is out of the way, display the dashed line separating
-	 * each column header from the data.
-	 */
+	return plan;
+}
 
-	/*-- We haven't used any screen yet --*/
-	tot_width = 0;
+/*
+ * dsp_plan_destroy():
+ *
+ * Frees a layout created by dsp_plan().
+ */
+static void dsp_plan_destroy( plan )
+	dsp_hplan_t  *plan;
+{
+	free( plan->h_cols );
+	free( plan );
+}
+
+/*
+ * dsp_prhead():
+ *
+ * Displays the column headers as described by result set desc, sending
+ * the output to stream output.
+ */
+static void dsp_prhead( output, desc, plan )
+	dsp_out_t   *output;
+	dsp_desc_t  *desc;
+	dsp_hplan_t *plan;
+{
+	dsp_hcol_t   *hcol;
+	CS_INT        i;
+	CS_INT        j;
+	dsp_col_t    *col;
 
 	/*-- Blast through available data --*/
 	for (i = 0; i < desc->d_ncols; i++)
 	{
-		/*-- Handy Pointer --*/
-		col = &desc->d_cols[i];
+		/*-- Handy Pointers --*/
+		col  = &desc->d_cols[i];
+		hcol = &plan->h_cols[i];
+
+		dsp_prsep( output, plan, i );
 
 		/*
-		 * The column is as wide as the widest of the name or the
-		 * length of the data that it holds.
+		 * Display the name of the column.
 		 */
-		col_width = max(col->c_format.namelen, col->c_maxlength);
-
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
+		if (memchr( col->c_format.name, '\t', col->c_format.namelen ) == NULL &&
+		    memchr( col->c_format.name, '\n', col->c_format.namelen ) == NULL)
 		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
+			dsp_putn( col->c_format.name, col->c_format.namelen, output );
 		}
 		else
 		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
+			for (j = 0; j < col->c_format.namelen; j++)
+			{
+				dsp_putc ( col->c_format.name[j], output );
+			}
 		}
 
-		tot_width += col_width;
+		/*-- Display trailing padding spaces --*/
+		dsp_putpad( ' ', hcol->h_limit - col->c_format.namelen, output );
+	}
+	dsp_putc ( '\n', output );
 
-		for (j = 0; j < col_width && j < MAX_COLWIDTH; ++j)
-		{
-			dsp_putc ( '-', output );
-		}
+	/*
+	 * Now that that is out of the way, display the dashed line separating
+	 * each column header from the data.
+	 */
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		dsp_prsep( output, plan, i );
+		dsp_putpad( '-', plan->h_cols[i].h_limit, output );
 	}
 	dsp_putc ( '\n', output );
 }
 
-static void dsp_prrow( output, desc )
+static void dsp_prrow( output, desc, plan )
 	dsp_out_t   *output;
 	dsp_desc_t  *desc;
+	dsp_hplan_t *plan;
 {
-	int          col_width;        /* Width of current column */
-	int          tot_width;        /* Total screen width used */
+	dsp_hcol_t  *hcol;
 	int          dat_width;        /* Amount of data */
 	CS_CHAR     *data;             /* Point to data to display */
 	CS_INT       i;
-	CS_INT       j;
 	dsp_col_t   *col;
 
-	/*-- We haven't used any screen yet --*/
-	tot_width = 0;
-
 	/*-- Blast through available data --*/
 	for (i = 0; i < desc->d_ncols; i++)
 	{
-		/*-- Handy Pointer --*/
-		col = &desc->d_cols[i];
-
-		/*
-		 * The column is as wide as the widest of the name or the
-		 * length of the data that it holds.
-		 */
-		col_width = max(col->c_format.namelen, col->c_maxlength);
-
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
-		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
-		}
-		else
-		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
-		}
+		/*-- Handy Pointers --*/
+		col  = &desc->d_cols[i];
+		hcol = &plan->h_cols[i];
 
-		tot_width += col_width;
+		dsp_prsep( output, plan, i );
 
 		/*
-		 * Determine the amount of data to display.  Null columns will
-		 * be represented as "NULL", so they need to be at least four
-		 * wide.
+		 * Null columns will be represented as "NULL", so they need to
+		 * be at least four wide.
 		 */
 		if (col->c_nullind != 0)
 		{
-			dat_width = 4;
-			data      = "NULL";
+			data = "NULL";
 		}
 		else
 		{
-			dat_width = strlen( col->c_data );
-			data      = col->c_data;
+			data = col->c_data;
 		}
 
 		if (col->c_justification == DSP_JUST_RIGHT)
 		{
-			for (j = dat_width; j < col_width; ++j)
-			{
-				dsp_putc ( ' ', output );
-			}
-
-			dsp_puts( data, output );
+			dsp_putpad( ' ', hcol->h_width - (int)strlen( data ), output );
+			dsp_putdata( data, hcol->h_max, output );
 		}
 		else  /* DSP_JUST_LEFT */
 		{
-			dsp_puts( data, output );
-
-			for (j = dat_width; j < col_width && j < MAX_COLWIDTH; ++j)
-			{
-				dsp_putc ( ' ', output );
-			}
+			dat_width = dsp_putdata( data, hcol->h_max, output );
+			dsp_putpad( ' ', hcol->h_limit - dat_width, output );
 		}
 	}
 
 	dsp_putc ( '\n', output );
 }
 
-static void dsp_comp_prrow( output, sel_desc, com_desc )
+/*
+ * dsp_prsep():
+ *
+ * Displays whatever separates column i of a row from the previous one,
+ * according to the layout in plan.
+ */
+static void dsp_prsep( output, plan, i )
+	dsp_out_t   *output;
+	dsp_hplan_t *plan;
+	CS_INT       i;
+{
+	if (plan->h_cols[i].h_wrap == True)
+	{
+		dsp_puts( g_dsp_props.p_linesep, output );
+	}
+	else if (plan->h_colsep >= 0)
+	{
+		dsp_putn( g_dsp_props.p_colsep, plan->h_colsep, output );
+	}
+	else
+	{
+		dsp_puts( g_dsp_props.p_colsep, output );
+	}
+}
+
+static void dsp_comp_prrow( output, sel_desc, com_desc, plan )
 	dsp_out_t   *output;
 	dsp_desc_t  *sel_desc;
 	dsp_desc_t  *com_desc;
+	dsp_hplan_t *plan;
 {
 	CS_INT       ncols = 0;
 	CS_INT       i;
@@ -580,7 +702,7 @@ static void dsp_comp_prrow( output, sel_desc, com_desc )
 
 	while (ncols < com_desc->d_ncols)
 	{
-		ncols += dsp_comp_prrow_one( output, sel_desc, com_desc );
+		ncols += dsp_comp_prrow_one( output, sel_desc, com_desc, plan );
 	}
 }
 
@@ -594,27 +716,22 @@ static void dsp_comp_prrow( output, sel_desc, com_desc )
  * exists, dsp_comp_prhead() must be called again.  This function
  * returns the number of compute columns displayed.
  */
-static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
+static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc, plan )
 	dsp_out_t   *output;
 	dsp_desc_t  *sel_desc;
 	dsp_desc_t  *com_desc;
+	dsp_hplan_t *plan;
 {
-	int          col_width;        /* Width of current column */
-	int          tot_width;        /* Total screen width used */
+	dsp_hcol_t  *hcol;
 	char        *aggregate_op;     /* Name of aggregate operator */
 	int          dash;             /* Character to use for dash */
 	int          dat_width;        /* Width of data to display */
 	CS_CHAR     *data;             /* Point to data to display */
 	CS_INT       justification;    /* Justification for data */
 	CS_INT       i;
-	CS_INT       j;
 	CS_INT       count = 0;
-	dsp_col_t    *sel_col;
 	dsp_col_t    *com_col;
 
-	/*-- We haven't used any screen yet --*/
-	tot_width = 0;
-
 	/**
 	 ** STAGE 1: Display column headers
 	 **/
@@ -627,27 +744,9 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 	for (i = 0; i < sel_desc->d_ncols; i++)
 	{
 		/*-- Handy Pointer --*/
-		sel_col = &sel_desc->d_cols[i];
+		hcol = &plan->h_cols[i];
 
-		/*
-		 * The column is as wide as the widest of the name or the
-		 * length of the data that it holds.
-		 */
-		col_width = max(sel_col->c_format.namelen, sel_col->c_maxlength);
-
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
-		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
-		}
-		else
-		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
-		}
-
-		tot_width += col_width;
+		dsp_prsep( output, plan, i );
 
 		/*
 		 * Attempt to find the first compute column that hasn't been
@@ -668,12 +767,7 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 		}
 
 		/*-- Display trailing padding spaces --*/
-		for (j = strlen( aggregate_op ); 
-		     j < col_width && j < MAX_COLWIDTH; j++)
-		{
-			dsp_putc ( ' ', output );
-		}
-
+		dsp_putpad( ' ', hcol->h_limit - (int)strlen( aggregate_op ), output );
 	}
 	dsp_putc ( '\n', output );
 
@@ -681,34 +775,10 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 	 ** STAGE 2: Display dashed line
 	 **/
 
-	/*-- We haven't used any screen yet --*/
-	tot_width = 0;
-
 	/*-- Blast through available data --*/
 	for (i = 0; i < sel_desc->d_ncols; i++)
 	{
-		/*-- Handy Pointer --*/
-		sel_col = &sel_desc->d_cols[i];
-
-		/*
-		 * The column is as wide as the widest of the name or the
-		 * length of the data that it holds.
-		 */
-		col_width = max(sel_col->c_format.namelen, sel_col->c_maxlength);
-
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
-		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
-		}
-		else
-		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
-		}
-
-		tot_width += col_width;
+		dsp_prsep( output, plan, i );
 
 		/*
 		 * Once again, look up the compute column that represents this
@@ -732,10 +802,7 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 			dash = ' ';
 		}
 
-		for (j = 0; j < col_width && j < MAX_COLWIDTH; ++j)
-		{
-			dsp_putc ( dash, output );
-		}
+		dsp_putpad( dash, plan->h_cols[i].h_limit, output );
 	}
 	dsp_putc ( '\n', output );
 
@@ -743,34 +810,13 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 	 ** STAGE 3: Display data
 	 **/
 
-	/*-- We haven't used any screen yet --*/
-	tot_width = 0;
-
 	/*-- Blast through available data --*/
 	for (i = 0; i < sel_desc->d_ncols; i++)
 	{
 		/*-- Handy Pointer --*/
-		sel_col = &sel_desc->d_cols[i];
+		hcol = &plan->h_cols[i];
 
-		/*
-		 * The column is as wide as the widest of the name or the
-		 * length of the data that it holds.
-		 */
-		col_width = max(sel_col->c_format.namelen, sel_col->c_maxlength);
-
-		if ((tot_width + g_dsp_props.p_colsep_len + 
-		     col_width) > g_dsp_props.p_width)
-		{
-			dsp_puts( g_dsp_props.p_linesep, output );
-			tot_width = g_dsp_props.p_linesep_len;
-		}
-		else
-		{
-			dsp_puts( g_dsp_props.p_colsep, output );
-			tot_width += g_dsp_props.p_colsep_len;
-		}
-
-		tot_width += col_width;
+		dsp_prsep( output, plan, i );
 
 		/*
 		 * Look up the value for this select column by looking it up
@@ -785,39 +831,28 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 
 			if (com_col->c_nullind != 0)
 			{
-				dat_width = 4;
 				data      = "NULL";
 			}
 			else
 			{
-				dat_width = strlen( com_col->c_data );
 				data      = com_col->c_data;
 			}
 		}
 		else
 		{
 			justification = DSP_JUST_LEFT;
-			dat_width     = 0;
 			data          = "";
 		}
 
 		if (justification == DSP_JUST_RIGHT)
 		{
-			for (j = dat_width; j < col_width; ++j)
-			{
-				dsp_putc ( ' ', output );
-			}
-
-			dsp_puts( data, output );
+			dsp_putpad( ' ', hcol->h_width - (int)strlen( data ), output );
+			dsp_putdata( data, hcol->h_max, output );
 		}
 		else  /* DSP_JUST_LEFT */
 		{
-			dsp_puts( data, output );
-
-			for (j = dat_width; j < col_width && j < MAX_COLWIDTH; ++j)
-			{
-				dsp_putc ( ' ', output );
-			}
+			dat_width = dsp_putdata( data, hcol->h_max, output );
+			dsp_putpad( ' ', hcol->h_limit - dat_width, output );
 		}
 	}
 
@@ -956,3 +991,106 @@ static int dsp_putc ( ch, output )
 
 	return sg_line_width;
 }
+
+/*
+ * dsp_putn():
+ *
+ * sqsh-3.0: Displays len characters from str, none of which may be a
+ * tab or a new-line.  As long as they fit onto what is left of the
+ * line they are copied out in one go, otherwise dsp_putc() takes care
+ * of chopping them up.
+ */
+static void dsp_putn( str, len, output )
+	char       *str;
+	int         len;
+	dsp_out_t  *output;
+{
+	if (sg_line_width + len <= g_dsp_props.p_width)
+	{
+		dsp_fwrite( str, len, output );
+		sg_line_width += len;
+		return;
+	}
+
+	for (; len > 0; --len, ++str)
+	{
+		dsp_putc ( *str, output );
+	}
+}
+
+/*
+ * dsp_putdata():
+ *
+ * Displays the string str, or only its first maxlen characters if
+ * maxlen isn't -1, returning the number of characters displayed.
+ */
+static int dsp_putdata( str, maxlen, output )
+	char       *str;
+	int         maxlen;
+	dsp_out_t  *output;
+{
+	int   len;
+
+	len = strcspn( str, "\t\n" );
+
+	if (str[len] == '\0')
+	{
+		if (maxlen >= 0 && len > maxlen)
+		{
+			len = maxlen;
+		}
+		dsp_putn( str, len, output );
+		return len;
+	}
+
+	if (maxlen < 0)
+	{
+		dsp_puts( str, output );
+		return len + strlen( str + len );
+	}
+
+	for (len = 0; len < maxlen && str[len] != '\0'; ++len)
+	{
+		dsp_putc ( str[len], output );
+	}
+	return len;
+}
+
+/*
+ * dsp_putpad():
+ *
+ * Displays n copies of the character ch (which is never a tab or a
+ * new-line), if n is greater than 0.
+ */
+static void dsp_putpad( ch, n, output )
+	int         ch;
+	int         n;
+	dsp_out_t  *output;
+{
+	char   pad[256];
+	int    len;
+
+	if (n <= 0)
+	{
+		return;
+	}
+
+	if (sg_line_width + n > g_dsp_props.p_width)
+	{
+		for (; n > 0; --n)
+		{
+			dsp_putc ( ch, output );
+		}
+		return;
+	}
+
+	sg_line_width += n;
+
+	memset( pad, ch, min(n, (int)sizeof(pad)) );
+	while (n > 0)
+	{
+		len = min(n, (int)sizeof(pad));
+		dsp_fwrite( pad, len, output );
+		n  -= len;
+	}
+}
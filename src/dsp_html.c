@@ -81,7 +81,7 @@ int dsp_html( output, cmd, flags )
 	 * That's it for the setup, now start banging through the set of
 	 * results coming back from the server.
 	 */
-	while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		/*-- Check for interrupt --*/
 		if (g_dsp_interrupted)
@@ -112,11 +112,11 @@ int dsp_html( output, cmd, flags )
 					dsp_fputs( "</p>\n", output );
 				}
 
-				if (ct_res_info( cmd,                       /* Command */
-				                 CS_ROW_COUNT,              /* Type */
-				                 (CS_VOID*)&rows_affected,  /* Buffer */
-				                 CS_UNUSED,                 /* Buffer Length */
-				                 (CS_INT*)NULL ) != CS_SUCCEED)
+				if (dsp_res_info( cmd,                       /* Command */
+				                  CS_ROW_COUNT,              /* Type */
+				                  (CS_VOID*)&rows_affected,  /* Buffer */
+				                  CS_UNUSED,                 /* Buffer Length */
+				                  (CS_INT*)NULL ) != CS_SUCCEED)
 				{
 					goto dsp_fail;
 				}
@@ -132,7 +132,7 @@ int dsp_html( output, cmd, flags )
 				if (g_dsp_interrupted)
 					goto dsp_interrupted;
 
-				while ((ret = ct_fetch( cmd,              /* Command */
+				while ((ret = dsp_fetch( cmd,             /* Command */
 				                  CS_UNUSED,        /* Type */
 				                  CS_UNUSED,        /* Offset */
 				                  CS_UNUSED,        /* Option */
@@ -141,11 +141,11 @@ int dsp_html( output, cmd, flags )
 					if (g_dsp_interrupted)
 						goto dsp_interrupted;
 
-					if (ct_get_data( cmd,                      /* Command */
-					                 1,                        /* Item */
-					                 (CS_VOID*)&result_status, /* Buffer */
-					                 CS_SIZEOF(CS_INT),        /* Buffer Length */
-					                 (CS_INT*)NULL ) != CS_END_DATA)
+					if (dsp_get_data( cmd,                      /* Command */
+					                  1,                        /* Item */
+					                  (CS_VOID*)&result_status, /* Buffer */
+					                  CS_SIZEOF(CS_INT),        /* Buffer Length */
+					                  (CS_INT*)NULL ) != CS_END_DATA)
 					{
 						goto dsp_fail;
 					}
@@ -184,7 +184,7 @@ int dsp_html( output, cmd, flags )
 				if (result_type == CS_PARAM_RESULT &&
 					g_dsp_props.p_outputparms == 0)
 				{
-					while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 						&nrows )) == CS_SUCCEED);
 					
 					if (ret != CS_END_DATA)
@@ -0,0 +1,667 @@
+/*
+ * dsp_json.c - Display result set as JSON objects
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include "sqsh_config.h"
+#include "sqsh_error.h"
+#include "sqsh_global.h"
+#include "sqsh_debug.h"
+#include "dsp.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: dsp_json.c,v 1.1 $";
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * sg_json_esc: For every byte value, 0 if it may be copied into a
+ * JSON string as is, otherwise the character that follows the '\'
+ * in its escape sequence ('u' meaning \u00XX).  Bytes from 0x80 on
+ * are passed through untouched, so UTF-8 data comes out intact.
+ */
+static char sg_json_esc[256];
+static int  sg_json_init = False;
+
+/*-- Widest unsigned type integers are written through --*/
+#if defined(CS_BIGINT_TYPE) && defined(CS_UBIGINT_TYPE)
+#define JSON_HAVE_INT64
+typedef CS_UBIGINT json_uint_t;
+#else
+typedef CS_UINT json_uint_t;
+#endif
+
+/*-- Prototypes --*/
+static void  dsp_json_setup   _ANSI_ARGS(( void ));
+static void  dsp_json_string  _ANSI_ARGS(( dsp_out_t*, char*, int ));
+static void  dsp_json_number  _ANSI_ARGS(( dsp_out_t*, char*, int ));
+static void  dsp_json_double  _ANSI_ARGS(( dsp_out_t*, double, int ));
+static void  dsp_json_uint    _ANSI_ARGS(( dsp_out_t*, int, json_uint_t, int ));
+static void  dsp_json_int     _ANSI_ARGS(( dsp_out_t*, dsp_col_t* ));
+static void  dsp_json_value   _ANSI_ARGS(( dsp_out_t*, dsp_col_t* ));
+static char** dsp_json_keys   _ANSI_ARGS(( dsp_desc_t* ));
+static void  dsp_json_free    _ANSI_ARGS(( char**, int ));
+
+/*
+ * dsp_json:
+ *
+ * Displays every row as a JSON object keyed by column name.  With
+ * the ndjson style each object goes on a line of its own, with the
+ * json style each result set becomes an array of objects, and those
+ * arrays are in turn wrapped in a single outer array so that the
+ * output as a whole is one JSON document.  Rows are written as they
+ * are fetched; nothing is held back until the end of the result set.
+ */
+int dsp_json( output, cmd, flags )
+	dsp_out_t   *output;
+	CS_COMMAND  *cmd;
+	int          flags;
+{
+	int          i;
+	CS_INT       result_type;  /* Current result set type */
+	CS_INT       ret;          /* ct_results return code */
+	CS_INT       nrows;        /* Number of rows fetch */
+	int          as_array;     /* True for json, False for ndjson */
+	int          nsets = 0;    /* Result sets written so far */
+	int          row = 0;      /* Rows written in the current set */
+	int          dsp_return = DSP_SUCCEED;
+
+	/*
+	 * The following must be cleaned up (and the arrays closed) before
+	 * returning, see dsp_leave at the bottom of this function.
+	 */
+	dsp_desc_t  *desc = NULL;  /* Result set description */
+	char       **keys = NULL;  /* "name": for each column */
+
+	if (sg_json_init == False)
+	{
+		dsp_json_setup();
+	}
+
+	as_array = (g_dsp_props.p_style == DSP_JSON);
+
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
+	{
+		if (g_dsp_interrupted)
+			goto dsp_interrupted;
+
+		if (ret != CS_SUCCEED)
+			goto dsp_fail;
+
+		switch (result_type)
+		{
+			case CS_STATUS_RESULT:
+				while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+				                         &nrows )) == CS_SUCCEED);
+
+				if (ret != CS_END_DATA)
+				{
+					goto dsp_fail;
+				}
+				break;
+
+			case CS_PARAM_RESULT:
+			case CS_ROW_RESULT:
+			case CS_COMPUTE_RESULT:
+				if (result_type == CS_PARAM_RESULT &&
+				    g_dsp_props.p_outputparms == 0)
+				{
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					                         &nrows )) == CS_SUCCEED);
+
+					if (ret != CS_END_DATA)
+					{
+						goto dsp_fail;
+					}
+					break;
+				}
+
+				desc = dsp_desc_bind( cmd, result_type );
+
+				if (desc == NULL)
+					goto dsp_fail;
+
+				keys = dsp_json_keys( desc );
+
+				if (keys == NULL)
+					goto dsp_fail;
+
+				if (as_array)
+					dsp_fputs( (nsets == 0) ? "[\n[" : ",\n[", output );
+				++nsets;
+
+				row = 0;
+				while ((ret = dsp_desc_fetch( cmd, desc )) == CS_SUCCEED)
+				{
+					if (g_dsp_interrupted)
+						goto dsp_interrupted;
+
+					if (as_array)
+						dsp_fputs( (row == 0) ? "\n" : ",\n", output );
+
+					dsp_fputc( '{', output );
+					for (i = 0; i < desc->d_ncols; i++)
+					{
+						if (i > 0)
+							dsp_fputc( ',', output );
+
+						dsp_fputs( keys[i], output );
+						dsp_json_value( output, &desc->d_cols[i] );
+					}
+					dsp_fputc( '}', output );
+
+					if (!as_array)
+						dsp_fputc( '\n', output );
+
+					++row;
+				}
+
+				if (g_dsp_interrupted)
+					goto dsp_interrupted;
+
+				if (ret != CS_END_DATA)
+					goto dsp_fail;
+
+				if (as_array)
+					dsp_fputs( (row > 0) ? "\n]" : "]", output );
+
+				dsp_json_free( keys, desc->d_ncols );
+				dsp_desc_destroy( desc );
+				keys = NULL;
+				desc = NULL;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	goto dsp_leave;
+
+dsp_fail:
+	dsp_return = DSP_FAIL;
+	goto dsp_leave;
+
+dsp_interrupted:
+	dsp_return = DSP_INTERRUPTED;
+
+dsp_leave:
+	/*-- Close whatever arrays are still open --*/
+	if (as_array)
+	{
+		if (desc != NULL && keys != NULL)
+			dsp_fputs( (row > 0) ? "\n]" : "]", output );
+
+		dsp_fputs( (nsets > 0) ? "\n]\n" : "[]\n", output );
+	}
+
+	if (keys != NULL)
+		dsp_json_free( keys, desc->d_ncols );
+	if (desc != NULL)
+		dsp_desc_destroy( desc );
+
+	return dsp_return;
+}
+
+/*
+ * dsp_json_setup():
+ *
+ * Fills in the sg_json_esc table.
+ */
+static void dsp_json_setup()
+{
+	int   i;
+
+	for (i = 0; i < 0x20; i++)
+		sg_json_esc[i] = 'u';
+
+	sg_json_esc['\b'] = 'b';
+	sg_json_esc['\f'] = 'f';
+	sg_json_esc['\n'] = 'n';
+	sg_json_esc['\r'] = 'r';
+	sg_json_esc['\t'] = 't';
+	sg_json_esc['"']  = '"';
+	sg_json_esc['\\'] = '\\';
+
+	sg_json_init = True;
+}
+
+/*
+ * dsp_json_string():
+ *
+ * Writes len bytes of str as a quoted JSON string.  Runs of bytes that
+ * need no escaping are handed to dsp_fwrite() in one piece.
+ */
+static void dsp_json_string( output, str, len )
+	dsp_out_t   *output;
+	char        *str;
+	int          len;
+{
+	static char   hex[] = "0123456789abcdef";
+	unsigned char *cp  = (unsigned char*)str;
+	unsigned char *end = cp + len;
+	unsigned char *run;
+	char           esc[6];
+
+	dsp_fputc( '"', output );
+
+	while (cp < end)
+	{
+		for (run = cp; cp < end && sg_json_esc[*cp] == 0; ++cp);
+
+		if (cp > run)
+			dsp_fwrite( (char*)run, (int)(cp - run), output );
+
+		if (cp == end)
+			break;
+
+		esc[0] = '\\';
+		esc[1] = sg_json_esc[*cp];
+		if (esc[1] == 'u')
+		{
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[*cp >> 4];
+			esc[5] = hex[*cp & 0x0f];
+			dsp_fwrite( esc, 6, output );
+		}
+		else
+		{
+			dsp_fwrite( esc, 2, output );
+		}
+		++cp;
+	}
+
+	dsp_fputc( '"', output );
+}
+
+/*
+ * dsp_json_number():
+ *
+ * Writes a numeric, decimal or money value that has already been
+ * converted to a string.  The locale's radix (if $localeconv is in
+ * effect) is turned back into a '.', and a missing leading or
+ * trailing digit around it is supplied.  Should the string not look
+ * like a number at all, it is written as a JSON string instead.
+ */
+static void dsp_json_number( output, str, radix )
+	dsp_out_t   *output;
+	char        *str;
+	int          radix;
+{
+	char         num[128];
+	char        *cp;
+	int          n = 0;
+	int          ndigits = 0;
+	int          seen_radix = False;
+
+	for (cp = str; *cp == ' '; ++cp);
+
+	if (*cp == '-')
+		num[n++] = *cp++;
+
+	for (; *cp != '\0' && *cp != ' ' && n < (int)sizeof(num) - 3; ++cp)
+	{
+		if (isdigit( (unsigned char)*cp ))
+		{
+			num[n++] = *cp;
+			++ndigits;
+		}
+		else if ((*cp == radix || *cp == '.') && seen_radix == False)
+		{
+			if (ndigits == 0)
+				num[n++] = '0';
+			num[n++] = '.';
+			seen_radix = True;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	for (; *cp == ' '; ++cp);
+
+	if (*cp != '\0' || ndigits == 0)
+	{
+		dsp_json_string( output, str, strlen(str) );
+		return;
+	}
+
+	if (num[n-1] == '.')
+		num[n++] = '0';
+
+	dsp_fwrite( num, n, output );
+}
+
+/*
+ * dsp_json_double():
+ *
+ * Writes a float or real taken straight from the native value, with
+ * enough digits for it to be read back exactly.  JSON has no way of
+ * representing infinity or NaN, so those come out as null.
+ */
+static void dsp_json_double( output, d, ndigits )
+	dsp_out_t   *output;
+	double       d;
+	int          ndigits;
+{
+	char         num[64];
+	char        *cp;
+
+	if (d != d || d - d != 0.0)
+	{
+		dsp_fwrite( "null", 4, output );
+		return;
+	}
+
+	sprintf( num, "%.*g", ndigits, d );
+
+	/*-- Undo the locale's radix if $localeconv is in effect --*/
+	for (cp = num; *cp != '\0'; ++cp)
+	{
+		if (*cp == ',')
+			*cp = '.';
+	}
+
+	dsp_fputs( num, output );
+}
+
+/*
+ * dsp_json_uint():
+ *
+ * Writes v, preceded by a '-' if neg is set.  If ndec is greater than
+ * 0 the last ndec digits of v go after a decimal point, which is how
+ * money (a count of 1/10000ths) is written.
+ */
+static void dsp_json_uint( output, neg, v, ndec )
+	dsp_out_t   *output;
+	int          neg;
+	json_uint_t  v;
+	int          ndec;
+{
+	char         num[32];
+	char        *cp = num + sizeof(num);
+	int          i;
+
+	for (i = 0; i < ndec; i++)
+	{
+		*--cp = (char)('0' + (int)(v % 10));
+		v    /= 10;
+	}
+
+	if (ndec > 0)
+		*--cp = '.';
+
+	do
+	{
+		*--cp = (char)('0' + (int)(v % 10));
+		v    /= 10;
+	}
+	while (v > 0);
+
+	if (neg)
+		*--cp = '-';
+
+	dsp_fwrite( cp, (int)((num + sizeof(num)) - cp), output );
+}
+
+/*
+ * dsp_json_int():
+ *
+ * Writes an integer or money column straight from its native value,
+ * falling back on the converted string if the column wasn't bound
+ * natively (or this is money without 64 bit integers to hold it).
+ */
+static void dsp_json_int( output, col )
+	dsp_out_t   *output;
+	dsp_col_t   *col;
+{
+	CS_VOID     *v = col->c_native;
+#if defined(JSON_HAVE_INT64)
+	CS_BIGINT    m;
+#endif
+
+	if (col->c_is_native != CS_TRUE)
+	{
+		dsp_json_number( output, col->c_data, (int)col->c_radix );
+		return;
+	}
+
+	switch (col->c_format.datatype)
+	{
+		case CS_TINYINT_TYPE:
+			dsp_json_uint( output, 0, (json_uint_t)*(CS_TINYINT*)v, 0 );
+			return;
+
+		case CS_SMALLINT_TYPE:
+			dsp_json_uint( output, *(CS_SMALLINT*)v < 0,
+				(*(CS_SMALLINT*)v < 0) ?
+					(json_uint_t)0 - (json_uint_t)*(CS_SMALLINT*)v :
+					(json_uint_t)*(CS_SMALLINT*)v, 0 );
+			return;
+
+		case CS_INT_TYPE:
+			dsp_json_uint( output, *(CS_INT*)v < 0,
+				(*(CS_INT*)v < 0) ?
+					(json_uint_t)0 - (json_uint_t)*(CS_INT*)v :
+					(json_uint_t)*(CS_INT*)v, 0 );
+			return;
+
+#if defined(CS_USMALLINT_TYPE)
+		case CS_USMALLINT_TYPE:
+			dsp_json_uint( output, 0, (json_uint_t)*(CS_USMALLINT*)v, 0 );
+			return;
+#endif
+
+#if defined(CS_UINT_TYPE)
+		case CS_UINT_TYPE:
+			dsp_json_uint( output, 0, (json_uint_t)*(CS_UINT*)v, 0 );
+			return;
+#endif
+
+#if defined(JSON_HAVE_INT64)
+		case CS_BIGINT_TYPE:
+			dsp_json_uint( output, *(CS_BIGINT*)v < 0,
+				(*(CS_BIGINT*)v < 0) ?
+					(json_uint_t)0 - (json_uint_t)*(CS_BIGINT*)v :
+					(json_uint_t)*(CS_BIGINT*)v, 0 );
+			return;
+
+		case CS_UBIGINT_TYPE:
+			dsp_json_uint( output, 0, (json_uint_t)*(CS_UBIGINT*)v, 0 );
+			return;
+
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+			m = dsp_money_value( col->c_format.datatype, v );
+			dsp_json_uint( output, m < 0,
+				(m < 0) ? (json_uint_t)0 - (json_uint_t)m : (json_uint_t)m, 4 );
+			return;
+#endif
+
+		default:
+			dsp_json_number( output, col->c_data, (int)col->c_radix );
+			return;
+	}
+}
+
+/*
+ * dsp_json_value():
+ *
+ * Writes the value of a column.  Numbers and bits are typed by the
+ * datatype the server sent them as; everything else is a string.
+ * Integers, money, floats and bits are taken from the native value
+ * where there is one, rather than parsed back out of c_data.
+ */
+static void dsp_json_value( output, col )
+	dsp_out_t   *output;
+	dsp_col_t   *col;
+{
+	if (col->c_nullind != 0)
+	{
+		dsp_fwrite( "null", 4, output );
+		return;
+	}
+
+	switch (col->c_format.datatype)
+	{
+		case CS_BIT_TYPE:
+			if (col->c_is_native == CS_TRUE)
+				dsp_fputs( (*(CS_BIT*)col->c_native != 0) ? "true" : "false", output );
+			else
+				dsp_fputs( (atoi( col->c_data ) != 0) ? "true" : "false", output );
+			break;
+
+		case CS_TINYINT_TYPE:
+		case CS_SMALLINT_TYPE:
+		case CS_INT_TYPE:
+#if defined(CS_BIGINT_TYPE)
+		case CS_BIGINT_TYPE:
+#endif
+#if defined(CS_UBIGINT_TYPE)
+		case CS_UBIGINT_TYPE:
+#endif
+#if defined(CS_USMALLINT_TYPE)
+		case CS_USMALLINT_TYPE:
+#endif
+#if defined(CS_UINT_TYPE)
+		case CS_UINT_TYPE:
+#endif
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+			dsp_json_int( output, col );
+			break;
+
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			dsp_json_number( output, col->c_data, (int)col->c_radix );
+			break;
+
+		case CS_FLOAT_TYPE:
+			if (col->c_is_native == CS_TRUE)
+				dsp_json_double( output, (double)*(CS_FLOAT*)col->c_native, 17 );
+			else
+				dsp_json_number( output, col->c_data, (int)col->c_radix );
+			break;
+
+		case CS_REAL_TYPE:
+			if (col->c_is_native == CS_TRUE)
+				dsp_json_double( output, (double)*(CS_REAL*)col->c_native, 9 );
+			else
+				dsp_json_number( output, col->c_data, (int)col->c_radix );
+			break;
+
+		default:
+			dsp_json_string( output, col->c_data, strlen( col->c_data ) );
+			break;
+	}
+}
+
+/*
+ * dsp_json_keys():
+ *
+ * Builds the '"name":' prefix of every column of the result set, so
+ * that it doesn't have to be escaped again for each row.  Columns
+ * without a name (compute columns, expressions without an alias) are
+ * called col1, col2, etc.
+ */
+static char** dsp_json_keys( desc )
+	dsp_desc_t  *desc;
+{
+	char       **keys;
+	char         name[32];
+	char        *src;
+	int          len;
+	char        *dst;
+	int          i;
+	int          j;
+
+	keys = (char**)calloc( desc->d_ncols, sizeof(char*) );
+
+	if (keys == NULL)
+	{
+		fprintf( stderr, "dsp_json: Memory allocation failure\n" );
+		return NULL;
+	}
+
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		if (desc->d_cols[i].c_format.namelen > 0)
+		{
+			src = desc->d_cols[i].c_format.name;
+			len = desc->d_cols[i].c_format.namelen;
+		}
+		else
+		{
+			sprintf( name, "col%d", i + 1 );
+			src = name;
+			len = strlen( name );
+		}
+
+		/*-- Worst case every byte becomes \u00XX --*/
+		keys[i] = dst = (char*)malloc( len * 6 + 4 );
+
+		if (dst == NULL)
+		{
+			fprintf( stderr, "dsp_json: Memory allocation failure\n" );
+			dsp_json_free( keys, desc->d_ncols );
+			return NULL;
+		}
+
+		*dst++ = '"';
+		for (j = 0; j < len; j++)
+		{
+			if (sg_json_esc[(unsigned char)src[j]] == 0)
+			{
+				*dst++ = src[j];
+			}
+			else if (sg_json_esc[(unsigned char)src[j]] == 'u')
+			{
+				sprintf( dst, "\\u%04x", (unsigned char)src[j] );
+				dst += 6;
+			}
+			else
+			{
+				*dst++ = '\\';
+				*dst++ = sg_json_esc[(unsigned char)src[j]];
+			}
+		}
+		*dst++ = '"';
+		*dst++ = ':';
+		*dst   = '\0';
+	}
+
+	return keys;
+}
+
+static void dsp_json_free( keys, ncols )
+	char       **keys;
+	int          ncols;
+{
+	int          i;
+
+	for (i = 0; i < ncols; i++)
+	{
+		if (keys[i] != NULL)
+			free( keys[i] );
+	}
+	free( keys );
+}
@@ -62,7 +62,7 @@ int dsp_meta( out, cmd, flags )
     /*
      * Fetch results until there ain't any more left.
      */
-    while ((r = ct_results( cmd, &result_type ) == CS_SUCCEED))
+    while ((r = dsp_results( cmd, &result_type ) == CS_SUCCEED))
     {
         if (g_dsp_interrupted)
         {
@@ -203,7 +203,7 @@ static CS_RETCODE dsp_meta_desc( out, cmd )
     CS_DATAFMT fmt;
     CS_INT     i;
 
-    if (ct_res_info(cmd, CS_NUMDATA, (CS_VOID*)&ncols,
+    if (dsp_res_info(cmd, CS_NUMDATA, (CS_VOID*)&ncols,
         CS_UNUSED, (CS_INT*)NULL) != CS_SUCCEED)
     {
         dsp_fprintf( out, "dsp_meta_desc: Cannot determine #cols\n" );
@@ -213,7 +213,7 @@ static CS_RETCODE dsp_meta_desc( out, cmd )
     for (i = 0; i < ncols; i++)
     {
         memset( (void*)&fmt, 0, sizeof(fmt) );
-        if (ct_describe( cmd, (i+1), &fmt ) != CS_SUCCEED)
+        if (dsp_describe( cmd, (i+1), &fmt ) != CS_SUCCEED)
         {
             dsp_fprintf( out, "dsp_meta_desc:   Cannot describe col #%d\n", 
                 (int)i+1 );
@@ -637,7 +637,7 @@ static CS_RETCODE dsp_meta_bool_prop( out, cmd, type, desc )
 {
     CS_BOOL  bool;
 
-    if (ct_res_info(cmd, type, (CS_VOID*)&bool,
+    if (dsp_res_info(cmd, type, (CS_VOID*)&bool,
         CS_UNUSED, (CS_INT*)NULL) != CS_SUCCEED)
     {
         dsp_fprintf( out, "dsp_meta_bool_prop:   Failed fetching %s\n", desc );
@@ -666,7 +666,7 @@ static  CS_RETCODE dsp_meta_int_prop( out, cmd, type, desc )
 {
     CS_INT  num;
 
-    if (ct_res_info(cmd, type, (CS_VOID*)&num,
+    if (dsp_res_info(cmd, type, (CS_VOID*)&num,
         CS_UNUSED, (CS_INT*)NULL) != CS_SUCCEED)
     {
         dsp_fprintf( out, "dsp_meta_int_prop: Failed fetching %s\n", desc );
@@ -693,7 +693,7 @@ static CS_RETCODE dsp_meta_transtate( out, cmd )
     CS_INT  transtate;
     CS_CHAR *s;
 
-    if (ct_res_info(cmd, CS_TRANS_STATE, (CS_VOID*)&transtate,
+    if (dsp_res_info(cmd, CS_TRANS_STATE, (CS_VOID*)&transtate,
         CS_UNUSED, (CS_INT*)NULL) != CS_SUCCEED)
     {
         dsp_fprintf( out, "Failed CS_TRANS_STATE\n" );
@@ -748,8 +748,8 @@ static int dsp_meta_fetch( cmd, rows )
 
     *rows = 0;
 
-    while ((r = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, 
-                          CS_UNUSED, &nrows )) == CS_SUCCEED)
+    while ((r = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, 
+                           CS_UNUSED, &nrows )) == CS_SUCCEED)
     {
         if (g_dsp_interrupted)
         {
@@ -51,7 +51,7 @@ int dsp_none( output, cmd, flags )
 	CS_INT   result_type;
 	CS_INT   return_code;
 
-	while ((return_code = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((return_code = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		if (g_dsp_interrupted)
 			return DSP_INTERRUPTED;
@@ -62,11 +62,11 @@ int dsp_none( output, cmd, flags )
 			case CS_PARAM_RESULT:
 			case CS_ROW_RESULT:
 			case CS_STATUS_RESULT:
-				while (ct_fetch(cmd,             /* Command */
-				                CS_UNUSED,       /* Type */
-				                CS_UNUSED,       /* Offset */
-				                CS_UNUSED,       /* Option */
-				                &nrows) != CS_END_DATA)
+				while (dsp_fetch(cmd,            /* Command */
+				                 CS_UNUSED,      /* Type */
+				                 CS_UNUSED,      /* Offset */
+				                 CS_UNUSED,      /* Option */
+				                 &nrows) != CS_END_DATA)
 				{
 					if (g_dsp_interrupted)
 						return DSP_INTERRUPTED;
@@ -24,12 +24,22 @@
  */
 #include <stdio.h>
 #include <ctype.h>
+#include <signal.h>
 #include "sqsh_config.h"
 #include "sqsh_error.h"
 #include "sqsh_global.h"
 #include "sqsh_debug.h"
 #include "dsp.h"
 
+#if defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#include <zlib.h>
+#define DSP_ZLIB
+#endif
+
 extern int errno;
 
 /*-- Current Version --*/
@@ -38,6 +48,67 @@ static char RCS_Id[] = "$Id: dsp_out.c,v 1.1.1.1 2001/10/23 20:31:06 gray Exp $"
 USE(RCS_Id)
 #endif /* !defined(lint) */
 
+/*
+ * sg_dsp_active: The output stream currently being written to by
+ * dsp_cmd(), or NULL when no result set is being displayed.  This
+ * allows dsp_sync() to push out buffered rows before somebody
+ * else (such as the server message callback) writes to the same
+ * file descriptor.
+ */
+static dsp_out_t *sg_dsp_active = NULL;
+
+#if defined(HAVE_PTHREAD_H)
+/*
+ * sqsh-3.0: When dsp_fpipe() is in effect the buffer of the stream
+ * becomes one of a ring of p_nbufs buffers.  Each time the buffer
+ * would have been written it is queued to the writer thread instead,
+ * and the next free buffer in the ring is filled.  Only when every
+ * buffer is queued up does the displaying thread have to wait.
+ */
+typedef struct dsp_pipe_st {
+	pthread_t        p_thread;
+	pthread_mutex_t  p_lock;
+	pthread_cond_t   p_cond;      /* Signalled when p_count changes */
+	int              p_nbufs;     /* Buffers in the ring */
+	char           **p_bufs;
+	int             *p_lens;      /* Bytes queued in each buffer */
+	int              p_head;      /* Next buffer to be written */
+	int              p_count;     /* Number of buffers queued */
+	int              p_errno;     /* errno of a failed write(), or 0 */
+	int              p_raised;    /* SIGPIPE passed on to us yet? */
+	int              p_done;      /* Tells the writer to exit */
+} dsp_pipe_t;
+
+static void* dsp_pipe_writer _ANSI_ARGS(( void* ));
+static int   dsp_pipe_push   _ANSI_ARGS(( dsp_out_t* ));
+static int   dsp_pipe_drain  _ANSI_ARGS(( dsp_out_t* ));
+static void  dsp_pipe_free   _ANSI_ARGS(( dsp_pipe_t* ));
+static void  dsp_pipe_close  _ANSI_ARGS(( dsp_out_t* ));
+#endif /* HAVE_PTHREAD_H */
+
+#if defined(DSP_ZLIB)
+/*
+ * sqsh-3.0: With dsp_fzip() in effect, every buffer that would have
+ * been written to o_fd is run through deflate() instead, and the
+ * compressed data collected in z_out is what gets written.  This is
+ * done wherever the write() happens, so in the writer thread if
+ * there is one.
+ */
+#define DSP_ZBUFSIZE  262144
+typedef struct dsp_zip_st {
+	z_stream         z_strm;
+	int              z_errno;     /* errno of a failed write(), or 0 */
+	unsigned char    z_out[DSP_ZBUFSIZE];
+} dsp_zip_t;
+
+static int   dsp_zip_write   _ANSI_ARGS(( dsp_out_t*, char*, int, int, long*, long* ));
+static void  dsp_zip_close   _ANSI_ARGS(( dsp_out_t* ));
+#endif /* DSP_ZLIB */
+
+static int   dsp_fpush       _ANSI_ARGS(( dsp_out_t* ));
+static int   dsp_fdwrite     _ANSI_ARGS(( int, char*, int, long*, long* ));
+static int   dsp_fout        _ANSI_ARGS(( dsp_out_t*, char*, int, long*, long* ));
+
 dsp_out_t* dsp_fopen( f )
 	FILE  *f;
 {
@@ -57,9 +128,39 @@ dsp_out_t* dsp_fopen( f )
 	 */
 	fflush( f );
 
-	o->o_fd   = fileno( f );
-	o->o_file = f;
-	o->o_nbuf = 0;
+	o->o_fd      = fileno( f );
+	o->o_file    = f;
+	o->o_nbuf    = 0;
+	o->o_nwrites = 0;
+	o->o_nbytes  = 0;
+	o->o_nput    = 0;
+	o->o_wtime   = 0.0;
+	o->o_pipe    = NULL;
+	o->o_zip     = NULL;
+	o->o_buf     = o->o_space;
+
+	/*
+	 * sqsh-3.0: Figure out when the buffer is to be pushed out to
+	 * the file descriptor.  A user sitting in front of a terminal
+	 * wants to see every line as soon as it is available, but when
+	 * the output is going to a file or a pipe there is no reason to
+	 * issue a write() for each row, so we let the buffer fill up.
+	 */
+	switch (g_dsp_props.p_flush)
+	{
+		case DSP_FLUSH_LINE:
+		case DSP_FLUSH_FULL:
+			o->o_flush = g_dsp_props.p_flush;
+			break;
+		default:
+			o->o_flush = isatty( o->o_fd ) ? DSP_FLUSH_LINE : DSP_FLUSH_FULL;
+			break;
+	}
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fopen: fd %d, flush policy %s\n",
+		o->o_fd, (o->o_flush == DSP_FLUSH_LINE) ? "line" : "full");)
+
+	sg_dsp_active = o;
 
 	return o;
 }
@@ -68,42 +169,195 @@ int dsp_fclose( o )
 	dsp_out_t  *o;
 {
 	dsp_fflush( o );
+#if defined(HAVE_PTHREAD_H)
+	dsp_pipe_close( o );
+#endif
+#if defined(DSP_ZLIB)
+	dsp_zip_close( o );
+#endif
 	clearerr( o->o_file );
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fclose: %ld bytes in %ld write(s)\n",
+		o->o_nbytes, o->o_nwrites);)
+
+	if (sg_dsp_active == o)
+	{
+		sg_dsp_active = NULL;
+	}
+
 	free( o );
 
 	return 0;
 }
 
+/*
+ * dsp_sync():
+ *
+ * Flushes the output stream of the result set currently being
+ * displayed, if there is one.  This is to be called by anything that
+ * writes directly to stdout or stderr while a result set is being
+ * processed, so that its output does not overtake the rows that are
+ * still sitting in our buffer.
+ */
+void dsp_sync()
+{
+	if (sg_dsp_active != NULL)
+	{
+		dsp_fflush( sg_dsp_active );
+	}
+}
+
+/*
+ * dsp_zipping():
+ *
+ * sqsh-3.0: Returns True if the result sets currently being displayed
+ * are being compressed (see dsp_fzip()) on their way to fp, in which
+ * case nothing else may be written to it.
+ */
+int dsp_zipping( fp )
+	FILE  *fp;
+{
+	return (sg_dsp_active != NULL && sg_dsp_active->o_zip != NULL &&
+	        sg_dsp_active->o_fd == fileno( fp )) ? True : False;
+}
+
 int dsp_fputc( c, o )
 	int         c;
 	dsp_out_t  *o;
 {
 	o->o_buf[o->o_nbuf++] = c;
 
-	if (c == '\n' || o->o_nbuf == DSP_BUFSIZE)
+	if (o->o_nbuf == DSP_BUFSIZE || (c == '\n' && o->o_flush == DSP_FLUSH_LINE))
 	{
-		return dsp_fflush( o );
+		return dsp_fpush( o );
 	}
 
 	return 0;
 }
 
-int dsp_fputs( s, o )
-	char       *s;
+/*
+ * dsp_fwrite():
+ *
+ * Copies len bytes from buf into the output buffer, flushing as
+ * required by the flush policy of the stream.  In line mode a flush
+ * is only done once the whole chunk has been copied, so a string
+ * containing several new-lines costs a single write().
+ */
+int dsp_fwrite( buf, len, o )
+	char       *buf;
+	int         len;
 	dsp_out_t  *o;
 {
-	while (*s != '\0')
+	int    n;
+	int    nl = False;
+
+	while (len > 0)
 	{
-		o->o_buf[o->o_nbuf++] = *s;
+		n = min( len, DSP_BUFSIZE - o->o_nbuf );
 
-		if (*s == '\n' || o->o_nbuf == DSP_BUFSIZE)
+		if (o->o_flush == DSP_FLUSH_LINE && nl == False &&
+		    memchr( buf, '\n', n ) != NULL)
 		{
-			if (dsp_fflush( o ) == -1)
+			nl = True;
+		}
+
+		memcpy( o->o_buf + o->o_nbuf, buf, n );
+		o->o_nbuf += n;
+		buf       += n;
+		len       -= n;
+
+		if (o->o_nbuf == DSP_BUFSIZE)
+		{
+			if (dsp_fpush( o ) == -1)
 			{
 				return -1;
 			}
 		}
-		++s;
+	}
+
+	if (nl == True && o->o_nbuf > 0)
+	{
+		return dsp_fpush( o );
+	}
+
+	return 0;
+}
+
+int dsp_fputs( s, o )
+	char       *s;
+	dsp_out_t  *o;
+{
+	return dsp_fwrite( s, strlen(s), o );
+}
+
+/*
+ * dsp_rtrim():
+ *
+ * sqsh-3.0: Returns the length of the first len bytes of s, less any
+ * trailing white-space (or nulls), as the bcp and csv styles want it
+ * when $bcp_trim is set.  The first byte is never trimmed.  Since the
+ * white-space is nearly always the blank padding of a CHAR column,
+ * whole words of blanks are skipped at a time before looking at the
+ * remaining bytes one by one.
+ */
+int dsp_rtrim( s, len )
+	char       *s;
+	int         len;
+{
+	unsigned long  w;
+	unsigned long  blanks = (~0UL / 0xff) * ' ';
+
+	while (len > (int)sizeof(w))
+	{
+		memcpy( &w, s + len - sizeof(w), sizeof(w) );
+		if (w != blanks)
+		{
+			break;
+		}
+		len -= sizeof(w);
+	}
+
+	while (len > 1 && (s[len-1] == '\0' || isspace((int)s[len-1])))
+	{
+		--len;
+	}
+
+	return len;
+}
+
+/*
+ * dsp_fquote():
+ *
+ * sqsh-3.0: Writes len bytes of s, doubling every occurrence of the
+ * character q, as needed for a quoted CSV field.  memchr() (which
+ * the C library vectorizes) finds each q, and the bytes in between
+ * are copied into the buffer as one span.
+ */
+int dsp_fquote( s, len, q, o )
+	char       *s;
+	int         len;
+	int         q;
+	dsp_out_t  *o;
+{
+	char  *p;
+	int    n;
+
+	while (len > 0)
+	{
+		p = (char*)memchr( s, q, len );
+
+		if (p == NULL)
+		{
+			return dsp_fwrite( s, len, o );
+		}
+
+		n = (int)(p - s) + 1;
+		if (dsp_fwrite( s, n, o ) == -1 || dsp_fputc( q, o ) == -1)
+		{
+			return -1;
+		}
+		s   += n;
+		len -= n;
 	}
 
 	return 0;
@@ -120,33 +374,133 @@ int dsp_fprintf( o, fmt, va_alist )
 {
 	va_list     ap;
 	int         nbytes;
+	char       *big;
 
-	dsp_fflush( o );
-
+	/*
+	 * sqsh-3.0: Format straight into the free space at the end of
+	 * the buffer, rather than flushing it before and after each
+	 * call.  If the result doesn't fit then flush what we have and
+	 * try again with the whole buffer available.  Should it not even
+	 * fit into that, it is formatted into memory of its own and
+	 * handed to dsp_fwrite().
+	 */
 #if defined(__ansi__)
 	va_start( ap, fmt );
 #else
 	va_start( ap );
 #endif
-
-	o->o_nbuf = vsprintf( o->o_buf, fmt, ap );
+	nbytes = vsnprintf( o->o_buf + o->o_nbuf, DSP_BUFSIZE - o->o_nbuf, fmt, ap );
 	va_end( ap );
 
-	nbytes = o->o_nbuf;
-	dsp_fflush( o );
+	if (nbytes >= 0 && nbytes >= DSP_BUFSIZE - o->o_nbuf)
+	{
+		if (dsp_fpush( o ) == -1)
+		{
+			return -1;
+		}
+
+#if defined(__ansi__)
+		va_start( ap, fmt );
+#else
+		va_start( ap );
+#endif
+		nbytes = vsnprintf( o->o_buf, DSP_BUFSIZE, fmt, ap );
+		va_end( ap );
+
+		if (nbytes >= DSP_BUFSIZE)
+		{
+			if ((big = (char*)malloc( nbytes + 1 )) == NULL)
+			{
+				fprintf( stderr, "dsp_fprintf: Memory allocation failure\n" );
+				return -1;
+			}
+
+#if defined(__ansi__)
+			va_start( ap, fmt );
+#else
+			va_start( ap );
+#endif
+			vsnprintf( big, nbytes + 1, fmt, ap );
+			va_end( ap );
+
+			if (dsp_fwrite( big, nbytes, o ) == -1)
+			{
+				nbytes = -1;
+			}
+			free( big );
+
+			return nbytes;
+		}
+	}
+
+	if (nbytes < 0)
+	{
+		return -1;
+	}
+
+	o->o_nbuf += nbytes;
+
+	if (o->o_nbuf == DSP_BUFSIZE ||
+	    (o->o_flush == DSP_FLUSH_LINE && memchr( o->o_buf + o->o_nbuf - nbytes,
+	                                             '\n', nbytes ) != NULL))
+	{
+		dsp_fpush( o );
+	}
 
 	return nbytes;
 }
 
+/*
+ * dsp_fpush():
+ *
+ * Called whenever the buffer has filled up (or a line is complete in
+ * line mode).  With a writer thread running the buffer is queued up
+ * for it, otherwise it is written out right away.
+ */
+static int dsp_fpush( o )
+	dsp_out_t   *o;
+{
+	if (g_dsp_meter != NULL && g_dsp_meter->m_out == o)
+	{
+		dsp_meter_clear( g_dsp_meter );
+	}
+
+#if defined(HAVE_PTHREAD_H)
+	if (o->o_pipe != NULL)
+	{
+		return dsp_pipe_push( o );
+	}
+#endif
+	return dsp_fflush( o );
+}
+
+/*
+ * dsp_fflush():
+ *
+ * Writes everything that has been buffered so far.  If a writer thread
+ * is running, the current buffer is queued and we wait until all of
+ * the queued buffers have been written, so the caller can rely on the
+ * output having reached the file descriptor upon return.
+ */
 int dsp_fflush( o )
 	dsp_out_t   *o;
 {
-	char   *cp;
-	int     nbytes;
 	int     r;
 
-	cp     = o->o_buf;
-	nbytes = o->o_nbuf;
+	if (g_dsp_meter != NULL && g_dsp_meter->m_out == o)
+	{
+		dsp_meter_clear( g_dsp_meter );
+	}
+
+#if defined(HAVE_PTHREAD_H)
+	if (o->o_pipe != NULL)
+	{
+		dsp_pipe_drain( o );
+		fflush( o->o_file );
+		r = dsp_pipe_push( o );
+		return (dsp_pipe_drain( o ) != 0 || r == -1) ? -1 : 0;
+	}
+#endif
 
 	/*
 	 * Just in case someone has been using the *real* FILE
@@ -154,24 +508,602 @@ int dsp_fflush( o )
 	 */
 	fflush( o->o_file );
 
+	r = 0;
+	if (o->o_nbuf > 0)
+	{
+		r = dsp_fout( o, o->o_buf, o->o_nbuf, &o->o_nwrites, &o->o_nbytes );
+	}
+
+	/*
+	 * sqsh-3.0: Throw away whatever we couldn't write (typically the
+	 * reader of our pipe went away), so that the callers can keep on
+	 * appending to the buffer without running off of the end of it.
+	 */
+	o->o_nput += o->o_nbuf;
+	o->o_nbuf  = 0;
+
+	if (r != 0)
+	{
+		errno = r;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * dsp_fbytes():
+ *
+ * sqsh-3.0: Returns the number of bytes written so far.  With a writer
+ * thread running o_nbytes is added to by that thread, so it is read
+ * under the lock of the pipe.
+ */
+long dsp_fbytes( o )
+	dsp_out_t   *o;
+{
+	long    nbytes;
+
+#if defined(HAVE_PTHREAD_H)
+	if (o->o_pipe != NULL)
+	{
+		pthread_mutex_lock( &o->o_pipe->p_lock );
+		nbytes = o->o_nbytes;
+		pthread_mutex_unlock( &o->o_pipe->p_lock );
+		return nbytes;
+	}
+#endif
+
+	return o->o_nbytes;
+}
+
+/*
+ * dsp_fdwrite():
+ *
+ * Writes nbytes from cp to fd, adding the number of write() calls
+ * and bytes written to *nwrites and *nbytes.  Returns 0, or the errno
+ * of the write() that failed.
+ */
+static int dsp_fdwrite( fd, cp, nbytes, nwrites, nwritten )
+	int          fd;
+	char        *cp;
+	int          nbytes;
+	long        *nwrites;
+	long        *nwritten;
+{
+	int     r;
+
 	while (nbytes > 0)
 	{
-		r = write(o->o_fd, (void*)cp, nbytes);
+		r = write( fd, (void*)cp, nbytes );
 
 		if (r == -1)
 		{
 			if (errno != EINTR)
 			{
-				return -1;
+				return errno;
 			}
 		}
 		else
 		{
-			nbytes -= r;
-			cp     += r;
+			++(*nwrites);
+			*nwritten += r;
+			nbytes    -= r;
+			cp        += r;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * dsp_fout():
+ *
+ * Sends nbytes of buffered output from cp on their way to the file
+ * descriptor, compressing them first if need be.  Returns 0, or the
+ * errno of the write() that failed.
+ */
+static int dsp_fout( o, cp, nbytes, nwrites, nwritten )
+	dsp_out_t   *o;
+	char        *cp;
+	int          nbytes;
+	long        *nwrites;
+	long        *nwritten;
+{
+	double   start;
+	int      r;
+
+	/*
+	 * Only the one thread ever writes, so o_wtime needs no locking.
+	 */
+	start = dsp_now();
+
+#if defined(DSP_ZLIB)
+	if (o->o_zip != NULL)
+	{
+		r = dsp_zip_write( o, cp, nbytes, Z_NO_FLUSH, nwrites, nwritten );
+	}
+	else
+#endif
+	r = dsp_fdwrite( o->o_fd, cp, nbytes, nwrites, nwritten );
+
+	o->o_wtime += dsp_now() - start;
+	return r;
+}
+
+#if defined(HAVE_PTHREAD_H)
+
+/*
+ * dsp_fpipe():
+ *
+ * Starts a thread that takes care of all write()'s to the output
+ * stream from here on out, with up to nbufs buffers queued up for it.
+ * The thread is created with all signals blocked, so SIGINT keeps on
+ * being delivered to the displaying thread, and a write() to a pipe
+ * that has gone away fails with EPIPE rather than raising SIGPIPE.
+ * That failure is handed back to the displaying thread as a SIGPIPE
+ * by dsp_pipe_push().  Returns 0 upon success, or -1 if the output
+ * is to be written in-line after all.
+ */
+int dsp_fpipe( o, nbufs )
+	dsp_out_t   *o;
+	int          nbufs;
+{
+	dsp_pipe_t  *p;
+	sigset_t     all_sigs;
+	sigset_t     old_sigs;
+	int          i;
+	int          r;
+
+	if (o->o_pipe != NULL || nbufs < 1)
+	{
+		return -1;
+	}
+
+	/*
+	 * Push out anything written so far, since o_space is about to
+	 * be replaced by the first buffer in the ring.
+	 */
+	if (dsp_fflush( o ) == -1)
+	{
+		return -1;
+	}
+
+	p = (dsp_pipe_t*)malloc( sizeof(dsp_pipe_t) );
+	if (p == NULL)
+	{
+		return -1;
+	}
+
+	/*
+	 * One more buffer than asked for, as the one being filled is
+	 * never among those queued.
+	 */
+	p->p_nbufs  = nbufs + 1;
+	p->p_bufs   = (char**)calloc( p->p_nbufs, sizeof(char*) );
+	p->p_lens   = (int*)calloc( p->p_nbufs, sizeof(int) );
+	p->p_head   = 0;
+	p->p_count  = 0;
+	p->p_errno  = 0;
+	p->p_raised = False;
+	p->p_done   = False;
+
+	for (i = 0; p->p_bufs != NULL && i < p->p_nbufs; i++)
+	{
+		if ((p->p_bufs[i] = (char*)malloc( DSP_BUFSIZE )) == NULL)
+			break;
+	}
+
+	if (p->p_bufs == NULL || p->p_lens == NULL || i < p->p_nbufs)
+	{
+		DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fpipe: Unable to allocate %d buffers\n",
+			p->p_nbufs);)
+		dsp_pipe_free( p );
+		return -1;
+	}
+
+	pthread_mutex_init( &p->p_lock, NULL );
+	pthread_cond_init( &p->p_cond, NULL );
+
+	o->o_pipe = p;
+
+	sigfillset( &all_sigs );
+	pthread_sigmask( SIG_BLOCK, &all_sigs, &old_sigs );
+	r = pthread_create( &p->p_thread, NULL, dsp_pipe_writer, (void*)o );
+	pthread_sigmask( SIG_SETMASK, &old_sigs, NULL );
+
+	if (r != 0)
+	{
+		DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fpipe: pthread_create: %s\n",
+			strerror(r));)
+
+		o->o_pipe = NULL;
+		pthread_cond_destroy( &p->p_cond );
+		pthread_mutex_destroy( &p->p_lock );
+		dsp_pipe_free( p );
+		return -1;
+	}
+
+	o->o_buf  = p->p_bufs[0];
+	o->o_nbuf = 0;
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fpipe: Writer thread started, %d buffers\n",
+		nbufs);)
+
+	return 0;
+}
+
+/*
+ * dsp_pipe_writer():
+ *
+ * Body of the writer thread.  Takes buffers off of the head of the
+ * queue and writes them until told to quit.  Once a write() has
+ * failed, everything else that is queued is thrown away, just as
+ * dsp_fflush() does when it is writing for itself.
+ */
+static void* dsp_pipe_writer( arg )
+	void  *arg;
+{
+	dsp_out_t   *o = (dsp_out_t*)arg;
+	dsp_pipe_t  *p = o->o_pipe;
+	char        *cp;
+	int          nbytes;
+	long         nwrites;
+	long         nwritten;
+	int          err;
+
+	pthread_mutex_lock( &p->p_lock );
+	for (;;)
+	{
+		while (p->p_count == 0 && p->p_done == False)
+		{
+			pthread_cond_wait( &p->p_cond, &p->p_lock );
+		}
+
+		if (p->p_count == 0)
+		{
+			break;
 		}
+
+		cp     = p->p_bufs[p->p_head];
+		nbytes = p->p_lens[p->p_head];
+		err    = p->p_errno;
+		pthread_mutex_unlock( &p->p_lock );
+
+		nwrites  = 0;
+		nwritten = 0;
+		if (err == 0)
+		{
+			err = dsp_fout( o, cp, nbytes, &nwrites, &nwritten );
+		}
+
+		pthread_mutex_lock( &p->p_lock );
+		o->o_nwrites += nwrites;
+		o->o_nbytes  += nwritten;
+		p->p_errno    = err;
+		p->p_head     = (p->p_head + 1) % p->p_nbufs;
+		--p->p_count;
+		pthread_cond_broadcast( &p->p_cond );
+	}
+	pthread_mutex_unlock( &p->p_lock );
+
+	return NULL;
+}
+
+/*
+ * dsp_pipe_push():
+ *
+ * Queues the buffer currently being filled for the writer thread and
+ * moves on to the next one in the ring, waiting for the writer to
+ * free one up if need be.
+ */
+static int dsp_pipe_push( o )
+	dsp_out_t   *o;
+{
+	dsp_pipe_t  *p = o->o_pipe;
+	int          err;
+	int          slot;
+
+	pthread_mutex_lock( &p->p_lock );
+
+	if (o->o_nbuf > 0 && p->p_errno == 0)
+	{
+		slot = (p->p_head + p->p_count) % p->p_nbufs;
+		p->p_lens[slot] = o->o_nbuf;
+		++p->p_count;
+		pthread_cond_broadcast( &p->p_cond );
+
+		while (p->p_count == p->p_nbufs)
+		{
+			pthread_cond_wait( &p->p_cond, &p->p_lock );
+		}
+
+		o->o_buf = p->p_bufs[(p->p_head + p->p_count) % p->p_nbufs];
+	}
+	o->o_nput += o->o_nbuf;
+	o->o_nbuf  = 0;
+
+	err = p->p_errno;
+	pthread_mutex_unlock( &p->p_lock );
+
+	if (err == 0)
+	{
+		return 0;
 	}
 
+	/*
+	 * The writer can't take the SIGPIPE for us, since dsp_signal()
+	 * has to run in this thread to interrupt the result set, so
+	 * pass it along once.
+	 */
+	if (err == EPIPE && p->p_raised == False)
+	{
+		p->p_raised = True;
+		raise( SIGPIPE );
+	}
+
+	return -1;
+}
+
+/*
+ * dsp_pipe_drain():
+ *
+ * Waits for the writer thread to finish with everything queued,
+ * returning the errno of the write() that failed, if any.
+ */
+static int dsp_pipe_drain( o )
+	dsp_out_t   *o;
+{
+	dsp_pipe_t  *p = o->o_pipe;
+	int          err;
+
+	pthread_mutex_lock( &p->p_lock );
+	while (p->p_count > 0)
+	{
+		pthread_cond_wait( &p->p_cond, &p->p_lock );
+	}
+	err = p->p_errno;
+	pthread_mutex_unlock( &p->p_lock );
+
+	return err;
+}
+
+/*
+ * dsp_pipe_free():
+ *
+ * Releases the buffers of a pipeline.
+ */
+static void dsp_pipe_free( p )
+	dsp_pipe_t  *p;
+{
+	int          i;
+
+	if (p->p_bufs != NULL)
+	{
+		for (i = 0; i < p->p_nbufs; i++)
+		{
+			if (p->p_bufs[i] != NULL)
+				free( p->p_bufs[i] );
+		}
+		free( p->p_bufs );
+	}
+	if (p->p_lens != NULL)
+		free( p->p_lens );
+	free( p );
+}
+
+/*
+ * dsp_pipe_close():
+ *
+ * Stops the writer thread, if there is one, once it has written
+ * everything it was given.
+ */
+static void dsp_pipe_close( o )
+	dsp_out_t   *o;
+{
+	dsp_pipe_t  *p = o->o_pipe;
+
+	if (p == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock( &p->p_lock );
+	p->p_done = True;
+	pthread_cond_broadcast( &p->p_cond );
+	pthread_mutex_unlock( &p->p_lock );
+
+	pthread_join( p->p_thread, NULL );
+
+	pthread_cond_destroy( &p->p_cond );
+	pthread_mutex_destroy( &p->p_lock );
+	dsp_pipe_free( p );
+
+	o->o_pipe = NULL;
+	o->o_buf  = o->o_space;
 	o->o_nbuf = 0;
+}
+
+#else /* HAVE_PTHREAD_H */
+
+/*
+ * dsp_fpipe():
+ *
+ * Without threads all output is written in-line.
+ */
+int dsp_fpipe( o, nbufs )
+	dsp_out_t   *o;
+	int          nbufs;
+{
+	return -1;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+#if defined(DSP_ZLIB)
+
+/*
+ * dsp_fzip():
+ *
+ * Compresses everything written to the output stream from here on
+ * out into a gzip stream at the given level.  Each call to dsp_cmd()
+ * produces a gzip member of its own, and since gzip(1) reads a file
+ * of concatenated members as a single file, several batches may be
+ * appended to the same file.  Returns 0 upon success, or -1 if the
+ * stream could not be set up.
+ */
+int dsp_fzip( o, level )
+	dsp_out_t   *o;
+	int          level;
+{
+	dsp_zip_t   *z;
+
+	if (o->o_zip != NULL || o->o_pipe != NULL)
+	{
+		return -1;
+	}
+
+	/*
+	 * Anything written so far is left as it is.
+	 */
+	if (dsp_fflush( o ) == -1)
+	{
+		return -1;
+	}
+
+	z = (dsp_zip_t*)malloc( sizeof(dsp_zip_t) );
+	if (z == NULL)
+	{
+		fprintf( stderr, "dsp_fzip: Memory allocation failure\n" );
+		return -1;
+	}
+
+	z->z_strm.zalloc = Z_NULL;
+	z->z_strm.zfree  = Z_NULL;
+	z->z_strm.opaque = Z_NULL;
+	z->z_errno       = 0;
+
+	/*
+	 * A window of 15 bits plus 16 asks zlib for a gzip header and
+	 * trailer rather than a zlib one.
+	 */
+	if (deflateInit2( &z->z_strm, level, Z_DEFLATED, 15 + 16, 8,
+	                  Z_DEFAULT_STRATEGY ) != Z_OK)
+	{
+		fprintf( stderr, "dsp_fzip: %s\n",
+			(z->z_strm.msg != NULL) ? z->z_strm.msg : "Unable to start compression" );
+		free( z );
+		return -1;
+	}
+
+	o->o_zip = z;
+
+	/*
+	 * Compressing a line at a time would only make the output
+	 * bigger, and nobody is going to read it as it comes.
+	 */
+	o->o_flush = DSP_FLUSH_FULL;
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_fzip: fd %d, compression level %d\n",
+		o->o_fd, level);)
+
 	return 0;
 }
+
+/*
+ * dsp_zip_write():
+ *
+ * Runs nbytes from cp through deflate(), writing compressed data out
+ * whenever z_out fills up.  With a flush of Z_FINISH the gzip trailer
+ * is written as well.  Returns 0, or the errno of the write() that
+ * failed, after which nothing more is compressed.
+ */
+static int dsp_zip_write( o, cp, nbytes, flush, nwrites, nwritten )
+	dsp_out_t   *o;
+	char        *cp;
+	int          nbytes;
+	int          flush;
+	long        *nwrites;
+	long        *nwritten;
+{
+	dsp_zip_t   *z = o->o_zip;
+	int          n;
+	int          r;
+
+	if (z->z_errno != 0)
+	{
+		return z->z_errno;
+	}
+
+	z->z_strm.next_in  = (Bytef*)cp;
+	z->z_strm.avail_in = (uInt)nbytes;
+
+	/*
+	 * deflate() only leaves input behind (or, when finishing,
+	 * output unwritten) if it ran out of room in z_out.
+	 */
+	do
+	{
+		z->z_strm.next_out  = z->z_out;
+		z->z_strm.avail_out = DSP_ZBUFSIZE;
+
+		if (deflate( &z->z_strm, flush ) == Z_STREAM_ERROR)
+		{
+			z->z_errno = EIO;
+			return EIO;
+		}
+
+		n = DSP_ZBUFSIZE - z->z_strm.avail_out;
+		if (n > 0 &&
+		    (r = dsp_fdwrite( o->o_fd, (char*)z->z_out, n, nwrites, nwritten )) != 0)
+		{
+			z->z_errno = r;
+			return r;
+		}
+	}
+	while (z->z_strm.avail_out == 0);
+
+	return 0;
+}
+
+/*
+ * dsp_zip_close():
+ *
+ * Finishes off the gzip stream, if there is one, once everything
+ * buffered has been compressed.
+ */
+static void dsp_zip_close( o )
+	dsp_out_t   *o;
+{
+	dsp_zip_t   *z = o->o_zip;
+
+	if (z == NULL)
+	{
+		return;
+	}
+
+	dsp_zip_write( o, (char*)NULL, 0, Z_FINISH, &o->o_nwrites, &o->o_nbytes );
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_zip_close: %lu bytes compressed to %lu\n",
+		(unsigned long)z->z_strm.total_in, (unsigned long)z->z_strm.total_out);)
+
+	deflateEnd( &z->z_strm );
+	free( z );
+
+	o->o_zip = NULL;
+}
+
+#else /* DSP_ZLIB */
+
+/*
+ * dsp_fzip():
+ *
+ * Without zlib the output can't be compressed.
+ */
+int dsp_fzip( o, level )
+	dsp_out_t   *o;
+	int          level;
+{
+	fprintf( stderr, "dsp_fzip: sqsh was built without zlib, output can't be compressed\n" );
+	return -1;
+}
+
+#endif /* DSP_ZLIB */
@@ -55,6 +55,8 @@ static CS_INT     dsp_comp_prrow_one
 	_ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, dsp_desc_t* ));
 static void      dsp_calc_width      
 	_ANSI_ARGS(( dsp_desc_t* ));
+static int       dsp_col_width
+	_ANSI_ARGS(( dsp_col_t* ));
 
 /*
  * dsp_pretty:
@@ -84,7 +86,7 @@ int dsp_pretty( o, cmd, flags )
 	 * That's it for the setup, now start banging through the set of
 	 * results coming back from the server.
 	 */
-	while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		/*-- Check for interrupt --*/
 		if (g_dsp_interrupted)
@@ -124,11 +126,11 @@ int dsp_pretty( o, cmd, flags )
 							 (rows_affected == 1) ? "" : "s");
 				}
 
-				if (ct_res_info( cmd,                       /* Command */
-				                 CS_ROW_COUNT,              /* Type */
-				                 (CS_VOID*)&rows_affected,  /* Buffer */
-				                 CS_UNUSED,                 /* Buffer Length */
-				                 (CS_INT*)NULL ) != CS_SUCCEED)
+				if (dsp_res_info( cmd,                       /* Command */
+				                  CS_ROW_COUNT,              /* Type */
+				                  (CS_VOID*)&rows_affected,  /* Buffer */
+				                  CS_UNUSED,                 /* Buffer Length */
+				                  (CS_INT*)NULL ) != CS_SUCCEED)
 				{
 					goto dsp_fail;
 				}
@@ -138,7 +140,7 @@ int dsp_pretty( o, cmd, flags )
 				break;
 
 			case CS_STATUS_RESULT:
-			  while (((ret = ct_fetch( cmd,        /* Command */
+			  while (((ret = dsp_fetch( cmd,       /* Command */
 				                  CS_UNUSED,        /* Type */
 				                  CS_UNUSED,        /* Offset */
 				                  CS_UNUSED,        /* Option */
@@ -151,11 +153,11 @@ int dsp_pretty( o, cmd, flags )
 					if (ret == CS_ROW_FAIL)
 					    continue;
 
-					if (ct_get_data( cmd,                      /* Command */
-					                 1,                        /* Item */
-					                 (CS_VOID*)&result_status, /* Buffer */
-					                 CS_SIZEOF(CS_INT),        /* Buffer Length */
-					                 (CS_INT*)NULL ) != CS_END_DATA)
+					if (dsp_get_data( cmd,                      /* Command */
+					                  1,                        /* Item */
+					                  (CS_VOID*)&result_status, /* Buffer */
+					                  CS_SIZEOF(CS_INT),        /* Buffer Length */
+					                  (CS_INT*)NULL ) != CS_END_DATA)
 					{
 						goto dsp_fail;
 					}
@@ -205,7 +207,7 @@ int dsp_pretty( o, cmd, flags )
 				if (result_type == CS_PARAM_RESULT &&
 					g_dsp_props.p_outputparms == 0)
 				{
-					while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 						&nrows )) == CS_SUCCEED);
 					
 					if (ret != CS_END_DATA)
@@ -257,6 +259,17 @@ int dsp_pretty( o, cmd, flags )
 					goto dsp_fail;
 				}
 
+				/*
+				 * sqsh-3.0: Look at the first $width_sample rows to see
+				 * how wide the columns really need to be.
+				 */
+				if (g_dsp_props.p_sample > 0 &&
+				    dsp_desc_sample( cmd, select_desc,
+				                     g_dsp_props.p_sample ) != CS_SUCCEED)
+				{
+					goto dsp_fail;
+				}
+
 				/*
 				 * Now, calculate the width of the columns.
 				 */
@@ -401,7 +414,7 @@ static void dsp_calc_width( desc )
 		/*-- Handy Pointer --*/
 		col = &desc->d_cols[i];
 
-		col->c_width = max(col->c_format.namelen, col->c_maxlength);
+		col->c_width = dsp_col_width( col );
 
 		if (col->c_width > g_dsp_props.p_colwidth)
 		{
@@ -433,7 +446,7 @@ static void dsp_calc_width( desc )
 		for (i = 0; ntrunc > 0 && i < desc->d_ncols; i++)
 		{
 			col = &desc->d_cols[i];
-			w = max(col->c_format.namelen, col->c_maxlength);
+			w = dsp_col_width( col );
 
 			if (col->c_width != w)
 			{
@@ -459,6 +472,24 @@ static void dsp_calc_width( desc )
 	}
 }
 
+/*
+ * dsp_col_width():
+ *
+ * The width a column would like to have: as wide as the widest of the
+ * name and the data that it holds.  If the result set was sampled the
+ * data is only as wide as the widest value that was looked at.
+ */
+static int dsp_col_width( col )
+	dsp_col_t    *col;
+{
+	if (col->c_sample_width >= 0)
+	{
+		return max(col->c_format.namelen, col->c_sample_width);
+	}
+
+	return max(col->c_format.namelen, col->c_maxlength);
+}
+
 static void dsp_prsep( output, desc, sep )
 	dsp_out_t   *output;
 	dsp_desc_t  *desc;
@@ -592,6 +623,17 @@ static void dsp_prrow( output, desc )
 					dsp_fputc( col->c_ptr[j], output );
 				}
 				col->c_ptr += j;
+
+				/*
+				 * sqsh-3.0: When the width was sampled, a later value
+				 * that doesn't fit is wrapped as well, unless asked
+				 * to truncate it.
+				 */
+				if (*col->c_ptr != '\0' && col->c_sample_width >= 0 &&
+				    g_dsp_props.p_overflow == DSP_OVERFLOW_WRAP)
+				{
+					done = False;
+				}
 			}
 			else
 			{
@@ -607,6 +649,16 @@ static void dsp_prrow( output, desc )
 					++col->c_ptr;
 				}
 
+				/*
+				 * sqsh-3.0: Cut the value off rather than wrap it, if
+				 * the width was sampled and that is what was asked for.
+				 */
+				if (col->c_sample_width >= 0 &&
+				    g_dsp_props.p_overflow == DSP_OVERFLOW_TRUNC)
+				{
+					col->c_ptr += strlen( col->c_ptr );
+				}
+
 				if (*col->c_ptr != '\0')
 				{
 					done = False;
@@ -783,6 +835,17 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 						dsp_fputc( com_col->c_ptr[j], output );
 					}
 					com_col->c_ptr += j;
+
+					/*
+					 * sqsh-3.0: An aggregate is easily wider than any of
+					 * the values sampled, so wrap it as well.
+					 */
+					if (*com_col->c_ptr != '\0' && sel_col->c_sample_width >= 0 &&
+					    g_dsp_props.p_overflow == DSP_OVERFLOW_WRAP)
+					{
+						done = False;
+						com_col->c_processed &= ~(DSP_PROC_DATA);
+					}
 				}
 				else
 				{
@@ -798,6 +861,12 @@ static CS_INT dsp_comp_prrow_one( output, sel_desc, com_desc )
 						++com_col->c_ptr;
 					}
 
+					if (sel_col->c_sample_width >= 0 &&
+					    g_dsp_props.p_overflow == DSP_OVERFLOW_TRUNC)
+					{
+						com_col->c_ptr += strlen( com_col->c_ptr );
+					}
+
 					if (*com_col->c_ptr != '\0')
 					{
 						done = False;
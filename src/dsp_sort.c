@@ -0,0 +1,1448 @@
+/*
+ * dsp_sort.c - Sorting of result sets on the client ($order_by)
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#include <stdio.h>
+#include <ctype.h>
+#include "sqsh_config.h"
+#include "sqsh_error.h"
+#include "sqsh_global.h"
+#include "sqsh_debug.h"
+#include "dsp.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: dsp_sort.c,v 1.1 2026/10/18 00:00:00 sqsh Exp $";
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * sqsh-3.0: With $order_by set, dsp_desc_bind() opens a sort for every
+ * regular result set and dsp_desc_next() takes the rows from
+ * dsp_sort_next() rather than from CT-Lib.  The first call reads the
+ * whole result set, in the blocks bound by dsp_desc_bind(), keeping
+ * each row the way it was bound.  The keys are compared as the native
+ * values they were bound as, not as the strings they are displayed
+ * as; dsp_sort_native() has the few datatypes CT-Lib would otherwise
+ * convert to strings (NUMERIC and DECIMAL) bound native when they are
+ * keys.
+ *
+ * With a row limit in effect only the first N rows in sort order are
+ * wanted, and these are kept in a heap of N fixed size slots with the
+ * last of them on top, ready to be replaced by a row that sorts ahead
+ * of it.  Otherwise rows are gathered until $sort_memory is used up,
+ * sorted, and written out as a run to $tmp_dir.  The runs are merged
+ * at the end, SORT_MAXMERGE at a time.  Rows with equal keys come out
+ * in the order they came back in.
+ *
+ * A row is a sort_hdr_t followed by, for each column (the keys first,
+ * in key order, then the rest), a CS_SMALLINT indicator, a CS_INT
+ * length and the bytes bound for it.
+ */
+#define SORT_MAXMERGE   64      /* Most runs merged at once */
+#define SORT_MINARENA   65536   /* Smallest block of rows allocated */
+
+#define SORT_FLDHDR     (sizeof(CS_SMALLINT) + sizeof(CS_INT))
+#define SORT_ALIGN(n)   (((n) + sizeof(double) - 1) & ~((long)sizeof(double) - 1))
+#define SORT_CMP(x,y)   (((x) < (y)) ? -1 : (((x) > (y)) ? 1 : 0))
+
+typedef struct sort_hdr_st {
+	long         h_len;         /* Bytes in the row, this included */
+	long         h_seq;         /* Position the row came back in */
+} sort_hdr_t;
+
+typedef struct sort_key_st {
+	CS_INT       k_col;         /* Index into d_cols */
+	int          k_dir;         /* 1 ascending, -1 descending */
+	CS_INT       k_type;        /* Datatype of the column */
+	int          k_native;      /* Bound native, rather than as a string */
+	int          k_numlen;      /* NUMERIC/DECIMAL, bytes of digits */
+} sort_key_t;
+
+typedef struct sort_run_st {
+	FILE        *r_file;        /* The run, already unlink()'ed */
+	char        *r_row;         /* Current row of the run */
+	long         r_size;        /* Bytes allocated for r_row */
+	int          r_eof;         /* No more rows */
+} sort_run_t;
+
+typedef struct dsp_sort_st {
+	int          s_nkeys;
+	sort_key_t  *s_keys;
+	CS_INT       s_ncols;
+	CS_INT      *s_order;       /* Columns in the order they are kept */
+	long         s_budget;      /* Bytes of rows that may be held */
+	int          s_loaded;      /* The result set has been read */
+	long         s_slot;        /* Bytes per row of the top N, 0 if not */
+	long         s_limit;       /* N */
+	long         s_spare;       /* Top N, slot the next row is read into */
+	long         s_nread;       /* Rows read from CT-Lib */
+	long         s_nout;        /* Rows handed back */
+
+	char        *s_arena;       /* Rows held in memory */
+	long         s_used;
+	long         s_size;
+	long        *s_offs;        /* Offset in s_arena of each row held */
+	long         s_nheld;
+	long         s_maxheld;
+	long         s_next;        /* Next of s_offs to be handed back */
+
+	sort_run_t  *s_runs;        /* Runs written out */
+	int          s_nruns;
+	int          s_maxruns;
+	int         *s_heap;        /* Runs being merged, least row on top */
+	int          s_nheap;
+	int          s_moved;       /* Top of s_heap has been handed back */
+} dsp_sort_t;
+
+/*
+ * sg_sort: The sort qsort() is working on, for sort_qcmp().
+ */
+static dsp_sort_t *sg_sort = NULL;
+
+/*-- Prototypes --*/
+static CS_INT      sort_column      _ANSI_ARGS(( dsp_desc_t*, char*, int ));
+static CS_RETCODE  sort_load        _ANSI_ARGS(( CS_COMMAND*, dsp_desc_t*, dsp_sort_t*, CS_INT ));
+static int         sort_add         _ANSI_ARGS(( dsp_desc_t*, dsp_sort_t*, CS_INT ));
+static CS_INT      sort_datalen     _ANSI_ARGS(( dsp_col_t*, CS_INT ));
+static void        sort_copy        _ANSI_ARGS(( dsp_desc_t*, dsp_sort_t*, CS_INT, char*, long ));
+static void        sort_fill        _ANSI_ARGS(( dsp_desc_t*, dsp_sort_t*, char* ));
+static int         sort_cmp         _ANSI_ARGS(( dsp_sort_t*, char*, char* ));
+static int         sort_qcmp        _ANSI_ARGS(( const void*, const void* ));
+static int         sort_value_cmp   _ANSI_ARGS(( sort_key_t*, char*, CS_INT, char*, CS_INT ));
+static int         sort_bytes_cmp   _ANSI_ARGS(( char*, CS_INT, char*, CS_INT ));
+static void        sort_heap_up     _ANSI_ARGS(( dsp_sort_t*, long ));
+static void        sort_heap_down   _ANSI_ARGS(( dsp_sort_t*, long ));
+static int         sort_spill       _ANSI_ARGS(( dsp_sort_t* ));
+static int         sort_finish      _ANSI_ARGS(( dsp_sort_t* ));
+static int         sort_run_read    _ANSI_ARGS(( sort_run_t* ));
+static int         sort_merge_start _ANSI_ARGS(( dsp_sort_t*, int ));
+static int         sort_merge_next  _ANSI_ARGS(( dsp_sort_t*, char** ));
+static void        sort_merge_down  _ANSI_ARGS(( dsp_sort_t*, int ));
+static void        sort_release     _ANSI_ARGS(( dsp_sort_t* ));
+
+/*
+ * dsp_sort_open():
+ *
+ * Called by dsp_desc_bind() once the columns of a regular result set
+ * have been described, returns a sort by the keys in $order_by, or
+ * NULL if one of them isn't in the result set (in which case it is
+ * displayed unsorted).  A key is a column name or number, preceded
+ * by a '-' to sort it in descending order.
+ */
+dsp_sort_t* dsp_sort_open( d )
+	dsp_desc_t  *d;
+{
+	dsp_sort_t  *s;
+	sort_key_t  *k;
+	char        *cp;
+	char        *end;
+	CS_INT       col;
+	int          dir;
+	int          len;
+	int          i;
+	int          j;
+
+	if (d->d_ncols < 1)
+		return NULL;
+
+	if ((s = (dsp_sort_t*)calloc( 1, sizeof(dsp_sort_t) )) == NULL ||
+	    (s->s_keys = (sort_key_t*)malloc( sizeof(sort_key_t) * d->d_ncols )) == NULL ||
+	    (s->s_order = (CS_INT*)malloc( sizeof(CS_INT) * d->d_ncols )) == NULL)
+	{
+		fprintf( stderr, "dsp_sort: Memory allocation failure, rows not sorted\n" );
+		dsp_sort_close( s );
+		return NULL;
+	}
+
+	s->s_ncols  = d->d_ncols;
+	s->s_budget = (long)g_dsp_props.p_sortmem * 1048576L;
+
+	for (cp = g_dsp_props.p_orderby; *cp != '\0'; )
+	{
+		if ((end = strchr( cp, ',' )) == NULL)
+			end = cp + strlen( cp );
+
+		while (cp < end && isspace( (int)*cp ))
+			++cp;
+
+		dir = 1;
+		if (cp < end && (*cp == '-' || *cp == '+'))
+		{
+			dir = (*cp == '-') ? -1 : 1;
+			for (++cp; cp < end && isspace( (int)*cp ); ++cp);
+		}
+
+		for (len = (int)(end - cp); len > 0 && isspace( (int)cp[len-1] ); --len);
+
+		if ((col = sort_column( d, cp, len )) == -1)
+		{
+			fprintf( stderr, "dsp_sort: No column %.*s in result set, rows not sorted\n",
+				len, cp );
+			dsp_sort_close( s );
+			return NULL;
+		}
+
+		/*
+		 * Sorting on a column a second time makes no difference.
+		 */
+		for (j = 0; j < s->s_nkeys && s->s_keys[j].k_col != col; j++);
+
+		if (j == s->s_nkeys)
+		{
+			k = &s->s_keys[s->s_nkeys++];
+
+			k->k_col    = col;
+			k->k_dir    = dir;
+			k->k_type   = d->d_cols[col].c_format.datatype;
+			k->k_native = True;
+			k->k_numlen = 0;
+
+			if (k->k_type == CS_NUMERIC_TYPE || k->k_type == CS_DECIMAL_TYPE)
+				k->k_numlen = dsp_numeric_len( d->d_cols[col].c_format.precision );
+		}
+
+		cp = (*end == ',') ? end + 1 : end;
+	}
+
+	/*
+	 * The keys go first in a row, so that comparing two rows only
+	 * has to look at as much of them as it takes.
+	 */
+	for (i = 0; i < s->s_nkeys; i++)
+		s->s_order[i] = s->s_keys[i].k_col;
+
+	for (col = 0; col < d->d_ncols; col++)
+	{
+		for (j = 0; j < s->s_nkeys && s->s_keys[j].k_col != col; j++);
+
+		if (j == s->s_nkeys)
+			s->s_order[i++] = col;
+	}
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_sort_open: Sorting on %d key(s) in %ld bytes\n",
+		s->s_nkeys, s->s_budget);)
+
+	return s;
+}
+
+/*
+ * dsp_sort_native():
+ *
+ * Returns True if column col must be bound in its native datatype,
+ * rather than as a string, for it to be sorted by its value.
+ */
+int dsp_sort_native( s, col )
+	dsp_sort_t  *s;
+	CS_INT       col;
+{
+	int          i;
+
+	for (i = 0; i < s->s_nkeys; i++)
+	{
+		if (s->s_keys[i].k_col == col)
+		{
+			return (s->s_keys[i].k_type == CS_NUMERIC_TYPE ||
+			        s->s_keys[i].k_type == CS_DECIMAL_TYPE);
+		}
+	}
+
+	return False;
+}
+
+/*
+ * dsp_sort_next():
+ *
+ * Puts the next row in sort order into the first row of the block
+ * bound for d, reading the whole result set the first time around.
+ * left is the number of rows that will be displayed, -1 for all of
+ * them.  Returns CS_SUCCEED, CS_END_DATA, or the failing return
+ * code of ct_fetch().
+ */
+CS_INT dsp_sort_next( cmd, d, left )
+	CS_COMMAND  *cmd;
+	dsp_desc_t  *d;
+	CS_INT       left;
+{
+	dsp_sort_t  *s = d->d_sort;
+	CS_RETCODE   r;
+	char        *row;
+
+	if (!s->s_loaded)
+	{
+		s->s_loaded = True;
+
+		if ((r = sort_load( cmd, d, s, left )) != CS_SUCCEED)
+			return r;
+	}
+
+	if (s->s_nruns == 0)
+	{
+		if (s->s_next >= s->s_nheld)
+			return CS_END_DATA;
+
+		row = s->s_arena + s->s_offs[s->s_next++];
+	}
+	else
+	{
+		switch (sort_merge_next( s, &row ))
+		{
+			case 0:
+				return CS_END_DATA;
+			case -1:
+				return CS_FAIL;
+			default:
+				break;
+		}
+	}
+
+	sort_fill( d, s, row );
+	++s->s_nout;
+
+	d->d_nrows = 1;
+	d->d_row   = 0;
+
+	return CS_SUCCEED;
+}
+
+/*
+ * dsp_sort_left():
+ *
+ * The number of rows read that have not been handed back, or -1 if
+ * the result set hasn't been read yet.
+ */
+long dsp_sort_left( s )
+	dsp_sort_t  *s;
+{
+	if (!s->s_loaded)
+		return -1;
+
+	return s->s_nread - s->s_nout;
+}
+
+/*
+ * dsp_sort_close():
+ *
+ * Throws away the sort and whatever rows it still holds.
+ */
+void dsp_sort_close( s )
+	dsp_sort_t  *s;
+{
+	if (s == NULL)
+		return;
+
+	sort_release( s );
+
+	if (s->s_keys != NULL)
+		free( s->s_keys );
+	if (s->s_order != NULL)
+		free( s->s_order );
+
+	free( s );
+}
+
+/*
+ * dsp_numeric_len():
+ *
+ * The number of bytes the digits of a NUMERIC or DECIMAL of the given
+ * precision take up in the array of a CS_NUMERIC, after the sign.
+ */
+int dsp_numeric_len( precision )
+	CS_INT       precision;
+{
+	double       lim;
+	double       v;
+	int          len;
+	int          i;
+
+	if (precision <= 0)
+		return CS_MAX_NUMLEN - 1;
+
+	for (i = 0, lim = 1.0; i < precision; i++)
+		lim *= 10.0;
+	for (len = 1, v = 256.0; v < lim; v *= 256.0)
+		++len;
+
+	return min( len, CS_MAX_NUMLEN - 1 );
+}
+
+/*
+ * dsp_native_cmp():
+ *
+ * Compares two non-NULL values of datatype type, as bound natively,
+ * returning less than, equal to or greater than 0 as a sorts ahead
+ * of, with or after b.  numlen is the number of bytes of digits of
+ * a NUMERIC or DECIMAL (see dsp_sort_open()).  Datatypes that have
+ * no order of their own are compared byte by byte.
+ */
+int dsp_native_cmp( type, numlen, a, la, b, lb )
+	CS_INT       type;
+	int          numlen;
+	CS_VOID     *a;
+	CS_INT       la;
+	CS_VOID     *b;
+	CS_INT       lb;
+{
+	union {
+		CS_TINYINT   ti;
+		CS_SMALLINT  si;
+		CS_INT       i;
+		CS_REAL      r;
+		CS_FLOAT     f;
+		CS_MONEY     m;
+		CS_MONEY4    m4;
+		CS_DATETIME  dt;
+		CS_DATETIME4 dt4;
+		CS_NUMERIC   n;
+#if defined(CS_BIGINT_TYPE) && defined(CS_UBIGINT_TYPE)
+		CS_BIGINT    bi;
+		CS_UBIGINT   ubi;
+#endif
+#if defined(CS_USMALLINT_TYPE) && defined(CS_UINT_TYPE)
+		CS_USMALLINT usi;
+		CS_UINT      ui;
+#endif
+	} x, y;
+	int          neg;
+	int          c;
+
+	/*
+	 * Values have to be as long as each other to be compared as
+	 * numbers.
+	 */
+	if (la != lb)
+		return sort_bytes_cmp( (char*)a, la, (char*)b, lb );
+
+	switch (type)
+	{
+		case CS_TINYINT_TYPE:
+		case CS_BIT_TYPE:
+			memcpy( (void*)&x.ti, (void*)a, sizeof(CS_TINYINT) );
+			memcpy( (void*)&y.ti, (void*)b, sizeof(CS_TINYINT) );
+			return SORT_CMP( x.ti, y.ti );
+
+		case CS_SMALLINT_TYPE:
+			memcpy( (void*)&x.si, (void*)a, sizeof(CS_SMALLINT) );
+			memcpy( (void*)&y.si, (void*)b, sizeof(CS_SMALLINT) );
+			return SORT_CMP( x.si, y.si );
+
+		case CS_INT_TYPE:
+#if defined(CS_DATE_TYPE)
+		case CS_DATE_TYPE:
+#endif
+#if defined(CS_TIME_TYPE)
+		case CS_TIME_TYPE:
+#endif
+			memcpy( (void*)&x.i, (void*)a, sizeof(CS_INT) );
+			memcpy( (void*)&y.i, (void*)b, sizeof(CS_INT) );
+			return SORT_CMP( x.i, y.i );
+
+#if defined(CS_BIGINT_TYPE) && defined(CS_UBIGINT_TYPE)
+		case CS_BIGINT_TYPE:
+			memcpy( (void*)&x.bi, (void*)a, sizeof(CS_BIGINT) );
+			memcpy( (void*)&y.bi, (void*)b, sizeof(CS_BIGINT) );
+			return SORT_CMP( x.bi, y.bi );
+
+		case CS_UBIGINT_TYPE:
+#if defined(CS_BIGDATETIME_TYPE)
+		case CS_BIGDATETIME_TYPE:
+#endif
+#if defined(CS_BIGTIME_TYPE)
+		case CS_BIGTIME_TYPE:
+#endif
+			memcpy( (void*)&x.ubi, (void*)a, sizeof(CS_UBIGINT) );
+			memcpy( (void*)&y.ubi, (void*)b, sizeof(CS_UBIGINT) );
+			return SORT_CMP( x.ubi, y.ubi );
+#endif
+
+#if defined(CS_USMALLINT_TYPE) && defined(CS_UINT_TYPE)
+		case CS_USMALLINT_TYPE:
+			memcpy( (void*)&x.usi, (void*)a, sizeof(CS_USMALLINT) );
+			memcpy( (void*)&y.usi, (void*)b, sizeof(CS_USMALLINT) );
+			return SORT_CMP( x.usi, y.usi );
+
+		case CS_UINT_TYPE:
+			memcpy( (void*)&x.ui, (void*)a, sizeof(CS_UINT) );
+			memcpy( (void*)&y.ui, (void*)b, sizeof(CS_UINT) );
+			return SORT_CMP( x.ui, y.ui );
+#endif
+
+		case CS_REAL_TYPE:
+			memcpy( (void*)&x.r, (void*)a, sizeof(CS_REAL) );
+			memcpy( (void*)&y.r, (void*)b, sizeof(CS_REAL) );
+			return SORT_CMP( x.r, y.r );
+
+		case CS_FLOAT_TYPE:
+			memcpy( (void*)&x.f, (void*)a, sizeof(CS_FLOAT) );
+			memcpy( (void*)&y.f, (void*)b, sizeof(CS_FLOAT) );
+			return SORT_CMP( x.f, y.f );
+
+		case CS_MONEY_TYPE:
+			memcpy( (void*)&x.m, (void*)a, sizeof(CS_MONEY) );
+			memcpy( (void*)&y.m, (void*)b, sizeof(CS_MONEY) );
+			if (x.m.mnyhigh != y.m.mnyhigh)
+				return SORT_CMP( x.m.mnyhigh, y.m.mnyhigh );
+			return SORT_CMP( x.m.mnylow, y.m.mnylow );
+
+		case CS_MONEY4_TYPE:
+			memcpy( (void*)&x.m4, (void*)a, sizeof(CS_MONEY4) );
+			memcpy( (void*)&y.m4, (void*)b, sizeof(CS_MONEY4) );
+			return SORT_CMP( x.m4.mny4, y.m4.mny4 );
+
+		case CS_DATETIME_TYPE:
+			memcpy( (void*)&x.dt, (void*)a, sizeof(CS_DATETIME) );
+			memcpy( (void*)&y.dt, (void*)b, sizeof(CS_DATETIME) );
+			if (x.dt.dtdays != y.dt.dtdays)
+				return SORT_CMP( x.dt.dtdays, y.dt.dtdays );
+			return SORT_CMP( x.dt.dttime, y.dt.dttime );
+
+		case CS_DATETIME4_TYPE:
+			memcpy( (void*)&x.dt4, (void*)a, sizeof(CS_DATETIME4) );
+			memcpy( (void*)&y.dt4, (void*)b, sizeof(CS_DATETIME4) );
+			if (x.dt4.days != y.dt4.days)
+				return SORT_CMP( x.dt4.days, y.dt4.days );
+			return SORT_CMP( x.dt4.minutes, y.dt4.minutes );
+
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			/*
+			 * The first byte of the array is the sign, the digits
+			 * follow as a base 256 number, most significant first.
+			 */
+			memset( (void*)&x.n, 0, sizeof(CS_NUMERIC) );
+			memset( (void*)&y.n, 0, sizeof(CS_NUMERIC) );
+			memcpy( (void*)&x.n, (void*)a, min( la, (CS_INT)sizeof(CS_NUMERIC) ) );
+			memcpy( (void*)&y.n, (void*)b, min( lb, (CS_INT)sizeof(CS_NUMERIC) ) );
+
+			neg = (x.n.array[0] != 0);
+			if (neg != (y.n.array[0] != 0))
+				return neg ? -1 : 1;
+
+			c = memcmp( (void*)&x.n.array[1], (void*)&y.n.array[1], numlen );
+			c = SORT_CMP( c, 0 );
+			return neg ? -c : c;
+
+		default:
+			return sort_bytes_cmp( (char*)a, la, (char*)b, lb );
+	}
+}
+
+/*
+ * PRIVATE FUNCTIONS
+ */
+
+/*
+ * sort_column():
+ *
+ * Returns the index of the column called name (or numbered, starting
+ * at 1), or -1 if there is no such column.  A name that doesn't match
+ * exactly may match regardless of case.
+ */
+static CS_INT sort_column( d, name, len )
+	dsp_desc_t  *d;
+	char        *name;
+	int          len;
+{
+	CS_DATAFMT  *fmt;
+	CS_INT       col;
+	int          i;
+
+	if (len <= 0)
+		return -1;
+
+	for (i = 0; i < len && isdigit( (int)name[i] ); i++);
+
+	if (i == len)
+	{
+		col = (CS_INT)atoi( name ) - 1;
+		return (col >= 0 && col < d->d_ncols) ? col : -1;
+	}
+
+	for (col = 0; col < d->d_ncols; col++)
+	{
+		fmt = &d->d_cols[col].c_format;
+		if (fmt->namelen == len && strncmp( fmt->name, name, len ) == 0)
+			return col;
+	}
+
+	for (col = 0; col < d->d_ncols; col++)
+	{
+		fmt = &d->d_cols[col].c_format;
+		if (fmt->namelen != len)
+			continue;
+
+		for (i = 0; i < len &&
+		     tolower( (int)fmt->name[i] ) == tolower( (int)name[i] ); i++);
+
+		if (i == len)
+			return col;
+	}
+
+	return -1;
+}
+
+/*
+ * sort_load():
+ *
+ * Reads the rest of the result set, leaving the rows ready to be
+ * handed back in order.
+ */
+static CS_RETCODE sort_load( cmd, d, s, left )
+	CS_COMMAND  *cmd;
+	dsp_desc_t  *d;
+	dsp_sort_t  *s;
+	CS_INT       left;
+{
+	CS_RETCODE   r;
+	CS_INT       nrows;
+	CS_INT       i;
+	double       start = 0.0;
+	double       now;
+	long         slot;
+
+	for (i = 0; i < s->s_nkeys; i++)
+	{
+		s->s_keys[i].k_native =
+			(d->d_cols[s->s_keys[i].k_col].c_is_native == CS_TRUE);
+	}
+
+	/*
+	 * If only the first left rows will be displayed and the widest
+	 * they could be fits in the budget, they are all that is kept.
+	 */
+	if (left > 0)
+	{
+		slot = sizeof(sort_hdr_t);
+		for (i = 0; i < d->d_ncols; i++)
+		{
+			slot += SORT_FLDHDR + ((d->d_cols[i].c_is_native == CS_TRUE) ?
+				d->d_cols[i].c_native_size : d->d_cols[i].c_data_size);
+		}
+		slot = SORT_ALIGN(slot);
+
+		if (((double)left + 1.0) * (double)(slot + sizeof(long)) <= (double)s->s_budget)
+		{
+			s->s_arena = (char*)malloc( slot * ((long)left + 1) );
+			s->s_offs  = (long*)malloc( sizeof(long) * left );
+
+			if (s->s_arena == NULL || s->s_offs == NULL)
+			{
+				fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+				return CS_FAIL;
+			}
+
+			s->s_slot      = slot;
+			s->s_limit     = left;
+			s->s_spare     = slot * (long)left;
+			s->s_size      = slot * ((long)left + 1);
+			s->s_maxheld   = left;
+		}
+	}
+
+	for (;;)
+	{
+		if (d->d_phase != NULL)
+		{
+			start = dsp_now();
+		}
+
+		r = dsp_fetch( cmd,             /* Command */
+		               CS_UNUSED,       /* Type */
+		               CS_UNUSED,       /* Offset */
+		               CS_UNUSED,       /* Option */
+		               &nrows );
+
+		if (d->d_phase != NULL)
+		{
+			now = dsp_now();
+			d->d_phase->ph_fetch += now - start;
+
+			if (d->d_phase->ph_first < 0.0 && r != CS_END_DATA)
+			{
+				d->d_phase->ph_first = now - g_dsp_stats.s_sent;
+			}
+		}
+
+		if (r == CS_END_DATA)
+			break;
+
+		/*
+		 * As in dsp_desc_next(), a CS_ROW_FAIL is not the end of the
+		 * result set.
+		 */
+		if (r != CS_SUCCEED && r != CS_ROW_FAIL)
+			return r;
+
+		if (nrows < 1)
+			nrows = 1;
+
+		for (i = 0; i < nrows; i++)
+		{
+			if (sort_add( d, s, i ) == -1)
+				return CS_FAIL;
+		}
+
+		if (g_dsp_meter != NULL &&
+		    (g_dsp_meter->m_nrows += nrows) >= g_dsp_meter->m_check)
+		{
+			dsp_meter_tick( g_dsp_meter );
+		}
+	}
+
+	if (sort_finish( s ) == -1)
+		return CS_FAIL;
+
+	DBG(sqsh_debug(DEBUG_DISPLAY,
+		"sort_load: %ld row(s) read, %ld held, %d run(s)\n",
+		s->s_nread, s->s_nheld, s->s_nruns);)
+
+	return CS_SUCCEED;
+}
+
+/*
+ * sort_add():
+ *
+ * Adds row r of the block just fetched to the sort.
+ */
+static int sort_add( d, s, r )
+	dsp_desc_t  *d;
+	dsp_sort_t  *s;
+	CS_INT       r;
+{
+	char        *arena;
+	long        *offs;
+	long         len;
+	long         need;
+	long         size;
+	long         off;
+	CS_INT       i;
+
+	len = sizeof(sort_hdr_t);
+	for (i = 0; i < d->d_ncols; i++)
+		len += SORT_FLDHDR + sort_datalen( &d->d_cols[i], r );
+
+	/*
+	 * Top N: the row is read into the spare slot.  While the heap
+	 * isn't full it simply goes in, otherwise it takes the place of
+	 * the last row in the heap if it sorts ahead of it.
+	 */
+	if (s->s_slot > 0)
+	{
+		sort_copy( d, s, r, s->s_arena + s->s_spare, len );
+
+		if (s->s_nheld < s->s_limit)
+		{
+			s->s_offs[s->s_nheld] = s->s_spare;
+			sort_heap_up( s, s->s_nheld++ );
+			s->s_spare = s->s_slot * s->s_nheld;
+		}
+		else if (sort_cmp( s, s->s_arena + s->s_spare,
+		                   s->s_arena + s->s_offs[0] ) < 0)
+		{
+			off           = s->s_offs[0];
+			s->s_offs[0]  = s->s_spare;
+			s->s_spare    = off;
+			sort_heap_down( s, 0 );
+		}
+
+		return 0;
+	}
+
+	need = SORT_ALIGN(len);
+
+	/*
+	 * When the rows held reach the budget they are written out as a
+	 * run.
+	 */
+	if (s->s_nheld > 0 &&
+	    s->s_used + need + (s->s_nheld + 1) * (long)sizeof(long) > s->s_budget &&
+	    sort_spill( s ) == -1)
+	{
+		return -1;
+	}
+
+	if (s->s_used + need > s->s_size)
+	{
+		for (size = max( s->s_size * 2, SORT_MINARENA ); size < s->s_used + need; size *= 2);
+
+		if (size > s->s_budget && s->s_used + need <= s->s_budget)
+			size = s->s_budget;
+
+		if ((arena = (char*)realloc( s->s_arena, size )) == NULL)
+		{
+			fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+			return -1;
+		}
+
+		s->s_arena = arena;
+		s->s_size  = size;
+	}
+
+	if (s->s_nheld == s->s_maxheld)
+	{
+		size = max( s->s_maxheld * 2, 1024 );
+
+		if ((offs = (long*)realloc( (void*)s->s_offs, sizeof(long) * size )) == NULL)
+		{
+			fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+			return -1;
+		}
+
+		s->s_offs    = offs;
+		s->s_maxheld = size;
+	}
+
+	sort_copy( d, s, r, s->s_arena + s->s_used, len );
+	s->s_offs[s->s_nheld++] = s->s_used;
+	s->s_used += need;
+
+	return 0;
+}
+
+/*
+ * sort_datalen():
+ *
+ * The number of bytes bound for row r of column c.  A string keeps
+ * its null terminator.
+ */
+static CS_INT sort_datalen( c, r )
+	dsp_col_t   *c;
+	CS_INT       r;
+{
+	CS_INT       len;
+
+	if (c->c_nullinds[r] != 0)
+		return 0;
+
+	if (c->c_is_native == CS_TRUE)
+		len = c->c_native_lens[r];
+	else
+		len = (CS_INT)strlen( c->c_data_blk + r * c->c_data_size ) + 1;
+
+	if (len < 0)
+		len = 0;
+	else if (c->c_is_native == CS_TRUE && len > c->c_native_size)
+		len = c->c_native_size;
+	else if (c->c_is_native != CS_TRUE && len > c->c_data_size)
+		len = c->c_data_size;
+
+	return len;
+}
+
+/*
+ * sort_copy():
+ *
+ * Copies row r of the block just fetched, len bytes once copied, to
+ * dst.
+ */
+static void sort_copy( d, s, r, dst, len )
+	dsp_desc_t  *d;
+	dsp_sort_t  *s;
+	CS_INT       r;
+	char        *dst;
+	long         len;
+{
+	sort_hdr_t  *h = (sort_hdr_t*)dst;
+	dsp_col_t   *c;
+	CS_SMALLINT  ind;
+	CS_INT       n;
+	CS_INT       i;
+	char        *data;
+
+	h->h_len = len;
+	h->h_seq = s->s_nread++;
+	dst += sizeof(sort_hdr_t);
+
+	for (i = 0; i < s->s_ncols; i++)
+	{
+		c   = &d->d_cols[s->s_order[i]];
+		ind = c->c_nullinds[r];
+		n   = sort_datalen( c, r );
+
+		if (c->c_is_native == CS_TRUE)
+			data = (char*)c->c_native_blk + r * c->c_native_size;
+		else
+			data = c->c_data_blk + r * c->c_data_size;
+
+		memcpy( (void*)dst, (void*)&ind, sizeof(CS_SMALLINT) );
+		memcpy( (void*)(dst + sizeof(CS_SMALLINT)), (void*)&n, sizeof(CS_INT) );
+		dst += SORT_FLDHDR;
+
+		if (n > 0)
+			memcpy( (void*)dst, (void*)data, n );
+		dst += n;
+	}
+}
+
+/*
+ * sort_fill():
+ *
+ * Puts row back into the first row of the block bound for d, as
+ * though it had just been fetched.
+ */
+static void sort_fill( d, s, row )
+	dsp_desc_t  *d;
+	dsp_sort_t  *s;
+	char        *row;
+{
+	dsp_col_t   *c;
+	CS_SMALLINT  ind;
+	CS_INT       n;
+	CS_INT       i;
+	char        *p = row + sizeof(sort_hdr_t);
+
+	for (i = 0; i < s->s_ncols; i++)
+	{
+		c = &d->d_cols[s->s_order[i]];
+
+		memcpy( (void*)&ind, (void*)p, sizeof(CS_SMALLINT) );
+		memcpy( (void*)&n, (void*)(p + sizeof(CS_SMALLINT)), sizeof(CS_INT) );
+		p += SORT_FLDHDR;
+
+		c->c_nullinds[0] = ind;
+
+		if (c->c_is_native == CS_TRUE)
+		{
+			if (n > 0)
+				memcpy( c->c_native_blk, (void*)p, n );
+			c->c_native_lens[0] = n;
+		}
+		else
+		{
+			if (n > 0)
+				memcpy( (void*)c->c_data_blk, (void*)p, n );
+			else
+				c->c_data_blk[0] = '\0';
+		}
+
+		p += n;
+	}
+}
+
+/*
+ * sort_cmp():
+ *
+ * Compares rows a and b by their keys, NULL ahead of any value, and
+ * then by the order they came back in.
+ */
+static int sort_cmp( s, a, b )
+	dsp_sort_t  *s;
+	char        *a;
+	char        *b;
+{
+	sort_key_t  *k;
+	CS_SMALLINT  ia, ib;
+	CS_INT       la, lb;
+	char        *pa = a + sizeof(sort_hdr_t);
+	char        *pb = b + sizeof(sort_hdr_t);
+	int          c;
+	int          i;
+
+	for (i = 0; i < s->s_nkeys; i++)
+	{
+		k = &s->s_keys[i];
+
+		memcpy( (void*)&ia, (void*)pa, sizeof(CS_SMALLINT) );
+		memcpy( (void*)&la, (void*)(pa + sizeof(CS_SMALLINT)), sizeof(CS_INT) );
+		memcpy( (void*)&ib, (void*)pb, sizeof(CS_SMALLINT) );
+		memcpy( (void*)&lb, (void*)(pb + sizeof(CS_SMALLINT)), sizeof(CS_INT) );
+		pa += SORT_FLDHDR;
+		pb += SORT_FLDHDR;
+
+		if (ia != 0 || ib != 0)
+			c = (ia != 0) ? ((ib != 0) ? 0 : -1) : 1;
+		else
+			c = sort_value_cmp( k, pa, la, pb, lb );
+
+		if (c != 0)
+			return c * k->k_dir;
+
+		pa += la;
+		pb += lb;
+	}
+
+	return SORT_CMP( ((sort_hdr_t*)a)->h_seq, ((sort_hdr_t*)b)->h_seq );
+}
+
+static int sort_qcmp( a, b )
+	const void  *a;
+	const void  *b;
+{
+	return sort_cmp( sg_sort, sg_sort->s_arena + *((const long*)a),
+	                 sg_sort->s_arena + *((const long*)b) );
+}
+
+/*
+ * sort_value_cmp():
+ *
+ * Compares two non-NULL values of key k.
+ */
+static int sort_value_cmp( k, a, la, b, lb )
+	sort_key_t  *k;
+	char        *a;
+	CS_INT       la;
+	char        *b;
+	CS_INT       lb;
+{
+	if (!k->k_native)
+		return sort_bytes_cmp( a, la, b, lb );
+
+	return dsp_native_cmp( k->k_type, k->k_numlen, (CS_VOID*)a, la, (CS_VOID*)b, lb );
+}
+
+static int sort_bytes_cmp( a, la, b, lb )
+	char        *a;
+	CS_INT       la;
+	char        *b;
+	CS_INT       lb;
+{
+	int          c;
+
+	if ((c = memcmp( (void*)a, (void*)b, min( la, lb ) )) != 0)
+		return SORT_CMP( c, 0 );
+
+	return SORT_CMP( la, lb );
+}
+
+/*
+ * sort_heap_up(), sort_heap_down():
+ *
+ * Keep the top N rows in s_offs a heap, with the row that sorts last
+ * on top.
+ */
+static void sort_heap_up( s, i )
+	dsp_sort_t  *s;
+	long         i;
+{
+	long         parent;
+	long         off;
+
+	while (i > 0)
+	{
+		parent = (i - 1) / 2;
+
+		if (sort_cmp( s, s->s_arena + s->s_offs[i],
+		              s->s_arena + s->s_offs[parent] ) <= 0)
+			break;
+
+		off              = s->s_offs[i];
+		s->s_offs[i]      = s->s_offs[parent];
+		s->s_offs[parent] = off;
+		i = parent;
+	}
+}
+
+static void sort_heap_down( s, i )
+	dsp_sort_t  *s;
+	long         i;
+{
+	long         child;
+	long         off;
+
+	for (;;)
+	{
+		child = 2 * i + 1;
+
+		if (child >= s->s_nheld)
+			break;
+
+		if (child + 1 < s->s_nheld &&
+		    sort_cmp( s, s->s_arena + s->s_offs[child + 1],
+		              s->s_arena + s->s_offs[child] ) > 0)
+			++child;
+
+		if (sort_cmp( s, s->s_arena + s->s_offs[child],
+		              s->s_arena + s->s_offs[i] ) <= 0)
+			break;
+
+		off             = s->s_offs[i];
+		s->s_offs[i]     = s->s_offs[child];
+		s->s_offs[child] = off;
+		i = child;
+	}
+}
+
+/*
+ * sort_spill():
+ *
+ * Sorts the rows held and writes them out as a new run.
+ */
+static int sort_spill( s )
+	dsp_sort_t  *s;
+{
+	sort_run_t  *runs;
+	FILE        *f;
+	long         i;
+	char        *row;
+
+	if (s->s_nruns == s->s_maxruns)
+	{
+		runs = (sort_run_t*)realloc( (void*)s->s_runs,
+			sizeof(sort_run_t) * (s->s_maxruns + 16) );
+
+		if (runs == NULL)
+		{
+			fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+			return -1;
+		}
+
+		s->s_runs     = runs;
+		s->s_maxruns += 16;
+	}
+
+	if ((f = dsp_tmpfile( "sort" )) == NULL)
+		return -1;
+
+	sg_sort = s;
+	qsort( (void*)s->s_offs, (size_t)s->s_nheld, sizeof(long), sort_qcmp );
+
+	for (i = 0; i < s->s_nheld; i++)
+	{
+		row = s->s_arena + s->s_offs[i];
+
+		if (fwrite( (void*)row, ((sort_hdr_t*)row)->h_len, 1, f ) != 1)
+			break;
+	}
+
+	if (i < s->s_nheld || fflush( f ) != 0)
+	{
+		fprintf( stderr, "dsp_sort: Unable to write run: %s\n", strerror( errno ) );
+		fclose( f );
+		return -1;
+	}
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "sort_spill: Run #%d, %ld row(s), %ld bytes\n",
+		s->s_nruns + 1, s->s_nheld, s->s_used);)
+
+	s->s_runs[s->s_nruns].r_file = f;
+	s->s_runs[s->s_nruns].r_row  = NULL;
+	s->s_runs[s->s_nruns].r_size = 0;
+	s->s_runs[s->s_nruns].r_eof  = False;
+	++s->s_nruns;
+
+	s->s_nheld = 0;
+	s->s_used  = 0;
+
+	return 0;
+}
+
+/*
+ * sort_finish():
+ *
+ * Called once every row has been added.  The rows held are sorted,
+ * or if runs had to be written, they are written out too and the
+ * runs are merged down to the last SORT_MAXMERGE of them.
+ */
+static int sort_finish( s )
+	dsp_sort_t  *s;
+{
+	sort_run_t   run;
+	FILE        *f;
+	char        *row;
+	int          i;
+	int          r;
+
+	if (s->s_nruns == 0)
+	{
+		sg_sort = s;
+		qsort( (void*)s->s_offs, (size_t)s->s_nheld, sizeof(long), sort_qcmp );
+		s->s_next = 0;
+		return 0;
+	}
+
+	if (s->s_nheld > 0 && sort_spill( s ) == -1)
+		return -1;
+
+	/*
+	 * The memory held for the rows isn't needed any more.
+	 */
+	free( s->s_arena );
+	free( s->s_offs );
+	s->s_arena   = NULL;
+	s->s_offs    = NULL;
+	s->s_size    = 0;
+	s->s_maxheld = 0;
+
+	if ((s->s_heap = (int*)malloc( sizeof(int) * SORT_MAXMERGE )) == NULL)
+	{
+		fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+		return -1;
+	}
+
+	while (s->s_nruns > SORT_MAXMERGE)
+	{
+		if (g_dsp_interrupted)
+			return -1;
+
+		if ((f = dsp_tmpfile( "sort" )) == NULL ||
+		    sort_merge_start( s, SORT_MAXMERGE ) == -1)
+		{
+			if (f != NULL)
+				fclose( f );
+			return -1;
+		}
+
+		while ((r = sort_merge_next( s, &row )) == 1)
+		{
+			if (fwrite( (void*)row, ((sort_hdr_t*)row)->h_len, 1, f ) != 1)
+			{
+				r = -1;
+				break;
+			}
+		}
+
+		if (r == -1 || fflush( f ) != 0)
+		{
+			fprintf( stderr, "dsp_sort: Unable to write run: %s\n", strerror( errno ) );
+			fclose( f );
+			return -1;
+		}
+
+		/*
+		 * The merged runs are replaced by the one they were merged
+		 * into.
+		 */
+		for (i = 0; i < SORT_MAXMERGE; i++)
+		{
+			fclose( s->s_runs[i].r_file );
+			if (s->s_runs[i].r_row != NULL)
+				free( s->s_runs[i].r_row );
+		}
+
+		run.r_file = f;
+		run.r_row  = NULL;
+		run.r_size = 0;
+		run.r_eof  = False;
+
+		s->s_runs[0] = run;
+		memmove( (void*)&s->s_runs[1], (void*)&s->s_runs[SORT_MAXMERGE],
+			sizeof(sort_run_t) * (s->s_nruns - SORT_MAXMERGE) );
+		s->s_nruns -= SORT_MAXMERGE - 1;
+
+		DBG(sqsh_debug(DEBUG_DISPLAY, "sort_finish: Merged %d runs, %d left\n",
+			SORT_MAXMERGE, s->s_nruns);)
+	}
+
+	return sort_merge_start( s, s->s_nruns );
+}
+
+/*
+ * sort_run_read():
+ *
+ * Reads the next row of run into r_row, returning 0, or -1 if it
+ * couldn't be read.  r_eof is set once there are no more.
+ */
+static int sort_run_read( run )
+	sort_run_t  *run;
+{
+	sort_hdr_t   h;
+	char        *row;
+
+	if (fread( (void*)&h, sizeof(sort_hdr_t), 1, run->r_file ) != 1)
+	{
+		if (ferror( run->r_file ))
+			goto sort_run_read_fail;
+
+		run->r_eof = True;
+		return 0;
+	}
+
+	if (h.h_len < (long)sizeof(sort_hdr_t))
+	{
+		errno = EINVAL;
+		goto sort_run_read_fail;
+	}
+
+	if (h.h_len > run->r_size)
+	{
+		if ((row = (char*)realloc( run->r_row, h.h_len )) == NULL)
+		{
+			fprintf( stderr, "dsp_sort: Memory allocation failure\n" );
+			return -1;
+		}
+
+		run->r_row  = row;
+		run->r_size = h.h_len;
+	}
+
+	memcpy( (void*)run->r_row, (void*)&h, sizeof(sort_hdr_t) );
+
+	if (h.h_len > (long)sizeof(sort_hdr_t) &&
+	    fread( (void*)(run->r_row + sizeof(sort_hdr_t)),
+	           h.h_len - sizeof(sort_hdr_t), 1, run->r_file ) != 1)
+	{
+		goto sort_run_read_fail;
+	}
+
+	return 0;
+
+sort_run_read_fail:
+	fprintf( stderr, "dsp_sort: Unable to read run: %s\n",
+		ferror( run->r_file ) ? strerror( errno ) : "Unexpected end of file" );
+	return -1;
+}
+
+/*
+ * sort_merge_start():
+ *
+ * Starts merging the first n runs, reading the first row of each.
+ */
+static int sort_merge_start( s, n )
+	dsp_sort_t  *s;
+	int          n;
+{
+	int          i;
+
+	s->s_nheap = 0;
+	s->s_moved = False;
+
+	for (i = 0; i < n; i++)
+	{
+		s->s_runs[i].r_eof = False;
+
+		if (fseek( s->s_runs[i].r_file, 0L, SEEK_SET ) == -1)
+		{
+			fprintf( stderr, "dsp_sort: Unable to read run: %s\n", strerror( errno ) );
+			return -1;
+		}
+
+		if (sort_run_read( &s->s_runs[i] ) == -1)
+			return -1;
+
+		if (!s->s_runs[i].r_eof)
+			s->s_heap[s->s_nheap++] = i;
+	}
+
+	for (i = s->s_nheap / 2 - 1; i >= 0; i--)
+		sort_merge_down( s, i );
+
+	return 0;
+}
+
+/*
+ * sort_merge_next():
+ *
+ * Points row at the next row of the runs being merged, returning 1,
+ * or 0 once they are used up, or -1 if a run couldn't be read.  The
+ * run the previous row came from is only moved on now, so that the
+ * row stays put while it is being handed back.
+ */
+static int sort_merge_next( s, row )
+	dsp_sort_t  *s;
+	char       **row;
+{
+	sort_run_t  *run;
+
+	if (s->s_moved && s->s_nheap > 0)
+	{
+		run = &s->s_runs[s->s_heap[0]];
+
+		if (sort_run_read( run ) == -1)
+			return -1;
+
+		if (run->r_eof)
+			s->s_heap[0] = s->s_heap[--s->s_nheap];
+
+		sort_merge_down( s, 0 );
+	}
+
+	s->s_moved = False;
+
+	if (s->s_nheap == 0)
+		return 0;
+
+	*row       = s->s_runs[s->s_heap[0]].r_row;
+	s->s_moved = True;
+
+	return 1;
+}
+
+/*
+ * sort_merge_down():
+ *
+ * Keeps s_heap a heap with the run whose current row sorts first on
+ * top.
+ */
+static void sort_merge_down( s, i )
+	dsp_sort_t  *s;
+	int          i;
+{
+	int          child;
+	int          run;
+
+	for (;;)
+	{
+		child = 2 * i + 1;
+
+		if (child >= s->s_nheap)
+			break;
+
+		if (child + 1 < s->s_nheap &&
+		    sort_cmp( s, s->s_runs[s->s_heap[child + 1]].r_row,
+		              s->s_runs[s->s_heap[child]].r_row ) < 0)
+			++child;
+
+		if (sort_cmp( s, s->s_runs[s->s_heap[child]].r_row,
+		              s->s_runs[s->s_heap[i]].r_row ) >= 0)
+			break;
+
+		run              = s->s_heap[i];
+		s->s_heap[i]     = s->s_heap[child];
+		s->s_heap[child] = run;
+		i = child;
+	}
+}
+
+/*
+ * sort_release():
+ *
+ * Frees the rows held and closes the runs.
+ */
+static void sort_release( s )
+	dsp_sort_t  *s;
+{
+	int          i;
+
+	for (i = 0; i < s->s_nruns; i++)
+	{
+		fclose( s->s_runs[i].r_file );
+		if (s->s_runs[i].r_row != NULL)
+			free( s->s_runs[i].r_row );
+	}
+
+	if (s->s_runs != NULL)
+		free( s->s_runs );
+	if (s->s_heap != NULL)
+		free( s->s_heap );
+	if (s->s_arena != NULL)
+		free( s->s_arena );
+	if (s->s_offs != NULL)
+		free( s->s_offs );
+
+	s->s_runs   = NULL;
+	s->s_heap   = NULL;
+	s->s_arena  = NULL;
+	s->s_offs   = NULL;
+	s->s_nruns  = 0;
+	s->s_nheld  = 0;
+}
@@ -0,0 +1,1479 @@
+/*
+ * dsp_spool.c - Spooling of result sets for \redisplay
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#include <stdio.h>
+#include <sys/stat.h>
+#include "sqsh_config.h"
+#include "sqsh_error.h"
+#include "sqsh_global.h"
+#include "sqsh_debug.h"
+#include "sqsh_env.h"
+#include "sqsh_expand.h"
+#include "sqsh_varbuf.h"
+#include "dsp.h"
+
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: dsp_spool.c,v 1.1 2026/10/18 00:00:00 sqsh Exp $";
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * sqsh-3.0: The spool is a file of records, each an CS_INT kind and
+ * an CS_INT length followed by that many bytes:
+ *
+ *   SPOOL_RESULT  CS_INT result type, CS_INT CS_ROW_COUNT (or CS_NO_COUNT)
+ *   SPOOL_DESC    CS_INT columns, CS_INT by-list length, the by-list,
+ *                 then a CS_DATAFMT, operator and column id per column
+ *   SPOOL_BIND    CS_INT item, CS_DATAFMT the item was bound with
+ *   SPOOL_ROW     CS_INT items, then per item a CS_INT item number,
+ *                 CS_SMALLINT indicator, CS_INT length and the data
+ *
+ * The rows are kept the way the display style had them bound (native
+ * or already converted to a string), so replaying them in the same
+ * style costs nothing more than a memcpy().  The file never outlives
+ * the process that wrote it, so everything is in native byte order.
+ */
+#define SPOOL_MAGIC     "SQSHSPL1"
+#define SPOOL_MAGICLEN  8
+
+#define SPOOL_RESULT    1
+#define SPOOL_DESC      2
+#define SPOOL_BIND      3
+#define SPOOL_ROW       4
+
+#define SPOOL_IDLE      0   /* Neither being written nor read */
+#define SPOOL_WRITING   1   /* dsp_cmd() is spooling a batch */
+#define SPOOL_READING   2   /* dsp_redisplay() is replaying it */
+
+/*
+ * dsp_bound_t: An item bound by the display style with dsp_bind().
+ */
+typedef struct dsp_bound_st {
+	CS_INT       b_item;
+	CS_DATAFMT   b_fmt;
+	CS_VOID     *b_buf;
+	CS_INT      *b_copied;
+	CS_SMALLINT *b_ind;
+} dsp_bound_t;
+
+typedef struct dsp_spool_st {
+	int          s_mode;        /* SPOOL_IDLE, SPOOL_WRITING or SPOOL_READING */
+	FILE        *s_file;        /* The spool, already unlink()'ed */
+	int          s_pid;         /* Process that created s_file */
+	int          s_valid;       /* Holds a complete batch? */
+	int          s_failed;      /* Gave up writing the current batch */
+	CS_INT       s_type;        /* Type of the current result set */
+
+	/*-- Writing --*/
+	char        *s_rec;         /* Record being put together */
+	int          s_reclen;
+	int          s_recmax;
+	CS_INT       s_status;      /* Return status fetched by dsp_fetch() */
+	CS_INT       s_statuslen;
+
+	/*-- Reading --*/
+	char        *s_map;         /* Contents of the spool */
+	long         s_len;
+	int          s_mapped;      /* s_map came from mmap() */
+	long         s_pos;         /* Offset of the next record */
+	char        *s_row;         /* Payload of the current SPOOL_ROW */
+	CS_INT       s_rowlen;
+	CS_INT       s_count;       /* CS_ROW_COUNT of the current result */
+	CS_INT       s_ncols;       /* From SPOOL_DESC */
+	CS_INT       s_nbylist;
+	CS_SMALLINT *s_bylist;
+	CS_DATAFMT  *s_fmts;
+	CS_INT      *s_ops;
+	CS_INT      *s_colids;
+	CS_DATAFMT  *s_sfmts;       /* From SPOOL_BIND, per column */
+	int         *s_sbound;
+	int          s_nset;        /* Regular result set wanted, 0 = all */
+	int          s_set;         /* Regular result sets passed so far */
+	int          s_done;        /* No more results to hand out */
+	int          s_cancelled;   /* Rest of current result set cancelled */
+
+	/*-- Both --*/
+	dsp_bound_t *s_binds;
+	int          s_nbinds;
+	int          s_maxbinds;
+} dsp_spool_t;
+
+/*
+ * g_dsp_spool: The spool while it is being written or read, see dsp.h.
+ */
+dsp_spool_t *g_dsp_spool = NULL;
+
+/*
+ * sg_spool: There is only the one spool, holding the most recent
+ * batch displayed with $spool set.
+ */
+static dsp_spool_t sg_spool;
+
+/*-- Prototypes --*/
+static int         spool_add        _ANSI_ARGS(( dsp_spool_t*, CS_VOID*, CS_INT ));
+static int         spool_put        _ANSI_ARGS(( dsp_spool_t*, CS_INT ));
+static void        spool_fail       _ANSI_ARGS(( dsp_spool_t*, char* ));
+static void        spool_result     _ANSI_ARGS(( dsp_spool_t*, CS_COMMAND*, CS_INT ));
+static void        spool_row        _ANSI_ARGS(( dsp_spool_t*, CS_INT ));
+static dsp_bound_t* spool_bound     _ANSI_ARGS(( dsp_spool_t*, CS_INT ));
+static int         spool_map        _ANSI_ARGS(( dsp_spool_t* ));
+static void        spool_unmap      _ANSI_ARGS(( dsp_spool_t* ));
+static int         spool_peek       _ANSI_ARGS(( dsp_spool_t*, CS_INT*, char**, CS_INT* ));
+static CS_RETCODE  spool_results    _ANSI_ARGS(( dsp_spool_t*, CS_INT* ));
+static int         spool_desc       _ANSI_ARGS(( dsp_spool_t*, char*, CS_INT ));
+static CS_RETCODE  spool_fetch      _ANSI_ARGS(( dsp_spool_t*, CS_INT* ));
+static void        spool_fill       _ANSI_ARGS(( dsp_spool_t*, dsp_bound_t*, CS_INT ));
+static char*       spool_item       _ANSI_ARGS(( dsp_spool_t*, CS_INT, CS_SMALLINT*, CS_INT* ));
+static void        spool_forget     _ANSI_ARGS(( dsp_spool_t* ));
+
+/*
+ * dsp_spool_begin():
+ *
+ * Called by dsp_cmd() before it sends a batch, when $spool is set.
+ * Empties the spool (creating it the first time around) and returns
+ * it, ready to be pointed to by g_dsp_spool.  If the spool cannot be
+ * written a warning is displayed and NULL returned; the batch is
+ * still displayed, it just can't be redisplayed.
+ */
+dsp_spool_t* dsp_spool_begin()
+{
+	dsp_spool_t  *s = &sg_spool;
+
+	/*
+	 * A background job or a \go -c session inherits the spool of its
+	 * parent from sqsh_fork(), and must not empty it from underneath
+	 * it, so it gets one of its own.
+	 */
+	if (s->s_file != NULL && s->s_pid != (int)getpid())
+	{
+		fclose( s->s_file );
+		s->s_file = NULL;
+	}
+
+	s->s_valid  = False;
+	s->s_failed = False;
+
+	if (s->s_file == NULL)
+	{
+		if ((s->s_file = dsp_tmpfile( "spool" )) == NULL)
+		{
+			return NULL;
+		}
+		s->s_pid = (int)getpid();
+	}
+	else
+	{
+		rewind( s->s_file );
+
+		if (ftruncate( fileno( s->s_file ), (off_t)0 ) == -1)
+		{
+			fprintf( stderr, "dsp_spool: Unable to empty spool: %s\n",
+				strerror( errno ) );
+			return NULL;
+		}
+	}
+
+	/*
+	 * The header is pushed out straight away so that nothing is left
+	 * in the buffer for the child forked by dsp_x() to write out a
+	 * second time when it exit()'s.
+	 */
+	if (fwrite( SPOOL_MAGIC, SPOOL_MAGICLEN, 1, s->s_file ) != 1 ||
+	    fflush( s->s_file ) != 0)
+	{
+		fprintf( stderr, "dsp_spool: Unable to write spool: %s\n",
+			strerror( errno ) );
+		return NULL;
+	}
+
+	s->s_mode   = SPOOL_WRITING;
+	s->s_type   = 0;
+	s->s_nbinds = 0;
+
+	return s;
+}
+
+/*
+ * dsp_spool_end():
+ *
+ * Called by dsp_cmd() once the batch has been displayed.  Whatever
+ * made it into the spool can be redisplayed, even if the batch was
+ * interrupted part of the way through.
+ */
+void dsp_spool_end( s )
+	dsp_spool_t *s;
+{
+	if (fflush( s->s_file ) != 0 && !s->s_failed)
+	{
+		spool_fail( s, strerror( errno ) );
+	}
+
+	s->s_valid  = !s->s_failed;
+	s->s_mode   = SPOOL_IDLE;
+	s->s_nbinds = 0;
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_spool_end: Spooled %ld bytes\n",
+		ftell( s->s_file ));)
+}
+
+/*
+ * dsp_spool_close():
+ *
+ * Throws away the spool, called when $spool is turned off.
+ */
+void dsp_spool_close()
+{
+	dsp_spool_t  *s = &sg_spool;
+
+	if (s->s_file != NULL)
+	{
+		fclose( s->s_file );
+		s->s_file = NULL;
+	}
+
+	s->s_valid = False;
+}
+
+/*
+ * dsp_redisplay():
+ *
+ * Displays the batch held in the spool all over again, in the current
+ * display style, as though it had just come back from the server.  If
+ * nset is greater than zero only the nset'th regular result set (and
+ * any compute results and row count that go with it) is displayed.
+ */
+int dsp_redisplay( output, nset, flags )
+	FILE  *output;
+	int    nset;
+	int    flags;
+{
+	dsp_spool_t  *s = &sg_spool;
+	CS_INT        kind;
+	CS_INT        len;
+	CS_INT        type;
+	char         *p;
+	int           nsets;
+	int           ret;
+
+	if (s->s_file == NULL || !s->s_valid || s->s_pid != (int)getpid())
+	{
+		sqsh_set_error( SQSH_E_EXIST, "No result sets have been spooled (see $spool)" );
+		return DSP_FAIL;
+	}
+
+	if (g_dsp_props.p_style == DSP_META)
+	{
+		sqsh_set_error( SQSH_E_INVAL, "Spooled result sets cannot be displayed in meta style" );
+		return DSP_FAIL;
+	}
+
+	if (spool_map( s ) == -1)
+	{
+		return DSP_FAIL;
+	}
+
+	/*
+	 * Count the regular result sets, so that asking for one that
+	 * isn't there is an error rather than displaying nothing.
+	 */
+	s->s_pos = SPOOL_MAGICLEN;
+	nsets    = 0;
+	while (spool_peek( s, &kind, &p, &len ))
+	{
+		if (kind == SPOOL_RESULT)
+		{
+			memcpy( (void*)&type, (void*)p, sizeof(CS_INT) );
+			if (type == CS_ROW_RESULT)
+				++nsets;
+		}
+		s->s_pos = (p - s->s_map) + len;
+	}
+
+	if (nset > nsets)
+	{
+		spool_unmap( s );
+		sqsh_set_error( SQSH_E_RANGE, "Result set #%d is not in the spool (%d spooled)",
+			nset, nsets );
+		return DSP_FAIL;
+	}
+
+	s->s_mode      = SPOOL_READING;
+	s->s_pos       = SPOOL_MAGICLEN;
+	s->s_type      = 0;
+	s->s_nset      = nset;
+	s->s_set       = 0;
+	s->s_done      = False;
+	s->s_cancelled = False;
+	s->s_row       = NULL;
+	s->s_nbinds    = 0;
+
+	g_dsp_spool = s;
+	ret = dsp_cmd( output, (CS_COMMAND*)NULL, (char*)NULL, flags );
+	g_dsp_spool = NULL;
+
+	s->s_mode = SPOOL_IDLE;
+	spool_forget( s );
+	spool_unmap( s );
+
+	return ret;
+}
+
+/*
+ * The following wrap the CT-Lib calls made by the display styles.
+ * With no spool in use they are nothing more than the CT-Lib call.
+ */
+
+CS_RETCODE dsp_results( cmd, result_type )
+	CS_COMMAND  *cmd;
+	CS_INT      *result_type;
+{
+	CS_RETCODE   r;
+
+	if (g_dsp_spool == NULL)
+		return ct_results( cmd, result_type );
+
+	if (g_dsp_spool->s_mode == SPOOL_READING)
+		return spool_results( g_dsp_spool, result_type );
+
+	r = ct_results( cmd, result_type );
+
+	if (r == CS_SUCCEED)
+		spool_result( g_dsp_spool, cmd, *result_type );
+
+	return r;
+}
+
+CS_RETCODE dsp_fetch( cmd, type, offset, option, rows_read )
+	CS_COMMAND  *cmd;
+	CS_INT       type;
+	CS_INT       offset;
+	CS_INT       option;
+	CS_INT      *rows_read;
+{
+	dsp_spool_t *s = g_dsp_spool;
+	CS_RETCODE   r;
+	CS_INT       nrows;
+	CS_INT       i;
+
+	if (s == NULL)
+		return ct_fetch( cmd, type, offset, option, rows_read );
+
+	if (s->s_mode == SPOOL_READING)
+		return spool_fetch( s, rows_read );
+
+	r = ct_fetch( cmd, type, offset, option, &nrows );
+
+	if (rows_read != NULL)
+		*rows_read = nrows;
+
+	if (s->s_failed || (r != CS_SUCCEED && r != CS_ROW_FAIL))
+		return r;
+
+	/*
+	 * The return status is not bound but read with ct_get_data(),
+	 * which can only be done the once, so it is read here and kept
+	 * for when the display style asks for it.
+	 */
+	if (s->s_type == CS_STATUS_RESULT)
+	{
+		s->s_status    = 0;
+		s->s_statuslen = 0;
+
+		if (ct_get_data( cmd, 1, (CS_VOID*)&s->s_status, CS_SIZEOF(CS_INT),
+		                 &s->s_statuslen ) == CS_FAIL)
+		{
+			return CS_FAIL;
+		}
+
+		i = 1;
+		s->s_reclen = 0;
+		if (spool_add( s, (CS_VOID*)&i, sizeof(CS_INT) ) == 0 &&
+		    spool_add( s, (CS_VOID*)&i, sizeof(CS_INT) ) == 0 &&
+		    spool_add( s, (CS_VOID*)"\0\0", sizeof(CS_SMALLINT) ) == 0 &&
+		    spool_add( s, (CS_VOID*)&s->s_statuslen, sizeof(CS_INT) ) == 0 &&
+		    spool_add( s, (CS_VOID*)&s->s_status, s->s_statuslen ) == 0)
+		{
+			spool_put( s, SPOOL_ROW );
+		}
+
+		return r;
+	}
+
+	for (i = 0; i < ((nrows > 0) ? nrows : 1) && !s->s_failed; i++)
+	{
+		spool_row( s, i );
+	}
+
+	return r;
+}
+
+CS_RETCODE dsp_res_info( cmd, type, buffer, buflen, outlen )
+	CS_COMMAND  *cmd;
+	CS_INT       type;
+	CS_VOID     *buffer;
+	CS_INT       buflen;
+	CS_INT      *outlen;
+{
+	CS_INT       value;
+
+	if (g_dsp_spool == NULL || g_dsp_spool->s_mode != SPOOL_READING)
+		return ct_res_info( cmd, type, buffer, buflen, outlen );
+
+	switch (type)
+	{
+		case CS_NUMDATA:
+			value = g_dsp_spool->s_ncols;
+			break;
+		case CS_ROW_COUNT:
+			value = g_dsp_spool->s_count;
+			break;
+		default:
+			return CS_FAIL;
+	}
+
+	*((CS_INT*)buffer) = value;
+	if (outlen != NULL)
+		*outlen = CS_SIZEOF(CS_INT);
+
+	return CS_SUCCEED;
+}
+
+CS_RETCODE dsp_describe( cmd, item, datafmt )
+	CS_COMMAND  *cmd;
+	CS_INT       item;
+	CS_DATAFMT  *datafmt;
+{
+	if (g_dsp_spool == NULL || g_dsp_spool->s_mode != SPOOL_READING)
+		return ct_describe( cmd, item, datafmt );
+
+	if (item < 1 || item > g_dsp_spool->s_ncols)
+		return CS_FAIL;
+
+	memcpy( (void*)datafmt, (void*)&g_dsp_spool->s_fmts[item-1], sizeof(CS_DATAFMT) );
+	return CS_SUCCEED;
+}
+
+CS_RETCODE dsp_compute_info( cmd, type, colnum, buffer, buflen, outlen )
+	CS_COMMAND  *cmd;
+	CS_INT       type;
+	CS_INT       colnum;
+	CS_VOID     *buffer;
+	CS_INT       buflen;
+	CS_INT      *outlen;
+{
+	dsp_spool_t *s = g_dsp_spool;
+	CS_INT       len = CS_SIZEOF(CS_INT);
+
+	if (s == NULL || s->s_mode != SPOOL_READING)
+		return ct_compute_info( cmd, type, colnum, buffer, buflen, outlen );
+
+	switch (type)
+	{
+		case CS_BYLIST_LEN:
+			*((CS_INT*)buffer) = s->s_nbylist;
+			break;
+		case CS_COMP_BYLIST:
+			len = min( buflen, s->s_nbylist * (CS_INT)sizeof(CS_SMALLINT) );
+			if (len > 0)
+				memcpy( buffer, (void*)s->s_bylist, len );
+			break;
+		case CS_COMP_OP:
+		case CS_COMP_COLID:
+			if (colnum < 1 || colnum > s->s_ncols)
+				return CS_FAIL;
+			*((CS_INT*)buffer) = (type == CS_COMP_OP) ?
+				s->s_ops[colnum-1] : s->s_colids[colnum-1];
+			break;
+		default:
+			return CS_FAIL;
+	}
+
+	if (outlen != NULL)
+		*outlen = len;
+
+	return CS_SUCCEED;
+}
+
+CS_RETCODE dsp_bind( cmd, item, datafmt, buffer, copied, indicator )
+	CS_COMMAND  *cmd;
+	CS_INT       item;
+	CS_DATAFMT  *datafmt;
+	CS_VOID     *buffer;
+	CS_INT      *copied;
+	CS_SMALLINT *indicator;
+{
+	dsp_spool_t *s = g_dsp_spool;
+	dsp_bound_t *b;
+
+	if (s == NULL)
+		return ct_bind( cmd, item, datafmt, buffer, copied, indicator );
+
+	if (s->s_mode == SPOOL_WRITING &&
+	    ct_bind( cmd, item, datafmt, buffer, copied, indicator ) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	if ((b = spool_bound( s, item )) == NULL)
+	{
+		if (s->s_mode == SPOOL_READING)
+			return CS_FAIL;
+
+		spool_fail( s, "Memory allocation failure" );
+		return CS_SUCCEED;
+	}
+
+	memcpy( (void*)&b->b_fmt, (void*)datafmt, sizeof(CS_DATAFMT) );
+	b->b_buf    = buffer;
+	b->b_copied = copied;
+	b->b_ind    = indicator;
+
+	if (b->b_fmt.count < 1)
+		b->b_fmt.count = 1;
+
+	if (s->s_mode == SPOOL_WRITING && !s->s_failed)
+	{
+		s->s_reclen = 0;
+		if (spool_add( s, (CS_VOID*)&item, sizeof(CS_INT) ) == 0 &&
+		    spool_add( s, (CS_VOID*)datafmt, sizeof(CS_DATAFMT) ) == 0)
+		{
+			spool_put( s, SPOOL_BIND );
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+CS_RETCODE dsp_get_data( cmd, item, buffer, buflen, outlen )
+	CS_COMMAND  *cmd;
+	CS_INT       item;
+	CS_VOID     *buffer;
+	CS_INT       buflen;
+	CS_INT      *outlen;
+{
+	dsp_spool_t *s = g_dsp_spool;
+	CS_SMALLINT  ind;
+	CS_INT       len;
+	char        *data;
+
+	if (s == NULL)
+		return ct_get_data( cmd, item, buffer, buflen, outlen );
+
+	if (s->s_mode == SPOOL_WRITING)
+	{
+		if (s->s_type != CS_STATUS_RESULT || item != 1)
+			return ct_get_data( cmd, item, buffer, buflen, outlen );
+
+		len  = s->s_statuslen;
+		data = (char*)&s->s_status;
+	}
+	else if ((data = spool_item( s, item, &ind, &len )) == NULL)
+	{
+		return CS_FAIL;
+	}
+
+	len = min( len, buflen );
+	if (len > 0)
+		memcpy( buffer, (void*)data, len );
+	if (outlen != NULL)
+		*outlen = len;
+
+	return CS_END_DATA;
+}
+
+CS_RETCODE dsp_cancel( con, cmd, type )
+	CS_CONNECTION *con;
+	CS_COMMAND    *cmd;
+	CS_INT         type;
+{
+	if (g_dsp_spool == NULL || g_dsp_spool->s_mode != SPOOL_READING)
+		return ct_cancel( con, cmd, type );
+
+	if (type == CS_CANCEL_CURRENT)
+		g_dsp_spool->s_cancelled = True;
+	else
+		g_dsp_spool->s_done = True;
+
+	return CS_SUCCEED;
+}
+
+/*
+ * dsp_tmpfile():
+ *
+ * Creates a scratch file called sqsh-<what>.XXXXXX in $tmp_dir, for
+ * the spool or for the runs of dsp_sort.c.  The name is made unique
+ * by mkstemp(), which also refuses to follow anything already planted
+ * there.  It is removed straight away, so that it goes when sqsh does,
+ * however sqsh goes.
+ */
+FILE* dsp_tmpfile( what )
+	char        *what;
+{
+	char         path[SQSH_MAXPATH+1];
+	char        *tmp_dir;
+	varbuf_t    *exp_buf = NULL;
+	FILE        *f;
+	int          fd;
+
+	env_get( g_env, "tmp_dir", &tmp_dir );
+
+	if (tmp_dir == NULL || *tmp_dir == '\0')
+		tmp_dir = SQSH_TMP;
+	else
+	{
+		if ((exp_buf = varbuf_create( 512 )) == NULL)
+		{
+			fprintf( stderr, "dsp_tmpfile: %s\n", sqsh_get_errstr() );
+			return NULL;
+		}
+		if (sqsh_expand( tmp_dir, exp_buf, 0 ) == False)
+			tmp_dir = SQSH_TMP;
+		else
+			tmp_dir = varbuf_getstr( exp_buf );
+	}
+
+	sprintf( path, "%.*s/sqsh-%.8s.XXXXXX", SQSH_MAXPATH - 32, tmp_dir, what );
+	if (exp_buf != NULL)
+		varbuf_destroy( exp_buf );
+
+	if ((fd = mkstemp( path )) == -1)
+	{
+		fprintf( stderr, "dsp_tmpfile: %s: %s\n", path, strerror( errno ) );
+		return NULL;
+	}
+
+	unlink( path );
+
+	if ((f = fdopen( fd, "w+" )) == NULL)
+	{
+		fprintf( stderr, "dsp_tmpfile: %s: %s\n", path, strerror( errno ) );
+		close( fd );
+		return NULL;
+	}
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_tmpfile: Created %s\n", path);)
+
+	return f;
+}
+
+/*
+ * PRIVATE FUNCTIONS
+ */
+
+/*
+ * spool_add():
+ *
+ * Appends len bytes to the record being put together.
+ */
+static int spool_add( s, data, len )
+	dsp_spool_t *s;
+	CS_VOID     *data;
+	CS_INT       len;
+{
+	char        *rec;
+	int          max;
+
+	if (s->s_reclen + len > s->s_recmax)
+	{
+		max = max( s->s_reclen + len, s->s_recmax * 2 );
+		max = max( max, 1024 );
+
+		if ((rec = (char*)realloc( s->s_rec, max )) == NULL)
+		{
+			spool_fail( s, "Memory allocation failure" );
+			return -1;
+		}
+
+		s->s_rec    = rec;
+		s->s_recmax = max;
+	}
+
+	if (len > 0)
+		memcpy( (void*)(s->s_rec + s->s_reclen), data, len );
+	s->s_reclen += len;
+
+	return 0;
+}
+
+/*
+ * spool_put():
+ *
+ * Writes the record put together with spool_add() to the spool.
+ */
+static int spool_put( s, kind )
+	dsp_spool_t *s;
+	CS_INT       kind;
+{
+	CS_INT       len = s->s_reclen;
+
+	if (s->s_failed)
+		return -1;
+
+	if (fwrite( (void*)&kind, sizeof(CS_INT), 1, s->s_file ) != 1 ||
+	    fwrite( (void*)&len, sizeof(CS_INT), 1, s->s_file ) != 1 ||
+	    (len > 0 && fwrite( (void*)s->s_rec, len, 1, s->s_file ) != 1))
+	{
+		spool_fail( s, strerror( errno ) );
+		return -1;
+	}
+
+	s->s_reclen = 0;
+	return 0;
+}
+
+/*
+ * spool_fail():
+ *
+ * Gives up on spooling the rest of the batch, which carries on being
+ * displayed regardless.
+ */
+static void spool_fail( s, reason )
+	dsp_spool_t *s;
+	char        *reason;
+{
+	if (!s->s_failed)
+	{
+		fprintf( stderr, "dsp_spool: Result sets will not be spooled: %s\n", reason );
+		s->s_failed = True;
+	}
+}
+
+/*
+ * spool_result():
+ *
+ * Spools the fact that a result of result_type has come back, along
+ * with the description of its columns if it has any.
+ */
+static void spool_result( s, cmd, result_type )
+	dsp_spool_t *s;
+	CS_COMMAND  *cmd;
+	CS_INT       result_type;
+{
+	CS_INT       count = CS_NO_COUNT;
+	CS_INT       ncols = 0;
+	CS_INT       nbylist = 0;
+	CS_SMALLINT *bylist = NULL;
+	CS_DATAFMT   fmt;
+	CS_INT       op;
+	CS_INT       colid;
+	CS_INT       i;
+
+	s->s_type   = result_type;
+	s->s_nbinds = 0;
+
+	if (s->s_failed)
+		return;
+
+	if (result_type == CS_CMD_DONE &&
+	    ct_res_info( cmd, CS_ROW_COUNT, (CS_VOID*)&count, CS_UNUSED,
+	                 (CS_INT*)NULL ) != CS_SUCCEED)
+	{
+		count = CS_NO_COUNT;
+	}
+
+	s->s_reclen = 0;
+	if (spool_add( s, (CS_VOID*)&result_type, sizeof(CS_INT) ) == -1 ||
+	    spool_add( s, (CS_VOID*)&count, sizeof(CS_INT) ) == -1 ||
+	    spool_put( s, SPOOL_RESULT ) == -1)
+	{
+		return;
+	}
+
+	if (result_type != CS_ROW_RESULT && result_type != CS_CURSOR_RESULT &&
+	    result_type != CS_PARAM_RESULT && result_type != CS_COMPUTE_RESULT)
+	{
+		return;
+	}
+
+	if (ct_res_info( cmd, CS_NUMDATA, (CS_VOID*)&ncols, CS_UNUSED,
+	                 (CS_INT*)NULL ) != CS_SUCCEED)
+	{
+		spool_fail( s, "Unable to retrieve column count" );
+		return;
+	}
+
+	if (result_type == CS_COMPUTE_RESULT)
+	{
+		if (ct_compute_info( cmd, CS_BYLIST_LEN, CS_UNUSED, (CS_VOID*)&nbylist,
+		                     CS_UNUSED, (CS_INT*)NULL ) != CS_SUCCEED)
+		{
+			spool_fail( s, "Unable to retrieve by-list length" );
+			return;
+		}
+
+		if (nbylist > 0)
+		{
+			if ((bylist = (CS_SMALLINT*)malloc( sizeof(CS_SMALLINT) * nbylist )) == NULL)
+			{
+				spool_fail( s, "Memory allocation failure" );
+				return;
+			}
+
+			if (ct_compute_info( cmd, CS_COMP_BYLIST, CS_UNUSED, (CS_VOID*)bylist,
+			                     (CS_INT)sizeof(CS_SMALLINT) * nbylist,
+			                     (CS_INT*)NULL ) != CS_SUCCEED)
+			{
+				free( bylist );
+				spool_fail( s, "Unable to retrieve by-list" );
+				return;
+			}
+		}
+	}
+
+	if (spool_add( s, (CS_VOID*)&ncols, sizeof(CS_INT) ) == -1 ||
+	    spool_add( s, (CS_VOID*)&nbylist, sizeof(CS_INT) ) == -1 ||
+	    spool_add( s, (CS_VOID*)bylist, sizeof(CS_SMALLINT) * nbylist ) == -1)
+	{
+		if (bylist != NULL)
+			free( bylist );
+		return;
+	}
+
+	if (bylist != NULL)
+		free( bylist );
+
+	for (i = 1; i <= ncols; i++)
+	{
+		op    = 0;
+		colid = 0;
+
+		if (ct_describe( cmd, i, &fmt ) != CS_SUCCEED ||
+		    (result_type == CS_COMPUTE_RESULT &&
+		     (ct_compute_info( cmd, CS_COMP_OP, i, (CS_VOID*)&op, CS_UNUSED,
+		                       (CS_INT*)NULL ) != CS_SUCCEED ||
+		      ct_compute_info( cmd, CS_COMP_COLID, i, (CS_VOID*)&colid, CS_UNUSED,
+		                       (CS_INT*)NULL ) != CS_SUCCEED)))
+		{
+			spool_fail( s, "Unable to describe result set" );
+			return;
+		}
+
+		fmt.locale = NULL;
+
+		if (spool_add( s, (CS_VOID*)&fmt, sizeof(CS_DATAFMT) ) == -1 ||
+		    spool_add( s, (CS_VOID*)&op, sizeof(CS_INT) ) == -1 ||
+		    spool_add( s, (CS_VOID*)&colid, sizeof(CS_INT) ) == -1)
+		{
+			return;
+		}
+	}
+
+	spool_put( s, SPOOL_DESC );
+}
+
+/*
+ * spool_row():
+ *
+ * Spools row r of the block just fetched into the bound items.
+ */
+static void spool_row( s, r )
+	dsp_spool_t *s;
+	CS_INT       r;
+{
+	dsp_bound_t *b;
+	CS_SMALLINT  ind;
+	CS_INT       len;
+	char        *data;
+	CS_INT       i;
+
+	s->s_reclen = 0;
+	if (spool_add( s, (CS_VOID*)&s->s_nbinds, sizeof(CS_INT) ) == -1)
+		return;
+
+	for (i = 0; i < s->s_nbinds; i++)
+	{
+		b    = &s->s_binds[i];
+		data = (char*)b->b_buf + (r * b->b_fmt.maxlength);
+		ind  = (b->b_ind != NULL) ? b->b_ind[r] : 0;
+
+		if (ind == -1)
+			len = 0;
+		else if (b->b_copied != NULL)
+			len = b->b_copied[r];
+		else if (b->b_fmt.datatype == CS_CHAR_TYPE &&
+		         (b->b_fmt.format & CS_FMT_NULLTERM) != 0)
+			len = (CS_INT)strlen( data );
+		else
+			len = b->b_fmt.maxlength;
+
+		if (len < 0)
+			len = 0;
+		else if (len > b->b_fmt.maxlength)
+			len = b->b_fmt.maxlength;
+
+		if (spool_add( s, (CS_VOID*)&b->b_item, sizeof(CS_INT) ) == -1 ||
+		    spool_add( s, (CS_VOID*)&ind, sizeof(CS_SMALLINT) ) == -1 ||
+		    spool_add( s, (CS_VOID*)&len, sizeof(CS_INT) ) == -1 ||
+		    spool_add( s, (CS_VOID*)data, len ) == -1)
+		{
+			return;
+		}
+	}
+
+	spool_put( s, SPOOL_ROW );
+}
+
+/*
+ * spool_bound():
+ *
+ * Returns the entry for item in the list of bound items, adding one
+ * if it isn't there yet.
+ */
+static dsp_bound_t* spool_bound( s, item )
+	dsp_spool_t *s;
+	CS_INT       item;
+{
+	dsp_bound_t *binds;
+	int          i;
+
+	for (i = 0; i < s->s_nbinds; i++)
+	{
+		if (s->s_binds[i].b_item == item)
+			return &s->s_binds[i];
+	}
+
+	if (s->s_nbinds == s->s_maxbinds)
+	{
+		binds = (dsp_bound_t*)realloc( (void*)s->s_binds,
+			sizeof(dsp_bound_t) * (s->s_maxbinds + 16) );
+
+		if (binds == NULL)
+			return NULL;
+
+		s->s_binds     = binds;
+		s->s_maxbinds += 16;
+	}
+
+	s->s_binds[s->s_nbinds].b_item = item;
+	return &s->s_binds[s->s_nbinds++];
+}
+
+/*
+ * spool_map():
+ *
+ * Makes the contents of the spool available in s_map, mapping it
+ * into memory where possible.
+ */
+static int spool_map( s )
+	dsp_spool_t *s;
+{
+	struct stat  st;
+	int          fd;
+	long         n;
+	int          r;
+
+	fd = fileno( s->s_file );
+
+	if (fflush( s->s_file ) != 0 || fstat( fd, &st ) == -1)
+	{
+		sqsh_set_error( errno, "Unable to read spool: %s", strerror( errno ) );
+		return -1;
+	}
+
+	s->s_len    = (long)st.st_size;
+	s->s_mapped = False;
+
+	if (s->s_len < SPOOL_MAGICLEN)
+	{
+		sqsh_set_error( SQSH_E_EXIST, "Spool is empty" );
+		return -1;
+	}
+
+#if defined(HAVE_MMAP)
+	s->s_map = (char*)mmap( NULL, (size_t)s->s_len, PROT_READ, MAP_SHARED, fd, (off_t)0 );
+
+	if (s->s_map != (char*)MAP_FAILED)
+	{
+		s->s_mapped = True;
+		return 0;
+	}
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "spool_map: mmap() failed: %s\n",
+		strerror( errno ));)
+#endif
+
+	/*
+	 * Without mmap() the spool is simply read into memory.
+	 */
+	if ((s->s_map = (char*)malloc( s->s_len )) == NULL)
+	{
+		sqsh_set_error( SQSH_E_NOMEM, NULL );
+		return -1;
+	}
+
+	if (lseek( fd, (off_t)0, SEEK_SET ) == -1)
+	{
+		sqsh_set_error( errno, "Unable to read spool: %s", strerror( errno ) );
+		spool_unmap( s );
+		return -1;
+	}
+
+	for (n = 0; n < s->s_len; n += r)
+	{
+		r = read( fd, s->s_map + n, s->s_len - n );
+
+		if (r == -1 && errno == EINTR)
+		{
+			r = 0;
+		}
+		else if (r <= 0)
+		{
+			sqsh_set_error( errno, "Unable to read spool: %s",
+				(r == 0) ? "Unexpected end of file" : strerror( errno ) );
+			spool_unmap( s );
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void spool_unmap( s )
+	dsp_spool_t *s;
+{
+	if (s->s_map == NULL)
+		return;
+
+#if defined(HAVE_MMAP)
+	if (s->s_mapped)
+		munmap( (void*)s->s_map, (size_t)s->s_len );
+	else
+#endif
+		free( s->s_map );
+
+	s->s_map = NULL;
+	s->s_len = 0;
+}
+
+/*
+ * spool_peek():
+ *
+ * Looks at the record at s_pos, returning False if there are no more
+ * (a record cut short is treated as the end of the spool).
+ */
+static int spool_peek( s, kind, payload, len )
+	dsp_spool_t *s;
+	CS_INT      *kind;
+	char       **payload;
+	CS_INT      *len;
+{
+	if (s->s_pos + (long)(2 * sizeof(CS_INT)) > s->s_len)
+		return False;
+
+	memcpy( (void*)kind, (void*)(s->s_map + s->s_pos), sizeof(CS_INT) );
+	memcpy( (void*)len, (void*)(s->s_map + s->s_pos + sizeof(CS_INT)), sizeof(CS_INT) );
+
+	if (*len < 0 || s->s_pos + (long)(2 * sizeof(CS_INT)) + *len > s->s_len)
+		return False;
+
+	*payload = s->s_map + s->s_pos + 2 * sizeof(CS_INT);
+	return True;
+}
+
+/*
+ * spool_results():
+ *
+ * ct_results() for a spool being replayed: moves on to the next
+ * result spooled, skipping any rows of the current one that weren't
+ * fetched.
+ */
+static CS_RETCODE spool_results( s, result_type )
+	dsp_spool_t *s;
+	CS_INT      *result_type;
+{
+	CS_INT       kind;
+	CS_INT       len;
+	CS_INT       type;
+	char        *p;
+
+	for (;;)
+	{
+		if (s->s_done || !spool_peek( s, &kind, &p, &len ))
+		{
+			return CS_END_RESULTS;
+		}
+
+		s->s_pos = (p - s->s_map) + len;
+
+		if (kind != SPOOL_RESULT)
+			continue;
+
+		memcpy( (void*)&type, (void*)p, sizeof(CS_INT) );
+		memcpy( (void*)&s->s_count, (void*)(p + sizeof(CS_INT)), sizeof(CS_INT) );
+
+		/*
+		 * When a single result set was asked for, everything up to
+		 * it is skipped, and the row count that follows it is the
+		 * last thing handed out.
+		 */
+		if (s->s_nset > 0)
+		{
+			if (type == CS_ROW_RESULT)
+				++s->s_set;
+
+			if (s->s_set != s->s_nset)
+				continue;
+
+			if (type == CS_CMD_DONE)
+				s->s_done = True;
+		}
+
+		break;
+	}
+
+	s->s_type      = type;
+	s->s_ncols     = 0;
+	s->s_nbylist   = 0;
+	s->s_nbinds    = 0;
+	s->s_row       = NULL;
+	s->s_cancelled = False;
+
+	/*
+	 * The description of the columns and the way they were bound
+	 * follow the result itself.
+	 */
+	while (spool_peek( s, &kind, &p, &len ) &&
+	       (kind == SPOOL_DESC || kind == SPOOL_BIND))
+	{
+		s->s_pos = (p - s->s_map) + len;
+
+		if (kind == SPOOL_DESC)
+		{
+			if (spool_desc( s, p, len ) == -1)
+				return CS_FAIL;
+		}
+		else if (len == (CS_INT)(sizeof(CS_INT) + sizeof(CS_DATAFMT)))
+		{
+			memcpy( (void*)&type, (void*)p, sizeof(CS_INT) );
+
+			if (type >= 1 && type <= s->s_ncols)
+			{
+				memcpy( (void*)&s->s_sfmts[type-1], (void*)(p + sizeof(CS_INT)),
+					sizeof(CS_DATAFMT) );
+				s->s_sbound[type-1] = True;
+			}
+		}
+	}
+
+	*result_type = s->s_type;
+
+	DBG(sqsh_debug(DEBUG_DISPLAY, "spool_results: %s, %d column(s)\n",
+		dsp_result_name( s->s_type ), (int)s->s_ncols);)
+
+	return CS_SUCCEED;
+}
+
+/*
+ * spool_desc():
+ *
+ * Reads a SPOOL_DESC record.
+ */
+static int spool_desc( s, p, len )
+	dsp_spool_t *s;
+	char        *p;
+	CS_INT       len;
+{
+	CS_INT       ncols;
+	CS_INT       nbylist;
+	CS_INT       i;
+	char        *end = p + len;
+
+	if (len < (CS_INT)(2 * sizeof(CS_INT)))
+		goto spool_desc_bad;
+
+	memcpy( (void*)&ncols, (void*)p, sizeof(CS_INT) );
+	memcpy( (void*)&nbylist, (void*)(p + sizeof(CS_INT)), sizeof(CS_INT) );
+	p += 2 * sizeof(CS_INT);
+
+	if (ncols < 0 || nbylist < 0 ||
+	    (long)(end - p) != (long)(nbylist * sizeof(CS_SMALLINT) +
+	         ncols * (sizeof(CS_DATAFMT) + 2 * sizeof(CS_INT))))
+		goto spool_desc_bad;
+
+	spool_forget( s );
+
+	if (ncols > 0)
+	{
+		s->s_fmts   = (CS_DATAFMT*)malloc( sizeof(CS_DATAFMT) * ncols );
+		s->s_sfmts  = (CS_DATAFMT*)malloc( sizeof(CS_DATAFMT) * ncols );
+		s->s_sbound = (int*)malloc( sizeof(int) * ncols );
+		s->s_ops    = (CS_INT*)malloc( sizeof(CS_INT) * ncols );
+		s->s_colids = (CS_INT*)malloc( sizeof(CS_INT) * ncols );
+	}
+	if (nbylist > 0)
+	{
+		s->s_bylist = (CS_SMALLINT*)malloc( sizeof(CS_SMALLINT) * nbylist );
+	}
+
+	if ((ncols > 0 && (s->s_fmts == NULL || s->s_sfmts == NULL ||
+	     s->s_sbound == NULL || s->s_ops == NULL || s->s_colids == NULL)) ||
+	    (nbylist > 0 && s->s_bylist == NULL))
+	{
+		spool_forget( s );
+		fprintf( stderr, "dsp_spool: Memory allocation failure\n" );
+		return -1;
+	}
+
+	if (nbylist > 0)
+		memcpy( (void*)s->s_bylist, (void*)p, sizeof(CS_SMALLINT) * nbylist );
+	p += sizeof(CS_SMALLINT) * nbylist;
+
+	for (i = 0; i < ncols; i++)
+	{
+		memcpy( (void*)&s->s_fmts[i], (void*)p, sizeof(CS_DATAFMT) );
+		p += sizeof(CS_DATAFMT);
+		memcpy( (void*)&s->s_ops[i], (void*)p, sizeof(CS_INT) );
+		p += sizeof(CS_INT);
+		memcpy( (void*)&s->s_colids[i], (void*)p, sizeof(CS_INT) );
+		p += sizeof(CS_INT);
+
+		s->s_fmts[i].locale = NULL;
+		s->s_sbound[i]      = False;
+	}
+
+	s->s_ncols   = ncols;
+	s->s_nbylist = nbylist;
+	return 0;
+
+spool_desc_bad:
+	fprintf( stderr, "dsp_spool: Spool is corrupt\n" );
+	return -1;
+}
+
+/*
+ * spool_fetch():
+ *
+ * ct_fetch() for a spool being replayed: copies as many of the rows
+ * spooled for the current result as the items were bound for into
+ * the bound buffers.
+ */
+static CS_RETCODE spool_fetch( s, rows_read )
+	dsp_spool_t *s;
+	CS_INT      *rows_read;
+{
+	CS_INT       count;
+	CS_INT       kind;
+	CS_INT       len;
+	CS_INT       n;
+	char        *p;
+	int          i;
+
+	count = (s->s_nbinds > 0) ? s->s_binds[0].b_fmt.count : 1;
+
+	for (n = 0; n < count && !s->s_cancelled; n++)
+	{
+		if (!spool_peek( s, &kind, &p, &len ) || kind != SPOOL_ROW)
+			break;
+
+		s->s_pos    = (p - s->s_map) + len;
+		s->s_row    = p;
+		s->s_rowlen = len;
+
+		for (i = 0; i < s->s_nbinds; i++)
+		{
+			spool_fill( s, &s->s_binds[i], n );
+		}
+	}
+
+	if (rows_read != NULL)
+		*rows_read = n;
+
+	return (n == 0) ? CS_END_DATA : CS_SUCCEED;
+}
+
+/*
+ * spool_fill():
+ *
+ * Copies the value of item b from the current spooled row into row r
+ * of its bound buffer, converting it if it was spooled in a different
+ * format than it is bound with now.
+ */
+static void spool_fill( s, b, r )
+	dsp_spool_t *s;
+	dsp_bound_t *b;
+	CS_INT       r;
+{
+	CS_DATAFMT   src;
+	CS_DATAFMT   dst;
+	CS_SMALLINT  ind;
+	CS_INT       len;
+	CS_INT       outlen;
+	char        *data;
+	char        *buf;
+	int          nullterm;
+
+	buf      = (char*)b->b_buf + (r * b->b_fmt.maxlength);
+	nullterm = (b->b_fmt.datatype == CS_CHAR_TYPE &&
+	            (b->b_fmt.format & CS_FMT_NULLTERM) != 0);
+
+	data = spool_item( s, b->b_item, &ind, &len );
+
+	if (data != NULL && ind != -1)
+	{
+		/*
+		 * The spooled format is the one the item was bound with when
+		 * it was fetched, or its own if it wasn't bound at all.
+		 */
+		if (b->b_item <= s->s_ncols && s->s_sbound[b->b_item-1])
+			memcpy( (void*)&src, (void*)&s->s_sfmts[b->b_item-1], sizeof(CS_DATAFMT) );
+		else if (b->b_item <= s->s_ncols)
+			memcpy( (void*)&src, (void*)&s->s_fmts[b->b_item-1], sizeof(CS_DATAFMT) );
+		else
+			data = NULL;
+	}
+
+	if (data == NULL || ind == -1)
+	{
+		if (b->b_ind != NULL)
+			b->b_ind[r] = -1;
+		if (b->b_copied != NULL)
+			b->b_copied[r] = 0;
+		if (nullterm && b->b_fmt.maxlength > 0)
+			*buf = '\0';
+		return;
+	}
+
+	if (src.datatype == b->b_fmt.datatype && src.format == b->b_fmt.format)
+	{
+		outlen = min( len, b->b_fmt.maxlength - (nullterm ? 1 : 0) );
+		if (outlen > 0)
+			memcpy( (void*)buf, (void*)data, outlen );
+		if (nullterm)
+			buf[outlen] = '\0';
+	}
+	else
+	{
+		src.maxlength = len;
+		src.count     = 1;
+		src.locale    = NULL;
+		memcpy( (void*)&dst, (void*)&b->b_fmt, sizeof(CS_DATAFMT) );
+		dst.count     = 1;
+
+		if (g_context == NULL ||
+		    cs_convert( g_context, &src, (CS_VOID*)data, &dst, (CS_VOID*)buf,
+		                &outlen ) != CS_SUCCEED)
+		{
+			DBG(sqsh_debug(DEBUG_DISPLAY,
+				"spool_fill: Conversion of item %d (type %d -> %d) failed\n",
+				(int)b->b_item, (int)src.datatype, (int)dst.datatype);)
+
+			ind    = -1;
+			outlen = 0;
+			if (nullterm && b->b_fmt.maxlength > 0)
+				*buf = '\0';
+		}
+	}
+
+	if (b->b_ind != NULL)
+		b->b_ind[r] = ind;
+	if (b->b_copied != NULL)
+		b->b_copied[r] = outlen;
+}
+
+/*
+ * spool_item():
+ *
+ * Finds item in the current spooled row, returning its data, NULL
+ * indicator and length, or NULL if the item wasn't spooled.
+ */
+static char* spool_item( s, item, ind, len )
+	dsp_spool_t *s;
+	CS_INT       item;
+	CS_SMALLINT *ind;
+	CS_INT      *len;
+{
+	char        *p;
+	char        *end;
+	CS_INT       nitems;
+	CS_INT       this;
+	CS_INT       i;
+
+	if (s->s_row == NULL || s->s_rowlen < (CS_INT)sizeof(CS_INT))
+		return NULL;
+
+	p   = s->s_row;
+	end = s->s_row + s->s_rowlen;
+
+	memcpy( (void*)&nitems, (void*)p, sizeof(CS_INT) );
+	p += sizeof(CS_INT);
+
+	for (i = 0; i < nitems; i++)
+	{
+		if (end - p < (long)(2 * sizeof(CS_INT) + sizeof(CS_SMALLINT)))
+			return NULL;
+
+		memcpy( (void*)&this, (void*)p, sizeof(CS_INT) );
+		p += sizeof(CS_INT);
+		memcpy( (void*)ind, (void*)p, sizeof(CS_SMALLINT) );
+		p += sizeof(CS_SMALLINT);
+		memcpy( (void*)len, (void*)p, sizeof(CS_INT) );
+		p += sizeof(CS_INT);
+
+		if (*len < 0 || end - p < (long)*len)
+			return NULL;
+
+		if (this == item)
+			return p;
+
+		p += *len;
+	}
+
+	return NULL;
+}
+
+/*
+ * spool_forget():
+ *
+ * Frees the description of the current result set.
+ */
+static void spool_forget( s )
+	dsp_spool_t *s;
+{
+	if (s->s_fmts != NULL)
+		free( s->s_fmts );
+	if (s->s_sfmts != NULL)
+		free( s->s_sfmts );
+	if (s->s_sbound != NULL)
+		free( s->s_sbound );
+	if (s->s_ops != NULL)
+		free( s->s_ops );
+	if (s->s_colids != NULL)
+		free( s->s_colids );
+	if (s->s_bylist != NULL)
+		free( s->s_bylist );
+
+	s->s_fmts    = NULL;
+	s->s_sfmts   = NULL;
+	s->s_sbound  = NULL;
+	s->s_ops     = NULL;
+	s->s_colids  = NULL;
+	s->s_bylist  = NULL;
+	s->s_ncols   = 0;
+	s->s_nbylist = 0;
+}
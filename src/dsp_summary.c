@@ -0,0 +1,818 @@
+/*
+ * dsp_summary.c - Display a profile of each column of a result set
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include "sqsh_config.h"
+#include "sqsh_error.h"
+#include "sqsh_global.h"
+#include "sqsh_debug.h"
+#include "dsp.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: dsp_summary.c,v 1.1 2026/10/18 00:00:00 sqsh Exp $";
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*
+ * sqsh-3.0: Rather than the rows of a result set, the summary style
+ * displays a line for each of its columns: how many values and NULLs
+ * it has, its smallest and largest value, the average of a numeric
+ * column, the shortest and longest string of a character column and
+ * roughly how many distinct values there are.  The figures are kept
+ * up to date as the rows are fetched, on the values as they were
+ * bound (dsp_desc_fetch() is told to leave them unformatted), so the
+ * memory used is the same whatever the number of rows.  Only the
+ * smallest and largest values are ever turned into strings.
+ *
+ * The distinct values are counted with a HyperLogLog sketch of
+ * SUMM_HLL_BITS bits, 2^SUMM_HLL_BITS one byte registers per column,
+ * which is accurate to within about 1.04/sqrt(2^SUMM_HLL_BITS), or
+ * 0.8%.
+ */
+#define SUMM_HLL_BITS    14
+#define SUMM_HLL_SIZE    (1 << SUMM_HLL_BITS)
+
+/*-- Longest min/max value displayed --*/
+#define SUMM_MAXWIDTH    40
+
+/*-- Figures displayed for each column, after its name --*/
+#define SUMM_NCELLS      8
+#define SUMM_CELLMAX     (SUMM_MAXWIDTH + 8)
+
+/*-- What is worked out for a column --*/
+#define SUMM_OTHER       0      /* Min and max only */
+#define SUMM_NUMBER      1      /* Native number, averaged */
+#define SUMM_DECIMAL     2      /* NUMERIC/DECIMAL string, averaged */
+#define SUMM_STRING      3      /* String, with lengths */
+
+#if defined(CS_BIGINT_TYPE)
+typedef CS_UBIGINT          summ_u64_t;
+#else
+typedef unsigned long long  summ_u64_t;
+#endif
+
+typedef struct summ_col_st {
+	int          sc_kind;       /* SUMM_NUMBER, etc. */
+	int          sc_numlen;     /* Native NUMERIC, bytes of digits */
+	long         sc_count;      /* Non-NULL values */
+	long         sc_nulls;      /* NULL values */
+	double       sc_sum;        /* Numbers, total of the values */
+	CS_INT       sc_size;       /* Bytes allocated for sc_min and sc_max */
+	CS_VOID     *sc_min;        /* Smallest value so far */
+	CS_INT       sc_minlen;
+	CS_VOID     *sc_max;        /* Largest value so far */
+	CS_INT       sc_maxlen;
+	CS_INT       sc_shortest;   /* Strings, shortest length */
+	CS_INT       sc_longest;    /* Strings, longest length */
+	unsigned char *sc_hll;      /* HyperLogLog registers */
+} summ_col_t;
+
+static char *sg_summ_head[SUMM_NCELLS + 1] = {
+	"column", "count", "nulls", "distinct", "min", "max", "avg",
+	"minlen", "maxlen"
+};
+
+/*-- Prototypes --*/
+static int    summ_kind    _ANSI_ARGS(( dsp_col_t* ));
+static void   summ_add     _ANSI_ARGS(( dsp_col_t*, summ_col_t* ));
+static int    summ_cmp     _ANSI_ARGS(( dsp_col_t*, summ_col_t*, CS_VOID*, CS_INT, CS_VOID*, CS_INT ));
+static int    summ_deccmp  _ANSI_ARGS(( char*, char* ));
+static double summ_number  _ANSI_ARGS(( dsp_col_t* ));
+static void   summ_hll_add _ANSI_ARGS(( unsigned char*, CS_BYTE*, CS_INT ));
+static double summ_hll_est _ANSI_ARGS(( unsigned char* ));
+static void   summ_value   _ANSI_ARGS(( dsp_col_t*, summ_col_t*, CS_VOID*, CS_INT, char* ));
+static int    summ_display _ANSI_ARGS(( dsp_out_t*, dsp_desc_t*, summ_col_t*, int ));
+static void   summ_free    _ANSI_ARGS(( summ_col_t*, int ));
+
+/*
+ * dsp_summary:
+ *
+ * Fetches every result set and displays the profile of each of its
+ * columns once it has been read to the end.
+ */
+int dsp_summary( output, cmd, flags )
+	dsp_out_t   *output;
+	CS_COMMAND  *cmd;
+	int          flags;
+{
+	CS_INT       result_type;  /* Current result set type */
+	CS_INT       ret;          /* ct_results return code */
+	CS_INT       nrows;        /* Number of rows fetch */
+	dsp_desc_t  *desc;         /* Result set description */
+	summ_col_t  *scols;        /* Figures for each column */
+	dsp_col_t   *col;
+	int          nsets = 0;
+	int          r;
+	int          i;
+
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
+	{
+		if (g_dsp_interrupted)
+			return DSP_INTERRUPTED;
+
+		if (ret != CS_SUCCEED)
+			return DSP_FAIL;
+
+		switch (result_type)
+		{
+			case CS_STATUS_RESULT:
+				while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+				                         &nrows )) == CS_SUCCEED);
+
+				if (ret != CS_END_DATA)
+				{
+					return DSP_FAIL;
+				}
+				break;
+
+			case CS_PARAM_RESULT:
+			case CS_ROW_RESULT:
+			case CS_COMPUTE_RESULT:
+				if (result_type == CS_PARAM_RESULT &&
+				    g_dsp_props.p_outputparms == 0)
+				{
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					                         &nrows )) == CS_SUCCEED);
+
+					if (ret != CS_END_DATA)
+					{
+						return DSP_FAIL;
+					}
+					break;
+				}
+
+				desc = dsp_desc_bind( cmd, result_type );
+
+				if (desc == NULL)
+					return DSP_FAIL;
+
+				desc->d_raw = True;
+
+				scols = (summ_col_t*)calloc( max( desc->d_ncols, 1 ), sizeof(summ_col_t) );
+				r     = (scols == NULL) ? -1 : 0;
+
+				for (i = 0; r == 0 && i < desc->d_ncols; i++)
+				{
+					col = &desc->d_cols[i];
+
+					scols[i].sc_kind   = summ_kind( col );
+					scols[i].sc_numlen = dsp_numeric_len( col->c_format.precision );
+					scols[i].sc_size   = (col->c_is_native == CS_TRUE) ?
+						col->c_native_size : col->c_data_size;
+					scols[i].sc_min    = malloc( max( scols[i].sc_size, 1 ) );
+					scols[i].sc_max    = malloc( max( scols[i].sc_size, 1 ) );
+					scols[i].sc_hll    = (unsigned char*)calloc( SUMM_HLL_SIZE, 1 );
+
+					if (scols[i].sc_min == NULL || scols[i].sc_max == NULL ||
+					    scols[i].sc_hll == NULL)
+					{
+						r = -1;
+					}
+				}
+
+				if (r == -1)
+				{
+					fprintf( stderr, "dsp_summary: Memory allocation failure\n" );
+					summ_free( scols, desc->d_ncols );
+					dsp_desc_destroy( desc );
+					return DSP_FAIL;
+				}
+
+				DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_summary: Profiling %d column(s)\n",
+					(int)desc->d_ncols);)
+
+				while ((ret = dsp_desc_fetch( cmd, desc )) == CS_SUCCEED)
+				{
+					if (g_dsp_interrupted)
+						break;
+
+					for (i = 0; i < desc->d_ncols; i++)
+						summ_add( &desc->d_cols[i], &scols[i] );
+				}
+
+				if (!g_dsp_interrupted && ret == CS_END_DATA)
+				{
+					if (nsets++ > 0)
+						dsp_fputc( '\n', output );
+
+					r = summ_display( output, desc, scols, flags );
+				}
+
+				summ_free( scols, desc->d_ncols );
+				dsp_desc_destroy( desc );
+
+				if (g_dsp_interrupted)
+					return DSP_INTERRUPTED;
+
+				if (r != 0 || ret != CS_END_DATA)
+				{
+					return DSP_FAIL;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return DSP_SUCCEED;
+}
+
+/*
+ * summ_kind():
+ *
+ * Works out what can be said about col, other than its count and
+ * range.
+ */
+static int summ_kind( col )
+	dsp_col_t   *col;
+{
+	switch (col->c_format.datatype)
+	{
+		case CS_TINYINT_TYPE:
+		case CS_SMALLINT_TYPE:
+		case CS_INT_TYPE:
+		case CS_REAL_TYPE:
+		case CS_FLOAT_TYPE:
+		case CS_BIT_TYPE:
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+#if defined(CS_BIGINT_TYPE)
+		case CS_BIGINT_TYPE:
+#endif
+#if defined(CS_USMALLINT_TYPE)
+		case CS_USMALLINT_TYPE:
+#endif
+#if defined(CS_UINT_TYPE)
+		case CS_UINT_TYPE:
+#endif
+#if defined(CS_UBIGINT_TYPE)
+		case CS_UBIGINT_TYPE:
+#endif
+			return (col->c_is_native == CS_TRUE) ? SUMM_NUMBER : SUMM_OTHER;
+
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			return (col->c_is_native == CS_TRUE) ? SUMM_OTHER : SUMM_DECIMAL;
+
+		case CS_CHAR_TYPE:
+		case CS_LONGCHAR_TYPE:
+		case CS_TEXT_TYPE:
+		case CS_VARCHAR_TYPE:
+		case CS_UNICHAR_TYPE:
+#if defined(CS_UNITEXT_TYPE)
+		case CS_UNITEXT_TYPE:
+#endif
+#if defined(CS_XML_TYPE)
+		case CS_XML_TYPE:
+#endif
+			return SUMM_STRING;
+
+		default:
+			return SUMM_OTHER;
+	}
+}
+
+/*
+ * summ_add():
+ *
+ * Adds the current row of col to the figures in sc.
+ */
+static void summ_add( col, sc )
+	dsp_col_t   *col;
+	summ_col_t  *sc;
+{
+	CS_VOID     *val;
+	CS_INT       len;
+
+	if (col->c_nullind != 0)
+	{
+		++sc->sc_nulls;
+		return;
+	}
+
+	if (col->c_is_native == CS_TRUE)
+	{
+		val = col->c_native;
+		len = min( max( col->c_native_len, 0 ), sc->sc_size );
+	}
+	else
+	{
+		val = (CS_VOID*)col->c_data;
+		len = (CS_INT)strlen( col->c_data );
+	}
+
+	summ_hll_add( sc->sc_hll, (CS_BYTE*)val, len );
+
+	switch (sc->sc_kind)
+	{
+		case SUMM_NUMBER:
+		case SUMM_DECIMAL:
+			sc->sc_sum += summ_number( col );
+			break;
+
+		case SUMM_STRING:
+			if (sc->sc_count == 0 || len < sc->sc_shortest)
+				sc->sc_shortest = len;
+			if (sc->sc_count == 0 || len > sc->sc_longest)
+				sc->sc_longest = len;
+			break;
+
+		default:
+			break;
+	}
+
+	/*
+	 * The strings keep their null terminator.
+	 */
+	if (col->c_is_native != CS_TRUE)
+		len = min( len + 1, sc->sc_size );
+
+	if (sc->sc_count == 0 ||
+	    summ_cmp( col, sc, val, len, sc->sc_min, sc->sc_minlen ) < 0)
+	{
+		memcpy( sc->sc_min, val, len );
+		sc->sc_minlen = len;
+	}
+
+	if (sc->sc_count == 0 ||
+	    summ_cmp( col, sc, val, len, sc->sc_max, sc->sc_maxlen ) > 0)
+	{
+		memcpy( sc->sc_max, val, len );
+		sc->sc_maxlen = len;
+	}
+
+	++sc->sc_count;
+}
+
+/*
+ * summ_cmp():
+ *
+ * Compares two values of col, native values by what they are, the
+ * strings of NUMERIC and DECIMAL columns as numbers and any other
+ * string byte by byte.
+ */
+static int summ_cmp( col, sc, a, la, b, lb )
+	dsp_col_t   *col;
+	summ_col_t  *sc;
+	CS_VOID     *a;
+	CS_INT       la;
+	CS_VOID     *b;
+	CS_INT       lb;
+{
+	int          c;
+
+	if (col->c_is_native == CS_TRUE)
+	{
+		return dsp_native_cmp( col->c_format.datatype, sc->sc_numlen,
+		                       a, la, b, lb );
+	}
+
+	if (sc->sc_kind == SUMM_DECIMAL)
+		return summ_deccmp( (char*)a, (char*)b );
+
+	if ((c = memcmp( a, b, min( la, lb ) )) != 0)
+		return c;
+
+	return la - lb;
+}
+
+/*
+ * summ_deccmp():
+ *
+ * Compares two numbers written out in decimal, such as CT-Lib makes
+ * of NUMERIC and DECIMAL values.
+ */
+static int summ_deccmp( a, b )
+	char        *a;
+	char        *b;
+{
+	char        *ea;
+	char        *eb;
+	int          neg;
+	int          c;
+
+	while (isspace( (int)*a ))
+		++a;
+	while (isspace( (int)*b ))
+		++b;
+
+	neg = (*a == '-');
+	if (neg != (*b == '-'))
+		return neg ? -1 : 1;
+
+	if (*a == '-' || *a == '+')
+		++a;
+	if (*b == '-' || *b == '+')
+		++b;
+
+	while (*a == '0' && isdigit( (int)a[1] ))
+		++a;
+	while (*b == '0' && isdigit( (int)b[1] ))
+		++b;
+
+	/*
+	 * The one with more digits ahead of the radix is the larger,
+	 * otherwise the digits decide, the radix lining up.
+	 */
+	for (ea = a; isdigit( (int)*ea ); ++ea);
+	for (eb = b; isdigit( (int)*eb ); ++eb);
+
+	if ((ea - a) != (eb - b))
+		c = ((ea - a) < (eb - b)) ? -1 : 1;
+	else
+	{
+		while (*a != '\0' && *a == *b)
+		{
+			++a;
+			++b;
+		}
+
+		if (*a == *b)
+			c = 0;
+		else if (*a == '\0')
+			c = (*b == '0' || !isdigit( (int)*b )) ? 0 : -1;
+		else if (*b == '\0')
+			c = (*a == '0' || !isdigit( (int)*a )) ? 0 : 1;
+		else
+			c = (*a < *b) ? -1 : 1;
+	}
+
+	return neg ? -c : c;
+}
+
+/*
+ * summ_number():
+ *
+ * The current value of a numeric column as a double.
+ */
+static double summ_number( col )
+	dsp_col_t   *col;
+{
+	CS_MONEY     m;
+
+	if (col->c_is_native != CS_TRUE)
+		return atof( col->c_data );
+
+	switch (col->c_format.datatype)
+	{
+		case CS_TINYINT_TYPE:
+			return (double)*((CS_TINYINT*)col->c_native);
+		case CS_BIT_TYPE:
+			return (double)*((CS_BIT*)col->c_native);
+		case CS_SMALLINT_TYPE:
+			return (double)*((CS_SMALLINT*)col->c_native);
+		case CS_INT_TYPE:
+			return (double)*((CS_INT*)col->c_native);
+		case CS_REAL_TYPE:
+			return (double)*((CS_REAL*)col->c_native);
+		case CS_FLOAT_TYPE:
+			return (double)*((CS_FLOAT*)col->c_native);
+		case CS_MONEY_TYPE:
+			memcpy( (void*)&m, col->c_native, sizeof(CS_MONEY) );
+			return ((double)m.mnyhigh * 4294967296.0 +
+			        (double)(unsigned long)(CS_UINT)m.mnylow) / 10000.0;
+		case CS_MONEY4_TYPE:
+			return (double)((CS_MONEY4*)col->c_native)->mny4 / 10000.0;
+#if defined(CS_BIGINT_TYPE)
+		case CS_BIGINT_TYPE:
+			return (double)*((CS_BIGINT*)col->c_native);
+#endif
+#if defined(CS_USMALLINT_TYPE)
+		case CS_USMALLINT_TYPE:
+			return (double)*((CS_USMALLINT*)col->c_native);
+#endif
+#if defined(CS_UINT_TYPE)
+		case CS_UINT_TYPE:
+			return (double)*((CS_UINT*)col->c_native);
+#endif
+#if defined(CS_UBIGINT_TYPE)
+		case CS_UBIGINT_TYPE:
+			return (double)*((CS_UBIGINT*)col->c_native);
+#endif
+		default:
+			return 0.0;
+	}
+}
+
+/*
+ * summ_hll_add():
+ *
+ * Adds a value to the HyperLogLog registers hll.  The value is
+ * hashed with 64 bit FNV-1a, with the bits mixed up some more by
+ * the finalizer of MurmurHash3, as FNV alone leaves the top bits
+ * (which pick the register) poorly spread for short values.
+ */
+static void summ_hll_add( hll, p, len )
+	unsigned char *hll;
+	CS_BYTE       *p;
+	CS_INT         len;
+{
+	summ_u64_t     h = (summ_u64_t)0xcbf29ce484222325ULL;
+	summ_u64_t     w;
+	unsigned char  rank;
+
+	while (len-- > 0)
+	{
+		h ^= (summ_u64_t)*p++;
+		h *= (summ_u64_t)0x100000001b3ULL;
+	}
+
+	h ^= h >> 33;
+	h *= (summ_u64_t)0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= (summ_u64_t)0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	/*
+	 * The top bits choose the register, which keeps the longest run
+	 * of leading zeroes seen in the rest.
+	 */
+	w = h << SUMM_HLL_BITS;
+	for (rank = 1; rank <= 64 - SUMM_HLL_BITS &&
+	     (w & ((summ_u64_t)1 << 63)) == 0; ++rank)
+	{
+		w <<= 1;
+	}
+
+	if (rank > hll[h >> (64 - SUMM_HLL_BITS)])
+		hll[h >> (64 - SUMM_HLL_BITS)] = rank;
+}
+
+/*
+ * summ_hll_est():
+ *
+ * The number of distinct values added to hll, estimated as set out
+ * by Flajolet et al, counting the empty registers instead while
+ * they are still plentiful.  A 64 bit hash needs no correction at
+ * the top end.
+ */
+static double summ_hll_est( hll )
+	unsigned char *hll;
+{
+	double       m = (double)SUMM_HLL_SIZE;
+	double       sum = 0.0;
+	double       est;
+	int          zeros = 0;
+	int          i;
+
+	for (i = 0; i < SUMM_HLL_SIZE; i++)
+	{
+		sum += ldexp( 1.0, -(int)hll[i] );
+		if (hll[i] == 0)
+			++zeros;
+	}
+
+	est = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+
+	if (est <= 2.5 * m && zeros > 0)
+		est = m * log( m / (double)zeros );
+
+	return est;
+}
+
+/*
+ * summ_value():
+ *
+ * Writes the value val of col out as it would be displayed to buf,
+ * cut short at SUMM_MAXWIDTH characters.
+ */
+static void summ_value( col, sc, val, len, buf )
+	dsp_col_t   *col;
+	summ_col_t  *sc;
+	CS_VOID     *val;
+	CS_INT       len;
+	char        *buf;
+{
+	char        *str = (char*)val;
+	CS_VOID     *native;
+	CS_INT       native_len;
+	int          n;
+
+	/*
+	 * A native value is handed to the formatter of the column as
+	 * though it had just been fetched.
+	 */
+	if (col->c_is_native == CS_TRUE)
+	{
+		str = "";
+
+		if (col->c_formatter != NULL)
+		{
+			native     = col->c_native;
+			native_len = col->c_native_len;
+
+			col->c_native     = val;
+			col->c_native_len = len;
+			col->c_nullind    = 0;
+
+			if ((*col->c_formatter)( col ) == CS_SUCCEED)
+				str = col->c_data;
+
+			col->c_native     = native;
+			col->c_native_len = native_len;
+		}
+	}
+
+	while (isspace( (int)*str ))
+		++str;
+
+	n = (int)strlen( str );
+
+	if (n > SUMM_MAXWIDTH)
+		sprintf( buf, "%.*s...", SUMM_MAXWIDTH - 3, str );
+	else
+		strcpy( buf, str );
+}
+
+/*
+ * summ_display():
+ *
+ * Displays the figures of every column of desc, a line for each.
+ */
+static int summ_display( output, desc, scols, flags )
+	dsp_out_t   *output;
+	dsp_desc_t  *desc;
+	summ_col_t  *scols;
+	int          flags;
+{
+	char        *cells;
+	char        *cell;
+	char         name[32];
+	summ_col_t  *sc;
+	dsp_col_t   *col;
+	int          width[SUMM_NCELLS + 1];
+	double       est;
+	long         nrows = 0;
+	int          len;
+	int          i;
+	int          j;
+
+	cells = (char*)malloc( max( desc->d_ncols, 1 ) * SUMM_NCELLS * SUMM_CELLMAX );
+
+	if (cells == NULL)
+	{
+		fprintf( stderr, "dsp_summary: Memory allocation failure\n" );
+		return -1;
+	}
+
+	for (j = 0; j <= SUMM_NCELLS; j++)
+		width[j] = ((flags & DSP_F_NOHEADERS) != 0) ? 0 : strlen( sg_summ_head[j] );
+
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		col  = &desc->d_cols[i];
+		sc   = &scols[i];
+		cell = cells + (i * SUMM_NCELLS * SUMM_CELLMAX);
+
+		if (i == 0)
+			nrows = sc->sc_count + sc->sc_nulls;
+
+		len = (col->c_format.namelen > 0) ? col->c_format.namelen :
+			sprintf( name, "col%d", i + 1 );
+		width[0] = max( width[0], len );
+
+		sprintf( cell, "%ld", sc->sc_count );
+		sprintf( cell + SUMM_CELLMAX, "%ld", sc->sc_nulls );
+
+		/*
+		 * There can't be more distinct values than there are values.
+		 */
+		est = summ_hll_est( sc->sc_hll );
+		if (est > (double)sc->sc_count)
+			est = (double)sc->sc_count;
+		sprintf( cell + 2 * SUMM_CELLMAX, "%.0f", est );
+
+		cell[3 * SUMM_CELLMAX] = '\0';
+		cell[4 * SUMM_CELLMAX] = '\0';
+		cell[5 * SUMM_CELLMAX] = '\0';
+		cell[6 * SUMM_CELLMAX] = '\0';
+		cell[7 * SUMM_CELLMAX] = '\0';
+
+		if (sc->sc_count > 0)
+		{
+			summ_value( col, sc, sc->sc_min, sc->sc_minlen, cell + 3 * SUMM_CELLMAX );
+			summ_value( col, sc, sc->sc_max, sc->sc_maxlen, cell + 4 * SUMM_CELLMAX );
+
+			if (sc->sc_kind == SUMM_NUMBER || sc->sc_kind == SUMM_DECIMAL)
+			{
+				sprintf( cell + 5 * SUMM_CELLMAX, "%.*g",
+					max( 1, min( g_dsp_props.p_flt_prec, 17 ) ),
+					sc->sc_sum / (double)sc->sc_count );
+			}
+			else if (sc->sc_kind == SUMM_STRING)
+			{
+				sprintf( cell + 6 * SUMM_CELLMAX, "%d", (int)sc->sc_shortest );
+				sprintf( cell + 7 * SUMM_CELLMAX, "%d", (int)sc->sc_longest );
+			}
+		}
+
+		for (j = 0; j < SUMM_NCELLS; j++)
+			width[j + 1] = max( width[j + 1], (int)strlen( cell + j * SUMM_CELLMAX ) );
+	}
+
+	if ((flags & DSP_F_NOHEADERS) == 0)
+	{
+		for (j = 0; j <= SUMM_NCELLS; j++)
+		{
+			dsp_fprintf( output, (j == 0 || j == 4 || j == 5) ? "%-*s" : "%*s",
+				width[j], sg_summ_head[j] );
+			dsp_fputs( (j < SUMM_NCELLS) ? "  " : "\n", output );
+		}
+
+		for (j = 0; j <= SUMM_NCELLS; j++)
+		{
+			for (len = 0; len < width[j]; len++)
+				dsp_fputc( '-', output );
+			dsp_fputs( (j < SUMM_NCELLS) ? "  " : "\n", output );
+		}
+	}
+
+	for (i = 0; i < desc->d_ncols; i++)
+	{
+		col  = &desc->d_cols[i];
+		cell = cells + (i * SUMM_NCELLS * SUMM_CELLMAX);
+
+		if (col->c_format.namelen > 0)
+			dsp_fprintf( output, "%-*.*s", width[0], (int)col->c_format.namelen,
+				col->c_format.name );
+		else
+		{
+			sprintf( name, "col%d", i + 1 );
+			dsp_fprintf( output, "%-*s", width[0], name );
+		}
+
+		/*
+		 * The min and max are justified the way the column is, the
+		 * figures to the right.
+		 */
+		for (j = 0; j < SUMM_NCELLS; j++)
+		{
+			dsp_fputs( "  ", output );
+			dsp_fprintf( output,
+				((j == 3 || j == 4) && col->c_justification != DSP_JUST_RIGHT) ?
+				"%-*s" : "%*s", width[j + 1], cell + j * SUMM_CELLMAX );
+		}
+		dsp_fputc( '\n', output );
+	}
+
+	if ((flags & DSP_F_NOFOOTERS) == 0)
+	{
+		dsp_fprintf( output, "\n(%ld row%s summarized)\n", nrows,
+			(nrows == 1) ? "" : "s" );
+	}
+
+	free( cells );
+	return 0;
+}
+
+/*
+ * summ_free():
+ *
+ * Frees the figures of ncols columns.
+ */
+static void summ_free( scols, ncols )
+	summ_col_t  *scols;
+	int          ncols;
+{
+	int          i;
+
+	if (scols == NULL)
+		return;
+
+	for (i = 0; i < ncols; i++)
+	{
+		if (scols[i].sc_min != NULL)
+			free( scols[i].sc_min );
+		if (scols[i].sc_max != NULL)
+			free( scols[i].sc_max );
+		if (scols[i].sc_hll != NULL)
+			free( scols[i].sc_hll );
+	}
+
+	free( scols );
+}
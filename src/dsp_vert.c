@@ -76,7 +76,7 @@ int dsp_vert( output, cmd, flags )
 	/*
 	 * Start blasting through result sets...
 	 */
-	while ((ret = ct_results( cmd, &result_type )) != CS_END_RESULTS)
+	while ((ret = dsp_results( cmd, &result_type )) != CS_END_RESULTS)
 	{
 		DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_vert: Result %s\n",
 		               dsp_result_name( result_type ));)
@@ -103,11 +103,11 @@ int dsp_vert( output, cmd, flags )
 				{
 					DBG(sqsh_debug(DEBUG_DISPLAY, "dsp_vert: Fetching affected.\n");)
 
-					if (ct_res_info( cmd,                       /* Command */
-					                 CS_ROW_COUNT,              /* Type */
-					                 (CS_VOID*) &rows_affected, /* Buffer */
-					                 CS_UNUSED,                 /* Buffer Length */
-					                 (CS_INT*)NULL ) != CS_SUCCEED)
+					if (dsp_res_info( cmd,                       /* Command */
+					                  CS_ROW_COUNT,              /* Type */
+					                  (CS_VOID*) &rows_affected, /* Buffer */
+					                  CS_UNUSED,                 /* Buffer Length */
+					                  (CS_INT*)NULL ) != CS_SUCCEED)
 					{
 						DBG(sqsh_debug(DEBUG_DISPLAY, 
 						               "dsp_vert: ct_res_info failed.\n" );)
@@ -118,17 +118,17 @@ int dsp_vert( output, cmd, flags )
 
 			case CS_STATUS_RESULT:
 
-				while ((ret = ct_fetch( cmd,              /* Command */
+				while ((ret = dsp_fetch( cmd,             /* Command */
 				                  CS_UNUSED,        /* Type */
 				                  CS_UNUSED,        /* Offset */
 				                  CS_UNUSED,        /* Option */
 				                  &nrows )) == CS_SUCCEED)
 				{
-					if (ct_get_data( cmd,                      /* Command */
-					                 1,                        /* Item */
-					                 (CS_VOID*)&result_status, /* Buffer */
-					                 CS_SIZEOF(CS_INT),        /* Buffer Length */
-					                 (CS_INT*)NULL ) != CS_END_DATA)
+					if (dsp_get_data( cmd,                      /* Command */
+					                  1,                        /* Item */
+					                  (CS_VOID*)&result_status, /* Buffer */
+					                  CS_SIZEOF(CS_INT),        /* Buffer Length */
+					                  (CS_INT*)NULL ) != CS_END_DATA)
 					{
 						DBG(sqsh_debug(DEBUG_DISPLAY, 
 						               "dsp_vert: ct_get_data failed.\n" );)
@@ -302,7 +302,7 @@ int dsp_vert( output, cmd, flags )
 				if (result_type == CS_PARAM_RESULT &&
 					g_dsp_props.p_outputparms == 0)
 				{
-					while ((ret = ct_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					while ((ret = dsp_fetch( cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
 						&nrows )) == CS_SUCCEED);
 					
 					if (ret != CS_END_DATA)
@@ -0,0 +1,242 @@
+/*
+ * sqsh_hist.c - Log-linear latency histogram
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#include <stdio.h>
+#include "sqsh_config.h"
+#include "sqsh_hist.h"
+#include "sqsh_error.h"
+
+/*-- Current Version --*/
+#if !defined(lint) && !defined(__LINT__)
+static char RCS_Id[] = "$Id: sqsh_hist.c,v 1.1 2026/10/18 00:00:00 sqsh Exp $" ;
+USE(RCS_Id)
+#endif /* !defined(lint) */
+
+/*-- local prototypes --*/
+static int  hist_index   _ANSI_ARGS(( long )) ;
+static long hist_highest _ANSI_ARGS(( int )) ;
+
+/*
+ * PUBLIC FUNCTIONS
+ */
+hist_t* hist_create()
+{
+	hist_t  *h ;
+
+	h = (hist_t*) calloc( 1, sizeof(hist_t) ) ;
+
+	if( h == NULL ) {
+		sqsh_set_error( SQSH_E_NOMEM, NULL ) ;
+		return (hist_t*)NULL ;
+	}
+
+	sqsh_set_error( SQSH_E_NONE, NULL ) ;
+	return h ;
+}
+
+void hist_destroy( h )
+	hist_t  *h ;
+{
+	if( h != NULL )
+		free( h ) ;
+}
+
+/*
+ * hist_record():
+ *
+ * Counts value (which is clipped to 0..HIST_MAXVALUE) in h.
+ */
+void hist_record( h, value )
+	hist_t  *h ;
+	long     value ;
+{
+	if( value < 0 )
+		value = 0 ;
+	else if( value > HIST_MAXVALUE )
+		value = HIST_MAXVALUE ;
+
+	if( h->h_count == 0 || value < h->h_min )
+		h->h_min = value ;
+	if( h->h_count == 0 || value > h->h_max )
+		h->h_max = value ;
+
+	++h->h_count ;
+	h->h_sum += (double)value ;
+	++h->h_counts[hist_index( value )] ;
+}
+
+/*
+ * hist_merge():
+ *
+ * Adds the values recorded in src to those in dst, as though they
+ * had been recorded in dst in the first place.
+ */
+void hist_merge( dst, src )
+	hist_t  *dst ;
+	hist_t  *src ;
+{
+	int      i ;
+
+	if( src->h_count == 0 )
+		return ;
+
+	if( dst->h_count == 0 || src->h_min < dst->h_min )
+		dst->h_min = src->h_min ;
+	if( dst->h_count == 0 || src->h_max > dst->h_max )
+		dst->h_max = src->h_max ;
+
+	dst->h_count += src->h_count ;
+	dst->h_sum   += src->h_sum ;
+
+	for( i = 0; i < HIST_NBUCKETS; i++ )
+		dst->h_counts[i] += src->h_counts[i] ;
+}
+
+/*
+ * hist_percentile():
+ *
+ * Returns the value below which pct percent of the values recorded
+ * fall, to within the precision of the bucket it ends up in (the
+ * highest value of the bucket is returned, but never more than the
+ * largest value recorded).  Returns 0 if nothing has been recorded.
+ */
+long hist_percentile( h, pct )
+	hist_t  *h ;
+	double   pct ;
+{
+	double   target ;
+	long     seen = 0 ;
+	long     value ;
+	int      i ;
+
+	if( h->h_count == 0 )
+		return 0 ;
+
+	if( pct >= 100.0 )
+		return h->h_max ;
+
+	target = (pct / 100.0) * (double)h->h_count ;
+	if( target < 1.0 )
+		target = 1.0 ;
+
+	for( i = 0; i < HIST_NBUCKETS; i++ ) {
+		seen += h->h_counts[i] ;
+
+		if( (double)seen >= target ) {
+			value = hist_highest( i ) ;
+			return (value > h->h_max) ? h->h_max : value ;
+		}
+	}
+
+	return h->h_max ;
+}
+
+/*
+ * hist_dump():
+ *
+ * Writes the percentile distribution of h to f, one line per bucket
+ * holding any values, in the same layout as HdrHistogram's
+ * outputPercentileDistribution() (values in milliseconds), so that
+ * the output of two runs can be compared with the usual tools.
+ * Returns 0 upon success, -1 if the write failed.
+ */
+int hist_dump( h, f )
+	hist_t  *h ;
+	FILE    *f ;
+{
+	long     seen = 0 ;
+	double   pct ;
+	int      i ;
+
+	fprintf( f, "%12s %14s %10s %14s\n\n",
+		"Value", "Percentile", "TotalCount", "1/(1-Percentile)" ) ;
+
+	for( i = 0; i < HIST_NBUCKETS; i++ ) {
+		if( h->h_counts[i] == 0 )
+			continue ;
+
+		seen += h->h_counts[i] ;
+		pct   = (double)seen / (double)h->h_count ;
+
+		if( seen < h->h_count )
+			fprintf( f, "%12.3f %14.12f %10ld %14.2f\n",
+				(double)hist_highest( i ) / 1000.0, pct, seen,
+				1.0 / (1.0 - pct) ) ;
+		else
+			fprintf( f, "%12.3f %14.12f %10ld %14s\n",
+				(double)h->h_max / 1000.0, pct, seen, "inf" ) ;
+	}
+
+	fprintf( f, "#[Mean    = %12.3f, Min            = %12.3f]\n",
+		(h->h_count > 0) ? (h->h_sum / (double)h->h_count) / 1000.0 : 0.0,
+		(double)h->h_min / 1000.0 ) ;
+	fprintf( f, "#[Max     = %12.3f, Total count    = %12ld]\n",
+		(double)h->h_max / 1000.0, h->h_count ) ;
+	fprintf( f, "#[Buckets = %12d, SubBuckets     = %12ld]\n",
+		HIST_MAXBITS - HIST_SUBBITS + 1, HIST_SUBBUCKETS ) ;
+
+	return (ferror( f ) ? -1 : 0) ;
+}
+
+/*
+ * PRIVATE FUNCTIONS
+ */
+
+/*
+ * hist_index():
+ *
+ * The bucket a value is counted in.  The first 2*HIST_SUBBUCKETS
+ * buckets hold a single value each, after that each further run of
+ * HIST_SUBBUCKETS buckets is twice as wide as the one before.
+ */
+static int hist_index( value )
+	long  value ;
+{
+	int   shift = 0 ;
+
+	while( (value >> shift) >= 2 * HIST_SUBBUCKETS )
+		++shift ;
+
+	return (int)(shift * HIST_SUBBUCKETS + (value >> shift)) ;
+}
+
+/*
+ * hist_highest():
+ *
+ * The highest value counted in bucket i.
+ */
+static long hist_highest( i )
+	int   i ;
+{
+	int   shift ;
+	long  sub ;
+
+	if( i < 2 * HIST_SUBBUCKETS )
+		return (long)i ;
+
+	shift = (int)(i / HIST_SUBBUCKETS) - 1 ;
+	sub   = (long)i - (long)shift * HIST_SUBBUCKETS ;
+
+	return ((sub + 1) << shift) - 1 ;
+}
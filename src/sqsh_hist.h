@@ -0,0 +1,59 @@
+/*
+ * sqsh_hist.h - Log-linear latency histogram
+ *
+ * Copyright (C) 1995, 1996 by Scott C. Gray
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, write to the Free Software
+ * Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * You may contact the author :
+ *   e-mail:  gray@voicenet.com
+ *            grays@xtend-tech.com
+ *            gray@xenotropic.com
+ */
+#ifndef sqsh_hist_h_included
+#define sqsh_hist_h_included
+#include "sqsh_config.h"
+
+/*
+ * hist_t: Counts of values (microseconds) in buckets whose width
+ * doubles every HIST_SUBBUCKETS buckets, in the manner of an HDR
+ * histogram.  Values below 2*HIST_SUBBUCKETS are counted exactly, the
+ * rest to within 1/HIST_SUBBUCKETS of their value.  Values above
+ * HIST_MAXVALUE (a little over 35 minutes, so that it fits in a 32 bit
+ * long) are counted as HIST_MAXVALUE.
+ */
+#define HIST_SUBBITS      7
+#define HIST_SUBBUCKETS   (1L << HIST_SUBBITS)
+#define HIST_MAXBITS      31
+#define HIST_MAXVALUE     ((1L << HIST_MAXBITS) - 1)
+#define HIST_NBUCKETS     ((HIST_MAXBITS - HIST_SUBBITS + 1) * HIST_SUBBUCKETS)
+
+typedef struct {
+	long    h_count;                    /* Values recorded */
+	long    h_min;                      /* Smallest value recorded */
+	long    h_max;                      /* Largest value recorded */
+	double  h_sum;                      /* Total of the values recorded */
+	long    h_counts[HIST_NBUCKETS];    /* Values per bucket */
+} hist_t;
+
+/*-- Prototypes --*/
+hist_t*   hist_create      _ANSI_ARGS(( void )) ;
+void      hist_destroy     _ANSI_ARGS(( hist_t* )) ;
+void      hist_record      _ANSI_ARGS(( hist_t*, long )) ;
+void      hist_merge       _ANSI_ARGS(( hist_t*, hist_t* )) ;
+long      hist_percentile  _ANSI_ARGS(( hist_t*, double )) ;
+int       hist_dump        _ANSI_ARGS(( hist_t*, FILE* )) ;
+
+#endif /* sqsh_hist_h_included */
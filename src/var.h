@@ -66,6 +66,18 @@ int var_set_timefmt         _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_set_lconv           _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_set_p2fname         _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_set_csv_nullind     _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_output_flush    _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_fetch_rows      _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_output_pipeline _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_output_compress _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_width_sample    _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_width_overflow  _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_row_limit       _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_batch_row_limit _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_progress        _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_spool           _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_order_by        _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_set_sort_memory     _ANSI_ARGS(( env_t*, char*, char** )) ;
 
 /*-- Retrieval validation functions --*/
 int var_get_date            _ANSI_ARGS(( env_t*, char*, char** )) ;
@@ -87,6 +99,18 @@ int var_get_maxlen          _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_get_datefmt         _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_get_timefmt         _ANSI_ARGS(( env_t*, char*, char** )) ;
 int var_get_csv_nullind     _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_output_flush    _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_fetch_rows      _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_output_pipeline _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_output_compress _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_width_sample    _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_width_overflow  _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_row_limit       _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_batch_row_limit _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_progress        _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_spool           _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_order_by        _ANSI_ARGS(( env_t*, char*, char** )) ;
+int var_get_sort_memory     _ANSI_ARGS(( env_t*, char*, char** )) ;
 
 #ifdef SQSH_INIT
 
@@ -225,6 +249,18 @@ static var_entry_t  sg_var_entry[] = {
     { "clientname",       NULL,          var_set_nullstr,     NULL            },
     { "clienthostname",   NULL,          var_set_nullstr,     NULL            },
     { "clientapplname",   NULL,          var_set_nullstr,     NULL            },
+    { "output_flush",     "auto",        var_set_output_flush, var_get_output_flush},
+    { "fetch_rows",       "1",           var_set_fetch_rows,  var_get_fetch_rows},
+    { "output_pipeline",  "0",           var_set_output_pipeline, var_get_output_pipeline},
+    { "output_compress",  "0",           var_set_output_compress, var_get_output_compress},
+    { "width_sample",     "0",           var_set_width_sample, var_get_width_sample},
+    { "width_overflow",   "wrap",        var_set_width_overflow, var_get_width_overflow},
+    { "row_limit",        "0",           var_set_row_limit,   var_get_row_limit},
+    { "batch_row_limit",  "0",           var_set_batch_row_limit, var_get_batch_row_limit},
+    { "progress",         "0",           var_set_progress,    var_get_progress},
+    { "spool",            "0",           var_set_spool,       var_get_spool},
+    { "order_by",         "",            var_set_order_by,    var_get_order_by},
+    { "sort_memory",      "64",          var_set_sort_memory, var_get_sort_memory},
 } ;
 
 #endif /* SQSH_INIT */
@@ -255,6 +255,22 @@ int var_set_style( env, var_name, var_value )
 	{
 		style = DSP_NONE;
 	}
+	else if (strcasecmp( *var_value, "json" ) == 0)
+	{
+		style = DSP_JSON;
+	}
+	else if (strcasecmp( *var_value, "ndjson" ) == 0)
+	{
+		style = DSP_NDJSON;
+	}
+	else if (strcasecmp( *var_value, "arrow" ) == 0)
+	{
+		style = DSP_ARROW;
+	}
+	else if (strcasecmp( *var_value, "summary" ) == 0)
+	{
+		style = DSP_SUMMARY;
+	}
 	else
 	{
 		sqsh_set_error( SQSH_E_INVAL, "Invalid display style '%s'", *var_value );
@@ -309,6 +325,18 @@ int var_get_style( env, var_name, var_value )
 		case DSP_NONE:
 			*var_value = "none";
 			break;
+		case DSP_JSON:
+			*var_value = "json";
+			break;
+		case DSP_NDJSON:
+			*var_value = "ndjson";
+			break;
+		case DSP_ARROW:
+			*var_value = "arrow";
+			break;
+		case DSP_SUMMARY:
+			*var_value = "summary";
+			break;
 		default:
 			*var_value = "horizontal";
 			break;
@@ -804,3 +832,607 @@ int var_get_csv_nullind( env, var_name, var_value )
 	return True ;
 }
 
+
+/*
+ * sqsh-3.0 - Output flush policy of the display sub-system, one of
+ * "auto", "line" or "full".
+ */
+int var_set_output_flush( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  flush;
+
+	if (*var_value == NULL || strcasecmp( *var_value, "auto" ) == 0)
+	{
+		flush = DSP_FLUSH_AUTO;
+	}
+	else if (strcasecmp( *var_value, "line" ) == 0)
+	{
+		flush = DSP_FLUSH_LINE;
+	}
+	else if (strcasecmp( *var_value, "full" ) == 0)
+	{
+		flush = DSP_FLUSH_FULL;
+	}
+	else
+	{
+		sqsh_set_error( SQSH_E_INVAL, "Invalid output flush policy '%s'", *var_value );
+		return False;
+	}
+
+	if (dsp_prop( DSP_SET, DSP_FLUSH, (void*)&flush, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN,"var_set_output_flush: Output flush policy now set to %s\n",
+		(*var_value == NULL) ? "auto" : *var_value);)
+
+	return True;
+}
+
+int var_get_output_flush( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  flush;
+
+	if (dsp_prop( DSP_GET, DSP_FLUSH, (void*)&flush, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	switch (flush)
+	{
+		case DSP_FLUSH_LINE:
+			*var_value = "line";
+			break;
+		case DSP_FLUSH_FULL:
+			*var_value = "full";
+			break;
+		default:
+			*var_value = "auto";
+			break;
+	}
+
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Number of rows bound per ct_fetch() by the display styles.
+ */
+int var_set_fetch_rows( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  nrows;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	nrows = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_FETCH_ROWS, (void*)&nrows, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_fetch_rows: Fetch array size now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_fetch_rows( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   nrows;
+
+	if (dsp_prop( DSP_GET, DSP_FETCH_ROWS, (void*)&nrows, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", nrows );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Number of output buffers the display styles may queue up for a
+ * separate writer thread, 0 to do the writing in-line.
+ */
+int var_set_output_pipeline( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  nbufs;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	nbufs = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_PIPELINE, (void*)&nbufs, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_output_pipeline: Pipeline buffers now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_output_pipeline( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   nbufs;
+
+	if (dsp_prop( DSP_GET, DSP_PIPELINE, (void*)&nbufs, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", nbufs );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * gzip compression level of the display output, 0 to write it
+ * uncompressed.
+ */
+int var_set_output_compress( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  level;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	level = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_COMPRESS, (void*)&level, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_output_compress: Compression level now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_output_compress( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   level;
+
+	if (dsp_prop( DSP_GET, DSP_COMPRESS, (void*)&level, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", level );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Number of rows the horiz and pretty styles look at before deciding
+ * how wide to make the columns, 0 to go by their declared length.
+ */
+int var_set_width_sample( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  nrows;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	nrows = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_SAMPLE, (void*)&nrows, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_width_sample: Sample rows now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_width_sample( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   nrows;
+
+	if (dsp_prop( DSP_GET, DSP_SAMPLE, (void*)&nrows, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", nrows );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0 - What is done with a value that is wider than the width
+ * sampled for its column, either "wrap" or "truncate".
+ */
+int var_set_width_overflow( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  overflow;
+
+	if (*var_value == NULL || strcasecmp( *var_value, "wrap" ) == 0)
+	{
+		overflow = DSP_OVERFLOW_WRAP;
+	}
+	else if (strcasecmp( *var_value, "truncate" ) == 0)
+	{
+		overflow = DSP_OVERFLOW_TRUNC;
+	}
+	else
+	{
+		sqsh_set_error( SQSH_E_INVAL, "Invalid overflow policy '%s'", *var_value );
+		return False;
+	}
+
+	if (dsp_prop( DSP_SET, DSP_OVERFLOW, (void*)&overflow, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN,"var_set_width_overflow: Overflow policy now set to %s\n",
+		(*var_value == NULL) ? "wrap" : *var_value);)
+
+	return True;
+}
+
+int var_get_width_overflow( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  overflow;
+
+	if (dsp_prop( DSP_GET, DSP_OVERFLOW, (void*)&overflow, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	*var_value = (overflow == DSP_OVERFLOW_TRUNC) ? "truncate" : "wrap";
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Most rows displayed of any one result set, 0 for no limit.
+ */
+int var_set_row_limit( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  nrows;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	nrows = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_ROWLIMIT, (void*)&nrows, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_row_limit: Row limit now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_row_limit( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   nrows;
+
+	if (dsp_prop( DSP_GET, DSP_ROWLIMIT, (void*)&nrows, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", nrows );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Most rows displayed over all of the result sets of a batch, 0 for
+ * no limit.
+ */
+int var_set_batch_row_limit( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  nrows;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	nrows = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_BATCHLIMIT, (void*)&nrows, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_batch_row_limit: Batch row limit now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_batch_row_limit( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   nrows;
+
+	if (dsp_prop( DSP_GET, DSP_BATCHLIMIT, (void*)&nrows, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", nrows );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Seconds between reports of the progress of a batch on stderr, 0 for
+ * no reports.
+ */
+int var_set_progress( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  secs;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	secs = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_PROGRESS, (void*)&secs, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_progress: Progress interval now set to %s\n", *var_value);)
+
+	return True ;
+}
+
+int var_get_progress( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   secs;
+
+	if (dsp_prop( DSP_GET, DSP_PROGRESS, (void*)&secs, DSP_UNUSED) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", secs );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Whether the rows of each batch are kept in the spool for \redisplay.
+ */
+int var_set_spool( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  spool;
+
+	if (var_set_bool( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	spool = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_SPOOL, (void*)&spool, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_spool: Spool now set to %s\n", *var_value);)
+
+	return True;
+}
+
+int var_get_spool( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[4];
+	int   spool;
+
+	if (dsp_prop( DSP_GET, DSP_SPOOL, (void*)&spool, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", spool );
+
+	*var_value = nbr;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * The columns the rows of each result set are sorted on by sqsh
+ * itself, empty for none.
+ */
+int var_set_order_by( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	char  *order_by = "";
+
+	if (var_value != NULL && *var_value != NULL)
+	{
+		order_by = *var_value;
+	}
+
+	if (dsp_prop( DSP_SET, DSP_ORDERBY, (void*)order_by, DSP_NULLTERM ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_order_by: Order by now set to %s\n", order_by);)
+
+	return True;
+}
+
+int var_get_order_by( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char order_by[DSP_ORDERBY_MAXLEN+1];
+
+	if (dsp_prop( DSP_GET, DSP_ORDERBY, (void*)order_by, sizeof(order_by) ) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	*var_value = order_by;
+	return True;
+}
+
+/*
+ * sqsh-3.0
+ * Megabytes of rows a sort may hold before writing them out to
+ * $tmp_dir.
+ */
+int var_set_sort_memory( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	int  mbytes;
+
+	if (var_set_int( env, var_name, var_value ) == False)
+	{
+		return False;
+	}
+
+	mbytes = atoi(*var_value);
+
+	if (dsp_prop( DSP_SET, DSP_SORTMEM, (void*)&mbytes, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		return False;
+	}
+
+	DBG(sqsh_debug(DEBUG_SCREEN, "var_set_sort_memory: Sort memory now set to %s\n", *var_value);)
+
+	return True;
+}
+
+int var_get_sort_memory( env, var_name, var_value )
+	env_t    *env;
+	char     *var_name;
+	char     **var_value;
+{
+	static char nbr[16];
+	int   mbytes;
+
+	if (dsp_prop( DSP_GET, DSP_SORTMEM, (void*)&mbytes, DSP_UNUSED ) != DSP_SUCCEED)
+	{
+		*var_value = NULL;
+		return False;
+	}
+
+	sprintf( nbr, "%d", mbytes );
+
+	*var_value = nbr;
+	return True;
+}
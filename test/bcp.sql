@@ -0,0 +1,107 @@
+#!./sqsh -i
+
+\set t=${tmp_dir}/sqsh_bcp
+
+create table tempdb..bcp_src (
+	id          int           not null,
+	vchar_col   varchar(40)   null,
+	bin_col     varbinary(8)  null,
+	text_col    text          null,
+	int_col     int           null,
+	float_col   float         null,
+	bit_col     bit           not null,
+	dt_col      datetime      null,
+	money_col   money         null,
+	num_col     numeric(12,3) null
+)
+\go
+
+insert tempdb..bcp_src
+select number, replicate('v', number % 40), convert(varbinary(8), number),
+       replicate('t', number), number * 1000 - 500000, number / 3.0,
+       number % 2, dateadd(ms, number * 1003, '20261018'),
+       convert(money, number) / 3, number / 9.0
+  from master..spt_values
+ where type = 'P'
+\go
+
+update tempdb..bcp_src set vchar_col = null, int_col = null, dt_col = null where id % 5 = 0
+\go
+
+select * into tempdb..bcp_native from tempdb..bcp_src where 1 = 0
+select * into tempdb..bcp_char from tempdb..bcp_src where 1 = 0
+\go
+
+select * from tempdb..bcp_src order by id
+\go -m bcp > ${t}.src
+
+\echo "Testing \bcp -o and -f round trip through a native file"
+
+select * from tempdb..bcp_src
+\bcp -o ${t}.dat
+
+\bcp -b 500 -f ${t}.dat tempdb..bcp_native
+
+select * from tempdb..bcp_native order by id
+\go -m bcp > ${t}.native
+
+\if cmp -s ${t}.src ${t}.native
+	\echo "ok   native file round trip"
+\else
+	\echo "FAIL native file round trip"
+\fi
+
+\echo "Testing \bcp -f of the bcp display style output"
+
+select id, vchar_col, bin_col, text_col, int_col, float_col, bit_col,
+       convert(varchar(30), dt_col, 109), money_col, num_col
+  from tempdb..bcp_src
+\go -m bcp > ${t}.chr
+
+\bcp -t '|' -r '|\n' -f ${t}.chr tempdb..bcp_char
+
+select id, vchar_col, bin_col, text_col, int_col, float_col, bit_col,
+       convert(varchar(30), dt_col, 109), money_col, num_col
+  from tempdb..bcp_char
+ order by id
+\go -m bcp > ${t}.char
+
+select id, vchar_col, bin_col, text_col, int_col, float_col, bit_col,
+       convert(varchar(30), dt_col, 109), money_col, num_col
+  from tempdb..bcp_src
+ order by id
+\go -m bcp > ${t}.src
+
+\if cmp -s ${t}.src ${t}.char
+	\echo "ok   character file round trip"
+\else
+	\echo "FAIL character file round trip"
+\fi
+
+\echo "Testing \bcp -p in two streams"
+
+truncate table tempdb..bcp_native
+\go
+
+select * from tempdb..bcp_src where id % 2 = ${bcp_stream} - 1
+\bcp -p 2 tempdb..bcp_native
+
+select * from tempdb..bcp_native order by id
+\go -m bcp > ${t}.native
+
+select * from tempdb..bcp_src order by id
+\go -m bcp > ${t}.src
+
+\if cmp -s ${t}.src ${t}.native
+	\echo "ok   two stream copy"
+\else
+	\echo "FAIL two stream copy"
+\fi
+
+drop table tempdb..bcp_src
+drop table tempdb..bcp_native
+drop table tempdb..bcp_char
+\go
+
+\if rm -f ${t}.src ${t}.dat ${t}.native ${t}.chr ${t}.char
+\fi
@@ -0,0 +1,83 @@
+#!./sqsh -i
+
+\set t=${tmp_dir}/sqsh_display
+
+create table #dsp (
+	id          int           not null,
+	char_col    char(10)      null,
+	vchar_col   varchar(40)   null,
+	bin_col     varbinary(8)  null,
+	tiny_col    tinyint       null,
+	int_col     int           null,
+	real_col    real          null,
+	float_col   float         null,
+	bit_col     bit           not null,
+	dt_col      datetime      null,
+	money_col   money         null,
+	smoney_col  smallmoney    null,
+	num_col     numeric(12,3) null
+)
+\go
+
+insert #dsp
+select number, convert(char(10), number), replicate('v', number % 40),
+       convert(varbinary(8), number), number % 256, number * 1000 - 500000,
+       number / 7.0, number / 3.0, number % 2,
+       dateadd(ms, number * 1003, '20261018'),
+       convert(money, number) / 3, convert(smallmoney, number) / 7,
+       number / 9.0
+  from master..spt_values
+ where type = 'P'
+\go
+
+update #dsp set vchar_col = null, int_col = null, dt_col = null where id % 5 = 0
+\go
+
+\echo "Testing horiz output with and without array fetches"
+
+\set fetch_rows=1
+select * from #dsp order by id
+\go -m horiz -f > ${t}.1
+
+\set fetch_rows=100
+select * from #dsp order by id
+\go -m horiz -f > ${t}.100
+
+\if cmp -s ${t}.1 ${t}.100
+	\echo "ok   horiz identical with \$fetch_rows 1 and 100"
+\else
+	\echo "FAIL horiz identical with \$fetch_rows 1 and 100"
+\fi
+
+\echo "Testing horiz output through the writer thread"
+
+\set output_pipeline=4
+select * from #dsp order by id
+\go -m horiz -f > ${t}.pipe
+\set output_pipeline=0
+
+\if cmp -s ${t}.1 ${t}.pipe
+	\echo "ok   horiz identical with \$output_pipeline"
+\else
+	\echo "FAIL horiz identical with \$output_pipeline"
+\fi
+
+\echo "Testing \redisplay from the spool"
+
+\set spool=1
+select * from #dsp order by id
+\go -m horiz -f > ${t}.go
+
+\redisplay -f -m horiz > ${t}.re
+\set spool=0
+
+\if cmp -s ${t}.go ${t}.re
+	\echo "ok   \redisplay identical to \go"
+\else
+	\echo "FAIL \redisplay identical to \go"
+\fi
+
+\set fetch_rows=1
+
+\if rm -f ${t}.1 ${t}.100 ${t}.pipe ${t}.go ${t}.re
+\fi
@@ -0,0 +1,84 @@
+#!./sqsh -i
+
+\set t=${tmp_dir}/sqsh_json
+
+\echo "Testing json output of two result sets"
+
+select convert(int, -2147483648)        as i,
+       convert(tinyint, 255)            as ti,
+       convert(money, $-1.5)            as m,
+       convert(smallmoney, $0.0001)     as sm,
+       convert(bit, 1)                  as b,
+       convert(float, 0.1)              as f,
+       convert(int, null)               as n,
+       'a"b\c'                          as s
+select 1 as one
+\go -m json > ${t}.json
+
+\if python3 -c 'import json,sys; d=json.load(open(sys.argv[1])); sys.exit(len(d) != 2 or d[1] != [{"one": 1}])' ${t}.json
+	\echo "ok   json is one document holding both result sets"
+\else
+	\echo "FAIL json is one document holding both result sets"
+\fi
+
+\if grep -q -F '{"i":-2147483648,"ti":255,"m":-1.5000,"sm":0.0001,"b":true,"f":0.10000000000000001,"n":null,' ${t}.json
+	\echo "ok   json integers, money, bit and float"
+\else
+	\echo "FAIL json integers, money, bit and float"
+\fi
+
+\if python3 -c 'import json,sys; sys.exit(json.load(open(sys.argv[1]))[0][0]["s"] != "a\"b\\c")' ${t}.json
+	\echo "ok   json string escapes"
+\else
+	\echo "FAIL json string escapes"
+\fi
+
+\echo "Testing json output of a batch without result sets"
+
+declare @x int
+\go -m json > ${t}.json
+
+\if test "`cat ${t}.json`" = "[]"
+	\echo "ok   json empty batch"
+\else
+	\echo "FAIL json empty batch"
+\fi
+
+\echo "Testing ndjson output"
+
+select convert(bigint, -9223372036854775807) as big,
+       convert(money, $922337203685477.5807)  as m
+select 2 as two
+\go -m ndjson > ${t}.ndjson
+
+\if test `wc -l < ${t}.ndjson` -eq 2
+	\echo "ok   ndjson one line per row"
+\else
+	\echo "FAIL ndjson one line per row"
+\fi
+
+\if grep -q -F '{"big":-9223372036854775807,"m":922337203685477.5807}' ${t}.ndjson
+	\echo "ok   ndjson bigint and money"
+\else
+	\echo "FAIL ndjson bigint and money"
+\fi
+
+\echo "Testing arrow output (needs pyarrow)"
+
+select number                           as n,
+       convert(money, number) / 4       as m,
+       dateadd(ss, number, '20260101')  as d,
+       convert(varchar(10), number)     as s
+  from master..spt_values
+ where type = 'P'
+ order by number
+\go -m arrow > ${t}.arrow
+
+\if python3 -c 'import pyarrow as pa,sys; t=pa.ipc.open_stream(open(sys.argv[1],"rb")).read_all(); sys.exit(t.num_rows != 2048 or str(t.column("m")[3]) != "0.7500" or t.column("s")[10].as_py() != "10")' ${t}.arrow
+	\echo "ok   arrow stream read back"
+\else
+	\echo "FAIL arrow stream read back"
+\fi
+
+\if rm -f ${t}.json ${t}.ndjson ${t}.arrow
+\fi
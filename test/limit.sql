@@ -0,0 +1,76 @@
+#!./sqsh -i
+
+\set t=${tmp_dir}/sqsh_limit
+
+create table #lim (n int not null)
+insert #lim values (1)
+insert #lim values (2)
+insert #lim values (3)
+\go
+
+\echo "Testing \go -r with exactly as many rows as the limit"
+
+select n from #lim where n <= 2 order by n
+\go -m bcp -r 2 > ${t}.out 2> ${t}.err
+
+\if test `wc -l < ${t}.out` -eq 2 -a ! -s ${t}.err
+	\echo "ok   exact limit is not reported as cut short"
+\else
+	\echo "FAIL exact limit is not reported as cut short"
+\fi
+
+\echo "Testing \go -r with more rows than the limit"
+
+select n from #lim order by n
+\go -m bcp -r 2 > ${t}.out 2> ${t}.err
+
+\if test `wc -l < ${t}.out` -eq 2
+	\echo "ok   -r 2 displays 2 rows"
+\else
+	\echo "FAIL -r 2 displays 2 rows"
+\fi
+
+\if grep -q "Row limit reached: 2 rows displayed, remainder of 1 result set skipped" ${t}.err
+	\echo "ok   -r 2 reports the result set as cut short"
+\else
+	\echo "FAIL -r 2 reports the result set as cut short"
+\fi
+
+\echo "Testing \go -R over several result sets"
+
+select n from #lim order by n
+select n from #lim order by n
+select n from #lim order by n
+\go -m bcp -R 4 > ${t}.out 2> ${t}.err
+
+\if test "`tr -d '\n' < ${t}.out`" = "1|2|3|1|"
+	\echo "ok   -R 4 stops after 4 rows of the batch"
+\else
+	\echo "FAIL -R 4 stops after 4 rows of the batch"
+\fi
+
+\echo "Testing \go -Z (needs zlib)"
+
+select n, replicate('z', 100) from #lim order by n
+\go -m csv > ${t}.out
+
+select n, replicate('z', 100) from #lim order by n
+\go -m csv -Z 6 > ${t}.gz
+
+\if gzip -t ${t}.gz
+	\echo "ok   -Z 6 writes a gzip member"
+\else
+	\echo "FAIL -Z 6 writes a gzip member"
+\fi
+
+select n, replicate('z', 100) from #lim order by n
+\go -m csv -Z 6 | gzip -dc > ${t}.unz
+
+\if cmp -s ${t}.out ${t}.unz
+	\echo "ok   -Z 6 output unpacks to the plain output"
+\else
+	\echo "FAIL -Z 6 output unpacks to the plain output"
+\fi
+
+\if rm -f ${t}.out ${t}.err ${t}.gz ${t}.unz
+\fi
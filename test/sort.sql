@@ -0,0 +1,56 @@
+#!./sqsh -i
+
+\set t=${tmp_dir}/sqsh_sort
+
+\echo "Testing \go -o against the server's order by, in memory"
+
+select number, type, name from master..spt_values where type = 'P' order by number desc
+\go -m bcp > ${t}.srv
+
+select number, type, name from master..spt_values where type = 'P'
+\go -m bcp -o -number > ${t}.cli
+
+\if cmp -s ${t}.srv ${t}.cli
+	\echo "ok   in memory sort"
+\else
+	\echo "FAIL in memory sort"
+\fi
+
+\echo "Testing \go -o spilling to \$tmp_dir"
+
+\set sort_memory=1
+
+select a.number * 10000 + b.number as n, replicate('x', 200) as pad
+  from master..spt_values a, master..spt_values b
+ where a.type = 'P' and b.type = 'P' and a.number < 100
+ order by n desc
+\go -m bcp > ${t}.srv
+
+select a.number * 10000 + b.number as n, replicate('x', 200) as pad
+  from master..spt_values a, master..spt_values b
+ where a.type = 'P' and b.type = 'P' and a.number < 100
+\go -m bcp -o -n > ${t}.cli
+
+\if cmp -s ${t}.srv ${t}.cli
+	\echo "ok   sort with spill"
+\else
+	\echo "FAIL sort with spill"
+\fi
+
+\echo "Testing \go -o -r keeping the top rows only"
+
+select a.number * 10000 + b.number as n, replicate('x', 200) as pad
+  from master..spt_values a, master..spt_values b
+ where a.type = 'P' and b.type = 'P' and a.number < 100
+\go -m bcp -o -n -r 10 > ${t}.cli 2> /dev/null
+
+\if sh -c "head -10 ${t}.srv | cmp -s - ${t}.cli"
+	\echo "ok   top 10 rows"
+\else
+	\echo "FAIL top 10 rows"
+\fi
+
+\set sort_memory=64
+
+\if rm -f ${t}.srv ${t}.cli
+\fi